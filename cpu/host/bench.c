@@ -0,0 +1,269 @@
+// File: bench.c
+// Project: host
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "app.h"
+
+#define ITERATION (10000)
+
+#define CMD_RD_CPU_V_LSB (0x02)
+#define CMD_SEQ_FOCI_MODE (0x06)
+#define CMD_LIST (0x07)
+#define CMD_CLEAR (0x09)
+#define CMD_ULTRASOUND_CYCLE_CNT (0x0B)
+#define CMD_GLOBAL_PARAMS (0x0C)
+#define CMD_PAUSE (0x0D)
+#define CMD_RESUME (0x0E)
+#define CMD_WRITE_DUTY (0x10)
+#define CMD_WRITE_PHASE (0x11)
+
+#define HEADER_FLAG_APPLY (1 << 0)
+#define HEADER_FLAG_APPLY_AT (1 << 1)
+#define APPLY_TIME_OFFSET (3 + 117)
+
+#define CTRL_FLAGS_ADDR (0xF000)
+#define TR_BANK_SIZE (0x200)
+#define FPGA_INFO_ADDR (0x01)
+#define CYCLE_CNT_ADDR (0x10)
+#define PHASE_OFFSET_ADDR (0x11)
+#define DUTY_SCALE_ADDR (0x12)
+#define APPLY_AT_ADDR (0x13)
+#define SYNC0_CNT_LOAD_ADDR (0x14)
+
+#define CTRL_FLAG_APPLY_AT (0x04)
+#define CTRL_FLAG_SYNC0_LOAD (0x08)
+#define CTRL_FLAG_PAUSE (0x10)
+
+extern RX_STR0 _sRx0;
+extern RX_STR1 _sRx1;
+extern TX_STR _sTx;
+
+extern void recv_ethercat(void);
+extern void init_app(void);
+extern void update(void);
+
+static uint8_t _msg_id = 0;
+
+static void receive(uint8_t cmd, uint8_t flags) {
+  uint8_t *header = (uint8_t *)_sRx1.data;
+  _msg_id = _msg_id == 0xFF ? 1 : _msg_id + 1;
+  header[0] = _msg_id;
+  header[1] = flags;
+  header[2] = cmd;
+  recv_ethercat();
+}
+
+static void set_list(uint8_t n, const uint8_t *cmds, const uint8_t *offsets) {
+  uint8_t i;
+  uint8_t *header = (uint8_t *)_sRx1.data;
+  header[3] = n;
+  for (i = 0; i < n; i++) {
+    header[4 + 2 * i] = cmds[i];
+    header[5 + 2 * i] = offsets[i];
+  }
+}
+
+static void set_apply_time(uint64_t time) {
+  int i;
+  uint8_t *header = (uint8_t *)_sRx1.data;
+  for (i = 0; i < 8; i++) header[APPLY_TIME_OFFSET + i] = (uint8_t)(time >> (8 * i));
+}
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// check the bank which is currently shown by the FPGA
+static int check(uint16_t offset) {
+  int i;
+  uint16_t base = (host_fpga_region[CTRL_FLAGS_ADDR] & 0x01) ? TR_BANK_SIZE : 0;
+  for (i = 0; i < TRANS_NUM; i++)
+    if (host_fpga_region[base + (i << 1) + offset] != _sRx0.data[i]) {
+      fprintf(stderr, "mismatch at transducer %d\n", i);
+      return false;
+    }
+  return true;
+}
+
+static void bench(const char *name, uint8_t cmd, uint8_t flags) {
+  int i;
+  double start, elapsed;
+
+  host_bus_reset_stats();
+  receive(cmd, flags);
+  printf("%-24s stores: %4u, loads: %4u, bus cycles: %4u", name, host_bus_stats.stores, host_bus_stats.loads, host_bus_stats.bus_cycles);
+
+  start = now_ns();
+  for (i = 0; i < ITERATION; i++) receive(cmd, flags);
+  elapsed = now_ns() - start;
+  printf(", %8.1f ns/cmd on host\n", elapsed / ITERATION);
+}
+
+int main(void) {
+  int i;
+
+  init_app();
+
+  for (i = 0; i < TRANS_NUM; i++) _sRx0.data[i] = (uint16_t)rand();
+  receive(CMD_WRITE_DUTY, HEADER_FLAG_APPLY);
+  if (!check(1)) return EXIT_FAILURE;
+  for (i = 0; i < TRANS_NUM; i++) _sRx0.data[i] = (uint16_t)rand();
+  receive(CMD_WRITE_PHASE, 0);
+  receive(CMD_WRITE_DUTY, HEADER_FLAG_APPLY);
+  if (!check(0) || !check(1)) return EXIT_FAILURE;
+  receive(CMD_CLEAR, 0);
+  for (i = 0; i < TRANS_NUM; i++) _sRx0.data[i] = 0;
+  if (!check(0) || !check(1)) return EXIT_FAILURE;
+
+  {
+    // CLEAR, ULTRASOUND_CYCLE_CNT and SEQ_FOCI_MODE in one frame
+    const uint8_t cmds[] = {CMD_CLEAR, CMD_ULTRASOUND_CYCLE_CNT, CMD_SEQ_FOCI_MODE};
+    const uint8_t offsets[] = {0, 0, 1};
+    set_list(3, cmds, offsets);
+    _sRx0.data[0] = 5000;
+    receive(CMD_LIST, 0);
+    if (host_fpga_region[CTRL_FLAGS_ADDR] != (0x01 | 0x02) || host_fpga_region[CTRL_FLAGS_ADDR + CYCLE_CNT_ADDR] != 5000 ||
+        (_sTx.ack >> 8) != _msg_id) {
+      fprintf(stderr, "command list is not executed\n");
+      return EXIT_FAILURE;
+    }
+  }
+  if (host_fpga_region[CTRL_FLAGS_ADDR + PHASE_OFFSET_ADDR] != 0 || host_fpga_region[CTRL_FLAGS_ADDR + DUTY_SCALE_ADDR] != 256) {
+    fprintf(stderr, "global params are not cleared\n");
+    return EXIT_FAILURE;
+  }
+  {
+    // the phase offset is wrapped by the cycle, and the banks are untouched
+    const uint16_t ctrl_flags = host_fpga_region[CTRL_FLAGS_ADDR];
+    _sRx0.data[0] = 5000 + 100;
+    _sRx0.data[1] = 128;
+    receive(CMD_GLOBAL_PARAMS, 0);
+    if (host_fpga_region[CTRL_FLAGS_ADDR + PHASE_OFFSET_ADDR] != 100 || host_fpga_region[CTRL_FLAGS_ADDR + DUTY_SCALE_ADDR] != 128 ||
+        host_fpga_region[CTRL_FLAGS_ADDR] != ctrl_flags || (_sTx.ack >> 8) != _msg_id) {
+      fprintf(stderr, "global params are not written\n");
+      return EXIT_FAILURE;
+    }
+  }
+  host_fpga_region[CTRL_FLAGS_ADDR + FPGA_INFO_ADDR] = 0x01;  // THERMO
+  update();
+  if (_sTx.fpga_info != 0x01 || _sTx.ctrl_flags != (0x01 | 0x02) || _sTx.cycle != 5000 || _sTx.ack_history[0] != _msg_id ||
+      _sTx.ack_history[1] != (uint8_t)(_msg_id - 1)) {
+    fprintf(stderr, "status is not reported\n");
+    return EXIT_FAILURE;
+  }
+
+  {
+    // with the cycle of 5000, SYNC0 fires every 1 ms. The counter is aligned to the index of the next edge, i.e., 11.
+    uint16_t ctrl_flags;
+    host_dc_sys_time = 10500000;
+    _sRx0.data[0] = 5000;
+    receive(CMD_ULTRASOUND_CYCLE_CNT, 0);
+    if (host_fpga_region[CTRL_FLAGS_ADDR + SYNC0_CNT_LOAD_ADDR] != 11 || !(host_fpga_region[CTRL_FLAGS_ADDR] & CTRL_FLAG_SYNC0_LOAD)) {
+      fprintf(stderr, "SYNC0 counter is not aligned\n");
+      return EXIT_FAILURE;
+    }
+
+    // staged until the edge of 15 ms
+    ctrl_flags = host_fpga_region[CTRL_FLAGS_ADDR];
+    set_apply_time(14200000);
+    receive(CMD_WRITE_PHASE, HEADER_FLAG_APPLY | HEADER_FLAG_APPLY_AT);
+    if (host_fpga_region[CTRL_FLAGS_ADDR + APPLY_AT_ADDR] != 15 ||
+        host_fpga_region[CTRL_FLAGS_ADDR] != (((ctrl_flags ^ 0x01) & ~0x02) | CTRL_FLAG_APPLY_AT) || !check(0)) {
+      fprintf(stderr, "apply is not scheduled\n");
+      return EXIT_FAILURE;
+    }
+
+    // the staged bank is overwritten by the following apply before the time, since the other bank is being output
+    receive(CMD_WRITE_PHASE, HEADER_FLAG_APPLY);
+    if (host_fpga_region[CTRL_FLAGS_ADDR] != ((ctrl_flags ^ 0x01) & ~0x02) || !check(0)) {
+      fprintf(stderr, "schedule is not canceled\n");
+      return EXIT_FAILURE;
+    }
+
+    // the time has passed
+    set_apply_time(10000000);
+    receive(CMD_WRITE_PHASE, HEADER_FLAG_APPLY | HEADER_FLAG_APPLY_AT);
+    if (host_fpga_region[CTRL_FLAGS_ADDR] != (ctrl_flags & ~0x02)) {
+      fprintf(stderr, "apply of the past time is scheduled\n");
+      return EXIT_FAILURE;
+    }
+    set_apply_time(0);
+  }
+
+  {
+    // pause and resume touch only ctrl_flag, and the pause is kept across apply
+    const uint16_t ctrl_flags = host_fpga_region[CTRL_FLAGS_ADDR];
+    host_bus_reset_stats();
+    receive(CMD_PAUSE, 0);
+    if (host_fpga_region[CTRL_FLAGS_ADDR] != (ctrl_flags | CTRL_FLAG_PAUSE) || host_bus_stats.stores != 1 || (_sTx.ack >> 8) != _msg_id) {
+      fprintf(stderr, "output is not paused\n");
+      return EXIT_FAILURE;
+    }
+    receive(CMD_WRITE_PHASE, HEADER_FLAG_APPLY);
+    if (!(host_fpga_region[CTRL_FLAGS_ADDR] & CTRL_FLAG_PAUSE) || !check(0)) {
+      fprintf(stderr, "pause is released by apply\n");
+      return EXIT_FAILURE;
+    }
+    receive(CMD_RESUME, 0);
+    if (host_fpga_region[CTRL_FLAGS_ADDR] != (ctrl_flags ^ 0x01) || (_sTx.ack >> 8) != _msg_id) {
+      fprintf(stderr, "output is not resumed\n");
+      return EXIT_FAILURE;
+    }
+  }
+
+  {
+    // the commands whose payloads run past the body are skipped
+    const uint8_t cmds[] = {CMD_WRITE_DUTY, CMD_SEQ_FOCI_MODE, CMD_ULTRASOUND_CYCLE_CNT};
+    const uint8_t offsets[] = {1, TRANS_NUM - 8, TRANS_NUM - 1};
+    uint16_t ctrl_flags;
+    for (i = 0; i < TRANS_NUM; i++) _sRx0.data[i] = 0;
+    receive(CMD_WRITE_DUTY, 0);
+    receive(CMD_WRITE_PHASE, 0);
+    ctrl_flags = host_fpga_region[CTRL_FLAGS_ADDR];
+    for (i = 0; i < TRANS_NUM; i++) _sRx0.data[i] = (uint16_t)rand();
+    _sRx0.data[TRANS_NUM - 1] = 4000;
+    set_list(3, cmds, offsets);
+    receive(CMD_LIST, HEADER_FLAG_APPLY);
+    for (i = 0; i < TRANS_NUM; i++) _sRx0.data[i] = 0;
+    if (host_fpga_region[CTRL_FLAGS_ADDR] != ((ctrl_flags ^ 0x01) & ~0x02) || host_fpga_region[CTRL_FLAGS_ADDR + CYCLE_CNT_ADDR] != 4000 ||
+        !check(0) || !check(1)) {
+      fprintf(stderr, "command list with payloads out of the body is not skipped\n");
+      return EXIT_FAILURE;
+    }
+  }
+  {
+    const uint8_t cmds[] = {CMD_CLEAR, CMD_ULTRASOUND_CYCLE_CNT, CMD_SEQ_FOCI_MODE};
+    const uint8_t offsets[] = {0, 0, 1};
+    set_list(3, cmds, offsets);
+    _sRx0.data[0] = 5000;
+  }
+
+  bench("WRITE_DUTY", CMD_WRITE_DUTY, 0);
+  bench("WRITE_PHASE + APPLY", CMD_WRITE_PHASE, HEADER_FLAG_APPLY);
+  set_apply_time(~(uint64_t)0);
+  bench("WRITE_PHASE + APPLY_AT", CMD_WRITE_PHASE, HEADER_FLAG_APPLY | HEADER_FLAG_APPLY_AT);
+  set_apply_time(0);
+  bench("SEQ_FOCI_MODE", CMD_SEQ_FOCI_MODE, 0);
+  bench("ULTRASOUND_CYCLE_CNT", CMD_ULTRASOUND_CYCLE_CNT, 0);
+  bench("GLOBAL_PARAMS", CMD_GLOBAL_PARAMS, 0);
+  bench("PAUSE", CMD_PAUSE, 0);
+  bench("RESUME", CMD_RESUME, 0);
+  bench("CLEAR", CMD_CLEAR, 0);
+  bench("READ_CPU_VER_LSB", CMD_RD_CPU_V_LSB, 0);
+  bench("LIST(CLEAR, CYCLE, FOCI)", CMD_LIST, 0);
+
+  return EXIT_SUCCESS;
+}
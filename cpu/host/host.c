@@ -0,0 +1,66 @@
+// File: host.c
+// Project: host
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#include <stddef.h>
+#include <string.h>
+
+#include "app.h"
+#include "host_app.h"
+
+/* Process data, which are placed by the EtherCAT slave stack on the target */
+RX_STR0 _sRx0;
+RX_STR1 _sRx1;
+TX_STR _sTx;
+
+volatile uint16_t host_fpga_region[FPGA_ADDR_SPACE];
+HostBusStats host_bus_stats;
+volatile uint64_t host_dc_sys_time;
+
+static HostBusHandler _handler;
+static int _attached = false;
+
+void host_bus_attach(const HostBusHandler *handler) {
+  _attached = handler != null;
+  if (_attached) _handler = *handler;
+}
+
+void host_bus_reset_stats(void) { memset(&host_bus_stats, 0, sizeof(HostBusStats)); }
+
+void host_bus_write(uint16_t addr, uint16_t value) {
+  host_bus_stats.bus_cycles++;
+  if (_attached)
+    _handler.write(_handler.ctx, addr, value);
+  else
+    host_fpga_region[addr] = value;
+}
+
+uint16_t host_bus_read(uint16_t addr) {
+  host_bus_stats.bus_cycles++;
+  return _attached ? _handler.read(_handler.ctx, addr) : host_fpga_region[addr];
+}
+
+extern void recv_ethercat(void);
+extern void init_app(void);
+extern void update(void);
+
+void host_app_init(void) { init_app(); }
+
+void host_app_receive(const uint8_t *header, const uint8_t *body) {
+  memcpy(_sRx1.data, header, HOST_APP_HEADER_SIZE);
+  if (body != null) memcpy(_sRx0.data, body, HOST_APP_BODY_SIZE);
+  recv_ethercat();
+}
+
+uint16_t host_app_ack(void) { return _sTx.ack; }
+
+void host_app_input(uint8_t *dst) { memcpy(dst, (const uint8_t *)&_sTx + sizeof(uint16_t), HOST_APP_INPUT_SIZE); }
+
+void host_app_update(void) { update(); }
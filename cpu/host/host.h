@@ -0,0 +1,72 @@
+// File: host.h
+// Project: host
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#ifndef HOST_H_
+#define HOST_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FPGA_ADDR_SPACE (0x10000)
+
+/* Mock of the CS1 region, which is used when no bus handler is attached */
+extern volatile uint16_t host_fpga_region[FPGA_ADDR_SPACE];
+#define FPGA_BASE (host_fpga_region)
+
+typedef struct {
+  uint32_t stores;     /* number of store instructions */
+  uint32_t loads;      /* number of load instructions */
+  uint32_t bus_cycles; /* number of 16 bit bus cycles */
+} HostBusStats;
+
+extern HostBusStats host_bus_stats;
+
+typedef struct {
+  void (*write)(void *ctx, uint16_t addr, uint16_t value);
+  uint16_t (*read)(void *ctx, uint16_t addr);
+  void *ctx;
+} HostBusHandler;
+
+/* Forward accesses to the handler instead of the mock region. Pass null to detach. */
+void host_bus_attach(const HostBusHandler *handler);
+void host_bus_reset_stats(void);
+
+void host_bus_write(uint16_t addr, uint16_t value);
+uint16_t host_bus_read(uint16_t addr);
+
+/* Mock of the system time of the distributed clocks in ns, which is read from the EtherCAT slave controller on the target */
+extern volatile uint64_t host_dc_sys_time;
+static inline uint64_t dc_sys_time(void) { return host_dc_sys_time; }
+
+static inline void fpga_write(uint16_t addr, uint16_t value) {
+  host_bus_stats.stores++;
+  host_bus_write(addr, value);
+}
+
+static inline void fpga_write_pair(uint16_t addr, uint32_t value) {
+  host_bus_stats.stores++;
+  host_bus_write(addr, (uint16_t)(value & 0xFFFF));
+  host_bus_write(addr + 1, (uint16_t)(value >> 16));
+}
+
+static inline uint16_t fpga_read(uint16_t addr) {
+  host_bus_stats.loads++;
+  return host_bus_read(addr);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_H_ */
@@ -0,0 +1,43 @@
+// File: host_app.h
+// Project: host
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#ifndef HOST_APP_H_
+#define HOST_APP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Entry points of the host built firmware for programs which cannot include app.h (e.g. C++) */
+
+#define HOST_APP_HEADER_SIZE (128)
+#define HOST_APP_BODY_SIZE (498)
+#define HOST_APP_INPUT_SIZE (10)
+
+void host_app_init(void);
+/* Place a frame into the process data as the EtherCAT slave stack does, and process it. body may be null to keep the previous body. */
+void host_app_receive(const uint8_t *header, const uint8_t *body);
+uint16_t host_app_ack(void);
+/* Copy the input process data (ack followed by the status) of HOST_APP_INPUT_SIZE bytes */
+void host_app_input(uint8_t *dst);
+/* Run the periodic task of the firmware */
+void host_app_update(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HOST_APP_H_ */
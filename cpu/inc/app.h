@@ -3,7 +3,7 @@
 // Created Date: 04/12/2020
 // Author: Shun Suzuki
 // -----
-// Last Modified: 14/04/2021
+// Last Modified: 19/10/2026
 // Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
 // -----
 // Copyright (c) 2020 Hapis Lab. All rights reserved.
@@ -21,6 +21,9 @@
 #ifndef false
 #define false 0
 #endif
+#ifdef HOST_BUILD
+#include <stdint.h>
+#else
 #ifndef uint8_t
 typedef unsigned char uint8_t;
 #endif
@@ -45,6 +48,7 @@ typedef signed long int32_t;
 #ifndef int64_t
 typedef long long int int64_t;
 #endif
+#endif
 #ifndef float32_t
 typedef float float32_t;
 #endif
@@ -56,8 +60,19 @@ typedef int bool_t;
 #endif
 
 #define TRANS_NUM (249)
+
+#ifdef HOST_BUILD
+/* On host, accesses to the FPGA are forwarded to a mock bus (see host/host.h) */
+#include "host.h"
+#else
 #define FPGA_BASE (0x44000000) /* CS1 FPGA address */
 
+/* The FPGA is connected via 16 bit bus, so a 32 bit store is issued as two consecutive bus cycles */
+static inline void fpga_write(uint16_t addr, uint16_t value) { ((volatile uint16_t *)FPGA_BASE)[addr] = value; }
+static inline void fpga_write_pair(uint16_t addr, uint32_t value) { *((volatile uint32_t *)&((volatile uint16_t *)FPGA_BASE)[addr]) = value; }
+static inline uint16_t fpga_read(uint16_t addr) { return ((volatile uint16_t *)FPGA_BASE)[addr]; }
+#endif
+
 typedef struct {
   uint16_t reserved;
   uint16_t data[249]; /* Data from PC */
@@ -68,9 +83,15 @@ typedef struct {
   uint16_t data[64]; /* Header from PC */
 } RX_STR1;
 
+#define ACK_HISTORY_SIZE (4)
+
 typedef struct {
   uint16_t reserved;
   uint16_t ack;
+  uint8_t fpga_info;                     /* fpga_info in the config BRAM, bit 0 = THERMO */
+  uint8_t ctrl_flags;                    /* ctrl_flag written to the FPGA */
+  uint16_t cycle;                        /* ultrasound cycle count */
+  uint8_t ack_history[ACK_HISTORY_SIZE]; /* processed msg_ids, the most recent first */
 } TX_STR;
 
 static inline void word_cpy(uint16_t *dst, uint16_t *src, uint32_t cnt) {
@@ -114,16 +135,8 @@ static inline void memset_volatile(volatile void *s, char c, uint32_t cnt) {
 
 inline static uint16_t get_addr(uint8_t bram_select, uint16_t bram_addr) { return (((uint16_t)bram_select & 0x000F) << 12) | (bram_addr & 0x0FFF); }
 
-static inline void bram_write(uint8_t bram_select, uint16_t bram_addr, uint16_t value) {
-  volatile uint16_t *base = (volatile uint16_t *)FPGA_BASE;
-  uint16_t addr = get_addr(bram_select, bram_addr);
-  base[addr] = value;
-}
+static inline void bram_write(uint8_t bram_select, uint16_t bram_addr, uint16_t value) { fpga_write(get_addr(bram_select, bram_addr), value); }
 
-static inline uint16_t bram_read(uint8_t bram_select, uint16_t bram_addr) {
-  volatile uint16_t *base = (volatile uint16_t *)FPGA_BASE;
-  uint16_t addr = get_addr(bram_select, bram_addr);
-  return base[addr];
-}
+static inline uint16_t bram_read(uint8_t bram_select, uint16_t bram_addr) { return fpga_read(get_addr(bram_select, bram_addr)); }
 
 #endif /* APP_H_ */
@@ -0,0 +1,18 @@
+// File: cpu_version.h
+// Project: inc
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#ifndef CPU_VERSION_H_
+#define CPU_VERSION_H_
+
+/* Also reported by the slave simulator of the client (soft/client/lib/link/soem_sim) */
+#define CPU_VERSION (0xF009) /* v0.10-freq-shift */
+
+#endif /* CPU_VERSION_H_ */
@@ -4,7 +4,7 @@
  * Created Date: 29/06/2020
  * Author: Shun Suzuki
  * -----
- * Last Modified: 09/10/2021
+ * Last Modified: 19/10/2026
  * Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
  * -----
  * Copyright (c) 2020 Hapis Lab. All rights reserved.
@@ -12,27 +12,62 @@
  */
 
 #include "app.h"
+#include "cpu_version.h"
 
+#ifndef HOST_BUILD
 #include "iodefine.h"
 
-#define CPU_VERSION (0xF001)  // v0.2-freq-shift
+static uint64_t dc_sys_time(void) { return ECATC.DC_SYS_TIME.LONGLONG; }
+#endif
 
 #define PADDING_SIZE (125)
 
 #define BRAM_TR_SELECT (0x00)
 #define BRAM_CONFIG_SELECT (0x0F)
 
+#define TR_BANK_SIZE (0x200)
+#define FOCUS_PARAM_ADDR (0x1F2)
+
 #define CTRL_FLAGS_ADDR (0x00)
 #define FPGA_INFO_ADDR (0x01)
 #define CYCLE_CNT (0x10)
+#define PHASE_OFFSET_ADDR (0x11)
+#define DUTY_SCALE_ADDR (0x12)
+#define APPLY_AT_ADDR (0x13)
+#define SYNC0_CNT_LOAD_ADDR (0x14)
 #define FPGA_VER_ADDR (0xFF)
 
+#define DUTY_SCALE_ONE (256)
+
+#define CTRL_FLAG_BANK (1 << 0)
+#define CTRL_FLAG_FOCUS_MODE (1 << 1)
+#define CTRL_FLAG_APPLY_AT (1 << 2)
+#define CTRL_FLAG_SYNC0_LOAD (1 << 3)
+#define CTRL_FLAG_PAUSE (1 << 4)
+
+#define HEADER_FLAG_APPLY (1 << 0)
+#define HEADER_FLAG_APPLY_AT (1 << 1)
+
+// _pad[117..124]: system time of the distributed clocks in ns (little endian), at which APPLY takes effect if HEADER_FLAG_APPLY_AT is set
+#define APPLY_TIME_OFFSET (117)
+
+// SYNC0 fires every 40 ultrasound periods, and the FPGA base clock is 5 ns
+#define SYNC0_CYCLE_NS(cycle) ((uint64_t)(cycle)*5 * 40)
+#define SYNC0_ALIGN_MARGIN_NS (50000)
+
+#define CMD_LIST_MAX (16)
+
 #define CMD_RD_CPU_V_LSB (0x02)
 #define CMD_RD_CPU_V_MSB (0x03)
 #define CMD_RD_FPGA_V_LSB (0x04)
 #define CMD_RD_FPGA_V_MSB (0x05)
+#define CMD_SEQ_FOCI_MODE (0x06)
+#define CMD_LIST (0x07)
 #define CMD_CLEAR (0x09)
 #define CMD_ULTRASOUND_CYCLE_CNT (0x0B)
+#define CMD_GLOBAL_PARAMS (0x0C)
+#define CMD_PAUSE (0x0D)
+#define CMD_RESUME (0x0E)
 #define CMD_WRITE_DUTY (0x10)
 #define CMD_WRITE_PHASE (0x11)
 
@@ -42,6 +77,23 @@ extern TX_STR _sTx;
 
 static volatile uint8_t _header_id = 0;
 
+// duty and phase are staged here, and written to the back bank of the FPGA at once on apply
+static uint16_t _duty[TRANS_NUM];
+static uint16_t _phase[TRANS_NUM];
+static uint8_t _ctrl_flags = 0;
+static uint16_t _cycle_cnt = 0;
+static bool_t _sync0_aligned = false;
+static bool_t _image_applied = false;  // whether an image has been output since clear
+// While an image is output, a new cycle count and the global params received after it are held until the next image is applied,
+// so that the duties and phases calculated for the new cycle count take effect with it
+static bool_t _cycle_cnt_held = false;
+static uint16_t _held_cycle_cnt = 0;
+static bool_t _global_params_held = false;
+static uint16_t _held_global_params[2];
+static uint16_t _phase_offset = 0;  // phase offset as received, which is reduced by the cycle count whenever the cycle count changes
+static uint64_t _sync0_load_time = 0;  // system time of the SYNC0 edge at which the last load of the counter takes effect
+static uint64_t _apply_at_time = 0;    // system time of the SYNC0 edge at which the staged image is output
+
 // fire when ethercat packet arrives
 extern void recv_ethercat(void);
 // fire once after power on
@@ -56,32 +108,184 @@ typedef struct {
   uint8_t _pad[PADDING_SIZE];
 } GlobalHeader;
 
-static void write_duty(volatile uint16_t *src, uint32_t size) {
-  volatile uint16_t *base = (volatile uint16_t *)FPGA_BASE;
-  uint32_t i;
-  uint16_t base_addr;
-  base_addr = get_addr(BRAM_TR_SELECT, 0);
-  for (i = 0; i < size; i++) base[base_addr + (i << 1) + 1] = src[i];
+static void commit_cycle_cnt(void);
+
+static void write_phase_offset(void) {
+  uint16_t offset = _phase_offset;
+  if (_cycle_cnt != 0) offset %= _cycle_cnt;
+  bram_write(BRAM_CONFIG_SELECT, PHASE_OFFSET_ADDR, offset);
 }
 
-static void write_phase(volatile uint16_t *src, uint32_t size) {
-  volatile uint16_t *base = (volatile uint16_t *)FPGA_BASE;
+// If a scheduled image is still staged, the FPGA outputs the back bank. Then the staged bank is overwritten by the next image instead.
+static void cancel_schedule(void) {
+  if ((_ctrl_flags & CTRL_FLAG_APPLY_AT) && dc_sys_time() < _apply_at_time) _ctrl_flags ^= CTRL_FLAG_BANK;
+  _ctrl_flags &= ~CTRL_FLAG_APPLY_AT;
+}
+
+// flags: CTRL_FLAG_APPLY_AT to stage the image until apply_at
+static void apply(uint8_t flags) {
+  uint16_t addr;
   uint32_t i;
-  uint16_t base_addr;
 
-  base_addr = get_addr(BRAM_TR_SELECT, 0);
-  for (i = 0; i < size; i++) base[base_addr + (i << 1)] = src[i];
+  cancel_schedule();
+
+  // phase[i] and duty[i] are adjacent, so both are written with one 32 bit store
+  addr = get_addr(BRAM_TR_SELECT, (_ctrl_flags & CTRL_FLAG_BANK) ? 0 : TR_BANK_SIZE);
+  for (i = 0; i < TRANS_NUM; i++, addr += 2) fpga_write_pair(addr, (((uint32_t)_duty[i]) << 16) | _phase[i]);
+  commit_cycle_cnt();
+  _image_applied = true;
+
+  // FPGA switches the bank at the beginning of the next ultrasound period, or at the SYNC0 edge of apply_at
+  _ctrl_flags ^= CTRL_FLAG_BANK;
+  _ctrl_flags &= ~CTRL_FLAG_FOCUS_MODE;
+  _ctrl_flags |= flags;
+  bram_write(BRAM_CONFIG_SELECT, CTRL_FLAGS_ADDR, _ctrl_flags);
+}
+
+// data: x, y, z (32 bit, 1/1024 mm, device local), duty, (base clock)/(sound speed) (32 bit, 1/65536 clk/mm)
+// The FPGA calculates phases of all transducers from them
+static void set_focus(const uint16_t *data) {
+  uint16_t addr;
+
+  cancel_schedule();
+
+  addr = get_addr(BRAM_TR_SELECT, ((_ctrl_flags & CTRL_FLAG_BANK) ? 0 : TR_BANK_SIZE) + FOCUS_PARAM_ADDR);
+  fpga_write_pair(addr, (((uint32_t)data[1]) << 16) | data[0]);
+  fpga_write_pair(addr + 2, (((uint32_t)data[3]) << 16) | data[2]);
+  fpga_write_pair(addr + 4, (((uint32_t)data[5]) << 16) | data[4]);
+  fpga_write_pair(addr + 6, data[6]);
+  fpga_write_pair(addr + 8, (((uint32_t)data[8]) << 16) | data[7]);
+  commit_cycle_cnt();
+  _image_applied = true;
+
+  _ctrl_flags ^= CTRL_FLAG_BANK;
+  _ctrl_flags |= CTRL_FLAG_FOCUS_MODE;
+  bram_write(BRAM_CONFIG_SELECT, CTRL_FLAGS_ADDR, _ctrl_flags);
+}
+
+// data: phase offset, duty scale (1/256)
+// The FPGA applies them to all transducers at the beginning of the next ultrasound period without rewriting the banks
+static void set_global_params(const uint16_t *data) {
+  if (_cycle_cnt_held) {
+    _held_global_params[0] = data[0];
+    _held_global_params[1] = data[1];
+    _global_params_held = true;
+    return;
+  }
+  _phase_offset = data[0];
+  write_phase_offset();
+  bram_write(BRAM_CONFIG_SELECT, DUTY_SCALE_ADDR, data[1]);
+}
+
+// The FPGA outputs nothing from the next ultrasound period while paused, but keeps the banks, so that resume needs no rewrite
+static void set_pause(bool_t pause) {
+  if (pause)
+    _ctrl_flags |= CTRL_FLAG_PAUSE;
+  else
+    _ctrl_flags &= ~CTRL_FLAG_PAUSE;
+  bram_write(BRAM_CONFIG_SELECT, CTRL_FLAGS_ADDR, _ctrl_flags);
+}
+
+// SYNC0 of all devices fires at multiples of the SYNC0 cycle time in the system time,
+// so that the SYNC0 counter of the FPGA is loaded with the index of the next edge at that edge.
+// It is skipped if the next edge is too close, and retried when the next frame arrives.
+// The load bit is toggled at most once before each edge, otherwise the FPGA would miss the load.
+static void align_sync0(void) {
+  uint64_t cycle_ns, t, r, next;
+
+  if (_cycle_cnt == 0) return;
+  cycle_ns = SYNC0_CYCLE_NS(_cycle_cnt);
+  t = dc_sys_time();
+  r = t % cycle_ns;
+  if (r < SYNC0_ALIGN_MARGIN_NS || r + SYNC0_ALIGN_MARGIN_NS > cycle_ns) return;
+
+  next = t / cycle_ns + 1;
+  bram_write(BRAM_CONFIG_SELECT, SYNC0_CNT_LOAD_ADDR, (uint16_t)next);
+  if (t >= _sync0_load_time) {
+    _ctrl_flags ^= CTRL_FLAG_SYNC0_LOAD;
+    bram_write(BRAM_CONFIG_SELECT, CTRL_FLAGS_ADDR, _ctrl_flags);
+  }
+  _sync0_load_time = next * cycle_ns;
+  _sync0_aligned = true;
+}
+
+static void set_cycle_cnt(uint16_t cycle_cnt) {
+  _held_cycle_cnt = cycle_cnt;
+  _cycle_cnt_held = true;
+  if (!_image_applied) commit_cycle_cnt();
+}
+
+// The held cycle count is written just before the bank is switched, followed by the global params held after it,
+// and the SYNC0 counter is aligned to the new SYNC0 cycle.
+// The phase offset is reduced by the new cycle count, and written before the cycle count if it is lowered and after otherwise,
+// so that the FPGA never reads an offset which is not less than the cycle count.
+static void commit_cycle_cnt(void) {
+  bool_t lowered;
+  if (!_cycle_cnt_held) return;
+  _cycle_cnt_held = false;
+  lowered = _held_cycle_cnt < _cycle_cnt;
+  _cycle_cnt = _held_cycle_cnt;
+  if (lowered) write_phase_offset();
+  bram_write(BRAM_CONFIG_SELECT, CYCLE_CNT, _cycle_cnt);
+  if (!lowered) write_phase_offset();
+  if (_global_params_held) {
+    _global_params_held = false;
+    set_global_params(_held_global_params);
+  }
+  _sync0_aligned = false;
+  align_sync0();
+}
+
+// The image is written to the back bank, and the FPGA switches to it at the first SYNC0 edge at or after time.
+// If time has passed or the SYNC0 counter is not aligned yet, it is applied immediately.
+// A held cycle count is written immediately, since the SYNC0 edge is counted in the new SYNC0 cycle.
+static void apply_at(uint64_t time) {
+  uint64_t cycle_ns, edge;
+
+  commit_cycle_cnt();
+  if (!_sync0_aligned) align_sync0();
+  if (!_sync0_aligned || time <= dc_sys_time()) {
+    apply(0);
+    return;
+  }
+  cycle_ns = SYNC0_CYCLE_NS(_cycle_cnt);
+  edge = (time + cycle_ns - 1) / cycle_ns;
+  bram_write(BRAM_CONFIG_SELECT, APPLY_AT_ADDR, (uint16_t)edge);
+  apply(CTRL_FLAG_APPLY_AT);
+  _apply_at_time = edge * cycle_ns;
+}
+
+static uint64_t get_apply_time(const GlobalHeader *header) {
+  uint64_t time = 0;
+  int32_t i;
+  for (i = 7; i >= 0; i--) time = (time << 8) | header->_pad[APPLY_TIME_OFFSET + i];
+  return time;
 }
 
 static void clear(void) {
-  volatile uint16_t *base = (volatile uint16_t *)FPGA_BASE;
   uint16_t addr;
+  uint32_t i;
+
+  word_set(_duty, 0x0000, TRANS_NUM);
+  word_set(_phase, 0x0000, TRANS_NUM);
 
   addr = get_addr(BRAM_TR_SELECT, 0);
-  word_set_volatile(&base[addr], 0x0000, TRANS_NUM << 1);
+  for (i = 0; i < TRANS_NUM; i++, addr += 2) fpga_write_pair(addr, 0x00000000);
+  addr = get_addr(BRAM_TR_SELECT, TR_BANK_SIZE);
+  for (i = 0; i < TRANS_NUM; i++, addr += 2) fpga_write_pair(addr, 0x00000000);
 
-  bram_write(BRAM_CONFIG_SELECT, CTRL_FLAGS_ADDR, 0);
-  bram_write(BRAM_CONFIG_SELECT, CYCLE_CNT, 0);
+  // the SYNC0 load bit is kept, since toggling it would reload the SYNC0 counter
+  _ctrl_flags &= CTRL_FLAG_SYNC0_LOAD;
+  _cycle_cnt = 0;
+  _sync0_aligned = false;
+  _image_applied = false;
+  _cycle_cnt_held = false;
+  _global_params_held = false;
+  _phase_offset = 0;
+  bram_write(BRAM_CONFIG_SELECT, CTRL_FLAGS_ADDR, _ctrl_flags);
+  bram_write(BRAM_CONFIG_SELECT, CYCLE_CNT, _cycle_cnt);
+  bram_write(BRAM_CONFIG_SELECT, PHASE_OFFSET_ADDR, 0);
+  bram_write(BRAM_CONFIG_SELECT, DUTY_SCALE_ADDR, DUTY_SCALE_ONE);
 }
 
 void init_app(void) { clear(); }
@@ -89,52 +293,142 @@ void init_app(void) { clear(); }
 static uint16_t get_cpu_version(void) { return CPU_VERSION; }
 static uint16_t get_fpga_version(void) { return bram_read(BRAM_CONFIG_SELECT, FPGA_VER_ADDR); }
 
-void update(void) {}
+// the input process data other than ack are reported every cycle, so that the host monitors the devices without extra commands
+static void update_status(void) {
+  _sTx.ctrl_flags = _ctrl_flags;
+  _sTx.cycle = _cycle_cnt;
+}
 
-void recv_ethercat(void) {
-  GlobalHeader *header = (GlobalHeader *)(_sRx1.data);
+static void push_ack_history(uint8_t msg_id) {
+  uint32_t i;
+  for (i = ACK_HISTORY_SIZE - 1; i > 0; i--) _sTx.ack_history[i] = _sTx.ack_history[i - 1];
+  _sTx.ack_history[0] = msg_id;
+}
 
-  if (header->msg_id != _header_id) {
-    _header_id = header->msg_id;
+void update(void) {
+  _sTx.fpga_info = (uint8_t)(bram_read(BRAM_CONFIG_SELECT, FPGA_INFO_ADDR) & 0x00FF);
+  update_status();
+}
+
+// execute a command whose payload begins at data
+static void execute(uint8_t cmd, uint8_t msg_id, uint16_t *data) {
+  switch (cmd) {
+    case CMD_WRITE_DUTY:
+      word_cpy(_duty, data, TRANS_NUM);
+      _sTx.ack = ((uint16_t)msg_id) << 8;
+      break;
+
+    case CMD_WRITE_PHASE:
+      word_cpy(_phase, data, TRANS_NUM);
+      _sTx.ack = ((uint16_t)msg_id) << 8;
+      break;
+
+    case CMD_SEQ_FOCI_MODE:
+      set_focus(data);
+      _sTx.ack = ((uint16_t)msg_id) << 8;
+      break;
+
+    case CMD_ULTRASOUND_CYCLE_CNT:
+      set_cycle_cnt(data[0]);
+      _sTx.ack = ((uint16_t)msg_id) << 8;
+      break;
+
+    case CMD_GLOBAL_PARAMS:
+      set_global_params(data);
+      _sTx.ack = ((uint16_t)msg_id) << 8;
+      break;
 
-    switch (header->cmd) {
-      case CMD_WRITE_DUTY:
-        write_duty(_sRx0.data, TRANS_NUM);
-        _sTx.ack = ((uint16_t)(header->msg_id)) << 8;
-        break;
+    case CMD_PAUSE:
+      set_pause(true);
+      _sTx.ack = ((uint16_t)msg_id) << 8;
+      break;
 
-      case CMD_WRITE_PHASE:
-        write_phase(_sRx0.data, TRANS_NUM);
-        _sTx.ack = ((uint16_t)(header->msg_id)) << 8;
-        break;
+    case CMD_RESUME:
+      set_pause(false);
+      _sTx.ack = ((uint16_t)msg_id) << 8;
+      break;
 
-      case CMD_ULTRASOUND_CYCLE_CNT:
-        bram_write(BRAM_CONFIG_SELECT, CYCLE_CNT, _sRx0.data[0]);
-        _sTx.ack = ((uint16_t)(header->msg_id)) << 8;
-        break;
+    case CMD_RD_CPU_V_LSB:
+      _sTx.ack = ((((uint16_t)msg_id) << 8) & 0xFF00) | (get_cpu_version() & 0x00FF);
+      break;
 
-      case CMD_RD_CPU_V_LSB:
-        _sTx.ack = ((((uint16_t)(header->msg_id)) << 8) & 0xFF00) | (get_cpu_version() & 0x00FF);
-        break;
+    case CMD_RD_CPU_V_MSB:
+      _sTx.ack = ((((uint16_t)msg_id) << 8) & 0xFF00) | ((get_cpu_version() >> 8) & 0x00FF);
+      break;
 
-      case CMD_RD_CPU_V_MSB:
-        _sTx.ack = ((((uint16_t)(header->msg_id)) << 8) & 0xFF00) | ((get_cpu_version() >> 8) & 0x00FF);
-        break;
+    case CMD_RD_FPGA_V_LSB:
+      _sTx.ack = ((((uint16_t)msg_id) << 8) & 0xFF00) | (get_fpga_version() & 0x00FF);
+      break;
 
-      case CMD_RD_FPGA_V_LSB:
-        _sTx.ack = ((((uint16_t)(header->msg_id)) << 8) & 0xFF00) | (get_fpga_version() & 0x00FF);
-        break;
+    case CMD_RD_FPGA_V_MSB:
+      _sTx.ack = ((((uint16_t)msg_id) << 8) & 0xFF00) | ((get_fpga_version() >> 8) & 0x00FF);
+      break;
 
-      case CMD_RD_FPGA_V_MSB:
-        _sTx.ack = ((((uint16_t)(header->msg_id)) << 8) & 0xFF00) | ((get_fpga_version() >> 8) & 0x00FF);
-        break;
+    case CMD_CLEAR:
+      clear();
+      break;
 
-      case CMD_CLEAR:
-        clear();
-        break;
+    default:
+      break;
+  }
+}
+
+// number of 16 bit words of the payload read by execute
+static uint16_t payload_words(uint8_t cmd) {
+  switch (cmd) {
+    case CMD_WRITE_DUTY:
+    case CMD_WRITE_PHASE:
+      return TRANS_NUM;
+    case CMD_SEQ_FOCI_MODE:
+      return 9;
+    case CMD_ULTRASOUND_CYCLE_CNT:
+      return 1;
+    case CMD_GLOBAL_PARAMS:
+      return 2;
+    default:
+      return 0;
+  }
+}
+
+// _pad[0]: number of commands, _pad[1 + 2i]: i-th command, _pad[2 + 2i]: offset of its payload in the body in units of 16 bit words
+// The commands are executed in order and acknowledged once. A command whose payload does not fit in the body is skipped.
+static void execute_list(GlobalHeader *header) {
+  uint8_t i;
+  uint8_t n = header->_pad[0];
+  uint8_t cmd;
+  uint8_t offset;
+
+  if (n > CMD_LIST_MAX) n = CMD_LIST_MAX;
+  for (i = 0; i < n; i++) {
+    cmd = header->_pad[1 + 2 * i];
+    offset = header->_pad[2 + 2 * i];
+    if ((uint16_t)offset + payload_words(cmd) > TRANS_NUM) continue;
+    execute(cmd, header->msg_id, _sRx0.data + offset);
+  }
+  _sTx.ack = ((uint16_t)(header->msg_id)) << 8;
+}
 
-      default:
-        break;
+void recv_ethercat(void) {
+  GlobalHeader *header = (GlobalHeader *)(_sRx1.data);
+
+  if (!_sync0_aligned) align_sync0();
+
+  if (header->msg_id != _header_id) {
+    _header_id = header->msg_id;
+
+    if (header->cmd == CMD_LIST)
+      execute_list(header);
+    else
+      execute(header->cmd, header->msg_id, _sRx0.data);
+
+    if (header->control_flags & HEADER_FLAG_APPLY) {
+      if (header->control_flags & HEADER_FLAG_APPLY_AT)
+        apply_at(get_apply_time(header));
+      else
+        apply(0);
     }
+
+    push_ack_history(header->msg_id);
+    update_status();
   }
 }
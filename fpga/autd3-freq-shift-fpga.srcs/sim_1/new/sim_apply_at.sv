@@ -0,0 +1,201 @@
+/*
+ * File: sim_apply_at.sv
+ * Project: new
+ * Created Date: 19/10/2026
+ * Author: Shun Suzuki
+ * -----
+ * Last Modified: 19/10/2026
+ * Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+ * -----
+ * Copyright (c) 2021 Hapis Lab. All rights reserved.
+ *
+ */
+
+`timescale 1ns / 1ps
+
+module sim_apply_at();
+
+localparam int TRANS_NUM = 249;
+// the phases written to the banks are up to 1496, and must be less than the cycle, since the phase offset wraps them around the cycle
+localparam int ULTRASOUND_CNT_CYCLE = 2000;
+
+localparam [3:0] BRAM_TR_SELECT = 4'h0;
+localparam [3:0] BRAM_CONFIG_SELECT = 4'hF;
+localparam [10:0] CTRL_FLAGS_ADDR = 11'h000;
+localparam [10:0] CYCLE_ADDR = 11'h010;
+localparam [10:0] DUTY_SCALE_ADDR = 11'h012;
+localparam [10:0] APPLY_AT_ADDR = 11'h013;
+localparam [10:0] SYNC0_CNT_LOAD_ADDR = 11'h014;
+localparam int SYNC0_CYCLE = 2 * ULTRASOUND_CNT_CYCLE;
+
+localparam [15:0] CTRL_FLAG_BANK = 16'h0001;
+localparam [15:0] CTRL_FLAG_APPLY_AT = 16'h0004;
+localparam [15:0] CTRL_FLAG_SYNC0_LOAD = 16'h0008;
+localparam [10:0] BANK_SIZE = 11'h200;
+
+logic MRCC_25P6M;
+logic RESET_N;
+logic CPU_CKIO;
+logic CAT_SYNC0;
+logic CPU_CS1_N;
+logic CPU_WE0_N;
+logic [16:0] CPU_ADDR;
+logic [15:0] cpu_data;
+tri [15:0] CPU_DATA;
+logic [252:1] XDCR_OUT;
+
+assign CPU_DATA = ~CPU_WE0_N ? cpu_data : 16'bz;
+
+top top(
+        .CPU_ADDR(CPU_ADDR),
+        .CPU_DATA(CPU_DATA),
+        .CPU_CKIO(CPU_CKIO),
+        .CPU_CS1_N(CPU_CS1_N),
+        .RESET_N(RESET_N),
+        .CPU_WE0_N(CPU_WE0_N),
+        .CPU_WE1_N(1'b1),
+        .CPU_RD_N(1'b1),
+        .CPU_RDWR(1'b0),
+        .MRCC_25P6M(MRCC_25P6M),
+        .CAT_SYNC0(CAT_SYNC0),
+        .FORCE_FAN(),
+        .THERMO(1'b0),
+        .XDCR_OUT(XDCR_OUT),
+        .GPIO_IN(4'd0),
+        .GPIO_OUT()
+    );
+
+task bram_write(input [3:0] select, input [10:0] addr, input [15:0] data);
+    @(posedge CPU_CKIO);
+    CPU_ADDR <= {select, 1'b0, addr, 1'b0};
+    cpu_data <= data;
+    CPU_CS1_N <= 0;
+    CPU_WE0_N <= 0;
+    @(posedge CPU_CKIO);
+    CPU_CS1_N <= 1;
+    CPU_WE0_N <= 1;
+endtask
+
+// write duty = base + i and phase = base + 2 * i to the bank
+task write_image(input bank, input [15:0] base, input int num);
+    for (int i = 0; i < num; i++) begin
+        bram_write(BRAM_TR_SELECT, (bank ? BANK_SIZE : 11'h000) + 2 * i, base + 2 * i);
+        bram_write(BRAM_TR_SELECT, (bank ? BANK_SIZE : 11'h000) + 2 * i + 1, base + i);
+    end
+endtask
+
+function automatic bit is_image(input [15:0] base);
+    for (int i = 0; i < TRANS_NUM; i++)
+        if (top.duty[i] !== base + i || top.phase[i] !== base + 2 * i) return 0;
+    return 1;
+endfunction
+
+// SYNC0 with the period of two ultrasound periods
+logic sync0_en;
+logic [15:0] target;
+always begin
+    repeat(SYNC0_CYCLE - 4) @(posedge top.sys_clk);
+    CAT_SYNC0 = sync0_en;
+    repeat(4) @(posedge top.sys_clk);
+    CAT_SYNC0 = 0;
+end
+
+initial begin
+    MRCC_25P6M = 0;
+    CPU_CKIO = 0;
+    RESET_N = 0;
+    CAT_SYNC0 = 0;
+    CPU_CS1_N = 1;
+    CPU_WE0_N = 1;
+    CPU_ADDR = 0;
+    cpu_data = 0;
+    sync0_en = 0;
+    #1000;
+    RESET_N = 1;
+
+    bram_write(BRAM_CONFIG_SELECT, CYCLE_ADDR, ULTRASOUND_CNT_CYCLE);
+    bram_write(BRAM_CONFIG_SELECT, DUTY_SCALE_ADDR, 16'd256);
+    bram_write(BRAM_CONFIG_SELECT, CTRL_FLAGS_ADDR, 16'h0000);
+    write_image(0, 16'd0, TRANS_NUM);
+    write_image(1, 16'd1000, TRANS_NUM);
+    sync0_en = 1;
+
+    // align the counter to 65530, so that the target is reached across the wrap around.
+    // The load is written just after an edge, since the firmware keeps a margin from the edges, and sync0_load is read less often than ctrl_flags.
+    @(posedge top.sync0_edge);
+    bram_write(BRAM_CONFIG_SELECT, SYNC0_CNT_LOAD_ADDR, 16'd65530);
+    bram_write(BRAM_CONFIG_SELECT, CTRL_FLAGS_ADDR, CTRL_FLAG_SYNC0_LOAD);
+    // sync0_cnt is updated at the clock after sync0_edge rises
+    @(posedge top.sync0_edge);
+    repeat(2) @(posedge top.sys_clk);
+    if (top.sync0_cnt !== 16'd65530) begin
+        $display("ERR: sync0_cnt = %d, expected 65530", top.sync0_cnt);
+        $finish;
+    end
+
+    // the bank 1 must be output from the period after the edge at which sync0_cnt becomes 3
+    bram_write(BRAM_CONFIG_SELECT, APPLY_AT_ADDR, 16'd3);
+    bram_write(BRAM_CONFIG_SELECT, CTRL_FLAGS_ADDR, CTRL_FLAG_SYNC0_LOAD | CTRL_FLAG_APPLY_AT | CTRL_FLAG_BANK);
+    for (int n = 0; n < 10; n++) begin
+        @(posedge top.sync0_edge);
+        @(posedge top.sys_clk);
+        repeat(ULTRASOUND_CNT_CYCLE * 3 / 2) @(posedge top.sys_clk);
+        if (!is_image(($signed(top.sync0_cnt - 16'd3) >= 0) ? 16'd1000 : 16'd0)) begin
+            $display("ERR: wrong image at sync0_cnt = %d", top.sync0_cnt);
+            $finish;
+        end
+    end
+
+    // without CTRL_FLAG_APPLY_AT, the bank follows ctrl_flags from the next period
+    bram_write(BRAM_CONFIG_SELECT, CTRL_FLAGS_ADDR, CTRL_FLAG_SYNC0_LOAD);
+    repeat(ULTRASOUND_CNT_CYCLE * 3) @(posedge top.sys_clk);
+    if (!is_image(16'd0)) begin
+        $display("ERR: bank is not switched without APPLY_AT");
+        $finish;
+    end
+
+    // apply_at and ctrl_flags are written back to back, as the CPU does, while the previous apply_at has been reached.
+    // They are written just after config FSM reads apply_at, so that ctrl_flags is read before the edge and apply_at after it,
+    // if apply_at is read more than about 5 clocks before the edge. The bank must not be switched at that edge with the previous apply_at.
+    // Each iteration takes 4 SYNC0 cycles, which are not a multiple of the period of reading apply_at (15 clocks),
+    // so that the edges come at the different phases of config FSM.
+    for (int n = 0; n < 6; n++) begin
+        @(posedge top.sync0_edge);
+        @(posedge top.sync0_edge);
+        repeat(SYNC0_CYCLE - 16) @(posedge top.sys_clk);
+        @(posedge top.sys_clk);
+        while (!(top.config_state == 3'd2 && top.param_idx == 3'd3)) @(posedge top.sys_clk);
+        target = top.sync0_cnt + 16'd2;
+        bram_write(BRAM_CONFIG_SELECT, APPLY_AT_ADDR, target);
+        bram_write(BRAM_CONFIG_SELECT, CTRL_FLAGS_ADDR, CTRL_FLAG_SYNC0_LOAD | CTRL_FLAG_APPLY_AT | CTRL_FLAG_BANK);
+        wait(top.sync0_cnt == target - 16'd1);
+        repeat(ULTRASOUND_CNT_CYCLE * 3 / 2) @(posedge top.sys_clk);
+        if (!is_image(16'd0)) begin
+            $display("ERR: switched before apply_at = %d at sync0_cnt = %d", target, top.sync0_cnt);
+            $finish;
+        end
+        wait(top.sync0_cnt == target);
+        repeat(ULTRASOUND_CNT_CYCLE * 3 / 2) @(posedge top.sys_clk);
+        if (!is_image(16'd1000)) begin
+            $display("ERR: not switched at apply_at = %d", target);
+            $finish;
+        end
+        bram_write(BRAM_CONFIG_SELECT, CTRL_FLAGS_ADDR, CTRL_FLAG_SYNC0_LOAD);
+    end
+
+    $display("OK");
+    $finish;
+end
+
+always begin
+    #19.531 MRCC_25P6M = !MRCC_25P6M;
+    #19.531 MRCC_25P6M = !MRCC_25P6M;
+    #19.531 MRCC_25P6M = !MRCC_25P6M;
+    #19.532 MRCC_25P6M = !MRCC_25P6M;
+end
+
+always begin
+    #6.667 CPU_CKIO = !CPU_CKIO;
+end
+
+endmodule
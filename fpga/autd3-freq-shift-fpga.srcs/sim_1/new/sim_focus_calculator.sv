@@ -0,0 +1,122 @@
+/*
+ * File: sim_focus_calculator.sv
+ * Project: new
+ * Created Date: 19/10/2026
+ * Author: Shun Suzuki
+ * -----
+ * Last Modified: 19/10/2026
+ * Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+ * -----
+ * Copyright (c) 2021 Hapis Lab. All rights reserved.
+ *
+ */
+
+`timescale 1ns / 1ps
+
+// The test vectors are generated by example_focus_calculator in soft/client from the bodies packed by Logic::pack_seq_foci_body.
+// Each case is the focus, the sound speed factor and the cycle, followed by (host phase << 16 | model phase) of each transducer,
+// where the host phase is of gain::FocalPoint and the model phase is of the fixed point model of focus_calculator.
+// The phases must be the same as the model and less than the cycle, and differ from the host by TOLERANCE at most.
+// The last case has a phase which is rounded up to the cycle and must be wrapped to 0.
+module sim_focus_calculator();
+
+localparam int TRANS_NUM = 249;
+localparam int NUM_CASES = 32;
+localparam int CASE_WORDS = 5 + TRANS_NUM;
+localparam int TOLERANCE = 1;
+
+logic CLK;
+logic START;
+logic signed [31:0] focus_x, focus_y, focus_z;
+logic [31:0] k;
+logic [15:0] cycle;
+logic [15:0] phase;
+logic [7:0] tr_idx;
+logic valid;
+
+logic [31:0] vectors[0:NUM_CASES*CASE_WORDS-1];
+logic [15:0] phases[0:TRANS_NUM-1];
+int received;
+int max_error;
+
+focus_calculator focus_calculator(
+                     .CLK(CLK),
+                     .START(START),
+                     .FOCUS_X(focus_x),
+                     .FOCUS_Y(focus_y),
+                     .FOCUS_Z(focus_z),
+                     .SOUND_SPEED_FACTOR(k),
+                     .CYCLE(cycle),
+                     .PHASE(phase),
+                     .TR_IDX(tr_idx),
+                     .VALID(valid)
+                 );
+
+always @(posedge CLK) begin
+    if (valid) begin
+        phases[tr_idx] <= phase;
+        received <= received + 1;
+    end
+end
+
+// the errors are calculated in int, since they are negative and must not be compared as unsigned with the cycle
+task check_case(input int n);
+    int base, host, model, diff, c;
+    base = n * CASE_WORDS;
+    focus_x = vectors[base];
+    focus_y = vectors[base + 1];
+    focus_z = vectors[base + 2];
+    k = vectors[base + 3];
+    cycle = vectors[base + 4][15:0];
+    c = vectors[base + 4][15:0];
+    received = 0;
+    @(posedge CLK);
+    START <= 1;
+    @(posedge CLK);
+    START <= 0;
+    wait(received == TRANS_NUM);
+    @(posedge CLK);
+
+    for (int i = 0; i < TRANS_NUM; i++) begin
+        host = vectors[base + 5 + i][31:16];
+        model = vectors[base + 5 + i][15:0];
+        if (phases[i] != model) begin
+            $display("ERR: case %d, tr %d: phase = %d, model = %d (cycle = %d)", n, i, phases[i], model, cycle);
+            $finish;
+        end
+        if (phases[i] >= cycle) begin
+            $display("ERR: case %d, tr %d: phase = %d is not less than cycle = %d", n, i, phases[i], cycle);
+            $finish;
+        end
+        diff = (phases[i] % c) - (host % c);
+        if (diff > c / 2) diff -= c;
+        if (diff < -c / 2) diff += c;
+        if (diff < 0) diff = -diff;
+        if (diff > TOLERANCE) begin
+            $display("ERR: case %d, tr %d: phase = %d, host = %d (cycle = %d)", n, i, phases[i], host, cycle);
+            $finish;
+        end
+        if (diff > max_error) max_error = diff;
+    end
+endtask
+
+initial begin
+    CLK = 0;
+    START = 0;
+    received = 0;
+    max_error = 0;
+    $readmemh("focus_vectors.mem", vectors);
+    #100;
+
+    for (int n = 0; n < NUM_CASES; n++) check_case(n);
+
+    $display("max error from host: %d", max_error);
+    $display("OK");
+    $finish;
+end
+
+always begin
+    #2.5 CLK = !CLK;
+end
+
+endmodule
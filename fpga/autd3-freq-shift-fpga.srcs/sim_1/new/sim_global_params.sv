@@ -0,0 +1,184 @@
+/*
+ * File: sim_global_params.sv
+ * Project: new
+ * Created Date: 19/10/2026
+ * Author: Shun Suzuki
+ * -----
+ * Last Modified: 19/10/2026
+ * Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+ * -----
+ * Copyright (c) 2021 Hapis Lab. All rights reserved.
+ *
+ */
+
+`timescale 1ns / 1ps
+
+module sim_global_params();
+
+localparam int TRANS_NUM = 249;
+localparam int ULTRASOUND_CNT_CYCLE = 500;
+
+localparam [3:0] BRAM_TR_SELECT = 4'h0;
+localparam [3:0] BRAM_CONFIG_SELECT = 4'hF;
+localparam [10:0] CTRL_FLAGS_ADDR = 11'h000;
+localparam [10:0] CYCLE_ADDR = 11'h010;
+localparam [10:0] PHASE_OFFSET_ADDR = 11'h011;
+localparam [10:0] DUTY_SCALE_ADDR = 11'h012;
+
+logic MRCC_25P6M;
+logic RESET_N;
+logic CPU_CKIO;
+logic CAT_SYNC0;
+logic CPU_CS1_N;
+logic CPU_WE0_N;
+logic [16:0] CPU_ADDR;
+logic [15:0] cpu_data;
+tri [15:0] CPU_DATA;
+logic [252:1] XDCR_OUT;
+
+assign CPU_DATA = ~CPU_WE0_N ? cpu_data : 16'bz;
+
+top top(
+        .CPU_ADDR(CPU_ADDR),
+        .CPU_DATA(CPU_DATA),
+        .CPU_CKIO(CPU_CKIO),
+        .CPU_CS1_N(CPU_CS1_N),
+        .RESET_N(RESET_N),
+        .CPU_WE0_N(CPU_WE0_N),
+        .CPU_WE1_N(1'b1),
+        .CPU_RD_N(1'b1),
+        .CPU_RDWR(1'b0),
+        .MRCC_25P6M(MRCC_25P6M),
+        .CAT_SYNC0(CAT_SYNC0),
+        .FORCE_FAN(),
+        .THERMO(1'b0),
+        .XDCR_OUT(XDCR_OUT),
+        .GPIO_IN(4'd0),
+        .GPIO_OUT()
+    );
+
+task bram_write(input [3:0] select, input [10:0] addr, input [15:0] data);
+    @(posedge CPU_CKIO);
+    CPU_ADDR <= {select, 1'b0, addr, 1'b0};
+    cpu_data <= data;
+    CPU_CS1_N <= 0;
+    CPU_WE0_N <= 0;
+    @(posedge CPU_CKIO);
+    CPU_CS1_N <= 1;
+    CPU_WE0_N <= 1;
+endtask
+
+// write duty = i and phase = 2 * i to the bank 0
+task write_image();
+    for (int i = 0; i < TRANS_NUM; i++) begin
+        bram_write(BRAM_TR_SELECT, 2 * i, 2 * i);
+        bram_write(BRAM_TR_SELECT, 2 * i + 1, i);
+    end
+endtask
+
+task check_image(input [15:0] offset, input [15:0] scale, input [15:0] cycle);
+    for (int i = 0; i < TRANS_NUM; i++) begin
+        if (top.duty[i] !== (i * (scale > 256 ? 256 : scale)) / 256 || top.phase[i] !== (2 * i + offset) % cycle) begin
+            $display("ERR: tr %d: duty = %d, phase = %d, offset = %d, scale = %d, cycle = %d", i, top.duty[i], top.phase[i], offset, scale, cycle);
+            $finish;
+        end
+    end
+endtask
+
+task set_params(input [15:0] offset, input [15:0] scale);
+    bram_write(BRAM_CONFIG_SELECT, PHASE_OFFSET_ADDR, offset);
+    bram_write(BRAM_CONFIG_SELECT, DUTY_SCALE_ADDR, scale);
+endtask
+
+task wait_periods(input int n);
+    repeat(n * ULTRASOUND_CNT_CYCLE) @(posedge top.sys_clk);
+endtask
+
+// the parameters must be applied to all transducers at once at the period boundary
+logic checking;
+logic [15:0] duty_1, phase_0;
+always @(negedge top.sys_clk) begin
+    if (checking && (duty_1 !== top.duty[1] || phase_0 !== top.phase[0]) && top.time_cnt_for_ultrasound !== 0) begin
+        $display("ERR: duty/phase changed at time %d", top.time_cnt_for_ultrasound);
+        $finish;
+    end
+    duty_1 <= top.duty[1];
+    phase_0 <= top.phase[0];
+end
+
+initial begin
+    MRCC_25P6M = 0;
+    CPU_CKIO = 0;
+    RESET_N = 0;
+    CAT_SYNC0 = 0;
+    CPU_CS1_N = 1;
+    CPU_WE0_N = 1;
+    CPU_ADDR = 0;
+    cpu_data = 0;
+    checking = 0;
+    #1000;
+    RESET_N = 1;
+
+    bram_write(BRAM_CONFIG_SELECT, CYCLE_ADDR, ULTRASOUND_CNT_CYCLE);
+    bram_write(BRAM_CONFIG_SELECT, CTRL_FLAGS_ADDR, 16'h0000);
+    set_params(16'd0, 16'd256);
+    write_image();
+    #1000;
+    CAT_SYNC0 = 1;
+    #100;
+    CAT_SYNC0 = 0;
+    wait_periods(3);
+    check_image(16'd0, 16'd256, ULTRASOUND_CNT_CYCLE);
+    checking = 1;
+
+    set_params(16'd100, 16'd128);
+    wait_periods(3);
+    check_image(16'd100, 16'd128, ULTRASOUND_CNT_CYCLE);
+
+    // phase wraps around the cycle
+    set_params(16'd499, 16'd0);
+    wait_periods(3);
+    check_image(16'd499, 16'd0, ULTRASOUND_CNT_CYCLE);
+
+    // scale larger than 1 saturates
+    set_params(16'd0, 16'd1000);
+    wait_periods(3);
+    check_image(16'd0, 16'd1000, ULTRASOUND_CNT_CYCLE);
+
+    // the cycle lowered below the offset: the firmware writes the offset reduced by the new cycle before the cycle
+    checking = 0;
+    set_params(16'd400, 16'd256);
+    wait_periods(3);
+    check_image(16'd400, 16'd256, ULTRASOUND_CNT_CYCLE);
+    bram_write(BRAM_CONFIG_SELECT, PHASE_OFFSET_ADDR, 16'd400 % 16'd300);
+    bram_write(BRAM_CONFIG_SELECT, CYCLE_ADDR, 16'd300);
+    wait_periods(3);
+    check_image(16'd100, 16'd256, 16'd300);
+
+    // the offset which is not less than the cycle is ignored
+    bram_write(BRAM_CONFIG_SELECT, PHASE_OFFSET_ADDR, 16'd400);
+    wait_periods(3);
+    check_image(16'd0, 16'd256, 16'd300);
+
+    // the cycle raised again: the firmware writes the offset after the cycle
+    bram_write(BRAM_CONFIG_SELECT, CYCLE_ADDR, ULTRASOUND_CNT_CYCLE);
+    bram_write(BRAM_CONFIG_SELECT, PHASE_OFFSET_ADDR, 16'd400);
+    wait_periods(3);
+    check_image(16'd400, 16'd256, ULTRASOUND_CNT_CYCLE);
+
+    $display("OK");
+    $finish;
+end
+
+always begin
+    #19.531 MRCC_25P6M = !MRCC_25P6M;
+    #19.531 MRCC_25P6M = !MRCC_25P6M;
+    #19.531 MRCC_25P6M = !MRCC_25P6M;
+    #19.532 MRCC_25P6M = !MRCC_25P6M;
+end
+
+always begin
+    #6.667 CPU_CKIO = !CPU_CKIO;
+end
+
+endmodule
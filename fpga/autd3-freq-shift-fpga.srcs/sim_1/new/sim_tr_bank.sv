@@ -0,0 +1,172 @@
+/*
+ * File: sim_tr_bank.sv
+ * Project: new
+ * Created Date: 19/10/2026
+ * Author: Shun Suzuki
+ * -----
+ * Last Modified: 19/10/2026
+ * Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+ * -----
+ * Copyright (c) 2021 Hapis Lab. All rights reserved.
+ *
+ */
+
+`timescale 1ns / 1ps
+
+module sim_tr_bank();
+
+localparam int TRANS_NUM = 249;
+// the phases written to the banks are up to 2496, and must be less than the cycle, since the phase offset wraps them around the cycle
+localparam int ULTRASOUND_CNT_CYCLE = 5000;
+
+localparam [3:0] BRAM_TR_SELECT = 4'h0;
+localparam [3:0] BRAM_CONFIG_SELECT = 4'hF;
+localparam [10:0] CTRL_FLAGS_ADDR = 11'h000;
+localparam [10:0] CYCLE_ADDR = 11'h010;
+localparam [10:0] DUTY_SCALE_ADDR = 11'h012;
+localparam [10:0] BANK_SIZE = 11'h200;
+
+logic MRCC_25P6M;
+logic RESET_N;
+logic CPU_CKIO;
+logic CAT_SYNC0;
+logic CPU_CS1_N;
+logic CPU_WE0_N;
+logic [16:0] CPU_ADDR;
+logic [15:0] cpu_data;
+tri [15:0] CPU_DATA;
+logic [252:1] XDCR_OUT;
+
+assign CPU_DATA = ~CPU_WE0_N ? cpu_data : 16'bz;
+
+top top(
+        .CPU_ADDR(CPU_ADDR),
+        .CPU_DATA(CPU_DATA),
+        .CPU_CKIO(CPU_CKIO),
+        .CPU_CS1_N(CPU_CS1_N),
+        .RESET_N(RESET_N),
+        .CPU_WE0_N(CPU_WE0_N),
+        .CPU_WE1_N(1'b1),
+        .CPU_RD_N(1'b1),
+        .CPU_RDWR(1'b0),
+        .MRCC_25P6M(MRCC_25P6M),
+        .CAT_SYNC0(CAT_SYNC0),
+        .FORCE_FAN(),
+        .THERMO(1'b0),
+        .XDCR_OUT(XDCR_OUT),
+        .GPIO_IN(4'd0),
+        .GPIO_OUT()
+    );
+
+task bram_write(input [3:0] select, input [10:0] addr, input [15:0] data);
+    @(posedge CPU_CKIO);
+    CPU_ADDR <= {select, 1'b0, addr, 1'b0};
+    cpu_data <= data;
+    CPU_CS1_N <= 0;
+    CPU_WE0_N <= 0;
+    @(posedge CPU_CKIO);
+    CPU_CS1_N <= 1;
+    CPU_WE0_N <= 1;
+endtask
+
+// write duty = base + i and phase = base + 2 * i to the bank
+task write_image(input bank, input [15:0] base, input int num);
+    for (int i = 0; i < num; i++) begin
+        bram_write(BRAM_TR_SELECT, (bank ? BANK_SIZE : 11'h000) + 2 * i, base + 2 * i);
+        bram_write(BRAM_TR_SELECT, (bank ? BANK_SIZE : 11'h000) + 2 * i + 1, base + i);
+    end
+endtask
+
+task check_image(input [15:0] base);
+    for (int i = 0; i < TRANS_NUM; i++) begin
+        if (top.duty[i] !== base + i || top.phase[i] !== base + 2 * i) begin
+            $display("ERR: tr %d: duty = %d, phase = %d, expected base = %d", i, top.duty[i], top.phase[i], base);
+            $finish;
+        end
+    end
+endtask
+
+task wait_periods(input int n);
+    repeat(n * ULTRASOUND_CNT_CYCLE) @(posedge top.sys_clk);
+endtask
+
+// duty and phase of all transducers must be updated at once at the period boundary
+logic checking;
+logic [15:0] duty_0, phase_0;
+always @(negedge top.sys_clk) begin
+    if (checking && (duty_0 !== top.duty[0] || phase_0 !== top.phase[0])) begin
+        if (top.time_cnt_for_ultrasound !== 0) begin
+            $display("ERR: duty/phase changed at time %d", top.time_cnt_for_ultrasound);
+            $finish;
+        end
+        for (int i = 0; i < TRANS_NUM; i++) begin
+            if (top.duty[i] !== top.duty[0] + i || top.phase[i] !== top.duty[0] + 2 * i) begin
+                $display("ERR: torn update at tr %d", i);
+                $finish;
+            end
+        end
+    end
+    duty_0 <= top.duty[0];
+    phase_0 <= top.phase[0];
+end
+
+initial begin
+    MRCC_25P6M = 0;
+    CPU_CKIO = 0;
+    RESET_N = 0;
+    CAT_SYNC0 = 0;
+    CPU_CS1_N = 1;
+    CPU_WE0_N = 1;
+    CPU_ADDR = 0;
+    cpu_data = 0;
+    checking = 0;
+    #1000;
+    RESET_N = 1;
+
+    bram_write(BRAM_CONFIG_SELECT, CYCLE_ADDR, ULTRASOUND_CNT_CYCLE);
+    bram_write(BRAM_CONFIG_SELECT, DUTY_SCALE_ADDR, 16'd256);
+    bram_write(BRAM_CONFIG_SELECT, CTRL_FLAGS_ADDR, 16'h0000);
+    write_image(0, 16'd0, TRANS_NUM);
+    #1000;
+    CAT_SYNC0 = 1;
+    #100;
+    CAT_SYNC0 = 0;
+    wait_periods(3);
+    check_image(16'd0);
+    checking = 1;
+
+    // writing to the back bank must not affect the output
+    write_image(1, 16'd1000, TRANS_NUM);
+    wait_periods(3);
+    check_image(16'd0);
+
+    bram_write(BRAM_CONFIG_SELECT, CTRL_FLAGS_ADDR, 16'h0001);
+    wait_periods(3);
+    check_image(16'd1000);
+
+    // half-written image in the back bank must not be seen
+    write_image(0, 16'd2000, TRANS_NUM / 2);
+    wait_periods(3);
+    check_image(16'd1000);
+
+    write_image(0, 16'd2000, TRANS_NUM);
+    bram_write(BRAM_CONFIG_SELECT, CTRL_FLAGS_ADDR, 16'h0000);
+    wait_periods(3);
+    check_image(16'd2000);
+
+    $display("OK");
+    $finish;
+end
+
+always begin
+    #19.531 MRCC_25P6M = !MRCC_25P6M;
+    #19.531 MRCC_25P6M = !MRCC_25P6M;
+    #19.531 MRCC_25P6M = !MRCC_25P6M;
+    #19.532 MRCC_25P6M = !MRCC_25P6M;
+end
+
+always begin
+    #6.667 CPU_CKIO = !CPU_CKIO;
+end
+
+endmodule
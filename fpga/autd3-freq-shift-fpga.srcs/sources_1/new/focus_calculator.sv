@@ -0,0 +1,170 @@
+/*
+ * File: focus_calculator.sv
+ * Project: new
+ * Created Date: 19/10/2026
+ * Author: Shun Suzuki
+ * -----
+ * Last Modified: 19/10/2026
+ * Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+ * -----
+ * Copyright (c) 2021 Hapis Lab. All rights reserved.
+ * 
+ */
+
+`timescale 1ns / 1ps
+
+// Calculate phases of all transducers to make a focus.
+// FOCUS_X/Y/Z are in the local coordinate of the device, in units of 1/1024 mm.
+// SOUND_SPEED_FACTOR is (base clock frequency) / (sound speed) in units of 1/65536 [clk/mm].
+// The phase is round(mod(dist * SOUND_SPEED_FACTOR + CYCLE / 2, CYCLE)), which is the same as Utilities::to_phase in the host software,
+// except that a phase rounded up to CYCLE is output as 0, so that the phase is always less than CYCLE.
+// After START, phases are output one per clock with TR_IDX and VALID.
+module focus_calculator(
+           input var CLK,
+           input var START,
+           input var signed [31:0] FOCUS_X,
+           input var signed [31:0] FOCUS_Y,
+           input var signed [31:0] FOCUS_Z,
+           input var [31:0] SOUND_SPEED_FACTOR,
+           input var [15:0] CYCLE,
+           output var [15:0] PHASE,
+           output var [7:0] TR_IDX,
+           output var VALID
+       );
+
+localparam int NUM_TRANS_X = 18;
+localparam int NUM_TRANS_Y = 14;
+localparam [31:0] TRANS_SPACING_Q20 = 32'd10653532; // 10.16 mm * 2^20
+
+localparam int SQRT_WIDTH = 66;
+localparam int MOD_WIDTH = 26;
+localparam int LATENCY = 1 + 3 + 1 + SQRT_WIDTH/2 + 3 + 1 + MOD_WIDTH + 1;
+
+function automatic [27:0] tr_pos (input [4:0] i);
+    tr_pos = (i * TRANS_SPACING_Q20 + 32'd512) >> 10;
+endfunction
+
+function automatic is_missing_transducer (input [4:0] x, input [3:0] y);
+    is_missing_transducer = (y == 1) && (x == 1 || x == 2 || x == 16);
+endfunction
+
+logic running;
+logic [4:0] ix;
+logic [3:0] iy;
+logic [7:0] idx;
+
+logic signed [31:0] fx, fy, fz;
+logic [31:0] k;
+logic [15:0] cycle;
+
+logic valid_a;
+logic [7:0] idx_a;
+logic [27:0] tx_a, ty_a;
+
+logic signed [32:0] dx, dy, dz;
+logic [65:0] dx2[0:2], dy2[0:2], dz2[0:2];
+logic [SQRT_WIDTH-1:0] dist2;
+logic [SQRT_WIDTH/2-1:0] dist;
+logic [64:0] prod[0:2];
+logic [MOD_WIDTH-1:0] half_ticks;
+logic [16:0] rem;
+logic [16:0] rounded;
+
+logic valid_d[0:LATENCY-1];
+logic [7:0] idx_d[0:LATENCY-1];
+
+assign VALID = valid_d[LATENCY-1];
+assign TR_IDX = idx_d[LATENCY-1];
+
+always_ff @(posedge CLK) begin
+    if (START) begin
+        running <= 1'b1;
+        ix <= 0;
+        iy <= 0;
+        idx <= 0;
+        fx <= FOCUS_X;
+        fy <= FOCUS_Y;
+        fz <= FOCUS_Z;
+        k <= SOUND_SPEED_FACTOR;
+        cycle <= CYCLE;
+        valid_a <= 1'b0;
+    end
+    else if (running) begin
+        valid_a <= ~is_missing_transducer(ix, iy);
+        idx_a <= idx;
+        tx_a <= tr_pos(ix);
+        ty_a <= tr_pos({1'b0, iy});
+        idx <= is_missing_transducer(ix, iy) ? idx : idx + 1;
+        if (ix == NUM_TRANS_X - 1) begin
+            ix <= 0;
+            iy <= iy + 1;
+            running <= (iy != NUM_TRANS_Y - 1);
+        end
+        else begin
+            ix <= ix + 1;
+        end
+    end
+    else begin
+        valid_a <= 1'b0;
+    end
+end
+
+always_ff @(posedge CLK) begin
+    dx <= {fx[31], fx} - {5'd0, tx_a};
+    dy <= {fy[31], fy} - {5'd0, ty_a};
+    dz <= {fz[31], fz};
+
+    dx2[0] <= dx * dx;
+    dy2[0] <= dy * dy;
+    dz2[0] <= dz * dz;
+    for (int i = 1; i < 3; i++) begin
+        dx2[i] <= dx2[i-1];
+        dy2[i] <= dy2[i-1];
+        dz2[i] <= dz2[i-1];
+    end
+
+    dist2 <= dx2[2] + dy2[2] + dz2[2];
+end
+
+sqrt_pipeline#(
+                 .WIDTH(SQRT_WIDTH)
+             ) sqrt_pipeline(
+                 .CLK(CLK),
+                 .X(dist2),
+                 .Q(dist)
+             );
+
+// dist [1/1024 mm] * k [1/65536 clk/mm] is in units of 2^-26 clk. It is rounded to the half clock and shifted by CYCLE/2.
+always_ff @(posedge CLK) begin
+    prod[0] <= dist * k;
+    prod[1] <= prod[0];
+    prod[2] <= prod[1];
+    half_ticks <= ((prod[2] + 65'd16777216) >> 25) + cycle;
+end
+
+remainder_pipeline#(
+                      .WIDTH(MOD_WIDTH),
+                      .D_WIDTH(17)
+                  ) remainder_pipeline(
+                      .CLK(CLK),
+                      .A(half_ticks),
+                      .D({cycle, 1'b0}),
+                      .R(rem)
+                  );
+
+assign rounded = (rem + 17'd1) >> 1;
+
+always_ff @(posedge CLK) begin
+    PHASE <= (rounded[15:0] == cycle) ? 16'd0 : rounded[15:0];
+end
+
+always_ff @(posedge CLK) begin
+    valid_d[0] <= valid_a;
+    idx_d[0] <= idx_a;
+    for (int i = 1; i < LATENCY; i++) begin
+        valid_d[i] <= valid_d[i-1];
+        idx_d[i] <= idx_d[i-1];
+    end
+end
+
+endmodule
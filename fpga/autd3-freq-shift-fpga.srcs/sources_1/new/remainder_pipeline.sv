@@ -0,0 +1,50 @@
+/*
+ * File: remainder_pipeline.sv
+ * Project: new
+ * Created Date: 19/10/2026
+ * Author: Shun Suzuki
+ * -----
+ * Last Modified: 19/10/2026
+ * Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+ * -----
+ * Copyright (c) 2021 Hapis Lab. All rights reserved.
+ * 
+ */
+
+`timescale 1ns / 1ps
+
+// A mod D. One result per clock, latency = WIDTH
+module remainder_pipeline#(
+           parameter int WIDTH = 24,
+           parameter int D_WIDTH = 17
+       )(
+           input var CLK,
+           input var [WIDTH-1:0] A,
+           input var [D_WIDTH-1:0] D,
+           output var [D_WIDTH-1:0] R
+       );
+
+logic [WIDTH-1:0] a[0:WIDTH];
+logic [D_WIDTH-1:0] d[0:WIDTH];
+logic [D_WIDTH-1:0] r[0:WIDTH];
+
+assign a[0] = A;
+assign d[0] = D;
+assign r[0] = 0;
+assign R = r[WIDTH];
+
+generate begin:STAGES_GEN
+        genvar i;
+        for(i = 0; i < WIDTH; i++) begin
+            logic [D_WIDTH:0] rr;
+            assign rr = {r[i], a[i][WIDTH-1]};
+            always_ff @(posedge CLK) begin
+                a[i+1] <= {a[i][WIDTH-2:0], 1'b0};
+                d[i+1] <= d[i];
+                r[i+1] <= (rr >= {1'b0, d[i]}) ? rr - {1'b0, d[i]} : rr[D_WIDTH-1:0];
+            end
+        end
+    end
+endgenerate
+
+endmodule
@@ -0,0 +1,58 @@
+/*
+ * File: sqrt_pipeline.sv
+ * Project: new
+ * Created Date: 19/10/2026
+ * Author: Shun Suzuki
+ * -----
+ * Last Modified: 19/10/2026
+ * Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+ * -----
+ * Copyright (c) 2021 Hapis Lab. All rights reserved.
+ * 
+ */
+
+`timescale 1ns / 1ps
+
+// Integer square root (floor) of X. One result per clock, latency = WIDTH/2
+module sqrt_pipeline#(
+           parameter int WIDTH = 64
+       )(
+           input var CLK,
+           input var [WIDTH-1:0] X,
+           output var [WIDTH/2-1:0] Q
+       );
+
+localparam int STAGES = WIDTH/2;
+
+logic [WIDTH-1:0] x[0:STAGES];
+logic [WIDTH/2+1:0] r[0:STAGES];
+logic [WIDTH/2-1:0] q[0:STAGES];
+
+assign x[0] = X;
+assign r[0] = 0;
+assign q[0] = 0;
+assign Q = q[STAGES];
+
+generate begin:STAGES_GEN
+        genvar i;
+        for(i = 0; i < STAGES; i++) begin
+            logic [WIDTH/2+3:0] rr;
+            logic [WIDTH/2+3:0] t;
+            assign rr = {r[i], x[i][WIDTH-1:WIDTH-2]};
+            assign t = {2'b00, q[i], 2'b01};
+            always_ff @(posedge CLK) begin
+                x[i+1] <= {x[i][WIDTH-3:0], 2'b00};
+                if (rr >= t) begin
+                    r[i+1] <= rr[WIDTH/2+1:0] - t[WIDTH/2+1:0];
+                    q[i+1] <= {q[i][WIDTH/2-2:0], 1'b1};
+                end
+                else begin
+                    r[i+1] <= rr[WIDTH/2+1:0];
+                    q[i+1] <= {q[i][WIDTH/2-2:0], 1'b0};
+                end
+            end
+        end
+    end
+endgenerate
+
+endmodule
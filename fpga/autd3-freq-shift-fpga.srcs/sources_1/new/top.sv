@@ -4,7 +4,7 @@
  * Created Date: 27/03/2021
  * Author: Shun Suzuki
  * -----
- * Last Modified: 10/10/2021
+ * Last Modified: 19/10/2026
  * Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
  * -----
  * Copyright (c) 2021 Hapis Lab. All rights reserved.
@@ -42,6 +42,21 @@ localparam [3:0] BRAM_CONFIG_SELECT = 4'hF;
 localparam [7:0] CTRL_FLAGS_ADDR = 8'h0;
 localparam [7:0] FPGA_INFO_ADDR = 8'h1;
 localparam [7:0] CYCLE_ADDR = 8'h10;
+localparam [7:0] PHASE_OFFSET_ADDR = 8'h11;
+localparam [7:0] DUTY_SCALE_ADDR = 8'h12;
+localparam [7:0] APPLY_AT_ADDR = 8'h13;
+localparam [7:0] SYNC0_CNT_LOAD_ADDR = 8'h14;
+
+// duty scale in 1/256, where 256 = 1.0 and larger values saturate
+localparam [WIDTH-1:0] DUTY_SCALE_ONE = 16'd256;
+
+localparam int CTRL_FLAG_BANK = 0;
+localparam int CTRL_FLAG_FOCUS_MODE = 1;
+localparam int CTRL_FLAG_APPLY_AT = 2;
+localparam int CTRL_FLAG_SYNC0_LOAD = 3;
+localparam int CTRL_FLAG_PAUSE = 4;
+
+localparam [7:0] FOCUS_PARAM_ADDR = 8'hF9;
 
 logic sys_clk;
 logic bus_clk;
@@ -56,6 +71,11 @@ logic tr_wea;
 logic config_wea;
 
 logic [WIDTH-1:0] cycle;
+logic [WIDTH-1:0] phase_offset;
+logic [WIDTH-1:0] duty_scale;
+logic [15:0] apply_at;
+logic apply_at_fresh;
+logic [15:0] sync0_load;
 logic [WIDTH-1:0] duty[0:TRANS_NUM-1];
 logic [WIDTH-1:0] phase[0:TRANS_NUM-1];
 
@@ -83,34 +103,102 @@ ultrasound_cnt_clk_gen ultrasound_cnt_clk_gen(
 //////////////////////////////////// Synchronize ///////////////////////////////////////////
 logic [2:0] sync0;
 logic sync0_edge;
+logic [15:0] sync0_cnt;
+logic [15:0] sync0_cnt_next;
+logic sync0_load_toggle;
+logic [15:0] sync0_to_apply_at;
+logic apply_at_reached;
+logic out_bank;
+logic out_focus_mode;
 
 assign sync0_edge = (sync0 == 3'b011);
 
+// sync0_cnt counts the SYNC0 edges. The CPU aligns it to (DC system time) / (SYNC0 cycle time) by toggling CTRL_FLAG_SYNC0_LOAD,
+// so that sync0_load is loaded at the next edge, and the counters of all devices agree.
+assign sync0_cnt_next = (ctrl_flags[CTRL_FLAG_SYNC0_LOAD] != sync0_load_toggle) ? sync0_load : sync0_cnt + 1;
+// reached if sync0_cnt_next - apply_at is not negative in 16 bit, which allows the counter to wrap around
+assign sync0_to_apply_at = sync0_cnt_next - apply_at;
+assign apply_at_reached = ~sync0_to_apply_at[15];
+
 always_ff @(posedge sys_clk) begin
     sync0 <= reset ? 0 : {sync0[1:0], CAT_SYNC0};
     time_cnt_for_ultrasound <= (reset | sync0_edge | time_cnt_for_ultrasound == (cycle - 1)) ? 0 : time_cnt_for_ultrasound + 1;
 end
+
+always_ff @(posedge sys_clk) begin
+    if (reset) begin
+        sync0_cnt <= 0;
+        sync0_load_toggle <= 0;
+    end
+    else if (sync0_edge) begin
+        sync0_cnt <= sync0_cnt_next;
+        sync0_load_toggle <= ctrl_flags[CTRL_FLAG_SYNC0_LOAD];
+    end
+end
+
+// the bank and the mode to output follow ctrl_flags, but if CTRL_FLAG_APPLY_AT is set, they are switched only at the SYNC0 edge
+// at or after apply_at. The new image is loaded at the beginning of the period which starts at the edge.
+// apply_at is read less often than ctrl_flags, so that the edge is not taken until apply_at is read again after the schedule changes.
+always_ff @(posedge sys_clk) begin
+    if (reset) begin
+        out_bank <= 0;
+        out_focus_mode <= 0;
+    end
+    else if (~ctrl_flags[CTRL_FLAG_APPLY_AT] | (sync0_edge & apply_at_reached & apply_at_fresh)) begin
+        out_bank <= ctrl_flags[CTRL_FLAG_BANK];
+        out_focus_mode <= ctrl_flags[CTRL_FLAG_FOCUS_MODE];
+    end
+end
 //////////////////////////////////// Synchronize ///////////////////////////////////////////
 
 //////////////////////////////// Duty and Phase set ////////////////////////////////////////
+// the global duty scale and phase offset of the device are applied once per transducer while the buffers are loaded,
+// so that they share one multiplier and adder instead of one per pwm_generator
+function automatic [WIDTH-1:0] scale_duty(input [WIDTH-1:0] d, input [WIDTH-1:0] s);
+    logic [WIDTH+8:0] p;
+    p = d * ((s > DUTY_SCALE_ONE) ? DUTY_SCALE_ONE[8:0] : s[8:0]);
+    return p[WIDTH+7:8];
+endfunction
+
+// the firmware keeps offset less than cycle, and an offset which is not, e.g. while cycle and offset are read in different rounds,
+// is ignored so that the phase stays less than cycle
+function automatic [WIDTH-1:0] offset_phase(input [WIDTH-1:0] p, input [WIDTH-1:0] offset, input [WIDTH-1:0] c);
+    logic [WIDTH:0] sum;
+    sum = p + ((offset < c) ? offset : {WIDTH{1'b0}});
+    return (sum >= c) ? sum - c : sum[WIDTH-1:0];
+endfunction
+
 logic [7:0] tr_cnt_write;
-logic [7:0] tr_bram_addr;
+logic [8:0] tr_bram_addr;
 logic [31:0] tr_bram_dataout;
 logic [WIDTH-1:0] duty_buf[0:TRANS_NUM-1];
 logic [WIDTH-1:0] phase_buf[0:TRANS_NUM-1];
 
+logic [2:0] focus_param_cnt;
+logic signed [31:0] focus_x, focus_y, focus_z;
+logic [WIDTH-1:0] focus_duty;
+logic [31:0] focus_k;
+logic focus_start;
+logic [WIDTH-1:0] focus_phase;
+logic [7:0] focus_tr_idx;
+logic focus_valid;
+
 enum logic [2:0] {
          IDLE,
          DUTY_PHASE_WAIT_0,
          DUTY_PHASE_WAIT_1,
-         DUTY_PHASE
+         DUTY_PHASE,
+         FOCUS_WAIT_0,
+         FOCUS_WAIT_1,
+         FOCUS_PARAM,
+         FOCUS_CALC
      } tr_state;
 
 tr_bram tr_bram(
             .clka(bus_clk),
             .ena(~CPU_CS1_N),
             .wea(tr_wea),
-            .addra(cpu_addr[8:0]),
+            .addra(cpu_addr[9:0]),
             .dina(CPU_DATA),
             .douta(),
             .clkb(sys_clk),
@@ -120,20 +208,42 @@ tr_bram tr_bram(
             .doutb(tr_bram_dataout)
         );
 
+focus_calculator focus_calculator(
+                     .CLK(sys_clk),
+                     .START(focus_start),
+                     .FOCUS_X(focus_x),
+                     .FOCUS_Y(focus_y),
+                     .FOCUS_Z(focus_z),
+                     .SOUND_SPEED_FACTOR(focus_k),
+                     .CYCLE(cycle),
+                     .PHASE(focus_phase),
+                     .TR_IDX(focus_tr_idx),
+                     .VALID(focus_valid)
+                 );
+
 always_ff @(posedge sys_clk) begin
     if (reset) begin
         tr_bram_addr <= 0;
         tr_state <= IDLE;
         tr_cnt_write <= 0;
+        focus_param_cnt <= 0;
+        focus_start <= 0;
         duty_buf <= '{TRANS_NUM{0}};
         phase_buf <= '{TRANS_NUM{0}};
     end
     else begin
         case(tr_state)
             IDLE: begin
+                // the bank is latched here, so that duty and phase of one period always come from the same bank
                 if (time_cnt_for_ultrasound == 10'd0) begin
-                    tr_bram_addr <= 8'd0;
-                    tr_state <= DUTY_PHASE_WAIT_0;
+                    if (out_focus_mode) begin
+                        tr_bram_addr <= {out_bank, FOCUS_PARAM_ADDR};
+                        tr_state <= FOCUS_WAIT_0;
+                    end
+                    else begin
+                        tr_bram_addr <= {out_bank, 8'd0};
+                        tr_state <= DUTY_PHASE_WAIT_0;
+                    end
                 end
             end
             DUTY_PHASE_WAIT_0: begin
@@ -146,10 +256,10 @@ always_ff @(posedge sys_clk) begin
                 tr_state <= DUTY_PHASE;
             end
             DUTY_PHASE: begin
-                duty_buf[tr_cnt_write] <= tr_bram_dataout[16+WIDTH-1:16];
-                phase_buf[tr_cnt_write] <= tr_bram_dataout[WIDTH-1:0];
+                duty_buf[tr_cnt_write] <= scale_duty(tr_bram_dataout[16+WIDTH-1:16], duty_scale);
+                phase_buf[tr_cnt_write] <= offset_phase(tr_bram_dataout[WIDTH-1:0], phase_offset, cycle);
                 if (tr_cnt_write == TRANS_NUM - 1) begin
-                    tr_bram_addr <= 8'd0;
+                    tr_bram_addr <= 9'd0;
                     tr_state <= IDLE;
                 end
                 else begin
@@ -158,6 +268,42 @@ always_ff @(posedge sys_clk) begin
                     tr_state <= DUTY_PHASE;
                 end
             end
+            // focus mode: read the focus parameters in the tail of the bank, and calculate the phases of all transducers
+            FOCUS_WAIT_0: begin
+                tr_bram_addr <= tr_bram_addr + 1;
+                tr_state <= FOCUS_WAIT_1;
+            end
+            FOCUS_WAIT_1: begin
+                tr_bram_addr <= tr_bram_addr + 1;
+                focus_param_cnt <= 0;
+                tr_state <= FOCUS_PARAM;
+            end
+            FOCUS_PARAM: begin
+                case(focus_param_cnt)
+                    3'd0: focus_x <= tr_bram_dataout;
+                    3'd1: focus_y <= tr_bram_dataout;
+                    3'd2: focus_z <= tr_bram_dataout;
+                    3'd3: focus_duty <= tr_bram_dataout[WIDTH-1:0];
+                    3'd4: focus_k <= tr_bram_dataout;
+                endcase
+                tr_bram_addr <= tr_bram_addr + 1;
+                focus_param_cnt <= focus_param_cnt + 1;
+                if (focus_param_cnt == 3'd4) begin
+                    focus_start <= 1'b1;
+                    tr_state <= FOCUS_CALC;
+                end
+            end
+            FOCUS_CALC: begin
+                focus_start <= 1'b0;
+                if (focus_valid) begin
+                    duty_buf[focus_tr_idx] <= scale_duty(focus_duty, duty_scale);
+                    phase_buf[focus_tr_idx] <= offset_phase(focus_phase, phase_offset, cycle);
+                    if (focus_tr_idx == TRANS_NUM - 1) begin
+                        tr_bram_addr <= 9'd0;
+                        tr_state <= IDLE;
+                    end
+                end
+            end
         endcase
     end
 end
@@ -167,8 +313,9 @@ always_ff @(posedge sys_clk) begin
         duty <= '{TRANS_NUM{0}};
         phase <= '{TRANS_NUM{0}};
     end
+    // while paused, all pwm_generators are stopped from the next period by duty 0, but the banks are kept to resume
     else if (time_cnt_for_ultrasound == (cycle - 1)) begin
-        duty <= duty_buf;
+        duty <= ctrl_flags[CTRL_FLAG_PAUSE] ? '{TRANS_NUM{0}} : duty_buf;
         phase <= phase_buf;
     end
 end
@@ -179,11 +326,14 @@ logic [15:0] config_bram_din;
 logic [15:0] config_bram_dout;
 logic [7:0] config_bram_addr;
 logic config_web;
+logic [2:0] param_idx;
 
+// each state reads the data of the address which it set in the previous round, because of the latency of config_bram
+// PARAM_READ reads cycle, phase offset, duty scale, apply_at and sync0_load in turn
 enum logic [2:0] {
          CTRL_FLAGS_READ,
          FPGA_INFO_WRITE,
-         CYCLE_READ
+         PARAM_READ
      } config_state;
 
 config_bram config_bram(
@@ -207,23 +357,59 @@ always_ff @(posedge sys_clk) begin
         config_bram_din <= 0;
         config_web <= 0;
         ctrl_flags <= 0;
+        param_idx <= 0;
+        phase_offset <= 0;
+        duty_scale <= DUTY_SCALE_ONE;
+        apply_at <= 0;
+        apply_at_fresh <= 0;
+        sync0_load <= 0;
     end
     else begin
         case(config_state)
             CTRL_FLAGS_READ: begin
                 config_bram_addr <= CTRL_FLAGS_ADDR;
                 ctrl_flags <= config_bram_dout[7:0];
+                // the CPU writes apply_at before ctrl_flags, and apply_at read from the next PARAM_READ on is sampled after them
+                if ((config_bram_dout[CTRL_FLAG_APPLY_AT] != ctrl_flags[CTRL_FLAG_APPLY_AT])
+                        | (config_bram_dout[CTRL_FLAG_BANK] != ctrl_flags[CTRL_FLAG_BANK]))
+                    apply_at_fresh <= 1'b0;
                 config_state <= FPGA_INFO_WRITE;
             end
             FPGA_INFO_WRITE: begin
                 config_bram_addr <= FPGA_INFO_ADDR;
                 config_bram_din <= fpga_info;
                 config_web <= 1'b1;
-                config_state <= CYCLE_READ;
+                config_state <= PARAM_READ;
             end
-            CYCLE_READ: begin
-                config_bram_addr <= CYCLE_ADDR;
-                cycle <= config_bram_dout[WIDTH-1:0];
+            PARAM_READ: begin
+                case(param_idx)
+                    3'd0: begin
+                        cycle <= config_bram_dout[WIDTH-1:0];
+                        config_bram_addr <= PHASE_OFFSET_ADDR;
+                        param_idx <= 3'd1;
+                    end
+                    3'd1: begin
+                        phase_offset <= config_bram_dout[WIDTH-1:0];
+                        config_bram_addr <= DUTY_SCALE_ADDR;
+                        param_idx <= 3'd2;
+                    end
+                    3'd2: begin
+                        duty_scale <= config_bram_dout[WIDTH-1:0];
+                        config_bram_addr <= APPLY_AT_ADDR;
+                        param_idx <= 3'd3;
+                    end
+                    3'd3: begin
+                        apply_at <= config_bram_dout;
+                        apply_at_fresh <= 1'b1;
+                        config_bram_addr <= SYNC0_CNT_LOAD_ADDR;
+                        param_idx <= 3'd4;
+                    end
+                    default: begin
+                        sync0_load <= config_bram_dout;
+                        config_bram_addr <= CYCLE_ADDR;
+                        param_idx <= 3'd0;
+                    end
+                endcase
                 config_web <= 1'b0;
                 config_state <= CTRL_FLAGS_READ;
             end
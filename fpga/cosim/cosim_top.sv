@@ -0,0 +1,58 @@
+/*
+ * File: cosim_top.sv
+ * Project: cosim
+ * Created Date: 19/10/2026
+ * Author: Shun Suzuki
+ * -----
+ * Last Modified: 19/10/2026
+ * Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+ * -----
+ * Copyright (c) 2021 Hapis Lab. All rights reserved.
+ *
+ */
+
+`timescale 1ns / 1ps
+
+// Wrapper of top for Verilator, which splits the bidirectional CPU bus
+module cosim_top(
+           input var [16:0] CPU_ADDR,
+           input var [15:0] CPU_DATA_IN,
+           output var [15:0] CPU_DATA_OUT,
+           input var CPU_CKIO,
+           input var CPU_CS1_N,
+           input var RESET_N,
+           input var CPU_WE0_N,
+           input var CPU_RD_N,
+           input var CPU_RDWR,
+           input var MRCC_25P6M,
+           input var CAT_SYNC0,
+           input var THERMO,
+           output var [252:1] XDCR_OUT,
+           output var [3:0] GPIO_OUT
+       );
+
+tri [15:0] cpu_data;
+
+assign cpu_data = ~CPU_WE0_N ? CPU_DATA_IN : 16'bz;
+assign CPU_DATA_OUT = cpu_data;
+
+top top(
+        .CPU_ADDR(CPU_ADDR),
+        .CPU_DATA(cpu_data),
+        .CPU_CKIO(CPU_CKIO),
+        .CPU_CS1_N(CPU_CS1_N),
+        .RESET_N(RESET_N),
+        .CPU_WE0_N(CPU_WE0_N),
+        .CPU_WE1_N(1'b1),
+        .CPU_RD_N(CPU_RD_N),
+        .CPU_RDWR(CPU_RDWR),
+        .MRCC_25P6M(MRCC_25P6M),
+        .CAT_SYNC0(CAT_SYNC0),
+        .FORCE_FAN(),
+        .THERMO(THERMO),
+        .XDCR_OUT(XDCR_OUT),
+        .GPIO_IN(4'd0),
+        .GPIO_OUT(GPIO_OUT)
+    );
+
+endmodule
@@ -0,0 +1,56 @@
+/*
+ * File: config_bram.sv
+ * Project: ip
+ * Created Date: 19/10/2026
+ * Author: Shun Suzuki
+ * -----
+ * Last Modified: 19/10/2026
+ * Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+ * -----
+ * Copyright (c) 2021 Hapis Lab. All rights reserved.
+ *
+ */
+
+`timescale 1ns / 1ps
+
+// Behavioral model of config_bram for co-simulation
+// 256 x 16 bit true dual port, read latency of both ports is 2 (output of primitives is registered)
+module config_bram#(
+           parameter [15:0] FPGA_VERSION = 16'hF006
+       )(
+           input var clka,
+           input var ena,
+           input var wea,
+           input var [7:0] addra,
+           input var [15:0] dina,
+           output var [15:0] douta,
+           input var clkb,
+           input var web,
+           input var [7:0] addrb,
+           input var [15:0] dinb,
+           output var [15:0] doutb
+       );
+
+logic [15:0] mem[0:255];
+logic [15:0] douta_0, doutb_0;
+
+initial begin
+    for (int i = 0; i < 256; i++) mem[i] = 16'h0000;
+    mem[8'hFF] = FPGA_VERSION;
+end
+
+always_ff @(posedge clka) begin
+    if (ena) begin
+        if (wea) mem[addra] <= dina;
+        douta_0 <= wea ? dina : mem[addra];
+    end
+    douta <= douta_0;
+end
+
+always_ff @(posedge clkb) begin
+    if (web) mem[addrb] <= dinb;
+    doutb_0 <= web ? dinb : mem[addrb];
+    doutb <= doutb_0;
+end
+
+endmodule
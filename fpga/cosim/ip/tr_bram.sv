@@ -0,0 +1,47 @@
+/*
+ * File: tr_bram.sv
+ * Project: ip
+ * Created Date: 19/10/2026
+ * Author: Shun Suzuki
+ * -----
+ * Last Modified: 19/10/2026
+ * Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+ * -----
+ * Copyright (c) 2021 Hapis Lab. All rights reserved.
+ *
+ */
+
+`timescale 1ns / 1ps
+
+// Behavioral model of tr_bram for co-simulation
+// Port A: 1024 x 16 bit, port B: 512 x 32 bit, read latency of port B is 2 (output of primitives is registered)
+module tr_bram(
+           input var clka,
+           input var ena,
+           input var wea,
+           input var [9:0] addra,
+           input var [15:0] dina,
+           output var [15:0] douta,
+           input var clkb,
+           input var web,
+           input var [8:0] addrb,
+           input var [31:0] dinb,
+           output var [31:0] doutb
+       );
+
+logic [15:0] mem[0:1023];
+logic [31:0] doutb_0;
+
+always_ff @(posedge clka) begin
+    if (ena) begin
+        if (wea) mem[addra] <= dina;
+        douta <= mem[addra];
+    end
+end
+
+always_ff @(posedge clkb) begin
+    doutb_0 <= {mem[{addrb, 1'b1}], mem[{addrb, 1'b0}]};
+    doutb <= doutb_0;
+end
+
+endmodule
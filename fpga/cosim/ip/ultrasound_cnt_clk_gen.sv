@@ -0,0 +1,25 @@
+/*
+ * File: ultrasound_cnt_clk_gen.sv
+ * Project: ip
+ * Created Date: 19/10/2026
+ * Author: Shun Suzuki
+ * -----
+ * Last Modified: 19/10/2026
+ * Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+ * -----
+ * Copyright (c) 2021 Hapis Lab. All rights reserved.
+ *
+ */
+
+`timescale 1ns / 1ps
+
+// Behavioral model of the clocking wizard for co-simulation. The harness drives clk_in1 at the output frequency (200MHz).
+module ultrasound_cnt_clk_gen(
+           input var clk_in1,
+           input var reset,
+           output var clk_out1
+       );
+
+assign clk_out1 = clk_in1;
+
+endmodule
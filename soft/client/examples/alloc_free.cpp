@@ -0,0 +1,143 @@
+// File: alloc_free.cpp
+// Project: examples
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// Check that sending and re-building gains allocate no memory from the heap after warm-up.
+// All the forms of the global operator new, including the aligned ones used by the pool to allocate its chunks, are replaced to count
+// allocations, and the program fails if any allocation happens in the measured loop.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <vector>
+
+#include "autd3-freq-shift.hpp"
+#include "autd3-freq-shift/core/ec_config.hpp"
+#include "autd3-freq-shift/core/utils.hpp"
+
+namespace {
+std::atomic<size_t> num_allocations{0};
+
+void* allocate(const size_t size, const size_t alignment = alignof(std::max_align_t)) {
+  num_allocations.fetch_add(1, std::memory_order_relaxed);
+  const auto n = (std::max<size_t>(size, 1) + alignment - 1) / alignment * alignment;
+#ifdef _WIN32
+  void* p = _aligned_malloc(n, alignment);
+#else
+  void* p = std::aligned_alloc(alignment, n);
+#endif
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+void deallocate(void* p) noexcept {
+#ifdef _WIN32
+  _aligned_free(p);
+#else
+  std::free(p);
+#endif
+}
+}  // namespace
+
+// every form is replaced, so that the pairs of new and delete are consistent
+void* operator new(const size_t size) { return allocate(size); }
+void* operator new[](const size_t size) { return allocate(size); }
+void* operator new(const size_t size, const std::align_val_t alignment) { return allocate(size, static_cast<size_t>(alignment)); }
+void* operator new[](const size_t size, const std::align_val_t alignment) { return allocate(size, static_cast<size_t>(alignment)); }
+void operator delete(void* p) noexcept { deallocate(p); }
+void operator delete[](void* p) noexcept { deallocate(p); }
+void operator delete(void* p, size_t) noexcept { deallocate(p); }
+void operator delete[](void* p, size_t) noexcept { deallocate(p); }
+void operator delete(void* p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { deallocate(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { deallocate(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { deallocate(p); }
+
+class FocalPointGain final : public autd::core::Gain {
+ public:
+  void calc(const autd::GeometryPtr& geometry) override {
+    for (size_t dev_idx = 0; dev_idx < geometry->num_devices(); dev_idx++) {
+      const uint16_t freq_cycle = geometry->freq_cycle(dev_idx);
+      const double wavenum = 2.0 * M_PI / geometry->wavelength(dev_idx);
+      for (size_t i = 0; i < autd::NUM_TRANS_IN_UNIT; i++) {
+        const auto dist = (geometry->position(dev_idx, i) - this->point).norm();
+        this->_duties[dev_idx][i] = autd::core::Utilities::to_duty(1.0, freq_cycle);
+        this->_phases[dev_idx][i] = autd::core::Utilities::to_phase(dist * wavenum, freq_cycle);
+      }
+    }
+  }
+
+  FocalPointGain() : Gain() {}
+
+  autd::Vector3 point = autd::Vector3::Zero();
+};
+
+/**
+ * @brief Link which acknowledges every frame immediately
+ */
+class LoopbackLink final : public autd::core::Link {
+ public:
+  explicit LoopbackLink(const size_t num_devices) : _num_devices(num_devices), _tx(num_devices * autd::core::EC_OUTPUT_FRAME_SIZE) {}
+
+  void open(const autd::core::LinkConfiguration&) override { _is_open = true; }
+  void reconfigure(const autd::core::LinkConfiguration&) override {}
+  void close() override { _is_open = false; }
+  void send(const uint8_t* buf, const size_t size) override { std::memcpy(_tx.data(), buf, std::min(size, _tx.size())); }
+  void read(uint8_t* rx, const size_t buffer_len) override {
+    for (size_t dev = 0; dev < _num_devices && (dev + 1) * autd::core::EC_INPUT_FRAME_SIZE <= buffer_len; dev++) {
+      std::memset(&rx[dev * autd::core::EC_INPUT_FRAME_SIZE], 0, autd::core::EC_INPUT_FRAME_SIZE);
+      rx[dev * autd::core::EC_INPUT_FRAME_SIZE + 1] = _tx[0];
+    }
+  }
+  bool is_open() override { return _is_open; }
+
+ private:
+  size_t _num_devices;
+  std::vector<uint8_t> _tx;
+  bool _is_open = false;
+};
+
+constexpr size_t NUM_DEVICES = 2;
+// the pool grows its chunks a few times during the first thousands of sends
+constexpr size_t WARM_UP = 5000;
+constexpr size_t ITERATIONS = 10000;
+
+int main() try {
+  const auto cnt = autd::Controller::create();
+  for (size_t i = 0; i < NUM_DEVICES; i++) cnt->geometry()->add_device(autd::Vector3(autd::DEVICE_WIDTH * i, 0, 0), autd::Vector3(0, 0, 0));
+  cnt->open(std::make_unique<LoopbackLink>(NUM_DEVICES));
+
+  const auto g = cnt->create_gain<FocalPointGain>();
+  const auto step = [&cnt, &g](const size_t n) {
+    g->point = autd::Vector3(90.0 + static_cast<double>(n % 10), 70.0, 150.0);
+    g->rebuild(cnt->geometry());
+    if (!cnt->send(g)) throw std::runtime_error("Failed to send");
+    if (n % 10 == 0 && !cnt->send_focus(g->point)) throw std::runtime_error("Failed to send focus");
+    if (n % 100 == 0 && !cnt->stop()) throw std::runtime_error("Failed to stop");
+  };
+
+  for (size_t n = 0; n < WARM_UP; n++) step(n);
+
+  const auto before = num_allocations.load();
+  for (size_t n = 0; n < ITERATIONS; n++) step(n);
+  const auto allocations = num_allocations.load() - before;
+
+  cnt->close();
+
+  std::cout << allocations << " allocations in " << ITERATIONS << " iterations" << std::endl;
+  return allocations == 0 ? 0 : 1;
+} catch (std::exception& e) {
+  std::cerr << e.what() << std::endl;
+  return ENXIO;
+}
@@ -0,0 +1,100 @@
+// File: command_queue.cpp
+// Project: examples
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// Throughput of the command queue of a Controller driven from several producer threads with a loopback link.
+// "sync" producers wait for each command, which they process by themselves if no other thread does, and "async" producers keep up to
+// COMMAND_QUEUE_SIZE commands in flight, which the worker processes.
+// Note that the numbers on a machine with fewer cores than producers + 1 (the worker) are dominated by the thread switches.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "autd3-freq-shift.hpp"
+#include "autd3-freq-shift/core/ec_config.hpp"
+
+/**
+ * @brief Link which acknowledges every frame immediately
+ */
+class LoopbackLink final : public autd::core::Link {
+ public:
+  explicit LoopbackLink(const size_t num_devices) : _num_devices(num_devices), _tx(num_devices * autd::core::EC_OUTPUT_FRAME_SIZE) {}
+
+  void open(const autd::core::LinkConfiguration&) override { _is_open = true; }
+  void reconfigure(const autd::core::LinkConfiguration&) override {}
+  void close() override { _is_open = false; }
+  void send(const uint8_t* buf, const size_t size) override { std::memcpy(_tx.data(), buf, std::min(size, _tx.size())); }
+  void read(uint8_t* rx, const size_t buffer_len) override {
+    for (size_t dev = 0; dev < _num_devices && (dev + 1) * autd::core::EC_INPUT_FRAME_SIZE <= buffer_len; dev++) {
+      std::memset(&rx[dev * autd::core::EC_INPUT_FRAME_SIZE], 0, autd::core::EC_INPUT_FRAME_SIZE);
+      rx[dev * autd::core::EC_INPUT_FRAME_SIZE + 1] = _tx[0];
+    }
+  }
+  bool is_open() override { return _is_open; }
+
+ private:
+  size_t _num_devices;
+  std::vector<uint8_t> _tx;
+  bool _is_open = false;
+};
+
+constexpr size_t NUM_DEVICES = 2;
+constexpr auto DURATION = std::chrono::milliseconds(500);
+
+double measure(const unsigned int num_producers, const bool sync) {
+  const auto cnt = autd::Controller::create();
+  for (size_t i = 0; i < NUM_DEVICES; i++) cnt->geometry()->add_device(autd::Vector3(autd::DEVICE_WIDTH * i, 0, 0), autd::Vector3(0, 0, 0));
+  cnt->open(std::make_unique<LoopbackLink>(NUM_DEVICES));
+
+  // global params are FIFO commands, which are never dropped
+  std::vector<size_t> counts(num_producers, 0);
+  std::vector<std::thread> producers;
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned int p = 0; p < num_producers; p++)
+    producers.emplace_back([&cnt, &counts, p, sync, start] {
+      const autd::core::GlobalParams params{0.1 * static_cast<double>(p), 1.0};
+      std::deque<std::future<bool>> in_flight;
+      while (std::chrono::steady_clock::now() - start < DURATION) {
+        in_flight.emplace_back(cnt->set_global_params_async(params));
+        while (!in_flight.empty() && (sync || in_flight.size() >= autd::core::COMMAND_QUEUE_SIZE)) {
+          if (!in_flight.front().get()) throw std::runtime_error("Failed to send");
+          in_flight.pop_front();
+          counts[p]++;
+        }
+      }
+      for (auto& f : in_flight) counts[p] += f.get() ? 1 : 0;
+    });
+  for (auto& th : producers) th.join();
+  const auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  cnt->close();
+
+  size_t total = 0;
+  for (const auto c : counts) total += c;
+  return static_cast<double>(total) / elapsed;
+}
+
+int main() try {
+  std::cout << std::thread::hardware_concurrency() << " hardware thread(s)" << std::endl;
+  for (const auto sync : {true, false})
+    for (const unsigned int num_producers : {1u, 2u, 4u})
+      std::cout << (sync ? "sync " : "async") << " x " << num_producers << ": " << static_cast<size_t>(measure(num_producers, sync)) << " commands/s"
+                << std::endl;
+  return 0;
+} catch (std::exception& e) {
+  std::cerr << e.what() << std::endl;
+  return ENXIO;
+}
@@ -0,0 +1,104 @@
+// File: cosim.cpp
+// Project: examples
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#include "autd3-freq-shift/link/cosim.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+
+#include "autd3-freq-shift.hpp"
+#include "autd3-freq-shift/core/utils.hpp"
+
+class FocalPointGain final : public autd::core::Gain {
+ public:
+  static autd::GainPtr create(const autd::Vector3& point) { return std::make_shared<FocalPointGain>(std::forward<const autd::Vector3>(point)); }
+
+  void calc(const autd::GeometryPtr& geometry) override {
+    for (size_t dev_idx = 0; dev_idx < geometry->num_devices(); dev_idx++) {
+      const uint16_t freq_cycle = geometry->freq_cycle(dev_idx);
+      const double wavenum = 2.0 * M_PI / geometry->wavelength(dev_idx);
+      for (size_t i = 0; i < autd::NUM_TRANS_IN_UNIT; i++) {
+        const auto& trp = geometry->position(dev_idx, i);
+        const auto dist = (trp - this->_point).norm();
+        const auto phase = autd::core::Utilities::to_phase(dist * wavenum, freq_cycle);
+        this->_duties[dev_idx][i] = autd::core::Utilities::to_duty(1.0, freq_cycle);
+        this->_phases[dev_idx][i] = phase;
+      }
+    }
+  }
+
+  explicit FocalPointGain(const autd::Vector3& point) : Gain(), _point(std::forward<const autd::Vector3>(point)) {}
+
+ private:
+  autd::Vector3 _point = autd::Vector3::Zero();
+};
+
+void print_latencies(const std::vector<autd::link::CosimLatency>& latencies) {
+  std::printf("%6s %4s %12s %12s %12s %12s %12s %12s %10s\n", "msg_id", "cmd", "queue [us]", "cycle [us]", "firm [us]", "latch [us]",
+              "output [us]", "total [us]", "bus cycles");
+  for (const auto& l : latencies) {
+    if (l.dropped) {
+      std::printf("%6u 0x%02X %12s\n", l.msg_id, l.command, "dropped");
+      continue;
+    }
+    const auto us = [](const uint64_t ns) { return static_cast<double>(ns) / 1000.0; };
+    std::printf("%6u 0x%02X %12.3f %12.3f %12.3f %12.3f", l.msg_id, l.command, us(l.dequeued_ns - l.sent_ns), us(l.delivered_ns - l.dequeued_ns),
+                us(l.firmware_done_ns - l.delivered_ns), us(l.period_latched_ns - l.firmware_done_ns));
+    if (l.output_changed_ns.has_value())
+      std::printf(" %12.3f %12.3f", us(l.output_changed_ns.value() - l.period_latched_ns), us(l.output_changed_ns.value() - l.sent_ns));
+    else
+      std::printf(" %12s %12s", "-", "-");
+    std::printf(" %10u\n", l.bus_cycles);
+  }
+}
+
+int main() try {
+  const auto cnt = autd::Controller::create();
+
+  cnt->geometry()->sound_speed() = 340e3;  // mm/s
+  cnt->geometry()->add_device(autd::Vector3(0, 0, 0), autd::Vector3(0, 0, 0), 5000);  // 200MHz/5000 = 40kHz
+
+  auto link = autd::link::Cosim::create();
+  auto* cosim = link.get();
+  cnt->open(std::move(link));
+
+  cnt->clear();
+  cnt->set_frequency();
+
+  const auto center = autd::Vector3(autd::TRANS_SPACING_MM * ((autd::NUM_TRANS_X - 1) / 2.0), autd::TRANS_SPACING_MM * ((autd::NUM_TRANS_Y - 1) / 2.0), 150.0);
+  for (int i = 0; i < 4; i++) {
+    const auto g = FocalPointGain::create(center + autd::Vector3(10.0 * i, 0, 0));
+
+    const auto start = std::chrono::high_resolution_clock::now();
+    g->build(cnt->geometry());
+    const auto host_us = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now() - start).count() / 1000.0;
+    std::cout << "gain " << i << ": calculation on host " << host_us << " us" << std::endl;
+
+    cnt->send(g);
+    cosim->advance(1500 * 1000);  // the phase of the previous gain waits in the send queue for the next EtherCAT cycle
+  }
+
+  for (int i = 0; i < 4; i++) {
+    cnt->send_focus(center + autd::Vector3(0, 10.0 * i, 0));
+    cosim->advance(300 * 1000);  // faster than the EtherCAT cycle, so the queued focus is replaced by the next one
+  }
+
+  cosim->advance(10 * 1000 * 1000);  // deliver the queued frames, one per EtherCAT cycle
+  print_latencies(cosim->latencies());
+
+  cnt->close();
+
+  return 0;
+} catch (std::exception& e) {
+  std::cerr << e.what() << std::endl;
+  return ENXIO;
+}
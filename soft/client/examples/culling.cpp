@@ -0,0 +1,81 @@
+// File: culling.cpp
+// Project: examples
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// Calculation time of a focal point with and without culling the devices which do not face it.
+// 500 devices cover the four walls and the ceiling of a room, and the foci are near one of the walls.
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "autd3-freq-shift.hpp"
+#include "autd3-freq-shift/gain/focal_point.hpp"
+
+constexpr size_t N = 10;
+constexpr size_t ITERATIONS = 20;
+
+autd::GeometryPtr room() {
+  auto geometry = std::make_unique<autd::core::Geometry>();
+  const auto w = autd::DEVICE_WIDTH * N;
+  const auto h = autd::DEVICE_HEIGHT * N;
+  const auto rot = [](const double angle, const autd::Vector3& axis) { return autd::Quaternion(Eigen::AngleAxis<double>(angle, axis)); };
+  for (size_t i = 0; i < N; i++)
+    for (size_t j = 0; j < N; j++) {
+      const auto x = autd::DEVICE_WIDTH * static_cast<double>(i);
+      const auto y = autd::DEVICE_HEIGHT * static_cast<double>(j);
+      geometry->add_device(autd::Vector3(x, 0, y), rot(-M_PI / 2, autd::Vector3::UnitX()));                                       // y = 0
+      geometry->add_device(autd::Vector3(x, w, y), rot(M_PI, autd::Vector3::UnitZ()) * rot(-M_PI / 2, autd::Vector3::UnitX()));  // y = w
+      geometry->add_device(autd::Vector3(0, x, y), rot(M_PI / 2, autd::Vector3::UnitY()));                                        // x = 0
+      geometry->add_device(autd::Vector3(w, x, y), rot(-M_PI / 2, autd::Vector3::UnitY()));                                       // x = w
+      geometry->add_device(autd::Vector3(x, autd::DEVICE_WIDTH * static_cast<double>(j), h), rot(M_PI, autd::Vector3::UnitX()));  // ceiling
+    }
+  return geometry;
+}
+
+double measure(const autd::GeometryPtr& geometry, const std::vector<autd::Vector3>& targets, const bool culling, size_t* driven) {
+  const auto g = autd::gain::FocalPoint::create(targets[0]);
+  if (culling) g->set_culling(M_PI / 6, 1000.0);
+
+  *driven = 0;
+  const auto start = std::chrono::high_resolution_clock::now();
+  for (size_t n = 0; n < ITERATIONS; n++)
+    for (const auto& target : targets) {
+      g->set_point(target);
+      g->build(geometry);
+      if (n == 0)
+        for (size_t i = 0; i < geometry->num_devices(); i++)
+          if (g->duties()[i][0] != 0) (*driven)++;
+    }
+  const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count();
+  return elapsed / static_cast<double>(ITERATIONS * targets.size());
+}
+
+int main() {
+  const auto geometry = room();
+  std::cout << geometry->num_devices() << " devices" << std::endl;
+
+  std::vector<autd::Vector3> targets;
+  for (int i = -2; i <= 2; i++)
+    for (int j = -2; j <= 2; j++)
+      targets.emplace_back(autd::DEVICE_WIDTH * N / 2.0 + 50.0 * i, 300.0, autd::DEVICE_HEIGHT * N / 2.0 + 50.0 * j);
+
+  size_t all = 0;
+  size_t culled = 0;
+  const auto t_all = measure(geometry, targets, false, &all);
+  const auto t_culled = measure(geometry, targets, true, &culled);
+  std::cout << "without culling: " << t_all << " us/gain, " << static_cast<double>(all) / static_cast<double>(targets.size()) << " devices driven"
+            << std::endl;
+  std::cout << "with culling:    " << t_culled << " us/gain, " << static_cast<double>(culled) / static_cast<double>(targets.size())
+            << " devices driven" << std::endl;
+  std::cout << "speedup: " << t_all / t_culled << std::endl;
+
+  return 0;
+}
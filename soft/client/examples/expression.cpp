@@ -0,0 +1,102 @@
+// File: expression.cpp
+// Project: examples
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// Time to build a focus with a plane-wave bias written as an expression, compared with the same field written by hand in one loop.
+// Then check that both give the same duties and phases, and that a single focus expression matches FocalPoint.
+
+#include <chrono>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+
+#include "autd3-freq-shift.hpp"
+#include "autd3-freq-shift/core/utils.hpp"
+#include "autd3-freq-shift/gain/expression.hpp"
+#include "autd3-freq-shift/gain/focal_point.hpp"
+
+constexpr size_t NUM_BUILDS = 200;
+
+class Handwritten final : public autd::core::Gain {
+ public:
+  Handwritten(const autd::Vector3& point, const autd::Vector3& direction) : Gain(), _point(point), _direction(direction.normalized()) {}
+
+  void calc(const autd::GeometryPtr& geometry) override {
+    for (size_t dev_idx = 0; dev_idx < geometry->num_devices(); dev_idx++) {
+      const auto freq_cycle = geometry->freq_cycle(dev_idx);
+      const auto wavenum = 2.0 * M_PI / geometry->wavelength(dev_idx);
+      for (size_t i = 0; i < autd::NUM_TRANS_IN_UNIT; i++) {
+        const auto& pos = geometry->position(dev_idx, i);
+        const auto q = 0.7 * std::polar(1.0, wavenum * (pos - _point).norm()) + 0.3 * std::polar(1.0, -wavenum * pos.dot(_direction));
+        this->_duties[dev_idx][i] = autd::core::Utilities::to_duty(std::abs(q), freq_cycle);
+        this->_phases[dev_idx][i] = autd::core::Utilities::to_phase(std::arg(q), freq_cycle);
+      }
+    }
+  }
+
+ private:
+  autd::Vector3 _point;
+  autd::Vector3 _direction;
+};
+
+template <typename G>
+double measure_us(const autd::GeometryPtr& geometry, const G& gain) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  for (size_t n = 0; n < NUM_BUILDS; n++) gain->rebuild(geometry);
+  return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / static_cast<double>(NUM_BUILDS);
+}
+
+// number of transducers whose duty or phase differ by more than one step
+size_t count_differences(const autd::GeometryPtr& geometry, const autd::GainPtr& a, const autd::GainPtr& b) {
+  size_t n = 0;
+  for (size_t dev_idx = 0; dev_idx < geometry->num_devices(); dev_idx++) {
+    const auto cycle = static_cast<int>(geometry->freq_cycle(dev_idx));
+    for (size_t i = 0; i < autd::NUM_TRANS_IN_UNIT; i++) {
+      const auto dp = std::abs(static_cast<int>(a->phases()[dev_idx][i]) - static_cast<int>(b->phases()[dev_idx][i])) % cycle;
+      const auto dd = std::abs(static_cast<int>(a->duties()[dev_idx][i]) - static_cast<int>(b->duties()[dev_idx][i]));
+      if (std::min(dp, cycle - dp) > 1 || dd > 1) n++;
+    }
+  }
+  return n;
+}
+
+int main() try {
+  auto geometry = std::make_unique<autd::core::Geometry>();
+  for (size_t y = 0; y < 4; y++)
+    for (size_t x = 0; x < 4; x++)
+      geometry->add_device(autd::Vector3(autd::DEVICE_WIDTH * x, autd::DEVICE_HEIGHT * y, 0), autd::Vector3(0, 0, 0),
+                           static_cast<uint16_t>(5000 - x - 4 * y));
+
+  const auto point = autd::Vector3(2 * autd::DEVICE_WIDTH, 2 * autd::DEVICE_HEIGHT, 150.0);
+  const auto direction = autd::Vector3(0.1, 0.0, 1.0);
+
+  using autd::gain::expr::focus;
+  using autd::gain::expr::plane;
+  const auto composite = autd::gain::compose(0.7 * focus(point) + 0.3 * plane(direction));
+  const auto handwritten = std::make_shared<Handwritten>(point, direction);
+
+  const auto t_composite = measure_us(geometry, composite);
+  const auto t_handwritten = measure_us(geometry, handwritten);
+  std::printf("%zu devices\n", geometry->num_devices());
+  std::printf("expression:  %10.2f us/build\n", t_composite);
+  std::printf("handwritten: %10.2f us/build (expression / handwritten = %.2f)\n", t_handwritten, t_composite / t_handwritten);
+
+  const auto diff = count_differences(geometry, composite, handwritten);
+  const auto single = autd::gain::compose(focus(point));
+  const auto focal_point = autd::gain::FocalPoint::create(point);
+  single->build(geometry);
+  focal_point->build(geometry);
+  const auto diff_focus = count_differences(geometry, single, focal_point);
+  std::printf("differences: %zu against handwritten, %zu against FocalPoint\n", diff, diff_focus);
+  return diff == 0 && diff_focus == 0 ? 0 : 1;
+} catch (std::exception& e) {
+  std::fprintf(stderr, "%s\n", e.what());
+  return ENXIO;
+}
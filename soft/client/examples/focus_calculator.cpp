@@ -0,0 +1,180 @@
+// File: focus_calculator.cpp
+// Project: examples
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// Error of the phases which focus_calculator of the FPGA calculates in SEQ_FOCI_MODE, compared with the phases of gain::FocalPoint.
+// The parameters are packed by Logic::pack_seq_foci_body for random devices, foci, frequencies and sound speeds, and the phases of the FPGA
+// are calculated by a bit exact model of the fixed point arithmetic of focus_calculator.sv.
+// With a path, the first cases are written as the test vectors of sim_focus_calculator.sv, which checks that the logic agrees with the model.
+// The last vector case is the first one in which a phase is rounded up to the cycle, which the FPGA outputs as 0.
+//   example_focus_calculator [focus_vectors.mem]
+
+#include <array>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "autd3-freq-shift.hpp"
+#include "autd3-freq-shift/core/logic.hpp"
+#include "autd3-freq-shift/gain/focal_point.hpp"
+
+namespace {
+constexpr size_t NUM_CASES = 10000;
+constexpr size_t NUM_VECTOR_CASES = 32;
+
+using u128 = unsigned __int128;
+
+/**
+ * @brief Parameters of a focus read by the FPGA from the body of SEQ_FOCI_MODE
+ */
+struct FocusParams {
+  int32_t x, y, z;
+  uint32_t k;
+  uint16_t cycle;
+};
+
+// floor of the square root, as sqrt_pipeline.sv
+u128 isqrt(u128 v) {
+  u128 r = 0;
+  for (auto bit = static_cast<u128>(1) << 66; bit != 0; bit >>= 2) {
+    if (v >= r + bit) {
+      v -= r + bit;
+      r = (r >> 1) + bit;
+    } else {
+      r >>= 1;
+    }
+  }
+  return r;
+}
+
+// Same arithmetic as focus_calculator.sv, including the widths of the registers: the remainder of the half clocks by 2 * cycle
+uint64_t fpga_rem(const FocusParams& p, const size_t ix, const size_t iy) {
+  const auto tr_pos = [](const uint64_t i) { return static_cast<int64_t>(((i * 10653532ULL + 512ULL) & 0xFFFFFFFFULL) >> 10); };
+  const auto dx = static_cast<__int128>(p.x) - tr_pos(ix);
+  const auto dy = static_cast<__int128>(p.y) - tr_pos(iy);
+  const auto dz = static_cast<__int128>(p.z);
+  const u128 mask66 = (static_cast<u128>(1) << 66) - 1;
+  const auto dist2 = (static_cast<u128>(dx * dx) + static_cast<u128>(dy * dy) + static_cast<u128>(dz * dz)) & mask66;
+  const auto dist = isqrt(dist2);
+  const auto prod = dist * p.k;
+  const auto half_ticks = static_cast<uint64_t>((((prod + 16777216) >> 25) + p.cycle) & ((1ULL << 26) - 1));
+  return half_ticks % (2ULL * p.cycle);
+}
+
+// the phase rounded up to the cycle is wrapped to 0
+uint16_t fpga_phase(const FocusParams& p, const size_t ix, const size_t iy) {
+  const auto rounded = static_cast<uint16_t>((fpga_rem(p, ix, iy) + 1) >> 1);
+  return rounded == p.cycle ? 0 : rounded;
+}
+
+bool is_wrapped(const FocusParams& p, const size_t ix, const size_t iy) { return fpga_rem(p, ix, iy) == 2ULL * p.cycle - 1; }
+
+FocusParams unpack(const uint8_t* frame, const uint16_t cycle) {
+  const auto* words = reinterpret_cast<const uint16_t*>(frame + sizeof(autd::core::GlobalHeader));
+  const auto word32 = [words](const size_t i) { return static_cast<uint32_t>(words[i]) | static_cast<uint32_t>(words[i + 1]) << 16; };
+  return FocusParams{static_cast<int32_t>(word32(0)), static_cast<int32_t>(word32(2)), static_cast<int32_t>(word32(4)), word32(7), cycle};
+}
+}  // namespace
+
+int main(const int argc, char* argv[]) try {
+  FILE* vectors = nullptr;
+  if (argc > 1) {
+    vectors = std::fopen(argv[1], "w");
+    if (vectors == nullptr) throw std::runtime_error(std::string("Failed to open ") + argv[1]);
+    std::fprintf(vectors, "// generated by example_focus_calculator\n");
+  }
+
+  std::mt19937_64 rng(0);
+  std::uniform_real_distribution<double> unit(0.0, 1.0);
+  const auto uniform = [&rng, &unit](const double lo, const double hi) { return lo + (hi - lo) * unit(rng); };
+
+  // the cases checked by sim_focus_calculator.sv before, with the device at the origin, come first
+  const std::vector<std::pair<autd::Vector3, uint16_t>> fixed = {
+      {autd::Vector3(86.36, 66.04, 150.0), 5000}, {autd::Vector3(0.0, 0.0, 10.0), 5000},    {autd::Vector3(-300.0, 500.0, 1200.0), 5000},
+      {autd::Vector3(86.36, 66.04, 150.0), 4999}, {autd::Vector3(50.0, -20.0, 300.0), 2500}, {autd::Vector3(86.36, 66.04, -150.0), 4000},
+  };
+
+  std::array<size_t, 4> histogram{};  // |error| = 0, 1, 2, more
+  int max_error = 0;
+  size_t wrapped = 0;
+  bool wrap_case_written = false;
+  std::vector<uint8_t> frame(sizeof(autd::core::GlobalHeader) + sizeof(uint16_t) * autd::NUM_TRANS_IN_UNIT);
+  for (size_t n = 0; n < NUM_CASES; n++) {
+    const autd::core::GeometryPtr geometry = std::make_unique<autd::core::Geometry>();
+    autd::Vector3 point;
+    uint16_t cycle;
+    if (n < fixed.size()) {
+      geometry->add_device(autd::Vector3::Zero(), autd::Vector3::Zero(), fixed[n].second);
+      geometry->sound_speed() = 340.0e3;
+      point = fixed[n].first;
+      cycle = fixed[n].second;
+    } else {
+      cycle = static_cast<uint16_t>(uniform(autd::core::MIN_FREQ_CYCLE, 10000.0));
+      geometry->add_device(autd::Vector3(uniform(-500.0, 500.0), uniform(-500.0, 500.0), uniform(-100.0, 100.0)),
+                           autd::Vector3(uniform(-M_PI, M_PI), uniform(-M_PI, M_PI), uniform(-M_PI, M_PI)), cycle);
+      geometry->sound_speed() = uniform(330.0e3, 360.0e3);
+      point = autd::Vector3(uniform(-1000.0, 1000.0), uniform(-1000.0, 1000.0), uniform(-1000.0, 1500.0));
+    }
+
+    size_t size = 0;
+    autd::core::Logic::pack_seq_foci_body(geometry, point, 1.0, frame.data(), &size);
+    const auto params = unpack(frame.data(), cycle);
+
+    const auto gain = autd::gain::FocalPoint::create(point);
+    gain->build(geometry);
+    const auto* host = gain->data().phases;
+
+    bool has_wrap = false;
+    for (size_t iy = 0; iy < autd::core::NUM_TRANS_Y; iy++)
+      for (size_t ix = 0; ix < autd::core::NUM_TRANS_X; ix++)
+        if (!autd::core::is_missing_transducer(ix, iy) && is_wrapped(params, ix, iy)) {
+          has_wrap = true;
+          wrapped++;
+        }
+    const auto write = vectors != nullptr && (n + 1 < NUM_VECTOR_CASES || (has_wrap && !wrap_case_written));
+    if (write && n + 1 >= NUM_VECTOR_CASES) wrap_case_written = true;
+
+    if (write)
+      std::fprintf(vectors, "%08X\n%08X\n%08X\n%08X\n%08X\n", static_cast<uint32_t>(params.x), static_cast<uint32_t>(params.y),
+                   static_cast<uint32_t>(params.z), params.k, params.cycle);
+
+    size_t i = 0;
+    for (size_t iy = 0; iy < autd::core::NUM_TRANS_Y; iy++)
+      for (size_t ix = 0; ix < autd::core::NUM_TRANS_X; ix++) {
+        if (autd::core::is_missing_transducer(ix, iy)) continue;
+        const auto fpga = fpga_phase(params, ix, iy);
+        auto diff = static_cast<int>(fpga % cycle) - static_cast<int>(host[i] % cycle);
+        if (diff > cycle / 2) diff -= cycle;
+        if (diff < -cycle / 2) diff += cycle;
+        const auto error = std::abs(diff);
+        histogram[std::min<size_t>(static_cast<size_t>(error), histogram.size() - 1)]++;
+        max_error = std::max(max_error, error);
+        if (write) std::fprintf(vectors, "%04X%04X\n", host[i], fpga);
+        i++;
+      }
+  }
+  if (vectors != nullptr) {
+    std::fclose(vectors);
+    if (!wrap_case_written) throw std::runtime_error("No case in which a phase is rounded up to the cycle");
+  }
+
+  const auto total = static_cast<double>(NUM_CASES * autd::NUM_TRANS_IN_UNIT);
+  std::cout << NUM_CASES << " foci, " << NUM_CASES * autd::NUM_TRANS_IN_UNIT << " transducers" << std::endl;
+  for (size_t e = 0; e < histogram.size(); e++)
+    std::cout << "|error| " << (e + 1 < histogram.size() ? "= " : ">= ") << e << ": " << histogram[e] << " ("
+              << 100.0 * static_cast<double>(histogram[e]) / total << " %)" << std::endl;
+  std::cout << "max |error|: " << max_error << std::endl;
+  std::cout << "phases rounded up to the cycle and wrapped to 0: " << wrapped << std::endl;
+  return max_error <= 1 ? 0 : 1;
+} catch (std::exception& e) {
+  std::cerr << e.what() << std::endl;
+  return ENXIO;
+}
@@ -0,0 +1,104 @@
+// File: focus_lattice.cpp
+// Project: examples
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// Memory footprint of a precomputed focus lattice against its resolution, and the time to switch the focus,
+// compared with calculating the focal point from scratch.
+// The lattices coarser than wavelength / (2 * sqrt(3)) move the focus to the nearest lattice point instead of interpolating.
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "autd3-freq-shift.hpp"
+#include "autd3-freq-shift/gain/focal_point.hpp"
+#include "autd3-freq-shift/gain/focus_lattice.hpp"
+
+constexpr double WORKSPACE = 100.0;  // mm
+constexpr size_t NUM_SWITCHES = 1000;
+
+template <typename F>
+double measure_us(F&& f) {
+  const auto start = std::chrono::high_resolution_clock::now();
+  for (size_t n = 0; n < NUM_SWITCHES; n++) f(n);
+  return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / static_cast<double>(NUM_SWITCHES);
+}
+
+// mean absolute phase error against the exact focal point, in the unit of the phase sent to the device
+double phase_error(const autd::GeometryPtr& geometry, const autd::GainPtr& gain, const autd::GainPtr& exact) {
+  double err = 0.0;
+  for (size_t dev_idx = 0; dev_idx < geometry->num_devices(); dev_idx++) {
+    const auto cycle = static_cast<int>(geometry->freq_cycle(dev_idx));
+    for (size_t i = 0; i < autd::NUM_TRANS_IN_UNIT; i++) {
+      auto d = std::abs(static_cast<int>(gain->phases()[dev_idx][i]) - static_cast<int>(exact->phases()[dev_idx][i])) % cycle;
+      err += std::min(d, cycle - d);
+    }
+  }
+  return err / static_cast<double>(geometry->num_transducers());
+}
+
+int main() try {
+  auto geometry = std::make_unique<autd::core::Geometry>();
+  for (size_t y = 0; y < 2; y++)
+    for (size_t x = 0; x < 2; x++)
+      geometry->add_device(autd::Vector3(autd::DEVICE_WIDTH * x, autd::DEVICE_HEIGHT * y, 0), autd::Vector3(0, 0, 0));
+
+  const auto center = autd::Vector3(autd::DEVICE_WIDTH, autd::DEVICE_HEIGHT, 150.0);
+  const auto origin = center - autd::Vector3::Constant(WORKSPACE / 2);
+
+  std::mt19937 rng(0);
+  std::uniform_real_distribution<double> dist(0.0, WORKSPACE);
+  std::vector<autd::Vector3> targets;
+  for (size_t n = 0; n < NUM_SWITCHES; n++) targets.emplace_back(origin + autd::Vector3(dist(rng), dist(rng), dist(rng)));
+
+  const auto focal_point = autd::gain::FocalPoint::create(center);
+  const auto t_calc = measure_us([&](const size_t n) {
+    focal_point->set_point(targets[n]);
+    focal_point->build(geometry);
+  });
+  std::printf("%zu devices, %.0f mm workspace\n", geometry->num_devices(), WORKSPACE);
+  std::printf("calculation from scratch: %.2f us/switch\n\n", t_calc);
+
+  std::printf("%12s %10s %14s %16s %20s %12s %16s\n", "spacing [mm]", "points", "memory [MiB]", "index [us/sw]", "set_point [us/sw]", "interpolate",
+              "error [cycle]");
+  for (const auto spacing : {10.0, 5.0, 4.0, 2.5, 2.0}) {
+    const auto n = static_cast<size_t>(WORKSPACE / spacing) + 1;
+    const auto lattice = autd::gain::FocusLattice::create(geometry, origin, spacing, {n, n, n});
+    const auto g = autd::gain::LatticeFocus::create(lattice);
+
+    const auto t_index = measure_us([&](const size_t i) {
+      g->set_index(i % n, i / n % n, i / n / n % n);
+      g->build(geometry);
+    });
+
+    double err = 0.0;
+    const auto t_interp = measure_us([&](const size_t i) {
+      g->set_point(targets[i]);
+      g->build(geometry);
+    });
+    for (size_t i = 0; i < 100; i++) {
+      g->set_point(targets[i]);
+      g->build(geometry);
+      focal_point->set_point(targets[i]);
+      focal_point->build(geometry);
+      err += phase_error(geometry, g, focal_point) / static_cast<double>(geometry->freq_cycle(0));
+    }
+
+    std::printf("%12.1f %10zu %14.1f %16.2f %20.2f %12s %16.5f\n", spacing, lattice->num_points(),
+                static_cast<double>(lattice->memory_size()) / 1024.0 / 1024.0, t_index, t_interp, lattice->interpolatable() ? "yes" : "no (snap)",
+                err / 100.0);
+  }
+
+  return 0;
+} catch (std::exception& e) {
+  std::fprintf(stderr, "%s\n", e.what());
+  return ENXIO;
+}
@@ -0,0 +1,84 @@
+// File: gain_library.cpp
+// Project: examples
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// Store 10000 focal points to a gain library, and measure the time to load the library and to look up all the gains.
+// Then check that the library is rejected for a geometry with another frequency.
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "autd3-freq-shift.hpp"
+#include "autd3-freq-shift/gain/focal_point.hpp"
+#include "autd3-freq-shift/gain/library.hpp"
+
+constexpr size_t NUM_GAINS = 10000;
+
+autd::GeometryPtr create_geometry(const uint16_t freq_cycle) {
+  auto geometry = std::make_unique<autd::core::Geometry>();
+  for (size_t y = 0; y < 2; y++)
+    for (size_t x = 0; x < 2; x++)
+      geometry->add_device(autd::Vector3(autd::DEVICE_WIDTH * x, autd::DEVICE_HEIGHT * y, 0), autd::Vector3(0, 0, 0), freq_cycle);
+  return geometry;
+}
+
+int main(const int argc, char* argv[]) try {
+  const std::string path = argc > 1 ? argv[1] : "gains.autdlib";
+  const auto geometry = create_geometry(5000);
+
+  std::vector<std::pair<std::string, autd::GainPtr>> gains;
+  for (size_t i = 0; i < NUM_GAINS; i++) {
+    const auto point = autd::Vector3(autd::DEVICE_WIDTH + static_cast<double>(i % 100) - 50.0, autd::DEVICE_HEIGHT + static_cast<double>(i / 100) - 50.0, 150.0);
+    gains.emplace_back("focus_" + std::to_string(i), autd::gain::FocalPoint::create(point));
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+  autd::gain::GainLibrary::save(path, geometry, gains);
+  const auto t_save = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+  start = std::chrono::high_resolution_clock::now();
+  const auto library = autd::gain::GainLibrary::open(path);
+  library->validate(geometry);
+  const auto t_open = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+  start = std::chrono::high_resolution_clock::now();
+  uint64_t checksum = 0;
+  for (size_t i = 0; i < NUM_GAINS; i++) checksum += library->get("focus_" + std::to_string(i)).phases[0];
+  const auto t_lookup = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+  for (size_t i = 0; i < NUM_GAINS; i += 997) {
+    const auto data = library->get("focus_" + std::to_string(i));
+    const auto& gain = gains[i].second;
+    if (std::memcmp(data.phases, gain->phases()[0].data(), sizeof(uint16_t) * autd::NUM_TRANS_IN_UNIT * geometry->num_devices()) != 0)
+      throw std::runtime_error("Stored phases differ from the calculated ones");
+  }
+
+  std::printf("%zu gains on %zu devices\n", library->size(), library->num_devices());
+  std::printf("build and save:     %10.3f ms\n", t_save);
+  std::printf("open and validate:  %10.3f ms\n", t_open);
+  std::printf("look up all gains:  %10.3f ms (checksum %llu)\n", t_lookup, static_cast<unsigned long long>(checksum));
+
+  try {
+    library->validate(create_geometry(4000));
+    std::printf("ERR: the library is accepted for another frequency\n");
+    return 1;
+  } catch (autd::core::exception::GainBuildError& e) {
+    std::printf("rejected for another frequency: %s\n", e.what());
+  }
+
+  return 0;
+} catch (std::exception& e) {
+  std::fprintf(stderr, "%s\n", e.what());
+  return ENXIO;
+}
@@ -0,0 +1,159 @@
+// File: grouped.cpp
+// Project: examples
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// Time to re-build a Grouped gain after replacing one group, compared with building all the groups.
+// Then check that each group has the same data as its gain built alone over the devices of the group, that only the replaced group and the
+// groups whose frequency has changed are calculated again, and that an error in a group is reported by build.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "autd3-freq-shift.hpp"
+#include "autd3-freq-shift/gain/focal_point.hpp"
+#include "autd3-freq-shift/gain/grouped.hpp"
+
+constexpr size_t NUM_BUILDS = 200;
+
+class Counted final : public autd::core::Gain {
+ public:
+  explicit Counted(const autd::Vector3& point, const bool fail = false) : Gain(), _point(point), _fail(fail), _calls(0) {}
+
+  void calc(const autd::GeometryPtr& geometry) override {
+    _calls++;
+    if (_fail) throw std::runtime_error("failed to calculate");
+    for (size_t dev_idx = 0; dev_idx < geometry->num_devices(); dev_idx++) {
+      const auto freq_cycle = geometry->freq_cycle(dev_idx);
+      const auto wavenum = 2.0 * M_PI / geometry->wavelength(dev_idx);
+      for (size_t i = 0; i < autd::NUM_TRANS_IN_UNIT; i++) {
+        const auto dist = (geometry->position(dev_idx, i) - _point).norm();
+        this->_duties[dev_idx][i] = autd::core::Utilities::to_duty(1.0, freq_cycle);
+        this->_phases[dev_idx][i] = autd::core::Utilities::to_phase(dist * wavenum, freq_cycle);
+      }
+    }
+  }
+
+  [[nodiscard]] size_t calls() const noexcept { return _calls; }
+
+ private:
+  autd::Vector3 _point;
+  bool _fail;
+  std::atomic<size_t> _calls;
+};
+
+// whether the rows of the group in the grouped gain equal the gain built alone over the devices of the group
+bool same_as_alone(const autd::GeometryPtr& geometry, const autd::GainPtr& grouped, const std::vector<size_t>& device_ids,
+                   const autd::Vector3& point) {
+  const auto alone = autd::gain::FocalPoint::create(point);
+  alone->build(geometry->subset(device_ids));
+  for (size_t i = 0; i < device_ids.size(); i++)
+    if (std::memcmp(grouped->duties()[device_ids[i]].data(), alone->duties()[i].data(), sizeof(autd::core::DataArray)) != 0 ||
+        std::memcmp(grouped->phases()[device_ids[i]].data(), alone->phases()[i].data(), sizeof(autd::core::DataArray)) != 0)
+      return false;
+  return true;
+}
+
+int main() try {
+  auto geometry = std::make_unique<autd::core::Geometry>();
+  for (size_t y = 0; y < 4; y++)
+    for (size_t x = 0; x < 4; x++)
+      geometry->add_device(autd::Vector3(autd::DEVICE_WIDTH * x, autd::DEVICE_HEIGHT * y, 0), autd::Vector3(0, 0, 0),
+                           static_cast<uint16_t>(5000 - x - 4 * y));
+
+  // four groups of four devices, each of which is focused on its own point
+  std::vector<std::vector<size_t>> device_ids;
+  std::vector<autd::Vector3> points;
+  for (size_t g = 0; g < 4; g++) {
+    device_ids.emplace_back(std::vector<size_t>{g, g + 4, g + 8, g + 12});
+    points.emplace_back(autd::DEVICE_WIDTH * g, 2 * autd::DEVICE_HEIGHT, 150.0);
+  }
+  const auto grouped = autd::gain::Grouped::create();
+  for (size_t g = 0; g < 4; g++) grouped->add(device_ids[g], autd::gain::FocalPoint::create(points[g]));
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t n = 0; n < NUM_BUILDS; n++) {
+    for (size_t g = 0; g < 4; g++) grouped->replace(g, autd::gain::FocalPoint::create(points[g]));
+    grouped->build(geometry);
+  }
+  const auto t_all = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / NUM_BUILDS;
+  start = std::chrono::high_resolution_clock::now();
+  for (size_t n = 0; n < NUM_BUILDS; n++) {
+    grouped->replace(0, autd::gain::FocalPoint::create(points[0]));
+    grouped->build(geometry);
+  }
+  const auto t_one = std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - start).count() / NUM_BUILDS;
+  std::printf("%zu devices in 4 groups\n", geometry->num_devices());
+  std::printf("all groups replaced: %10.2f us/build\n", t_all);
+  std::printf("one group replaced:  %10.2f us/build (one / all = %.2f)\n", t_one, t_one / t_all);
+
+  size_t failures = 0;
+  const auto check = [&failures](const bool ok, const char* what) {
+    std::printf("%-66s %s\n", what, ok ? "ok" : "NG");
+    if (!ok) failures++;
+  };
+
+  bool same = true;
+  for (size_t g = 0; g < 4; g++) same &= same_as_alone(geometry, grouped, device_ids[g], points[g]);
+  check(same, "each group equals its gain built alone");
+
+  std::vector<std::shared_ptr<Counted>> counted;
+  for (size_t g = 0; g < 4; g++) {
+    counted.emplace_back(std::make_shared<Counted>(points[g]));
+    grouped->replace(g, counted[g]);
+  }
+  grouped->build(geometry);
+  grouped->replace(1, std::make_shared<Counted>(points[1]));
+  grouped->build(geometry);
+  check(counted[0]->calls() == 1 && counted[2]->calls() == 1 && counted[3]->calls() == 1, "only the replaced group is calculated again");
+
+  // device 6 belongs to group 2
+  const auto shared = std::make_shared<Counted>(points[2]);
+  grouped->replace(2, shared);
+  grouped->build(geometry);
+  geometry->set_freq_cycle(6, 4000);
+  grouped->rebuild(geometry);
+  check(shared->calls() == 2 && counted[0]->calls() == 1 && counted[3]->calls() == 1,
+        "only the group whose frequency has changed is calculated again");
+
+  for (size_t g = 0; g < 4; g++) grouped->replace(g, autd::gain::FocalPoint::create(points[g]));
+  grouped->build(geometry);
+  geometry->set_freq_cycle(5, 4000);
+  grouped->rebuild(geometry);
+  same = true;
+  for (size_t g = 0; g < 4; g++) same &= same_as_alone(geometry, grouped, device_ids[g], points[g]);
+  check(same, "each group equals its gain built alone after the frequency change");
+
+  grouped->replace(2, shared);
+  bool rejected = false;
+  try {
+    grouped->replace(3, shared);
+  } catch (autd::core::exception::GainBuildError&) {
+    rejected = true;
+  }
+  check(rejected, "the same gain in two groups is rejected");
+
+  bool reported = false;
+  grouped->replace(3, std::make_shared<Counted>(points[3], true));
+  try {
+    grouped->build(geometry);
+  } catch (std::runtime_error&) {
+    reported = true;
+  }
+  check(reported && !grouped->built(), "an error in a group is reported by build");
+
+  return failures == 0 ? 0 : 1;
+} catch (std::exception& e) {
+  std::fprintf(stderr, "%s\n", e.what());
+  return ENXIO;
+}
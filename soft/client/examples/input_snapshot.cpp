@@ -0,0 +1,79 @@
+// File: input_snapshot.cpp
+// Project: examples
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// Stress test of the input snapshot: a writer publishes images as fast as possible while readers check that every snapshot
+// is consistent with the cycle it reports, and that the cycles never go back.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "autd3-freq-shift/core/ec_config.hpp"
+#include "autd3-freq-shift/core/input_snapshot.hpp"
+
+constexpr size_t NUM_DEVICES = 99;  // the image is not a multiple of 8 bytes
+constexpr size_t NUM_READERS = 4;
+constexpr auto DURATION = std::chrono::seconds(2);
+
+uint8_t pattern(const uint64_t cycle, const size_t i) { return static_cast<uint8_t>(cycle * 31 + i); }
+
+int main() {
+  constexpr auto size = NUM_DEVICES * autd::core::EC_INPUT_FRAME_SIZE;
+  autd::core::InputSnapshot snapshot;
+  snapshot.resize(size);
+
+  std::atomic<bool> run{true};
+  std::thread writer([&] {
+    std::vector<uint8_t> image(size);
+    for (uint64_t cycle = 1; run.load(std::memory_order_relaxed); cycle++) {
+      for (size_t i = 0; i < size; i++) image[i] = pattern(cycle, i);
+      snapshot.publish(image.data());
+    }
+  });
+
+  std::vector<size_t> reads(NUM_READERS, 0);
+  std::vector<size_t> errors(NUM_READERS, 0);
+  std::vector<std::thread> readers;
+  for (size_t r = 0; r < NUM_READERS; r++)
+    readers.emplace_back([&, r] {
+      std::vector<uint8_t> image(size);
+      uint64_t last = 0;
+      while (run.load(std::memory_order_relaxed)) {
+        const auto cycle = snapshot.read(image.data());
+        reads[r]++;
+        if (cycle < last) errors[r]++;
+        last = cycle;
+        if (cycle == 0) continue;
+        for (size_t i = 0; i < size; i++)
+          if (image[i] != pattern(cycle, i)) {
+            errors[r]++;
+            break;
+          }
+      }
+    });
+
+  std::this_thread::sleep_for(DURATION);
+  run.store(false);
+  writer.join();
+  for (auto& th : readers) th.join();
+
+  size_t total_reads = 0;
+  size_t total_errors = 0;
+  for (size_t r = 0; r < NUM_READERS; r++) {
+    total_reads += reads[r];
+    total_errors += errors[r];
+  }
+  std::printf("%llu cycles published, %zu snapshots read by %zu readers, %zu inconsistent\n", static_cast<unsigned long long>(snapshot.cycle()),
+              total_reads, NUM_READERS, total_errors);
+  return total_errors == 0 ? 0 : 1;
+}
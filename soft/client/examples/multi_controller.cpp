@@ -0,0 +1,116 @@
+// File: multi_controller.cpp
+// Project: examples
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// Aggregate throughput of independent Controllers driven from separate threads, one Controller per thread.
+// The Controllers share no mutable state, i.e., each has its own link, message id sequence, command queue and memory pool. Whether the
+// throughput scales with the number of threads depends on the machine, and it is not measured on a machine with a single hardware thread.
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "autd3-freq-shift.hpp"
+#include "autd3-freq-shift/core/ec_config.hpp"
+#include "autd3-freq-shift/core/utils.hpp"
+
+class FocalPointGain final : public autd::core::Gain {
+ public:
+  static std::shared_ptr<FocalPointGain> create(const autd::Vector3& point) { return std::make_shared<FocalPointGain>(point); }
+
+  void calc(const autd::GeometryPtr& geometry) override {
+    for (size_t dev_idx = 0; dev_idx < geometry->num_devices(); dev_idx++) {
+      const uint16_t freq_cycle = geometry->freq_cycle(dev_idx);
+      const double wavenum = 2.0 * M_PI / geometry->wavelength(dev_idx);
+      for (size_t i = 0; i < autd::NUM_TRANS_IN_UNIT; i++) {
+        const auto dist = (geometry->position(dev_idx, i) - this->_point).norm();
+        this->_duties[dev_idx][i] = autd::core::Utilities::to_duty(1.0, freq_cycle);
+        this->_phases[dev_idx][i] = autd::core::Utilities::to_phase(dist * wavenum, freq_cycle);
+      }
+    }
+  }
+
+  explicit FocalPointGain(const autd::Vector3& point) : Gain(), _point(point) {}
+
+ private:
+  autd::Vector3 _point;
+};
+
+/**
+ * @brief Link which acknowledges every frame immediately
+ */
+class LoopbackLink final : public autd::core::Link {
+ public:
+  explicit LoopbackLink(const size_t num_devices) : _num_devices(num_devices), _tx(num_devices * autd::core::EC_OUTPUT_FRAME_SIZE) {}
+
+  void open(const autd::core::LinkConfiguration&) override { _is_open = true; }
+  void reconfigure(const autd::core::LinkConfiguration&) override {}
+  void close() override { _is_open = false; }
+  void send(const uint8_t* buf, const size_t size) override { std::memcpy(_tx.data(), buf, std::min(size, _tx.size())); }
+  void read(uint8_t* rx, const size_t buffer_len) override {
+    for (size_t dev = 0; dev < _num_devices && (dev + 1) * autd::core::EC_INPUT_FRAME_SIZE <= buffer_len; dev++) {
+      std::memset(&rx[dev * autd::core::EC_INPUT_FRAME_SIZE], 0, autd::core::EC_INPUT_FRAME_SIZE);
+      rx[dev * autd::core::EC_INPUT_FRAME_SIZE + 1] = _tx[0];
+    }
+  }
+  bool is_open() override { return _is_open; }
+
+ private:
+  size_t _num_devices;
+  std::vector<uint8_t> _tx;
+  bool _is_open = false;
+};
+
+constexpr size_t NUM_DEVICES = 2;
+constexpr auto DURATION = std::chrono::milliseconds(500);
+
+size_t run_controller() {
+  const auto cnt = autd::Controller::create();
+  for (size_t i = 0; i < NUM_DEVICES; i++) cnt->geometry()->add_device(autd::Vector3(autd::DEVICE_WIDTH * i, 0, 0), autd::Vector3(0, 0, 0));
+  cnt->open(std::make_unique<LoopbackLink>(NUM_DEVICES));
+
+  size_t n = 0;
+  const auto start = std::chrono::steady_clock::now();
+  while (std::chrono::steady_clock::now() - start < DURATION) {
+    const auto g = FocalPointGain::create(autd::Vector3(90.0 + static_cast<double>(n % 10), 70.0, 150.0));
+    if (!cnt->send(g)) throw std::runtime_error("Failed to send");
+    n++;
+  }
+
+  cnt->close();
+  return n;
+}
+
+int main() try {
+  const auto max_threads = std::max(1u, std::thread::hardware_concurrency());
+  if (max_threads == 1) std::cout << "only 1 hardware thread, so the scaling is not measured" << std::endl;
+
+  double single = 0.0;
+  for (unsigned int num_threads = 1; num_threads <= max_threads; num_threads *= 2) {
+    std::vector<size_t> counts(num_threads);
+    std::vector<std::thread> threads;
+    for (unsigned int i = 0; i < num_threads; i++) threads.emplace_back([&counts, i] { counts[i] = run_controller(); });
+    for (auto& th : threads) th.join();
+
+    size_t total = 0;
+    for (const auto c : counts) total += c;
+    const auto throughput = static_cast<double>(total) / std::chrono::duration<double>(DURATION).count();
+    if (num_threads == 1) single = throughput;
+    std::cout << num_threads << " controller(s): " << throughput << " sends/s (" << throughput / single << "x of 1 controller)" << std::endl;
+  }
+
+  return 0;
+} catch (std::exception& e) {
+  std::cerr << e.what() << std::endl;
+  return ENXIO;
+}
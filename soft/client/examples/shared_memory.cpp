@@ -0,0 +1,55 @@
+// File: shared_memory.cpp
+// Project: examples
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// Control the devices through autd3_daemon, e.g., `autd3_daemon eth0 1` in another terminal.
+// Several instances of this example can run at the same time, each with its own Controller.
+
+#include "autd3-freq-shift/link/shared_memory.hpp"
+
+#include <chrono>
+#include <iostream>
+
+#include "autd3-freq-shift.hpp"
+
+int main() try {
+  const auto cnt = autd::Controller::create();
+  cnt->geometry()->add_device(autd::Vector3(0, 0, 0), autd::Vector3(0, 0, 0));
+
+  cnt->open(autd::link::SharedMemory::create());
+  cnt->set_check_ack(true);
+
+  cnt->clear();
+  cnt->set_frequency();
+
+  const auto firm_info_list = cnt->firmware_info_list();
+  for (auto&& firm_info : firm_info_list) std::cout << firm_info << std::endl;
+
+  const auto center =
+      autd::Vector3(autd::TRANS_SPACING_MM * ((autd::NUM_TRANS_X - 1) / 2.0), autd::TRANS_SPACING_MM * ((autd::NUM_TRANS_Y - 1) / 2.0), 150.0);
+  cnt->send_focus(center);
+
+  // Round trip through the daemon and the devices, which is dominated by the EtherCAT cycle
+  constexpr size_t N = 100;
+  const auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < N; i++) cnt->send_focus(center + autd::Vector3(0, 0, static_cast<double>(i % 10)));
+  const auto elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "acknowledged focus: " << elapsed / N << " us" << std::endl;
+
+  std::cout << "press any key to finish..." << std::endl;
+  std::cin.ignore();
+
+  cnt->close();
+
+  return 0;
+} catch (std::exception& e) {
+  std::cerr << e.what() << std::endl;
+  return ENXIO;
+}
@@ -0,0 +1,303 @@
+// File: shared_memory_bench.cpp
+// Project: examples
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// Check the shared memory link against a daemon forked in this process, whose link records the forwarded frames instead of the devices.
+// 1. Several client processes send gains, and the daemon checks that the WRITE_PHASE frame of each gain directly follows its WRITE_DUTY frame.
+// 2. A client sends timestamped frames, and the daemon measures the time until each frame is forwarded to the link, while the daemon polls the
+//    rings and while it waits on the doorbell.
+// 3. The frequencies are changed by a client only while no other client is attached.
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "autd3-freq-shift.hpp"
+#include "autd3-freq-shift/core/device_status.hpp"
+#include "autd3-freq-shift/core/ec_config.hpp"
+#include "autd3-freq-shift/link/shared_memory.hpp"
+#include "shm_server.hpp"
+
+namespace {
+constexpr const char* SHM_NAME = "/autd3-freq-shift-bench";
+constexpr size_t NUM_DEVICES = 2;
+constexpr size_t NUM_CLIENTS = 3;
+constexpr size_t NUM_GAINS = 2000;
+constexpr size_t NUM_SAMPLES = 2000;
+constexpr uint32_t LATENCY_MAGIC = 0x54414C41;  // "ALAT"
+
+uint64_t now_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+std::atomic<bool> stop_requested(false);
+void request_stop(int) { stop_requested.store(true, std::memory_order_release); }
+
+/**
+ * @brief Link of the daemon which checks the order of the forwarded frames and acknowledges every frame immediately
+ */
+class RecordingLink final : public autd::core::Link {
+ public:
+  explicit RecordingLink(const size_t num_devices) : _num_devices(num_devices) {}
+
+  void open(const autd::core::LinkConfiguration&) override { _is_open = true; }
+  void reconfigure(const autd::core::LinkConfiguration&) override {}
+  void close() override { _is_open = false; }
+  void send(const uint8_t* buf, const size_t size) override { send_with_policy(buf, size, autd::core::SendPolicy::Fifo); }
+  void send_with_policy(const uint8_t* buf, const size_t size, autd::core::SendPolicy) override {
+    const auto* header = reinterpret_cast<const autd::core::GlobalHeader*>(buf);
+    uint32_t magic = 0;
+    std::memcpy(&magic, header->mod, sizeof(uint32_t));
+    if (magic == LATENCY_MAGIC) {
+      uint64_t sent = 0;
+      std::memcpy(&sent, header->mod + sizeof(uint32_t), sizeof(uint64_t));
+      latencies.emplace_back(now_ns() - sent);
+    }
+
+    // the first duty and phase of a gain is the tag of the sender
+    uint16_t tag = 0;
+    if (size >= sizeof(autd::core::GlobalHeader) + sizeof(uint16_t)) std::memcpy(&tag, buf + sizeof(autd::core::GlobalHeader), sizeof(uint16_t));
+    if (header->command == autd::core::COMMAND::WRITE_DUTY) {
+      gains++;
+      if (_duty_tag.has_value()) interleaved++;
+      _duty_tag = tag;
+    } else if (header->command == autd::core::COMMAND::WRITE_PHASE) {
+      if (!_duty_tag.has_value() || _duty_tag.value() != tag) interleaved++;
+      _duty_tag.reset();
+    } else if (_duty_tag.has_value()) {
+      interleaved++;
+      _duty_tag.reset();
+    }
+
+    std::copy_backward(_history.begin(), _history.end() - 1, _history.end());
+    _history[0] = header->msg_id;
+  }
+  void read(uint8_t* rx, const size_t buffer_len) override {
+    for (size_t dev = 0; dev < _num_devices && (dev + 1) * autd::core::EC_INPUT_FRAME_SIZE <= buffer_len; dev++) {
+      autd::core::DeviceStatus status{};
+      status.msg_id = _history[0];
+      status.ack_history = _history;
+      std::memcpy(&rx[dev * autd::core::EC_INPUT_FRAME_SIZE], &status, sizeof(status));
+    }
+  }
+  bool is_open() override { return _is_open; }
+
+  std::vector<uint64_t> latencies;
+  size_t gains = 0;
+  size_t interleaved = 0;
+
+ private:
+  size_t _num_devices;
+  std::array<uint8_t, autd::core::ACK_HISTORY_SIZE> _history{};
+  std::optional<uint16_t> _duty_tag;
+  bool _is_open = false;
+};
+
+/**
+ * @brief Gain whose duties and phases are all the tag
+ */
+class TagGain final : public autd::core::Gain {
+ public:
+  void calc(const autd::GeometryPtr& geometry) override {
+    for (size_t dev_idx = 0; dev_idx < geometry->num_devices(); dev_idx++)
+      for (size_t i = 0; i < autd::NUM_TRANS_IN_UNIT; i++) {
+        this->_duties[dev_idx][i] = tag;
+        this->_phases[dev_idx][i] = tag;
+      }
+  }
+
+  TagGain() : Gain() {}
+
+  uint16_t tag = 0;
+};
+
+void print_latency(const std::string& label, std::vector<uint64_t> samples) {
+  if (samples.empty()) {
+    std::cout << label << ": no samples" << std::endl;
+    return;
+  }
+  std::sort(samples.begin(), samples.end());
+  const auto at = [&samples](const double q) {
+    return static_cast<double>(samples[static_cast<size_t>(q * static_cast<double>(samples.size() - 1))]) / 1000.0;
+  };
+  std::cout << label << ": p50 " << at(0.5) << " us, p99 " << at(0.99) << " us, max " << at(1.0) << " us (" << samples.size() << " frames)"
+            << std::endl;
+}
+
+int run_daemon(const int ready) {
+  std::signal(SIGTERM, request_stop);
+  auto link = std::make_unique<RecordingLink>(NUM_DEVICES);
+  auto* recording = link.get();
+  autd::shm::Server server(SHM_NAME, std::move(link), std::vector<uint16_t>(NUM_DEVICES, autd::core::FPGA_BASE_CLK_FREQ / 40000));
+  server.on_log([](const std::string& msg) { std::cerr << "daemon: " << msg << std::endl; });
+  const char c = 0;
+  if (write(ready, &c, 1) != 1) return ENXIO;
+  ::close(ready);
+
+  server.run(stop_requested);
+
+  std::cout << "interleaving: " << recording->interleaved << " interleaved frames in " << recording->gains << " gains of " << NUM_CLIENTS
+            << " clients" << std::endl;
+  const auto half = std::min(recording->latencies.size(), NUM_SAMPLES);
+  print_latency("handover while polling", std::vector<uint64_t>(recording->latencies.begin(), recording->latencies.begin() + half));
+  print_latency("handover from doorbell", std::vector<uint64_t>(recording->latencies.begin() + half, recording->latencies.end()));
+  return recording->interleaved == 0 ? 0 : 1;
+}
+
+autd::ControllerPtr open_controller(const uint16_t freq_cycle = autd::core::FPGA_BASE_CLK_FREQ / 40000) {
+  auto cnt = autd::Controller::create();
+  for (size_t i = 0; i < NUM_DEVICES; i++)
+    cnt->geometry()->add_device(autd::Vector3(autd::DEVICE_WIDTH * i, 0, 0), autd::Vector3(0, 0, 0), freq_cycle);
+  cnt->open(autd::link::SharedMemory::create(SHM_NAME));
+  return cnt;
+}
+
+// The first client sends the gains by a Controller, and the others send the frames of a gain by the link directly, sleeping between them so
+// that the daemon would forward the frames of the others in between if a command were published frame by frame
+int run_raw_client(const uint16_t id) {
+  auto link = autd::link::SharedMemory::create(SHM_NAME);
+  autd::core::LinkConfiguration config;
+  config.freq_cycles.assign(NUM_DEVICES, autd::core::FPGA_BASE_CLK_FREQ / 40000);
+  link->open(config);
+  std::vector<uint8_t> frame(sizeof(autd::core::GlobalHeader) + sizeof(uint16_t) * autd::NUM_TRANS_IN_UNIT * NUM_DEVICES);
+  for (size_t n = 0; n < NUM_GAINS; n++) {
+    const auto tag = static_cast<uint16_t>(id << 12 | (n & 0xFFF));
+    std::memcpy(frame.data() + sizeof(autd::core::GlobalHeader), &tag, sizeof(uint16_t));
+    autd::core::Logic::pack_header(autd::core::COMMAND::WRITE_DUTY, 0, frame.data());
+    link->send_with_policy(frame.data(), frame.size(), autd::core::SendPolicy::LatestWins);
+    std::this_thread::sleep_for(std::chrono::microseconds(50));
+    autd::core::Logic::pack_header(autd::core::COMMAND::WRITE_PHASE, 0, frame.data(), autd::core::HEADER_FLAG_APPLY);
+    link->send_with_policy(frame.data(), frame.size(), autd::core::SendPolicy::LatestWins);
+    link->end_command();
+  }
+  link->close();
+  return 0;
+}
+
+int run_client(const uint16_t id) {
+  if (id > 1) return run_raw_client(id);
+
+  const auto cnt = open_controller();
+  const auto g = cnt->create_gain<TagGain>();
+  for (size_t n = 0; n < NUM_GAINS; n++) {
+    g->tag = static_cast<uint16_t>(id << 12 | (n & 0xFFF));
+    g->rebuild(cnt->geometry());
+    if (!cnt->send(g)) return 1;
+  }
+  cnt->close();
+  return 0;
+}
+
+void measure_latency(const std::chrono::microseconds interval) {
+  auto link = autd::link::SharedMemory::create(SHM_NAME);
+  autd::core::LinkConfiguration config;
+  config.freq_cycles.assign(NUM_DEVICES, autd::core::FPGA_BASE_CLK_FREQ / 40000);
+  link->open(config);
+  std::vector<uint8_t> frame(sizeof(autd::core::GlobalHeader));
+  autd::core::Logic::pack_header(autd::core::COMMAND::OP, 0, frame.data());
+  for (size_t i = 0; i < NUM_SAMPLES; i++) {
+    std::this_thread::sleep_for(interval);
+    std::memcpy(frame.data() + offsetof(autd::core::GlobalHeader, mod), &LATENCY_MAGIC, sizeof(uint32_t));
+    const auto sent = now_ns();
+    std::memcpy(frame.data() + offsetof(autd::core::GlobalHeader, mod) + sizeof(uint32_t), &sent, sizeof(uint64_t));
+    link->send(frame.data(), frame.size());
+  }
+  link->close();
+}
+
+bool check(const bool cond, const std::string& what) {
+  std::cout << (cond ? "ok: " : "FAILED: ") << what << std::endl;
+  return cond;
+}
+
+bool check_frequencies() {
+  auto ok = true;
+  const auto a = open_controller();
+  try {
+    open_controller(4000);
+    ok &= check(false, "a client with other frequencies is rejected");
+  } catch (autd::core::exception::LinkError&) {
+    ok &= check(true, "a client with other frequencies is rejected");
+  }
+
+  auto b = open_controller();
+  try {
+    a->set_frequency({{0, 4500}});
+    ok &= check(false, "the frequencies are not changed while another client is attached");
+  } catch (autd::core::exception::LinkError&) {
+    ok &= check(a->geometry()->freq_cycle(0) == autd::core::FPGA_BASE_CLK_FREQ / 40000,
+                "the frequencies are not changed while another client is attached");
+  }
+
+  b->close();
+  ok &= check(a->set_frequency({{0, 4500}}) && a->geometry()->freq_cycle(0) == 4500, "the frequencies are changed by the only client");
+  a->close();
+  return ok;
+}
+}  // namespace
+
+int main() try {
+  int ready[2];
+  if (pipe(ready) != 0) throw std::runtime_error("Failed to create a pipe");
+  const auto daemon = fork();
+  if (daemon == 0) {
+    ::close(ready[0]);
+    std::exit(run_daemon(ready[1]));
+  }
+  ::close(ready[1]);
+  char c = 0;
+  if (read(ready[0], &c, 1) != 1) throw std::runtime_error("Failed to start the daemon");
+  ::close(ready[0]);
+
+  std::cout << std::thread::hardware_concurrency() << " hardware thread(s)" << std::endl;
+  auto ok = true;
+
+  std::vector<pid_t> clients;
+  for (uint16_t id = 1; id <= NUM_CLIENTS; id++) {
+    const auto pid = fork();
+    if (pid == 0) std::exit(run_client(id));
+    clients.emplace_back(pid);
+  }
+  for (const auto pid : clients) {
+    int status = 0;
+    waitpid(pid, &status, 0);
+    ok &= check(WIFEXITED(status) && WEXITSTATUS(status) == 0, "client " + std::to_string(pid) + " sent all the gains");
+  }
+
+  // the daemon polls the rings for 10 ms after the last frame, and then waits on the doorbell
+  measure_latency(std::chrono::microseconds(100));
+  measure_latency(std::chrono::microseconds(20000));
+
+  ok &= check_frequencies();
+
+  kill(daemon, SIGTERM);
+  int status = 0;
+  waitpid(daemon, &status, 0);
+  ok &= check(WIFEXITED(status) && WEXITSTATUS(status) == 0, "no frames of a gain are interleaved with those of the others");
+  return ok ? 0 : 1;
+} catch (std::exception& e) {
+  std::cerr << e.what() << std::endl;
+  return ENXIO;
+}
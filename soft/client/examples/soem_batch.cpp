@@ -0,0 +1,63 @@
+// File: soem_batch.cpp
+// Project: examples
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// Controller::batch() sends several commands in a COMMAND_LIST frame, which is executed in order and acknowledged once.
+// COMMAND_LIST requires firmware v0.5 or later, so use example_soem for the devices with older firmware.
+
+#include <iostream>
+
+#include "autd3-freq-shift.hpp"
+#include "autd3-freq-shift/link/soem.hpp"
+
+std::string get_adapter_name() {
+  size_t i = 0;
+  const auto adapters = autd::link::SOEM::enumerate_adapters();
+  for (auto&& [desc, name] : adapters) std::cout << "[" << i++ << "]: " << desc << ", " << name << std::endl;
+
+  std::cout << "Choose number: ";
+  std::string in;
+  getline(std::cin, in);
+  std::stringstream s(in);
+  if (const auto empty = in == "\n"; !(s >> i) || i >= adapters.size() || empty) return "";
+
+  return adapters[i].name;
+}
+
+int main() try {
+  const auto cnt = autd::Controller::create();
+
+  cnt->geometry()->sound_speed() = 340e3;
+  cnt->geometry()->add_device(autd::Vector3(0, 0, 0), autd::Vector3(0, 0, 0), 5000);
+  cnt->geometry()->add_device(autd::Vector3(0, 0, 0), autd::Vector3(0, 0, 0), 4999);
+
+  const auto ifname = get_adapter_name();
+  cnt->open(autd::link::SOEM::create(ifname, cnt->geometry()->num_devices()));
+  cnt->set_check_ack(true);
+
+  const auto firm_info_list = cnt->firmware_info_list();
+  for (auto&& firm_info : firm_info_list) std::cout << firm_info << std::endl;
+
+  const auto center =
+      autd::Vector3(autd::TRANS_SPACING_MM * ((autd::NUM_TRANS_X - 1) / 2.0), autd::TRANS_SPACING_MM * ((autd::NUM_TRANS_Y - 1) / 2.0), 150.0);
+
+  // Clear, set the frequency and output a focus with one frame and one acknowledgement, instead of three
+  if (!cnt->batch().clear().set_frequency().send_focus(center).commit()) throw std::runtime_error("Failed to commit the batch");
+
+  std::cout << "press any key to finish..." << std::endl;
+  std::cin.ignore();
+
+  cnt->close();
+
+  return 0;
+} catch (std::exception& e) {
+  std::cerr << e.what() << std::endl;
+  return ENXIO;
+}
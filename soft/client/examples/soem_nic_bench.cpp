@@ -0,0 +1,219 @@
+// File: soem_nic_bench.cpp
+// Project: examples
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// Cycle time jitter and CPU usage of the cyclic process data exchange with the NIC backends of the SOEM link (Linux only, root is required).
+// The devices are emulated on the other end of a veth pair, which reflects the LRW and FRMW datagrams as the slaves do:
+//   ip link add veth0 type veth peer name veth1 && ip link set veth0 up && ip link set veth1 up
+//   example_soem_nic_bench veth0 veth1 [num_devices] [cycles] [cycle_us] [master_cpu] [device_cpu]
+// The master and the emulated devices should be pinned to different dedicated cores, e.g., isolated by isolcpus, since they otherwise compete
+// for the same core and the numbers show the scheduling rather than the NIC backends.
+
+#include <arpa/inet.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "autd3-freq-shift/core/ec_config.hpp"
+#include "nic.hpp"
+#include "process_data.hpp"
+
+using autd::autdsoem::ETHERTYPE_ECAT;
+
+constexpr size_t OUTPUT_SIZE = autd::core::EC_OUTPUT_FRAME_SIZE;
+constexpr size_t INPUT_SIZE = autd::core::EC_INPUT_FRAME_SIZE;
+
+uint64_t now_ns(const clockid_t clock = CLOCK_MONOTONIC) {
+  timespec ts{};
+  clock_gettime(clock, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+// pin the thread to the cpu, or do nothing if cpu is negative
+void pin(const std::thread::native_handle_type thread, const int cpu) {
+  if (cpu < 0) return;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (const auto err = pthread_setaffinity_np(thread, sizeof set, &set); err != 0)
+    throw std::runtime_error("Failed to pin a thread to cpu " + std::to_string(cpu) + ": " + std::strerror(err));
+}
+
+/**
+ * @brief Devices on the other end of the veth pair
+ */
+class Reflector {
+ public:
+  Reflector(const std::string& ifname, const size_t num_devices, const int cpu) : _num_devices(num_devices) {
+    _fd = socket(PF_PACKET, SOCK_RAW, htons(ETHERTYPE_ECAT));
+    timeval timeout{0, 100000};
+    setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+    sockaddr_ll addr{};
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETHERTYPE_ECAT);
+    addr.sll_ifindex = static_cast<int>(if_nametoindex(ifname.c_str()));
+    if (_fd < 0 || bind(_fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0) throw std::runtime_error("Failed to open " + ifname);
+    _th = std::thread([this] { run(); });
+    pin(_th.native_handle(), cpu);
+  }
+  ~Reflector() {
+    _stop = true;
+    _th.join();
+    close(_fd);
+  }
+  Reflector(const Reflector& v) = delete;
+  Reflector& operator=(const Reflector& obj) = delete;
+  Reflector(Reflector&& obj) = delete;
+  Reflector& operator=(Reflector&& obj) = delete;
+
+ private:
+  void run() {
+    std::vector<uint8_t> frame(autd::autdsoem::ETH_FRAME_MAX_SIZE);
+    uint8_t counter = 0;
+    while (!_stop) {
+      sockaddr_ll addr{};
+      socklen_t addr_len = sizeof addr;
+      const auto len = recvfrom(_fd, frame.data(), frame.size(), 0, reinterpret_cast<sockaddr*>(&addr), &addr_len);
+      if (len <= 0 || addr.sll_pkttype == PACKET_OUTGOING) continue;
+      frame[6] |= 0x02;  // the first slave marks the source address
+      for (size_t pos = autd::autdsoem::ETH_HEADER_SIZE + autd::autdsoem::EC_HEADER_SIZE;;) {
+        const auto cmd = frame[pos];
+        const auto address = static_cast<uint32_t>(frame[pos + 2] | frame[pos + 3] << 8 | frame[pos + 4] << 16 | frame[pos + 5] << 24);
+        const auto length = static_cast<uint16_t>(frame[pos + 6] | frame[pos + 7] << 8);
+        const auto size = static_cast<size_t>(length & 0x7FF);
+        auto* data = &frame[pos + autd::autdsoem::EC_DATAGRAM_HEADER_SIZE];
+        uint16_t wkc = 0;
+        if (cmd == autd::autdsoem::EC_CMD_LRW) {
+          for (size_t dev = 0; dev < _num_devices; dev++) {
+            if (const auto begin = dev * OUTPUT_SIZE; address <= begin && begin + OUTPUT_SIZE <= address + size) wkc += 2;
+            if (const auto begin = _num_devices * OUTPUT_SIZE + dev * INPUT_SIZE; address <= begin && begin + INPUT_SIZE <= address + size) {
+              std::memset(data + (begin - address), counter, INPUT_SIZE);
+              wkc += 1;
+            }
+          }
+        } else if (cmd == autd::autdsoem::EC_CMD_FRMW) {
+          const auto t = now_ns();
+          std::memcpy(data, &t, sizeof t);
+          wkc = 1;
+        }
+        data[size] = static_cast<uint8_t>(wkc);
+        data[size + 1] = static_cast<uint8_t>(wkc >> 8);
+        if ((length & 0x8000) == 0) break;
+        pos += autd::autdsoem::EC_DATAGRAM_HEADER_SIZE + size + autd::autdsoem::EC_WKC_SIZE;
+      }
+      send(_fd, frame.data(), static_cast<size_t>(len), 0);
+      counter++;
+    }
+  }
+
+  int _fd;
+  size_t _num_devices;
+  std::atomic<bool> _stop{false};
+  std::thread _th;
+};
+
+struct Stats {
+  double p50, p99, max;
+};
+
+Stats stats(std::vector<double> v) {
+  std::sort(v.begin(), v.end());
+  return {v[v.size() / 2], v[v.size() * 99 / 100], v.back()};
+}
+
+void bench(const std::string& name, std::unique_ptr<autd::autdsoem::Nic> nic, const size_t num_devices, const size_t cycles,
+           const uint32_t cycle_us) {
+  const auto output_size = num_devices * OUTPUT_SIZE;
+  const auto image_size = output_size + num_devices * INPUT_SIZE;
+  std::vector<uint8_t> io_map(image_size);
+  std::vector<size_t> boundaries;
+  for (size_t dev = 0; dev < num_devices; dev++) {
+    boundaries.emplace_back(dev * OUTPUT_SIZE);
+    boundaries.emplace_back(output_size + dev * INPUT_SIZE);
+  }
+  autd::autdsoem::ProcessData pd(std::move(nic), io_map.data(), output_size, image_size, boundaries, 0, 0x1001);
+  const auto expected_wkc = static_cast<int>(3 * num_devices);
+
+  std::vector<double> wakeup;
+  std::vector<double> exchange;
+  size_t errors = 0;
+  const auto period = static_cast<uint64_t>(cycle_us) * 1000;
+  auto next = now_ns() + period;
+  const auto cpu_begin = now_ns(CLOCK_THREAD_CPUTIME_ID);
+  const auto wall_begin = now_ns();
+  for (size_t i = 0; i < cycles; i++) {
+    const timespec ts{static_cast<time_t>(next / 1000000000ull), static_cast<long>(next % 1000000000ull)};
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr);
+    const auto start = now_ns();
+    pd.send();
+    if (pd.receive(autd::autdsoem::PD_MAX_FRAMES * 100) != expected_wkc) errors++;
+    const auto end = now_ns();
+    wakeup.emplace_back(static_cast<double>(start - next) / 1000.0);
+    exchange.emplace_back(static_cast<double>(end - start) / 1000.0);
+    next += period;
+  }
+  const auto cpu = static_cast<double>(now_ns(CLOCK_THREAD_CPUTIME_ID) - cpu_begin) / static_cast<double>(now_ns() - wall_begin);
+
+  const auto w = stats(wakeup);
+  const auto e = stats(exchange);
+  std::cout << std::fixed << std::setprecision(1) << std::setw(12) << name << std::setw(8) << pd.num_frames() << std::setw(10) << w.p50
+            << std::setw(10) << w.p99 << std::setw(10) << w.max << std::setw(10) << e.p50 << std::setw(10) << e.p99 << std::setw(10) << e.max
+            << std::setw(8) << errors << std::setw(8) << cpu * 100.0 << std::endl;
+}
+
+int main(const int argc, char* argv[]) try {
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0] << " <master_ifname> <device_ifname> [num_devices] [cycles] [cycle_us] [master_cpu] [device_cpu]"
+              << std::endl;
+    return EINVAL;
+  }
+  const std::string master = argv[1];
+  const auto num_devices = argc > 3 ? static_cast<size_t>(std::stoul(argv[3])) : 10;
+  const auto cycles = argc > 4 ? static_cast<size_t>(std::stoul(argv[4])) : 5000;
+  const auto cycle_us = argc > 5 ? static_cast<uint32_t>(std::stoul(argv[5])) : 500;
+  const auto master_cpu = argc > 6 ? std::stoi(argv[6]) : -1;
+  const auto device_cpu = argc > 7 ? std::stoi(argv[7]) : -1;
+
+  pin(pthread_self(), master_cpu);
+  Reflector reflector(argv[2], num_devices, device_cpu);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  std::cout << num_devices << " devices, " << cycles << " cycles of " << cycle_us << " us" << std::endl;
+  if (master_cpu < 0 || device_cpu < 0 || master_cpu == device_cpu)
+    std::cout << "the master and the devices are not pinned to different cores, so the backends are not compared fairly" << std::endl;
+  std::cout << "wake-up delay and exchange time in us" << std::endl;
+  std::cout << std::setw(12) << "backend" << std::setw(8) << "frames" << std::setw(10) << "wake p50" << std::setw(10) << "wake p99" << std::setw(10)
+            << "wake max" << std::setw(10) << "xchg p50" << std::setw(10) << "xchg p99" << std::setw(10) << "xchg max" << std::setw(8) << "errors"
+            << std::setw(8) << "CPU %" << std::endl;
+  bench("socket", autd::autdsoem::create_socket_nic(master), num_devices, cycles, cycle_us);
+  bench("packet_mmap", autd::autdsoem::create_packet_mmap_nic(master), num_devices, cycles, cycle_us);
+
+  return 0;
+} catch (std::exception& e) {
+  std::cerr << e.what() << std::endl;
+  return ENXIO;
+}
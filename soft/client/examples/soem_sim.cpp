@@ -0,0 +1,94 @@
+// File: soem_sim.cpp
+// Project: examples
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// Open time, cycle jitter and fault recovery time of the SOEM link with the simulated devices (Linux only, root is required).
+// The devices are simulated on the other end of a veth pair:
+//   ip link add veth0 type veth peer name veth1 && ip link set veth0 up && ip link set veth1 up
+//   example_soem_sim veth0 veth1 [num_devices] [jitter_sec]
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "autd3-freq-shift.hpp"
+#include "autd3-freq-shift/link/soem.hpp"
+#include "slave_chain.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+double elapsed_ms(const Clock::time_point since) { return std::chrono::duration<double, std::milli>(Clock::now() - since).count(); }
+
+/**
+ * @brief Inject a fault and measure the time until all the devices are operational and acknowledge a frame again
+ */
+double recovery_ms(const autd::ControllerPtr& cnt, autd::sim::SlaveChain& chain, const std::function<void()>& inject) {
+  const auto center =
+      autd::Vector3(autd::TRANS_SPACING_MM * ((autd::NUM_TRANS_X - 1) / 2.0), autd::TRANS_SPACING_MM * ((autd::NUM_TRANS_Y - 1) / 2.0), 150.0);
+  const auto begin = Clock::now();
+  inject();
+  while (elapsed_ms(begin) < 10000.0) {
+    const auto status = chain.al_status();
+    if (std::all_of(status.begin(), status.end(), [](const uint8_t s) { return s == autd::sim::EC_STATE_OPERATIONAL; }) && cnt->send_focus(center))
+      return elapsed_ms(begin);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  throw std::runtime_error("The devices did not recover in 10 s");
+}
+
+int main(const int argc, char* argv[]) try {
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0] << " <master_ifname> <device_ifname> [num_devices] [jitter_sec]" << std::endl;
+    return EINVAL;
+  }
+  const size_t num_devices = argc > 3 ? std::stoul(argv[3]) : 2;
+  const auto jitter_sec = argc > 4 ? std::stoul(argv[4]) : 5;
+
+  autd::sim::SlaveChain chain(argv[2], num_devices);
+
+  const auto cnt = autd::Controller::create();
+  for (size_t i = 0; i < num_devices; i++) cnt->geometry()->add_device(autd::Vector3(0, 0, 0), autd::Vector3(0, 0, 0));
+  cnt->set_check_ack(true);
+
+  std::cout << std::fixed << std::setprecision(1);
+
+  const auto open_begin = Clock::now();
+  cnt->open(autd::link::SOEM::create(argv[1], num_devices));
+  if (!cnt->batch().clear().set_frequency().commit()) throw std::runtime_error("Failed to initialize the devices");
+  std::cout << "open: " << elapsed_ms(open_begin) << " ms" << std::endl;
+
+  (void)chain.cycle_stats(true);
+  std::this_thread::sleep_for(std::chrono::seconds(jitter_sec));
+  const auto [cycles, mean, p50, p99, max] = chain.cycle_stats(true);
+  std::cout << "cycle: " << cycles << " cycles, interval " << mean << " us, jitter p50/p99/max " << p50 << "/" << p99 << "/" << max << " us"
+            << std::endl;
+
+  const auto last = num_devices - 1;
+  std::cout << "recovery from power cycle: " << recovery_ms(cnt, chain, [&] { chain.reset(last); }) << " ms" << std::endl;
+  std::cout << "recovery from sync error: " << recovery_ms(cnt, chain, [&] { chain.set_error(last); }) << " ms" << std::endl;
+  std::cout << "recovery from cable disconnection for 100 ms: " << recovery_ms(cnt, chain, [&] {
+    chain.unplug(last);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    chain.plug();
+  }) << " ms"
+            << std::endl;
+
+  cnt->close();
+  return 0;
+} catch (std::exception& e) {
+  std::cerr << e.what() << std::endl;
+  return ENXIO;
+}
@@ -0,0 +1,125 @@
+// File: soem_sim_conformance.cpp
+// Project: examples
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// Check that the firmware model of the slave simulator reports the same inputs as the firmware (cpu/src/app.c built for host).
+// Random frames, including command lists, scheduled gains near the SYNC0 edges and repeated message ids, are given to both at random system
+// times of the distributed clocks, and the inputs are compared after each frame.
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "autd3-freq-shift/core/device_status.hpp"
+#include "autd3-freq-shift/core/ec_config.hpp"
+#include "autd3-freq-shift/core/hardware_defined.hpp"
+#include "firmware.hpp"
+#include "host_app.h"
+
+namespace {
+constexpr size_t NUM_FRAMES = 200000;
+
+// BRAM addresses of the config area read by the firmware, see cpu/src/app.c
+constexpr uint16_t FPGA_INFO_ADDR = 0xF001;
+constexpr uint16_t FPGA_VER_ADDR = 0xF0FF;
+
+constexpr std::array<autd::core::COMMAND, 12> COMMANDS = {
+    autd::core::COMMAND::WRITE_DUTY,        autd::core::COMMAND::WRITE_PHASE,          autd::core::COMMAND::SEQ_FOCI_MODE,
+    autd::core::COMMAND::GLOBAL_PARAMS,     autd::core::COMMAND::ULTRASOUND_CYCLE_CNT, autd::core::COMMAND::PAUSE,
+    autd::core::COMMAND::RESUME,            autd::core::COMMAND::CLEAR,                autd::core::COMMAND::READ_CPU_VER_LSB,
+    autd::core::COMMAND::READ_CPU_VER_MSB,  autd::core::COMMAND::READ_FPGA_VER_LSB,    autd::core::COMMAND::READ_FPGA_VER_MSB,
+};
+
+std::string hex(const uint8_t* data, const size_t size) {
+  std::string s;
+  char buf[4];
+  for (size_t i = 0; i < size; i++) {
+    std::snprintf(buf, sizeof(buf), "%02X ", data[i]);
+    s += buf;
+  }
+  return s;
+}
+}  // namespace
+
+int main() {
+  std::mt19937_64 rng(0);
+  const auto uniform = [&rng](const uint64_t lo, const uint64_t hi) { return std::uniform_int_distribution<uint64_t>(lo, hi)(rng); };
+
+  autd::sim::Firmware model;
+  host_fpga_region[FPGA_VER_ADDR] = autd::sim::FPGA_VERSION;
+  host_app_init();
+
+  std::array<uint8_t, autd::core::HEADER_SIZE> header{};
+  std::array<uint8_t, autd::core::EC_OUTPUT_FRAME_SIZE - autd::core::HEADER_SIZE> body{};
+  uint8_t msg_id = 0;
+  uint64_t sys_time = 1000000000;
+  for (size_t n = 0; n < NUM_FRAMES; n++) {
+    // the SYNC0 cycle is 1 ms at 40 kHz, so some frames arrive within the alignment margin of an edge
+    sys_time += uniform(0, 2000000);
+    host_dc_sys_time = sys_time;
+
+    const auto thermo = uniform(0, 99) == 0;
+    host_fpga_region[FPGA_INFO_ADDR] = thermo ? autd::core::FPGA_INFO_THERMO : 0;
+    model.set_thermal_alert(thermo);
+
+    // a frame is sometimes repeated, as the same outputs are sent every cycle
+    if (uniform(0, 9) != 0) {
+      header.fill(0);
+      for (auto& b : body) b = static_cast<uint8_t>(uniform(0, 255));
+      header[0] = ++msg_id == 0 ? ++msg_id : msg_id;
+      auto cmd = COMMANDS[uniform(0, COMMANDS.size() - 1)];
+      if (cmd == autd::core::COMMAND::ULTRASOUND_CYCLE_CNT || uniform(0, 9) == 0) {
+        // the cycle counts are kept valid, and 0 as after clear
+        const uint16_t cycle = uniform(0, 9) == 0 ? 0 : static_cast<uint16_t>(uniform(4000, 6000));
+        std::memcpy(body.data(), &cycle, sizeof(uint16_t));
+      }
+      if (uniform(0, 4) == 0) {
+        cmd = autd::core::COMMAND::COMMAND_LIST;
+        const auto num = uniform(0, autd::core::COMMAND_LIST_MAX + 2);
+        header[3] = static_cast<uint8_t>(num);
+        for (size_t i = 0; i < std::min<size_t>(num, autd::core::COMMAND_LIST_MAX); i++) {
+          header[4 + 2 * i] = static_cast<uint8_t>(COMMANDS[uniform(0, COMMANDS.size() - 1)]);
+          header[5 + 2 * i] = static_cast<uint8_t>(uniform(0, 255));
+        }
+      }
+      header[2] = static_cast<uint8_t>(cmd);
+      if (cmd == autd::core::COMMAND::WRITE_PHASE || uniform(0, 9) == 0) {
+        header[1] = autd::core::HEADER_FLAG_APPLY;
+        if (uniform(0, 1) == 0) {
+          header[1] |= autd::core::HEADER_FLAG_APPLY_AT;
+          const auto time = sys_time - 1000000 + uniform(0, 5000000);
+          std::memcpy(&header[3 + autd::core::APPLY_TIME_OFFSET], &time, sizeof(uint64_t));
+        }
+      }
+    }
+
+    model.receive(header.data(), body.data(), sys_time);
+    host_app_receive(header.data(), body.data());
+    host_app_update();
+
+    std::array<uint8_t, autd::core::EC_INPUT_FRAME_SIZE> expected{};
+    std::array<uint8_t, autd::core::EC_INPUT_FRAME_SIZE> actual{};
+    host_app_input(expected.data());
+    model.input(actual.data());
+    if (expected != actual) {
+      std::cerr << "mismatch at frame " << n << " (msg_id " << static_cast<int>(header[0]) << ", cmd 0x" << std::hex << static_cast<int>(header[2])
+                << ", flags 0x" << static_cast<int>(header[1]) << std::dec << ", sys_time " << sys_time << ")" << std::endl;
+      std::cerr << "  app.c: " << hex(expected.data(), expected.size()) << std::endl;
+      std::cerr << "  model: " << hex(actual.data(), actual.size()) << std::endl;
+      return 1;
+    }
+  }
+
+  std::cout << "the model reported the same inputs as the firmware for " << NUM_FRAMES << " frames" << std::endl;
+  return 0;
+}
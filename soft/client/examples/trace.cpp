@@ -0,0 +1,84 @@
+// File: trace.cpp
+// Project: examples
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// Trace the stages of the frames sent to a loopback link, and export them to trace.json, which can be opened by chrome://tracing or
+// https://ui.perfetto.dev. Also measure the cost of recording a stage.
+
+#ifndef AUTD3_ENABLE_TRACE
+#define AUTD3_ENABLE_TRACE
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "autd3-freq-shift.hpp"
+#include "autd3-freq-shift/core/ec_config.hpp"
+#include "autd3-freq-shift/core/trace.hpp"
+#include "autd3-freq-shift/gain/focal_point.hpp"
+
+/**
+ * @brief Link which acknowledges every frame immediately
+ */
+class LoopbackLink final : public autd::core::Link {
+ public:
+  explicit LoopbackLink(const size_t num_devices) : _num_devices(num_devices), _tx(num_devices * autd::core::EC_OUTPUT_FRAME_SIZE) {}
+
+  void open(const autd::core::LinkConfiguration&) override { _is_open = true; }
+  void reconfigure(const autd::core::LinkConfiguration&) override {}
+  void close() override { _is_open = false; }
+  void send(const uint8_t* buf, const size_t size) override { std::memcpy(_tx.data(), buf, std::min(size, _tx.size())); }
+  void read(uint8_t* rx, const size_t buffer_len) override {
+    for (size_t dev = 0; dev < _num_devices && (dev + 1) * autd::core::EC_INPUT_FRAME_SIZE <= buffer_len; dev++) {
+      std::memset(&rx[dev * autd::core::EC_INPUT_FRAME_SIZE], 0, autd::core::EC_INPUT_FRAME_SIZE);
+      rx[dev * autd::core::EC_INPUT_FRAME_SIZE + 1] = _tx[0];
+    }
+  }
+  bool is_open() override { return _is_open; }
+
+ private:
+  size_t _num_devices;
+  std::vector<uint8_t> _tx;
+  bool _is_open = false;
+};
+
+constexpr size_t NUM_DEVICES = 4;
+constexpr size_t NUM_RECORDS = 1000000;
+
+int main() try {
+  auto& tracer = autd::core::trace::Tracer::instance();
+
+  const auto start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < NUM_RECORDS; i++) autd::core::trace::span(autd::core::trace::Stage::Pack, static_cast<uint8_t>(i), autd::core::trace::now());
+  const auto ns = std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - start).count();
+  std::cout << "cost of recording a stage: " << ns / NUM_RECORDS << " ns" << std::endl;
+  tracer.clear();
+
+  const auto cnt = autd::Controller::create();
+  for (size_t i = 0; i < NUM_DEVICES; i++) cnt->geometry()->add_device(autd::Vector3(autd::DEVICE_WIDTH * i, 0, 0), autd::Vector3(0, 0, 0));
+  cnt->open(std::make_unique<LoopbackLink>(NUM_DEVICES));
+  cnt->set_check_ack(true);
+
+  const auto g = autd::gain::FocalPoint::create(autd::Vector3(autd::DEVICE_WIDTH * 2, 70.0, 150.0));
+  for (size_t i = 0; i < 100; i++) {
+    g->set_point(autd::Vector3(autd::DEVICE_WIDTH * 2 + static_cast<double>(i % 10), 70.0, 150.0));
+    cnt->send(g);
+  }
+  cnt->close();
+
+  std::cout << tracer.export_chrome("trace.json") << " events are written to trace.json" << std::endl;
+  return 0;
+} catch (std::exception& e) {
+  std::cerr << e.what() << std::endl;
+  return ENXIO;
+}
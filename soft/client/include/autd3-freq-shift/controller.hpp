@@ -3,7 +3,7 @@
 // Created Date: 14/04/2021
 // Author: Shun Suzuki
 // -----
-// Last Modified: 09/10/2021
+// Last Modified: 19/10/2026
 // Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
 // -----
 // Copyright (c) 2021 Hapis Lab. All rights reserved.
@@ -12,49 +12,167 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cstring>
+#include <future>
+#include <limits>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <utility>
 #include <vector>
 
+#include "autd3-freq-shift/core/command_queue.hpp"
+#include "autd3-freq-shift/core/device_status.hpp"
 #include "autd3-freq-shift/core/ec_config.hpp"
 #include "autd3-freq-shift/core/firmware_version.hpp"
 #include "autd3-freq-shift/core/gain.hpp"
 #include "autd3-freq-shift/core/geometry.hpp"
 #include "autd3-freq-shift/core/link.hpp"
 #include "autd3-freq-shift/core/logic.hpp"
+#include "autd3-freq-shift/core/memory_pool.hpp"
+#include "autd3-freq-shift/core/trace.hpp"
 
 namespace autd {
 
 class Controller;
 using ControllerPtr = std::unique_ptr<Controller>;
 
+/**
+ * @brief Controller of the devices
+ * @details Commands can be issued from multiple threads. Each command is packed in the calling thread into a slot of a command queue,
+ * and a worker thread sends the slots to the link in the order of reservation. *_async functions return a future which becomes ready when the
+ * command has been sent (and acknowledged if ack checking is enabled). The synchronous functions send the slots in the calling thread instead of
+ * the worker if no other thread is sending. open() and close() must not be called concurrently with other functions.
+ *
+ * Commands issued through batch() are coalesced into fewer frames, which shortens the startup and reconfiguration sequences.
+ *
+ * Gains and foci are latest-wins: if a newer gain or focus is issued before an older one is sent, the older one is dropped and its future becomes false.
+ * stop() and clear() are urgent: they overtake every queued command, and cancel the commands issued before them which have not been sent yet,
+ * whose futures become false. A link which queues frames, e.g., SOEM, also drops the queued frames of the commands sent before them.
+ *
+ * The command slots, their futures and the gains generated by create_gain() are allocated from a pool owned by the controller,
+ * so that sending and re-building gains in a steady state does not allocate memory from the heap.
+ */
 class Controller {
+  struct BatchOp {
+    enum class Kind { Clear, Frequency, Gain, Focus, GlobalParams };
+    Kind kind;
+    core::GainPtr gain = nullptr;
+    core::Vector3 point = core::Vector3::Zero();
+    double amp = 0.0;
+    std::vector<core::GlobalParams> params{};
+  };
+
  public:
+  /**
+   * @brief Commands which are coalesced into as few frames as possible
+   * @details The commands are executed in the order of addition. Consecutive commands whose payloads fit into the body of a frame together
+   * are sent as a single COMMAND_LIST frame, e.g., clear(), set_frequency() and send_focus() take one frame instead of three.
+   * The frames of a batch are sent back to back in FIFO order, and only the last frame is waited for.
+   * Every frame of a batch is acknowledged, including a frame which has only clear().
+   * COMMAND_LIST requires firmware v0.5 or later.
+   */
+  class Batch {
+   public:
+    Batch& clear() {
+      _ops.emplace_back(BatchOp{BatchOp::Kind::Clear});
+      return *this;
+    }
+
+    /**
+     * @brief Send the frequencies in the geometry, as Controller::set_frequency()
+     */
+    Batch& set_frequency() {
+      _ops.emplace_back(BatchOp{BatchOp::Kind::Frequency});
+      return *this;
+    }
+
+    /**
+     * @brief Send gain. The gain is calculated at commit().
+     */
+    Batch& send(core::GainPtr gain) {
+      _ops.emplace_back(BatchOp{BatchOp::Kind::Gain, std::move(gain)});
+      return *this;
+    }
+
+    Batch& send_focus(const core::Vector3& point, const double amp = 1.0) {
+      _ops.emplace_back(BatchOp{BatchOp::Kind::Focus, nullptr, point, amp});
+      return *this;
+    }
+
+    /**
+     * @brief Set the phase offsets and duty scales, as Controller::set_global_params()
+     */
+    Batch& set_global_params(std::vector<core::GlobalParams> params) {
+      _cnt->check_global_params(params);
+      _ops.emplace_back(BatchOp{BatchOp::Kind::GlobalParams, nullptr, core::Vector3::Zero(), 0.0, std::move(params)});
+      return *this;
+    }
+
+    [[nodiscard]] size_t size() const noexcept { return _ops.size(); }
+
+    bool commit() { return _cnt->sync([this] { return commit_async(); }); }
+
+    std::future<bool> commit_async() { return _cnt->commit(_ops); }
+
+   private:
+    friend class Controller;
+    explicit Batch(Controller* cnt) : _cnt(cnt) {}
+
+    Controller* _cnt;
+    std::vector<BatchOp> _ops;
+  };
+
   static ControllerPtr create() { return std::make_unique<Controller>(); }
 
-  Controller() : _check_ack(false), _tx_buf(nullptr), _rx_buf(nullptr), _link(nullptr), _geometry(std::make_unique<core::Geometry>()) {}
+  Controller()
+      : _check_ack(false),
+        _rx_buf(nullptr),
+        _status_buf(nullptr),
+        _link(nullptr),
+        _geometry(std::make_unique<core::Geometry>()),
+        _pool(core::create_memory_pool()),
+        _queue(nullptr),
+        _msg_id(),
+        _stop_gain(nullptr),
+        _last_gain(nullptr),
+        _last_focus(std::nullopt),
+        _global_params() {}
   ~Controller() {
     try {
       this->close();
     } catch (...) {
     }
   }
+  Controller(const Controller& v) = delete;
+  Controller& operator=(const Controller& obj) = delete;
+  Controller(Controller&& obj) = delete;
+  Controller& operator=(Controller&& obj) = delete;
 
   void open(core::LinkPtr link) {
     this->close();
 
-    this->_tx_buf = std::make_unique<uint8_t[]>(this->_geometry->num_devices() * core::EC_OUTPUT_FRAME_SIZE);
     this->_rx_buf = std::make_unique<uint8_t[]>(this->_geometry->num_devices() * core::EC_INPUT_FRAME_SIZE);
+    this->_status_buf = std::make_unique<uint8_t[]>(this->_geometry->num_devices() * core::EC_INPUT_FRAME_SIZE);
 
     core::LinkConfiguration config;
     for (size_t i = 0; i < _geometry->num_devices(); i++) config.freq_cycles.emplace_back(_geometry->freq_cycle(i));
 
     link->open(config);
     this->_link = std::move(link);
+
+    this->_stop_gain = create_gain<core::Gain>();
+    this->_stop_gain->build(this->_geometry);
+
+    this->_queue = std::make_unique<core::CommandQueue>(this->_geometry->num_devices() * core::EC_OUTPUT_FRAME_SIZE, this->_pool);
+    this->_worker = std::thread([this] { this->run(); });
   }
 
   bool close() {
@@ -63,10 +181,19 @@ class Controller {
     if (!this->stop()) return false;
     if (!this->clear()) return false;
 
+    this->_queue->wait_idle();
+    this->_queue->close();
+    if (this->_worker.joinable()) this->_worker.join();
+    this->_queue = nullptr;
+
     this->_link->close();
     this->_link = nullptr;
-    this->_tx_buf = nullptr;
     this->_rx_buf = nullptr;
+    this->_status_buf = nullptr;
+    this->_last_gain = nullptr;
+    this->_last_focus = std::nullopt;
+    this->_global_params.clear();
+    this->_stop_gain = nullptr;
 
     return true;
   }
@@ -74,73 +201,616 @@ class Controller {
   bool is_open() const { return this->_link != nullptr && this->_link->is_open(); }
   core::GeometryPtr& geometry() noexcept { return this->_geometry; }
 
-  bool clear() { return send_header(core::COMMAND::CLEAR); }
+  /**
+   * @brief If true, each command waits until the devices acknowledge it
+   * @details It can be changed while commands are being sent, and takes effect from the next command processed.
+   */
+  [[nodiscard]] bool check_ack() const noexcept { return this->_check_ack.load(std::memory_order_relaxed); }
+  void set_check_ack(const bool check_ack) noexcept { this->_check_ack.store(check_ack, std::memory_order_relaxed); }
+
+  /**
+   * @brief Generate gain allocated from the pool of the controller
+   * @details Re-building and re-sending the gain does not allocate memory from the heap.
+   */
+  template <typename T, typename... Args>
+  std::shared_ptr<T> create_gain(Args&&... args) {
+    return core::Gain::create_in<T>(this->_pool, std::forward<Args>(args)...);
+  }
+
+  bool clear() { return this->sync([&] { return clear_async(); }); }
 
-  bool stop() { return this->send(core::Gain::create()); }
+  std::future<bool> clear_async() {
+    std::shared_lock lk(_geometry_mtx);
+    return submit(reserve(core::SendPolicy::Urgent), [](core::Command& cmd) {
+      core::Logic::pack_header(core::COMMAND::CLEAR, 0, cmd.add_frame(sizeof(core::GlobalHeader)));
+      cmd.sets_params = true;
+      cmd.params.clear();
+    });
+  }
+
+  bool stop() { return this->sync([&] { return stop_async(); }); }
+
+  /**
+   * @brief Stop outputting ultrasound prior to the queued commands
+   * @details The zero gain is built at open().
+   */
+  std::future<bool> stop_async() {
+    std::shared_lock lk(_geometry_mtx);
+    auto& slot = reserve(core::SendPolicy::Urgent, [this] {
+      this->_last_gain = this->_stop_gain;
+      this->_last_focus = std::nullopt;
+    });
+    return submit(slot, [this](core::Command& cmd) { this->pack_gain(cmd, this->_stop_gain); });
+  }
 
+  bool pause() { return this->sync([&] { return pause_async(); }); }
+
+  /**
+   * @brief Stop outputting ultrasound prior to the queued commands, keeping the current gain in the devices
+   * @details It takes only a header frame, and the devices stop from the next ultrasound period. Unlike stop(), it cancels no command:
+   * the gains and foci queued before it are sent after it, and output on resume. Requires firmware v0.9 or later.
+   */
+  std::future<bool> pause_async() {
+    std::shared_lock lk(_geometry_mtx);
+    return enqueue([](core::Command& cmd) { core::Logic::pack_header(core::COMMAND::PAUSE, 0, cmd.add_frame(sizeof(core::GlobalHeader))); },
+                   core::SendPolicy::Preempt);
+  }
+
+  bool resume() { return this->sync([&] { return resume_async(); }); }
+
+  /**
+   * @brief Resume outputting the gain which the devices kept during pause(), without sending it again
+   * @details The gains sent during pause are output on resume. Requires firmware v0.9 or later.
+   */
+  std::future<bool> resume_async() {
+    std::shared_lock lk(_geometry_mtx);
+    return enqueue_header(core::COMMAND::RESUME);
+  }
+
+  /**
+   * @brief Send the frequencies in the geometry
+   * @details While the devices output a gain or a focus, they hold the new cycle counts until the next gain or focus is applied.
+   */
   bool set_frequency() {
-    uint8_t msg_id;
-    core::Logic::pack_header(core::COMMAND::ULTRASOUND_CYCLE_CNT, &this->_tx_buf[0], &msg_id);
-    size_t size = 0;
-    core::Logic::pack_freq_body(this->_geometry, &this->_tx_buf[0], &size);
-    this->_link->send(&this->_tx_buf[0], size);
-    return wait_msg_processed(msg_id, 200);
+    std::shared_lock lk(_geometry_mtx);
+    return this->sync([this] { return enqueue([this](core::Command& cmd) { this->pack_freq(cmd); }); });
+  }
+
+  /**
+   * @brief Change ultrasound frequencies of the devices without closing the link
+   * @param freq_cycles pairs of a device index and a new freq_cycle of the device
+   * @details SYNC0 is reprogrammed only for the changed devices, and the last sent gain or focus is recalculated with the new frequencies.
+   * The phase offsets set by set_global_params() are also converted with the new frequencies.
+   * The new cycle counts are packed with the phase offsets and the focus into one frame. The devices hold the cycle counts and the phase
+   * offsets until the recalculated focus, or the phase frame of the recalculated gain, is applied, so that the FPGA switches to all of them in
+   * the same ultrasound period. Since a gain fills the body of a frame, it takes two more frames. If neither was sent, the devices re-apply the
+   * duties and phases they hold with the new cycle counts.
+   * Until the frame arrives, the devices output the old image with the old cycle counts, but with the new SYNC0 cycle, since the link is
+   * reconfigured first so that the firmware aligns the SYNC0 counter to the new SYNC0 cycle.
+   * The queued commands are flushed before the link is reconfigured.
+   * The devices are waited for even if ack checking is disabled, and stop() and clear() issued meanwhile wait for it, so that an urgent command
+   * never cancels the new cycle counts after the link has been reconfigured.
+   * If a device index or a freq_cycle is invalid, or the link fails to be reconfigured, an exception is thrown and the geometry is not changed.
+   * Requires firmware v0.10 or later.
+   */
+  bool set_frequency(const std::vector<std::pair<size_t, uint16_t>>& freq_cycles) {
+    std::unique_lock lk(_geometry_mtx);
+    auto geometry = std::make_unique<core::Geometry>(*this->_geometry);
+    for (const auto& [dev_idx, freq_cycle] : freq_cycles) geometry->set_freq_cycle(dev_idx, freq_cycle);
+
+    this->_queue->wait_idle();
+    core::LinkConfiguration config;
+    for (size_t i = 0; i < geometry->num_devices(); i++) config.freq_cycles.emplace_back(geometry->freq_cycle(i));
+    this->_link->reconfigure(config);
+    *this->_geometry = std::move(*geometry);
+
+    std::future<bool> res;
+    {
+      std::unique_lock last_lk(_last_mtx);
+      if (this->_last_gain != nullptr) this->_last_gain->rebuild(this->_geometry);
+      std::vector<BatchOp> ops{BatchOp{BatchOp::Kind::Frequency}};
+      if (std::lock_guard params_lk(_params_mtx); !this->_global_params.empty())
+        ops.emplace_back(BatchOp{BatchOp::Kind::GlobalParams, nullptr, core::Vector3::Zero(), 0.0, this->_global_params});
+      if (this->_last_focus.has_value())
+        ops.emplace_back(BatchOp{BatchOp::Kind::Focus, nullptr, this->_last_focus->first, this->_last_focus->second});
+      else if (this->_last_gain != nullptr)
+        ops.emplace_back(BatchOp{BatchOp::Kind::Gain, this->_last_gain});
+      auto frames = plan_batch(ops);
+      if (ops.back().kind != BatchOp::Kind::Focus && ops.back().kind != BatchOp::Kind::Gain) frames.back().flags |= core::HEADER_FLAG_APPLY;
+      res = enqueue(
+          [this, &frames](core::Command& cmd) {
+            for (const auto& frame : frames) this->pack_batch_frame(cmd, frame);
+          },
+          core::SendPolicy::Fifo, true);
+    }
+    return this->wait(std::move(res));
+  }
+
+  /**
+   * @brief Send gain to the devices
+   * @details Duty and phase are sent back to back, and the devices switch to them at once at the beginning of an ultrasound period.
+   */
+  bool send(const core::GainPtr& gain) { return this->sync([&] { return send_async(gain); }); }
+
+  /**
+   * @brief Send gain to the devices without waiting
+   * @details The gain is calculated in the calling thread.
+   */
+  std::future<bool> send_async(const core::GainPtr& gain) {
+    std::shared_lock lk(_geometry_mtx);
+    const auto calc_begin = core::trace::now();
+    if (gain != nullptr) gain->build(this->_geometry);
+    const auto calc_end = core::trace::now();
+    auto& slot = reserve(core::SendPolicy::LatestWins, [this, &gain] {
+      this->_last_gain = gain;
+      this->_last_focus = std::nullopt;
+    });
+    return submit(slot, [this, &gain, calc_begin, calc_end](core::Command& cmd) {
+      cmd.trace.calc(calc_begin, calc_end);
+      this->pack_gain(cmd, gain);
+    });
   }
 
-  bool send(const core::GainPtr& gain) {
+  /**
+   * @brief Send gain, which takes effect at the first SYNC0 edge at or after dc_time
+   * @param gain gain to send
+   * @param dc_time system time of the distributed clocks in ns, e.g., dc_time() + 10 ms
+   * @details The devices stage the gain until the SYNC0 edge of dc_time, so that all the devices switch at the beginning of the same
+   * ultrasound period regardless of when the frames arrive, and the gain can be sent early. Unlike send(), the gain is never dropped by a
+   * newer gain or focus. If the time has already passed when the frame is processed, the gain takes effect immediately.
+   * A gain or focus processed before the time cancels the schedule.
+   * The time must be less than core::APPLY_AT_MAX_SYNC0_PERIODS SYNC0 periods of the device with the shortest ultrasound cycle ahead,
+   * i.e., about 2.6 s at core::MIN_FREQ_CYCLE and 33 s at 40 kHz, otherwise std::invalid_argument is thrown.
+   * Requires firmware v0.8 or later.
+   */
+  bool send_at(const core::GainPtr& gain, const uint64_t dc_time) { return this->sync([&] { return send_at_async(gain, dc_time); }); }
+
+  std::future<bool> send_at_async(const core::GainPtr& gain, const uint64_t dc_time) {
+    std::shared_lock lk(_geometry_mtx);
+    check_apply_time(dc_time);
+    const auto calc_begin = core::trace::now();
     if (gain != nullptr) gain->build(this->_geometry);
+    const auto calc_end = core::trace::now();
+    auto& slot = reserve(core::SendPolicy::Fifo, [this, &gain] {
+      this->_last_gain = gain;
+      this->_last_focus = std::nullopt;
+    });
+    return submit(slot, [this, &gain, dc_time, calc_begin, calc_end](core::Command& cmd) {
+      cmd.trace.calc(calc_begin, calc_end);
+      this->pack_gain(cmd, gain);
+      core::Logic::pack_apply_time(cmd.frames[cmd.num_frames - 1].data.get(), dc_time);
+    });
+  }
 
-    uint8_t msg_id;
-    size_t size = 0;
-    core::Logic::pack_header(core::COMMAND::WRITE_DUTY, &this->_tx_buf[0], &msg_id);
-    core::Logic::pack_duty_body(gain, &this->_tx_buf[0], &size);
-    this->_link->send(&this->_tx_buf[0], size);
-    if (!wait_msg_processed(msg_id, 200)) return false;
+  /**
+   * @brief System time of the distributed clocks of the devices in ns, or 0 if the link has no distributed clocks
+   */
+  uint64_t dc_time() {
+    if (!this->is_open()) throw core::exception::LinkError("Controller is not opened");
+    return this->_link->dc_time();
+  }
+
+  /**
+   * @brief Send duties and phases built in advance, e.g., those stored in gain::GainLibrary
+   * @details The data is copied to the frames before this function returns.
+   * The data is rejected if it has a fingerprint and the fingerprint does not match the geometry.
+   * Since the data cannot be recalculated, it is not re-sent by set_frequency().
+   */
+  bool send(const core::GainData& data) { return this->sync([&] { return send_async(data); }); }
+
+  std::future<bool> send_async(const core::GainData& data) {
+    std::shared_lock lk(_geometry_mtx);
+    if (data.num_devices != this->_geometry->num_devices())
+      throw core::exception::GainBuildError("The gain data is for " + std::to_string(data.num_devices) + " devices, but the geometry has " +
+                                            std::to_string(this->_geometry->num_devices()));
+    if (data.fingerprint != 0 && data.fingerprint != this->_geometry->fingerprint())
+      throw core::exception::GainBuildError("The gain data was built for a different geometry or frequencies");
+    auto& slot = reserve(core::SendPolicy::LatestWins, [this] {
+      this->_last_gain = nullptr;
+      this->_last_focus = std::nullopt;
+    });
+    return submit(slot, [this, &data](core::Command& cmd) { this->pack_gain(cmd, data); });
+  }
 
-    core::Logic::pack_header(core::COMMAND::WRITE_PHASE, &this->_tx_buf[0], &msg_id);
-    core::Logic::pack_phase_body(gain, &this->_tx_buf[0], &size);
-    this->_link->send(&this->_tx_buf[0], size);
-    return wait_msg_processed(msg_id, 200);
+  /**
+   * @brief Make a single focus
+   * @param point focal point
+   * @param amp amplitude of the focus (0 to 1)
+   * @details Only the focal point is sent, and the FPGA of each device calculates the phases of its transducers.
+   * Since the gain calculation on the host is skipped, this is much faster than calculating and sending a gain for moving a focus.
+   */
+  bool send_focus(const core::Vector3& point, const double amp = 1.0) { return this->sync([&] { return send_focus_async(point, amp); }); }
+
+  std::future<bool> send_focus_async(const core::Vector3& point, const double amp = 1.0) {
+    std::shared_lock lk(_geometry_mtx);
+    auto& slot = reserve(core::SendPolicy::LatestWins, [this, &point, amp] {
+      this->_last_gain = nullptr;
+      this->_last_focus = std::make_pair(point, amp);
+    });
+    return submit(slot, [this, &point, amp](core::Command& cmd) { this->pack_focus(cmd, point, amp); });
   }
 
+  /**
+   * @brief Shift the phases and scale the duties of all the transducers of each device, without re-sending the gain or focus
+   * @param params phase offset and duty scale of each device
+   * @details Only two words per device are sent, and the FPGA applies them to the current gain or focus at the beginning of the next
+   * ultrasound period, so that a global phase shift or fade can be updated every cycle at a negligible cost.
+   * Unlike gains and foci, they are never dropped by a newer command. clear() resets them to 0 and 1.
+   * set_frequency() converts those of the last sent command, not those of a command cancelled by stop() or clear().
+   * Requires firmware v0.7 or later.
+   */
+  bool set_global_params(const std::vector<core::GlobalParams>& params) { return this->sync([&] { return set_global_params_async(params); }); }
+
+  /**
+   * @brief Set the same phase offset and duty scale to all the devices
+   */
+  bool set_global_params(const core::GlobalParams& params) { return this->sync([&] { return set_global_params_async(params); }); }
+
+  std::future<bool> set_global_params_async(const std::vector<core::GlobalParams>& params) {
+    std::shared_lock lk(_geometry_mtx);
+    check_global_params(params);
+    return submit(reserve(core::SendPolicy::Fifo), [this, &params](core::Command& cmd) {
+      this->pack_global_params(cmd, params.data());
+      cmd.sets_params = true;
+      cmd.params.assign(params.begin(), params.end());
+    });
+  }
+
+  std::future<bool> set_global_params_async(const core::GlobalParams& params) {
+    return set_global_params_async(std::vector<core::GlobalParams>(this->_geometry->num_devices(), params));
+  }
+
+  /**
+   * @brief Status of the devices reported in the latest cycle, i.e., thermal state, ctrl flags, cycle counts and recently processed msg_ids
+   * Requires firmware v0.6 or later, and the TxPDO mapped to 10 bytes. Otherwise, the fields other than the ack are 0.
+   * Requires firmware v0.6 or later.
+   */
+  core::DeviceStatusView status() {
+    if (!this->is_open()) throw core::exception::LinkError("Controller is not opened");
+    this->_link->read(this->_status_buf.get(), this->_geometry->num_devices() * core::EC_INPUT_FRAME_SIZE);
+    return {this->_status_buf.get(), this->_geometry->num_devices()};
+  }
+
+  /**
+   * @brief Start a batch of commands, e.g., cnt->batch().clear().set_frequency().send(gain).commit()
+   */
+  Batch batch() { return Batch(this); }
+
   std::vector<FirmwareInfo> firmware_info_list() {
     auto concat_byte = [](const uint8_t high, const uint16_t low) { return static_cast<uint16_t>(static_cast<uint16_t>(high) << 8 | low); };
 
     std::vector<FirmwareInfo> infos;
 
     const auto num_devices = this->_geometry->num_devices();
-    const auto check_ack = this->_check_ack;
-    this->_check_ack = true;
+    constexpr std::array commands = {core::COMMAND::READ_CPU_VER_LSB, core::COMMAND::READ_CPU_VER_MSB, core::COMMAND::READ_FPGA_VER_LSB,
+                                     core::COMMAND::READ_FPGA_VER_MSB};
+    std::array<std::vector<uint8_t>, commands.size()> rx;
+    std::array<std::future<bool>, commands.size()> res;
+    {
+      std::shared_lock lk(_geometry_mtx);
+      for (size_t i = 0; i < commands.size(); i++) {
+        rx[i].resize(num_devices * core::EC_INPUT_FRAME_SIZE);
+        res[i] = enqueue_header(commands[i], true, rx[i].data());
+      }
+    }
+    for (auto& r : res)
+      if (!this->wait(std::move(r))) return infos;
+
+    for (size_t i = 0; i < num_devices; i++) {
+      const auto cpu_version = concat_byte(rx[1][core::EC_INPUT_FRAME_SIZE * i], rx[0][core::EC_INPUT_FRAME_SIZE * i]);
+      const auto fpga_version = concat_byte(rx[3][core::EC_INPUT_FRAME_SIZE * i], rx[2][core::EC_INPUT_FRAME_SIZE * i]);
+      infos.emplace_back(FirmwareInfo(static_cast<uint16_t>(i), cpu_version, fpga_version));
+    }
+    return infos;
+  }
+
+ private:
+  template <typename F>
+  std::future<bool> enqueue(F&& pack, const core::SendPolicy policy = core::SendPolicy::Fifo, const bool force_ack = false, uint8_t* rx = nullptr) {
+    return submit(reserve(policy), std::forward<F>(pack), force_ack, rx);
+  }
+
+  core::Command& reserve(const core::SendPolicy policy) {
+    if (this->_queue == nullptr) throw core::exception::LinkError("Controller is not opened");
+    return this->_queue->reserve(policy);
+  }
 
-    std::vector<uint16_t> cpu_versions(num_devices);
-    if (const auto res = send_header(core::COMMAND::READ_CPU_VER_LSB); !res) return infos;
-    for (size_t i = 0; i < num_devices; i++) cpu_versions[i] = this->_rx_buf[2 * i];
-    if (const auto res = send_header(core::COMMAND::READ_CPU_VER_MSB); !res) return infos;
-    for (size_t i = 0; i < num_devices; i++) cpu_versions[i] = concat_byte(this->_rx_buf[2 * i], cpu_versions[i]);
+  // Reserve a slot after updating the last gain or focus. Since they are updated in the order of reservation, they do not refer to a command
+  // cancelled by an urgent command.
+  template <typename U>
+  core::Command& reserve(const core::SendPolicy policy, U&& update) {
+    std::unique_lock last_lk(_last_mtx);
+    update();
+    return reserve(policy);
+  }
+
+  template <typename F>
+  std::future<bool> submit(core::Command& cmd, F&& pack, const bool force_ack = false, uint8_t* rx = nullptr) {
+    cmd.force_ack = force_ack;
+    cmd.defer_ack = false;
+    cmd.rx = rx;
+    auto res = cmd.promise.get_future();
+    try {
+      const auto pack_begin = core::trace::now();
+      pack(cmd);
+      cmd.trace.pack(pack_begin, core::trace::now());
+    } catch (...) {
+      cmd.num_frames = 0;
+      this->_queue->publish(cmd);
+      throw;
+    }
+    this->_queue->publish(cmd);
+    return res;
+  }
 
-    std::vector<uint16_t> fpga_versions(num_devices);
-    if (const auto res = send_header(core::COMMAND::READ_FPGA_VER_LSB); !res) return infos;
-    for (size_t i = 0; i < num_devices; i++) fpga_versions[i] = this->_rx_buf[2 * i];
-    if (const auto res = send_header(core::COMMAND::READ_FPGA_VER_MSB); !res) return infos;
-    for (size_t i = 0; i < num_devices; i++) fpga_versions[i] = concat_byte(this->_rx_buf[2 * i], fpga_versions[i]);
+  // The links without the distributed clocks report 0, and the time is not checked then
+  void check_apply_time(const uint64_t dc_time) const {
+    const auto now = this->is_open() ? this->_link->dc_time() : 0;
+    if (now == 0 || dc_time <= now || this->_geometry->num_devices() == 0) return;
+    uint16_t min_cycle = std::numeric_limits<uint16_t>::max();
+    for (size_t i = 0; i < this->_geometry->num_devices(); i++) min_cycle = std::min(min_cycle, this->_geometry->freq_cycle(i));
+    const auto horizon = core::APPLY_AT_MAX_SYNC0_PERIODS * min_cycle * core::FPGA_BASE_CLK_PERIOD_NS * 40;
+    if (dc_time - now >= horizon)
+      throw std::invalid_argument("The time is " + std::to_string(dc_time - now) + " ns ahead, but must be less than " + std::to_string(horizon) +
+                                  " ns ahead");
+  }
 
-    this->_check_ack = check_ack;
+  void check_global_params(const std::vector<core::GlobalParams>& params) const {
+    if (params.size() != this->_geometry->num_devices())
+      throw std::invalid_argument("The parameters are for " + std::to_string(params.size()) + " devices, but the geometry has " +
+                                  std::to_string(this->_geometry->num_devices()));
+  }
 
-    for (size_t i = 0; i < num_devices; i++) infos.emplace_back(FirmwareInfo(static_cast<uint16_t>(i), cpu_versions[i], fpga_versions[i]));
-    return infos;
+  std::future<bool> enqueue_header(const core::COMMAND cmd, const bool force_ack = false, uint8_t* rx = nullptr) {
+    return enqueue([cmd](core::Command& c) { core::Logic::pack_header(cmd, 0, c.add_frame(sizeof(core::GlobalHeader))); },
+                   core::SendPolicy::Fifo, force_ack, rx);
   }
 
- private:
-  bool send_header(const core::COMMAND cmd) const {
-    constexpr auto send_size = sizeof(core::GlobalHeader);
-    uint8_t msg_id = 0;
-    core::Logic::pack_header(cmd, &_tx_buf[0], &msg_id);
-    _link->send(&_tx_buf[0], send_size);
-    return wait_msg_processed(msg_id, 200);
+  // A frame of a batch, which has up to COMMAND_LIST_MAX commands
+  struct BatchFrame {
+    std::array<const BatchOp*, core::COMMAND_LIST_MAX> ops{};
+    std::array<core::COMMAND, core::COMMAND_LIST_MAX> cmds{};
+    std::array<uint8_t, core::COMMAND_LIST_MAX> offsets{};
+    size_t n = 0;
+    size_t words = 0;
+    uint8_t flags = 0;
+  };
+
+  // Assign the commands to frames in order. A frame is closed when the next payload does not fit into the rest of the body,
+  // or after WRITE_PHASE since APPLY is processed after all the commands in the frame.
+  static std::vector<BatchFrame> plan_batch(const std::vector<BatchOp>& ops) {
+    std::vector<BatchFrame> frames;
+    const auto add = [&frames](const BatchOp& op, const core::COMMAND cmd, const size_t words, const uint8_t flags = 0) {
+      if (frames.empty() || frames.back().flags != 0 || frames.back().n == core::COMMAND_LIST_MAX ||
+          frames.back().words + words > core::NUM_TRANS_IN_UNIT)
+        frames.emplace_back();
+      auto& frame = frames.back();
+      frame.ops[frame.n] = &op;
+      frame.cmds[frame.n] = cmd;
+      frame.offsets[frame.n++] = static_cast<uint8_t>(frame.words);
+      frame.words += words;
+      frame.flags |= flags;
+    };
+    for (const auto& op : ops) {
+      switch (op.kind) {
+        case BatchOp::Kind::Clear:
+          add(op, core::COMMAND::CLEAR, 0);
+          break;
+        case BatchOp::Kind::Frequency:
+          add(op, core::COMMAND::ULTRASOUND_CYCLE_CNT, 1);
+          break;
+        case BatchOp::Kind::Gain:
+          add(op, core::COMMAND::WRITE_DUTY, core::NUM_TRANS_IN_UNIT);
+          add(op, core::COMMAND::WRITE_PHASE, core::NUM_TRANS_IN_UNIT, core::HEADER_FLAG_APPLY);
+          break;
+        case BatchOp::Kind::Focus:
+          add(op, core::COMMAND::SEQ_FOCI_MODE, 9);
+          break;
+        case BatchOp::Kind::GlobalParams:
+          add(op, core::COMMAND::GLOBAL_PARAMS, 2);
+          break;
+      }
+    }
+    return frames;
+  }
+
+  void pack_batch_frame(core::Command& cmd, const BatchFrame& frame) const {
+    auto* data = cmd.add_frame(sizeof(core::GlobalHeader));
+    size_t size = sizeof(core::GlobalHeader);
+    for (size_t i = 0; i < frame.n; i++) {
+      const auto* op = frame.ops[i];
+      switch (frame.cmds[i]) {
+        case core::COMMAND::ULTRASOUND_CYCLE_CNT:
+          core::Logic::pack_freq_body(this->_geometry, data, &size, frame.offsets[i]);
+          break;
+        case core::COMMAND::SEQ_FOCI_MODE:
+          core::Logic::pack_seq_foci_body(this->_geometry, op->point, op->amp, data, &size, frame.offsets[i]);
+          break;
+        case core::COMMAND::GLOBAL_PARAMS:
+          core::Logic::pack_global_params_body(this->_geometry, op->params.data(), data, &size, frame.offsets[i]);
+          break;
+        case core::COMMAND::WRITE_DUTY:
+          core::Logic::pack_duty_body(op->gain, data, &size);
+          break;
+        case core::COMMAND::WRITE_PHASE:
+          core::Logic::pack_phase_body(op->gain, data, &size);
+          break;
+        default:
+          break;
+      }
+    }
+    core::Logic::pack_command_list(frame.cmds.data(), frame.offsets.data(), frame.n, 0, data, frame.flags);
+    cmd.frames[cmd.num_frames - 1].size = size;
+  }
+
+  std::future<bool> commit(const std::vector<BatchOp>& ops) {
+    std::shared_lock lk(_geometry_mtx);
+    if (ops.empty()) {
+      std::promise<bool> res;
+      res.set_value(true);
+      return res.get_future();
+    }
+
+    for (const auto& op : ops)
+      if (op.kind == BatchOp::Kind::Gain && op.gain != nullptr) op.gain->build(this->_geometry);
+    const auto frames = plan_batch(ops);
+
+    // the commands of a batch are reserved at once, so that an urgent command cancels all of them or none of them
+    std::unique_lock last_lk(_last_mtx);
+    for (const auto& op : ops) {
+      if (op.kind == BatchOp::Kind::Gain) {
+        this->_last_gain = op.gain;
+        this->_last_focus = std::nullopt;
+      } else if (op.kind == BatchOp::Kind::Focus) {
+        this->_last_gain = nullptr;
+        this->_last_focus = std::make_pair(op.point, op.amp);
+      }
+    }
+
+    std::future<bool> res;
+    for (size_t begin = 0; begin < frames.size(); begin += core::Command::MAX_FRAMES) {
+      const auto end = std::min(begin + core::Command::MAX_FRAMES, frames.size());
+      res = enqueue([this, &frames, begin, end](core::Command& cmd) {
+        cmd.defer_ack = end != frames.size();
+        for (auto i = begin; i < end; i++) this->pack_batch_frame(cmd, frames[i]);
+        for (auto i = begin; i < end; i++)
+          for (size_t j = 0; j < frames[i].n; j++) {
+            if (frames[i].cmds[j] == core::COMMAND::CLEAR) {
+              cmd.sets_params = true;
+              cmd.params.clear();
+            } else if (frames[i].cmds[j] == core::COMMAND::GLOBAL_PARAMS) {
+              cmd.sets_params = true;
+              cmd.params.assign(frames[i].ops[j]->params.begin(), frames[i].ops[j]->params.end());
+            }
+          }
+      });
+    }
+    return res;
+  }
+
+  void pack_gain(core::Command& cmd, const core::GainPtr& gain) const { pack_gain(cmd, gain != nullptr ? gain->data() : core::GainData{}); }
+
+  void pack_gain(core::Command& cmd, const core::GainData& gain) const {
+    size_t size = 0;
+    auto* duty = cmd.add_frame(0);
+    core::Logic::pack_header(core::COMMAND::WRITE_DUTY, 0, duty);
+    core::Logic::pack_duty_body(gain, duty, &size);
+    cmd.frames[cmd.num_frames - 1].size = size;
+
+    auto* phase = cmd.add_frame(0);
+    core::Logic::pack_header(core::COMMAND::WRITE_PHASE, 0, phase, core::HEADER_FLAG_APPLY);
+    core::Logic::pack_phase_body(gain, phase, &size);
+    cmd.frames[cmd.num_frames - 1].size = size;
+  }
+
+  void pack_focus(core::Command& cmd, const core::Vector3& point, const double amp) const {
+    size_t size = 0;
+    auto* data = cmd.add_frame(0);
+    core::Logic::pack_header(core::COMMAND::SEQ_FOCI_MODE, 0, data);
+    core::Logic::pack_seq_foci_body(this->_geometry, point, amp, data, &size);
+    cmd.frames[cmd.num_frames - 1].size = size;
+  }
+
+  void pack_freq(core::Command& cmd) const {
+    size_t size = 0;
+    auto* data = cmd.add_frame(0);
+    core::Logic::pack_header(core::COMMAND::ULTRASOUND_CYCLE_CNT, 0, data);
+    core::Logic::pack_freq_body(this->_geometry, data, &size);
+    cmd.frames[cmd.num_frames - 1].size = size;
+  }
+
+  void pack_global_params(core::Command& cmd, const core::GlobalParams* params) const {
+    size_t size = 0;
+    auto* data = cmd.add_frame(0);
+    core::Logic::pack_header(core::COMMAND::GLOBAL_PARAMS, 0, data);
+    core::Logic::pack_global_params_body(this->_geometry, params, data, &size);
+    cmd.frames[cmd.num_frames - 1].size = size;
+  }
+
+  // The consumer of the queue is the only thread which touches the link, the message ids and _rx_buf after open.
+  // The worker is the consumer unless a thread waiting for its own command is, which saves the hand-off to the worker.
+  void run() {
+    while (this->_queue->wait_consumable()) this->consume();
+  }
+
+  // Process the ready commands if no other thread does. If res is given, stop once it becomes ready and leave the rest to the worker.
+  void consume(const std::future<bool>* res = nullptr) {
+    while (this->_queue->try_acquire()) {
+      auto done = false;
+      while (auto* cmd = this->_queue->try_front()) {
+        this->process(*cmd);
+        this->_queue->pop();
+        if (res != nullptr && res->wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+          done = true;
+          break;
+        }
+      }
+      this->_queue->release_consumer();
+      if (done || !this->_queue->has_ready()) return;
+    }
+  }
+
+  // Wait for the command, processing it in the calling thread if possible
+  bool wait(std::future<bool> res) {
+    this->consume(&res);
+    return res.get();
+  }
+
+  // Enqueue commands by the function and wait for the returned one. Since the calling thread processes them, the worker is not woken up.
+  template <typename F>
+  bool sync(F&& async) {
+    std::future<bool> res;
+    {
+      const core::CommandQueue::QuietScope quiet(this->_queue.get());
+      try {
+        res = async();
+      } catch (...) {
+        if (this->_queue != nullptr) this->consume();
+        throw;
+      }
+    }
+    return this->wait(std::move(res));
+  }
+
+  void process(core::Command& cmd) {
+    try {
+      uint8_t msg_id = 0;
+      for (size_t i = 0; i < cmd.num_frames; i++) {
+        msg_id = this->_msg_id.next();
+        reinterpret_cast<core::GlobalHeader*>(cmd.frames[i].data.get())->msg_id = msg_id;
+        if (i == 0) cmd.trace.emit(msg_id);
+        const auto enqueue_begin = core::trace::now();
+        this->_link->send_with_policy(cmd.frames[i].data.get(), cmd.frames[i].size, frame_policy(cmd.policy, i));
+        core::trace::span(core::trace::Stage::Enqueue, msg_id, enqueue_begin);
+      }
+      if (cmd.num_frames > 0) this->_link->end_command();
+      if (cmd.num_frames > 0 && cmd.sets_params) {
+        std::lock_guard params_lk(_params_mtx);
+        this->_global_params.assign(cmd.params.begin(), cmd.params.end());
+      }
+      auto res = true;
+      if (cmd.num_frames == 0) {
+        res = false;
+      } else if ((this->check_ack() || cmd.force_ack) && !cmd.defer_ack) {
+        const auto ack_begin = core::trace::now();
+        res = wait_msg_processed(msg_id, 200);
+        core::trace::span(core::trace::Stage::Ack, msg_id, ack_begin);
+      }
+      if (cmd.rx != nullptr) std::memcpy(cmd.rx, &this->_rx_buf[0], this->_geometry->num_devices() * core::EC_INPUT_FRAME_SIZE);
+      cmd.promise.set_value(res);
+    } catch (...) {
+      cmd.promise.set_exception(std::current_exception());
+    }
+  }
+
+  // The first frame of a latest-wins command replaces the frames of the previous latest-wins command remaining in the link,
+  // so that a group of frames (e.g., duty and phase) is replaced as a whole
+  static core::SendPolicy frame_policy(const core::SendPolicy policy, const size_t frame_idx) {
+    if (policy == core::SendPolicy::LatestWins && frame_idx == 0) return core::SendPolicy::LatestWinsFirst;
+    return policy;
   }
 
   bool wait_msg_processed(const uint8_t msg_id, const size_t max_trial) const {
-    if (!this->_check_ack) return true;
     const auto num_devices = this->_geometry->num_devices();
     const auto buffer_len = num_devices * core::EC_INPUT_FRAME_SIZE;
     for (size_t i = 0; i < max_trial; i++) {
@@ -154,12 +824,26 @@ class Controller {
     return false;
   }
 
-  bool _check_ack;
+  std::atomic<bool> _check_ack;
 
-  std::unique_ptr<uint8_t[]> _tx_buf;
   std::unique_ptr<uint8_t[]> _rx_buf;
+  std::unique_ptr<uint8_t[]> _status_buf;
 
   core::LinkPtr _link;
   core::GeometryPtr _geometry;
+  std::shared_mutex _geometry_mtx;
+
+  core::MemoryPoolPtr _pool;
+  std::unique_ptr<core::CommandQueue> _queue;
+  std::thread _worker;
+  core::MsgIdSequence _msg_id;
+  core::GainPtr _stop_gain;
+
+  std::mutex _last_mtx;
+  core::GainPtr _last_gain;
+  std::optional<std::pair<core::Vector3, double>> _last_focus;
+  // the phase offsets and duty scales of the last sent command, which is written by the consumer
+  std::vector<core::GlobalParams> _global_params;
+  std::mutex _params_mtx;
 };
 }  // namespace autd
@@ -0,0 +1,354 @@
+// File: command_queue.hpp
+// Project: core
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "exception.hpp"
+#include "global_params.hpp"
+#include "link.hpp"
+#include "memory_pool.hpp"
+#include "trace.hpp"
+
+namespace autd::core {
+
+constexpr size_t COMMAND_QUEUE_SIZE = 32;
+
+/**
+ * @brief Frames which are sent back to back, and whose completion is notified at once
+ */
+struct Command {
+  static constexpr size_t MAX_FRAMES = 3;
+
+  /**
+   * @brief Append a frame
+   * @return pointer to the frame buffer, whose size is the frame size of the queue
+   */
+  uint8_t* add_frame(const size_t size) {
+    auto& frame = frames.at(num_frames++);
+    frame.size = size;
+    return frame.data.get();
+  }
+
+  struct Frame {
+    std::unique_ptr<uint8_t[]> data;
+    size_t size = 0;
+  };
+
+  std::array<Frame, MAX_FRAMES> frames;
+  size_t num_frames = 0;
+  SendPolicy policy = SendPolicy::Fifo;  //!< Fifo, LatestWins, Urgent or Preempt
+  bool force_ack = false;                //!< wait for the ack even if the controller does not check acks
+  bool defer_ack = false;                //!< do not wait for the ack, since a following command of the same batch waits for it
+  uint8_t* rx = nullptr;                 //!< if not null, received data after the last frame is processed are copied here
+  bool sets_params = false;              //!< the devices take params once the command is sent
+  std::vector<GlobalParams> params;      //!< phase offsets and duty scales of the devices, or empty if reset by CLEAR
+  std::promise<bool> promise;
+  trace::CommandStamps trace;
+
+ private:
+  friend class CommandQueue;
+  size_t _seq = 0;
+  // for an urgent command, the number of the normal commands reserved before it, which it cancels
+  size_t _barrier = 0;
+  // _seq of the next reservation while free, and _seq + 1 once published
+  std::atomic<size_t> _turn{0};
+};
+
+/**
+ * @brief Lock-free rings of commands with multiple producers and one consumer
+ * @details The frame buffers are allocated once, and commands are processed in the order of reservation.
+ * A producer reserves a slot with a single compare-and-swap, packs the frames into it, and publishes it with a single store, so that producers
+ * never block each other. The sequence number of each slot tells whether it is free, reserved or published, as in the bounded queue of
+ * D. Vyukov. The mutex is taken only to sleep when the queue is empty, full or being drained, and publishers notify the consumer only if it is
+ * sleeping.
+ * Any thread can be the consumer by try_acquire(), so that a thread waiting for its own command can process it without handing it off to another
+ * thread.
+ * Urgent and Preempt commands are reserved in a separate lane which is always processed first, and no normal command is processed while
+ * a command of the lane is being packed. Preempt commands cancel nothing.
+ * Once an urgent command is published, every normal command reserved before it is cancelled without being sent, whatever its policy is.
+ * A LatestWins command is also dropped without being sent if a newer LatestWins command has been published after it.
+ * The future of a cancelled or dropped command becomes false.
+ * The shared states of the futures are allocated from the pool if given.
+ */
+class CommandQueue {
+ public:
+  explicit CommandQueue(const size_t frame_size, MemoryPoolPtr pool = nullptr)
+      : _pool(std::move(pool)), _spin_count(std::thread::hardware_concurrency() > 1 ? SPIN_COUNT : 0) {
+    for (auto& lane : _lanes) {
+      lane.slots = std::vector<Command>(COMMAND_QUEUE_SIZE);
+      for (size_t i = 0; i < lane.slots.size(); i++) {
+        lane.slots[i]._turn.store(i, std::memory_order_relaxed);
+        for (auto& frame : lane.slots[i].frames) frame.data = std::make_unique<uint8_t[]>(frame_size);
+      }
+    }
+  }
+
+  /**
+   * @brief Reserve a slot. Blocks while the queue is full.
+   */
+  Command& reserve(const SendPolicy policy = SendPolicy::Fifo) {
+    auto& lane = _lanes[policy == SendPolicy::Urgent || policy == SendPolicy::Preempt ? URGENT : NORMAL];
+    auto seq = lane.reserved.load(std::memory_order_relaxed);
+    for (;;) {
+      if (_closed.load(std::memory_order_acquire)) throw exception::LinkError("Controller is closed");
+      const auto turn = lane.slot(seq)._turn.load(std::memory_order_acquire);
+      if (turn == seq) {
+        // sequentially consistent, so that the consumer never processes a normal command reserved after an unpublished urgent command
+        if (lane.reserved.compare_exchange_weak(seq, seq + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) break;
+      } else if (turn < seq) {
+        // the slot is still used by the previous round. The consumer may be sleeping if the commands were published quietly.
+        wake_consumer();
+        wait_for([&lane, seq] { return lane.slot(seq)._turn.load(std::memory_order_acquire) >= seq; });
+        seq = lane.reserved.load(std::memory_order_relaxed);
+      } else {
+        seq = lane.reserved.load(std::memory_order_relaxed);
+      }
+    }
+    auto& slot = lane.slot(seq);
+    slot._seq = seq;
+    slot._barrier = policy == SendPolicy::Urgent ? _lanes[NORMAL].reserved.load(std::memory_order_seq_cst) : 0;
+    slot.num_frames = 0;
+    slot.policy = policy;
+    slot.force_ack = false;
+    slot.rx = nullptr;
+    slot.sets_params = false;
+    slot.trace = trace::CommandStamps();
+    slot.promise = std::promise<bool>(std::allocator_arg, PoolAllocator<bool>(_pool));
+    return slot;
+  }
+
+  /**
+   * @brief While an instance is alive, the commands published to the queue by the thread do not wake up the sleeping consumer
+   * @details The thread must try to be the consumer after publishing, so that the commands are processed by it or by the current consumer.
+   */
+  class QuietScope {
+   public:
+    explicit QuietScope(const CommandQueue* queue) : _prev(quiet_queue()) { quiet_queue() = queue; }
+    ~QuietScope() { quiet_queue() = _prev; }
+    QuietScope(const QuietScope& v) = delete;
+    QuietScope& operator=(const QuietScope& obj) = delete;
+    QuietScope(QuietScope&& obj) = delete;
+    QuietScope& operator=(QuietScope&& obj) = delete;
+
+   private:
+    const CommandQueue* _prev;
+  };
+
+  /**
+   * @brief Make the reserved slot visible to the consumer
+   * @details An urgent slot with frames cancels the normal commands reserved before it.
+   */
+  void publish(Command& slot) {
+    if (slot.policy == SendPolicy::Urgent && slot.num_frames > 0) raise_barrier(slot._barrier);
+    slot._turn.store(slot._seq + 1, std::memory_order_release);
+    if (quiet_queue() != this) wake_consumer();
+  }
+
+  /**
+   * @brief Become the consumer of the queue. Only one thread can be the consumer at a time.
+   * @return false if another thread is the consumer
+   */
+  bool try_acquire() { return !_consuming.exchange(true, std::memory_order_acquire); }
+
+  /**
+   * @brief Stop being the consumer, and wake up the sleeping thread in wait_consumable() if commands remain
+   */
+  void release_consumer() {
+    _consuming.store(false, std::memory_order_release);
+    if (has_ready()) wake_consumer();
+  }
+
+  /**
+   * @brief Whether a command is ready to be processed
+   */
+  [[nodiscard]] bool has_ready() const { return ready(URGENT) || normal_ready(); }
+
+  /**
+   * @brief Wait until a command is ready and no thread is the consumer
+   * @return false if the queue is closed
+   */
+  bool wait_consumable() {
+    for (size_t spin = 0;; spin++) {
+      if (consumable()) return true;
+      if (_closed.load(std::memory_order_acquire)) return false;
+      if (spin < _spin_count) {
+        std::this_thread::yield();
+        continue;
+      }
+
+      std::unique_lock lk(_mtx);
+      _consumer_sleeping.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      _published.wait(lk, [this] { return _closed.load(std::memory_order_acquire) || consumable(); });
+      _consumer_sleeping.store(false, std::memory_order_relaxed);
+      spin = 0;
+    }
+  }
+
+  /**
+   * @brief The next command to be processed. Must be called by the consumer.
+   * @return the command, or nullptr if no command is ready
+   */
+  Command* try_front() {
+    for (;;) {
+      if (ready(URGENT)) {
+        _current = URGENT;
+        return &head(URGENT);
+      }
+      if (!normal_ready()) {
+        notify_progress();
+        return nullptr;
+      }
+      if (!dropped(head(NORMAL))) {
+        _current = NORMAL;
+        return &head(NORMAL);
+      }
+      head(NORMAL).promise.set_value(false);
+      release(NORMAL);
+    }
+  }
+
+  /**
+   * @brief Release the command returned by try_front() after it has been processed
+   */
+  void pop() { release(_current); }
+
+  /**
+   * @brief Wait until all reserved commands are processed
+   */
+  void wait_idle() {
+    wake_consumer();
+    wait_for([this] {
+      return std::all_of(_lanes.begin(), _lanes.end(), [](const Lane& lane) {
+        return lane.reserved.load(std::memory_order_acquire) == lane.released.load(std::memory_order_acquire);
+      });
+    });
+  }
+
+  void close() {
+    _closed.store(true, std::memory_order_release);
+    { std::lock_guard lk(_mtx); }
+    _published.notify_all();
+    _progressed.notify_all();
+  }
+
+ private:
+  static constexpr size_t NORMAL = 0;
+  static constexpr size_t URGENT = 1;
+  // the consumer polls a while before sleeping, unless there is no other core on which producers can publish meanwhile
+  static constexpr size_t SPIN_COUNT = 64;
+  static constexpr size_t WAKE_BATCH = COMMAND_QUEUE_SIZE / 4;
+
+  static const CommandQueue*& quiet_queue() {
+    static thread_local const CommandQueue* queue = nullptr;
+    return queue;
+  }
+
+  struct Lane {
+    Command& slot(const size_t seq) { return slots[seq % slots.size()]; }
+    [[nodiscard]] const Command& slot(const size_t seq) const { return slots[seq % slots.size()]; }
+
+    std::vector<Command> slots;
+    std::atomic<size_t> reserved{0};
+    std::atomic<size_t> released{0};  // written only by the consumer
+  };
+
+  Command& head(const size_t lane) { return _lanes[lane].slot(_lanes[lane].released.load(std::memory_order_relaxed)); }
+
+  [[nodiscard]] bool consumable() const { return !_consuming.load(std::memory_order_acquire) && has_ready(); }
+
+  // the head of the normal lane must wait for the urgent commands reserved before it
+  [[nodiscard]] bool normal_ready() const {
+    return ready(NORMAL) && _lanes[URGENT].reserved.load(std::memory_order_seq_cst) == _lanes[URGENT].released.load(std::memory_order_acquire);
+  }
+
+  [[nodiscard]] bool ready(const size_t lane) const {
+    const auto seq = _lanes[lane].released.load(std::memory_order_relaxed);
+    return _lanes[lane].slot(seq)._turn.load(std::memory_order_acquire) == seq + 1;
+  }
+
+  void release(const size_t lane) {
+    const auto seq = _lanes[lane].released.load(std::memory_order_relaxed);
+    _lanes[lane].slot(seq)._turn.store(seq + COMMAND_QUEUE_SIZE, std::memory_order_release);
+    _lanes[lane].released.store(seq + 1, std::memory_order_release);
+    // producers waiting for free slots are woken up in batches, and at the latest when the consumer runs out of commands
+    if ((seq + 1) % WAKE_BATCH == 0) notify_progress();
+  }
+
+  void wake_consumer() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_consumer_sleeping.load(std::memory_order_relaxed)) {
+      { std::lock_guard lk(_mtx); }
+      _published.notify_one();
+    }
+  }
+
+  void notify_progress() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_waiters.load(std::memory_order_relaxed) > 0) {
+      { std::lock_guard lk(_mtx); }
+      _progressed.notify_all();
+    }
+  }
+
+  // sleep until the consumer makes the predicate true
+  template <typename P>
+  void wait_for(P&& pred) {
+    std::unique_lock lk(_mtx);
+    _waiters.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    _progressed.wait(lk, [this, &pred] { return _closed.load(std::memory_order_acquire) || pred(); });
+    _waiters.fetch_sub(1, std::memory_order_relaxed);
+  }
+
+  void raise_barrier(const size_t seq) {
+    auto barrier = _normal_barrier.load(std::memory_order_relaxed);
+    while (barrier < seq && !_normal_barrier.compare_exchange_weak(barrier, seq, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+  }
+
+  [[nodiscard]] bool dropped(const Command& cmd) const {
+    if (cmd._seq < _normal_barrier.load(std::memory_order_acquire)) return true;
+    if (cmd.policy != SendPolicy::LatestWins) return false;
+    const auto& lane = _lanes[NORMAL];
+    const auto reserved = lane.reserved.load(std::memory_order_acquire);
+    for (auto seq = cmd._seq + 1; seq < reserved; seq++)
+      if (const auto& later = lane.slot(seq); later._turn.load(std::memory_order_acquire) == seq + 1 && later.policy == SendPolicy::LatestWins)
+        return true;
+    return false;
+  }
+
+  MemoryPoolPtr _pool;
+  size_t _spin_count;
+  std::array<Lane, 2> _lanes;
+  size_t _current = NORMAL;
+  std::atomic<size_t> _normal_barrier{0};
+  std::atomic<bool> _closed{false};
+  std::atomic<bool> _consuming{false};
+  std::atomic<bool> _consumer_sleeping{false};
+  std::atomic<size_t> _waiters{0};
+  std::mutex _mtx;
+  std::condition_variable _published;
+  std::condition_variable _progressed;
+};
+
+}  // namespace autd::core
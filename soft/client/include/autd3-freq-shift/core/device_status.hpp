@@ -0,0 +1,71 @@
+// File: device_status.hpp
+// Project: core
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+#include "ec_config.hpp"
+
+namespace autd::core {
+
+constexpr size_t ACK_HISTORY_SIZE = 4;
+
+constexpr uint8_t FPGA_INFO_THERMO = 1 << 0;
+constexpr uint8_t CTRL_FLAG_BANK = 1 << 0;
+constexpr uint8_t CTRL_FLAG_FOCUS_MODE = 1 << 1;
+constexpr uint8_t CTRL_FLAG_APPLY_AT = 1 << 2;
+constexpr uint8_t CTRL_FLAG_PAUSE = 1 << 4;
+
+/**
+ * @brief Input data reported by a device every cycle (firmware v0.6 or later)
+ */
+struct DeviceStatus {
+  uint8_t ack_data;                                   //!< data of the read commands
+  uint8_t msg_id;                                     //!< msg_id of the frame which last set the ack
+  uint8_t fpga_info;                                  //!< bit 0 = THERMO
+  uint8_t ctrl_flags;                                 //!< ctrl_flag written to the FPGA
+  uint16_t cycle;                                     //!< ultrasound cycle count
+  std::array<uint8_t, ACK_HISTORY_SIZE> ack_history;  //!< msg_ids of the last processed frames, the most recent first
+
+  [[nodiscard]] bool is_thermal_alert() const noexcept { return (fpga_info & FPGA_INFO_THERMO) != 0; }
+  [[nodiscard]] bool is_focus_mode() const noexcept { return (ctrl_flags & CTRL_FLAG_FOCUS_MODE) != 0; }
+  [[nodiscard]] bool is_paused() const noexcept { return (ctrl_flags & CTRL_FLAG_PAUSE) != 0; }
+
+  /**
+   * @brief Whether the frame with msg_id has been processed recently, even if later frames have been processed after it
+   */
+  [[nodiscard]] bool has_processed(const uint8_t id) const noexcept {
+    return msg_id == id || std::find(ack_history.begin(), ack_history.end(), id) != ack_history.end();
+  }
+};
+static_assert(sizeof(DeviceStatus) == EC_INPUT_FRAME_SIZE, "DeviceStatus must match the input frame of a device");
+
+/**
+ * @brief View of the statuses of all the devices in received data, without copying them
+ */
+class DeviceStatusView {
+ public:
+  DeviceStatusView(const uint8_t* rx, const size_t num_devices) noexcept : _data(reinterpret_cast<const DeviceStatus*>(rx)), _size(num_devices) {}
+
+  [[nodiscard]] const DeviceStatus& operator[](const size_t dev_idx) const noexcept { return _data[dev_idx]; }
+  [[nodiscard]] size_t size() const noexcept { return _size; }
+  [[nodiscard]] const DeviceStatus* begin() const noexcept { return _data; }
+  [[nodiscard]] const DeviceStatus* end() const noexcept { return _data + _size; }
+
+ private:
+  const DeviceStatus* _data;
+  size_t _size;
+};
+
+}  // namespace autd::core
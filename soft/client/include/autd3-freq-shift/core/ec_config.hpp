@@ -3,7 +3,7 @@
 // Created Date: 05/11/2020
 // Author: Shun Suzuki
 // -----
-// Last Modified: 22/09/2021
+// Last Modified: 19/10/2026
 // Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
 // -----
 // Copyright (c) 2021 Hapis Lab. All rights reserved.
@@ -17,7 +17,9 @@
 namespace autd::core {
 constexpr size_t HEADER_SIZE = 128;
 constexpr size_t EC_OUTPUT_FRAME_SIZE = 626;
-constexpr size_t EC_INPUT_FRAME_SIZE = 2;
+constexpr size_t EC_INPUT_FRAME_SIZE = 10;
+// The TxPDO of the ESI shipped with the firmware older than v0.6 is mapped to the ack only
+constexpr size_t EC_LEGACY_INPUT_FRAME_SIZE = 2;
 
 constexpr uint32_t EC_SM3_CYCLE_TIME_MICRO_SEC = 1000;
 constexpr uint32_t EC_SYNC0_CYCLE_TIME_MICRO_SEC = 500;
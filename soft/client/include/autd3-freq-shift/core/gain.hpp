@@ -3,7 +3,7 @@
 // Created Date: 11/05/2021
 // Author: Shun Suzuki
 // -----
-// Last Modified: 09/10/2021
+// Last Modified: 19/10/2026
 // Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
 // -----
 // Copyright (c) 2021 Hapis Lab. All rights reserved.
@@ -12,10 +12,12 @@
 #pragma once
 
 #include <memory>
+#include <utility>
 #include <vector>
 
 #include "geometry.hpp"
 #include "hardware_defined.hpp"
+#include "memory_pool.hpp"
 #include "utils.hpp"
 
 namespace autd::core {
@@ -23,6 +25,126 @@ namespace autd::core {
 class Gain;
 using GainPtr = std::shared_ptr<Gain>;
 
+/**
+ * @brief Duties or phases of the devices
+ * @details The rows are stored contiguously in its own storage, or borrowed from rows of another DataArrays by borrow(), so that a gain can be
+ * built directly into a part of another gain.
+ */
+class DataArrays {
+ public:
+  using Allocator = PoolAllocator<DataArray>;
+
+  class const_iterator;
+
+  class iterator {
+   public:
+    explicit iterator(DataArray* const* row) noexcept : _row(row) {}
+    DataArray& operator*() const noexcept { return **_row; }
+    iterator& operator++() noexcept {
+      ++_row;
+      return *this;
+    }
+    bool operator==(const iterator& v) const noexcept { return _row == v._row; }
+    bool operator!=(const iterator& v) const noexcept { return _row != v._row; }
+
+   private:
+    DataArray* const* _row;
+  };
+
+  class const_iterator {
+   public:
+    explicit const_iterator(DataArray* const* row) noexcept : _row(row) {}
+    const DataArray& operator*() const noexcept { return **_row; }
+    const_iterator& operator++() noexcept {
+      ++_row;
+      return *this;
+    }
+    bool operator==(const const_iterator& v) const noexcept { return _row == v._row; }
+    bool operator!=(const const_iterator& v) const noexcept { return _row != v._row; }
+
+   private:
+    DataArray* const* _row;
+  };
+
+  explicit DataArrays(const Allocator& alloc = Allocator()) : _storage(alloc), _rows(PoolAllocator<DataArray*>(alloc)), _borrowed(false) {}
+  ~DataArrays() = default;
+  DataArrays(const DataArrays& v) : DataArrays(v._storage.get_allocator()) { this->assign(v); }
+  DataArrays& operator=(const DataArrays& v) {
+    if (this == &v) return *this;
+    this->_storage = std::vector<DataArray, Allocator>(v._storage.get_allocator());
+    this->_rows = std::vector<DataArray*, PoolAllocator<DataArray*>>(PoolAllocator<DataArray*>(v._storage.get_allocator()));
+    this->_borrowed = false;
+    this->assign(v);
+    return *this;
+  }
+  DataArrays(DataArrays&& v) = default;
+  DataArrays& operator=(DataArrays&& v) = default;
+
+  /**
+   * @brief Resize its own storage. The borrowed rows, if any, are released.
+   * @details The storage is not re-allocated as long as the size does not exceed the capacity.
+   */
+  void resize(const size_t size) {
+    if (this->_borrowed) this->release();
+    this->_storage.resize(size);
+    this->_rows.resize(size);
+    for (size_t i = 0; i < size; i++) this->_rows[i] = &this->_storage[i];
+  }
+
+  /**
+   * @brief Borrow rows of another DataArrays instead of its own storage
+   * @param target DataArrays whose rows are borrowed
+   * @param row_ids indices of the rows of target. The i-th row of this DataArrays is row_ids[i] of target.
+   */
+  void borrow(DataArrays& target, const std::vector<size_t>& row_ids) {
+    this->_rows.resize(row_ids.size());
+    for (size_t i = 0; i < row_ids.size(); i++) this->_rows[i] = &target[row_ids[i]];
+    this->_borrowed = true;
+  }
+
+  /**
+   * @brief Release the borrowed rows. The size becomes 0.
+   */
+  void release() noexcept {
+    this->_rows.clear();
+    this->_borrowed = false;
+  }
+
+  [[nodiscard]] bool borrowed() const noexcept { return this->_borrowed; }
+  [[nodiscard]] size_t size() const noexcept { return this->_rows.size(); }
+  [[nodiscard]] bool empty() const noexcept { return this->_rows.empty(); }
+
+  DataArray& operator[](const size_t i) noexcept { return *this->_rows[i]; }
+  const DataArray& operator[](const size_t i) const noexcept { return *this->_rows[i]; }
+
+  iterator begin() noexcept { return iterator(this->_rows.data()); }
+  iterator end() noexcept { return iterator(this->_rows.data() + this->_rows.size()); }
+  [[nodiscard]] const_iterator begin() const noexcept { return const_iterator(this->_rows.data()); }
+  [[nodiscard]] const_iterator end() const noexcept { return const_iterator(this->_rows.data() + this->_rows.size()); }
+
+ private:
+  void assign(const DataArrays& v) {
+    this->resize(v.size());
+    for (size_t i = 0; i < v.size(); i++) this->_storage[i] = v[i];
+  }
+
+  std::vector<DataArray, Allocator> _storage;
+  std::vector<DataArray*, PoolAllocator<DataArray*>> _rows;
+  bool _borrowed;
+};
+
+/**
+ * @brief View of built duties and phases
+ * @details duties and phases point to num_devices * NUM_TRANS_IN_UNIT values each, device by device.
+ * If fingerprint is not zero, the data can be sent only to a geometry whose Geometry::fingerprint() is the same.
+ */
+struct GainData {
+  const uint16_t* duties = nullptr;
+  const uint16_t* phases = nullptr;
+  size_t num_devices = 0;
+  uint64_t fingerprint = 0;
+};
+
 /**
  * @brief Gain controls the duty ratio and phase of each transducer in AUTD devices.
  */
@@ -33,6 +155,18 @@ class Gain {
    */
   static GainPtr create() { return std::make_shared<Gain>(); }
 
+  /**
+   * @brief Generate gain whose object and data are allocated from the pool
+   * @details Gains generated in this way and re-built in place do not allocate memory from the heap once the pool is warmed up.
+   */
+  template <typename T, typename... Args>
+  static std::shared_ptr<T> create_in(const MemoryPoolPtr& pool, Args&&... args) {
+    auto gain = std::allocate_shared<T>(PoolAllocator<T>(pool), std::forward<Args>(args)...);
+    gain->_duties = DataArrays(PoolAllocator<DataArray>(pool));
+    gain->_phases = DataArrays(PoolAllocator<DataArray>(pool));
+    return gain;
+  }
+
   /**
    * \brief Calculate duty ratio and phase of each transducer
    * \param geometry Geometry
@@ -47,19 +181,46 @@ class Gain {
    * \param geometry Geometry
    */
   void build(const GeometryPtr& geometry) {
-    if (this->_built) return;
+    if (this->_built && !this->_duties.borrowed()) return;
 
+    // the storage is reused as long as the number of devices does not change
     const auto num_device = geometry->num_devices();
-
-    this->_duties.clear();
     this->_duties.resize(num_device);
-    this->_phases.clear();
     this->_phases.resize(num_device);
+    this->clear_data();
+
+    this->calc(geometry);
+    this->_built = true;
+  }
+
+  /**
+   * \brief Initialize data and call calc(), building the data directly into rows of other duties and phases instead of its own storage
+   * \details It is used by a gain which consists of other gains. The gain keeps referring to the rows until it is built by build() or released.
+   * \param geometry Geometry. The i-th device of geometry corresponds to row_ids[i].
+   * \param duties duties whose rows are written
+   * \param phases phases whose rows are written
+   * \param row_ids indices of the rows of duties and phases
+   */
+  void build_into(const GeometryPtr& geometry, DataArrays& duties, DataArrays& phases, const std::vector<size_t>& row_ids) {
+    this->_built = false;
+    this->_duties.borrow(duties, row_ids);
+    this->_phases.borrow(phases, row_ids);
+    this->clear_data();
 
     this->calc(geometry);
     this->_built = true;
   }
 
+  /**
+   * \brief Release the rows borrowed by build_into(). The gain has to be built again.
+   */
+  void release() noexcept {
+    if (!this->_duties.borrowed()) return;
+    this->_duties.release();
+    this->_phases.release();
+    this->_built = false;
+  }
+
   /**
    * \brief Re-calculate duty ratio and phase of each transducer
    * \param geometry Geometry
@@ -69,9 +230,22 @@ class Gain {
     this->build(geometry);
   }
 
-  [[nodiscard]] const std::vector<DataArray>& duties() const noexcept { return _duties; }
+  /**
+   * \brief Whether the gain has been already built
+   */
+  [[nodiscard]] bool built() const noexcept { return _built; }
 
-  [[nodiscard]] const std::vector<DataArray>& phases() const noexcept { return _phases; }
+  [[nodiscard]] const DataArrays& duties() const noexcept { return _duties; }
+
+  [[nodiscard]] const DataArrays& phases() const noexcept { return _phases; }
+
+  /**
+   * \brief View of the built duties and phases
+   */
+  [[nodiscard]] GainData data() const noexcept {
+    if (_duties.empty() || _duties.borrowed()) return GainData{};
+    return GainData{_duties[0].data(), _phases[0].data(), _duties.size(), 0};
+  }
 
   Gain() noexcept : _built(false) {}
   virtual ~Gain() = default;
@@ -81,8 +255,17 @@ class Gain {
   Gain& operator=(Gain&& obj) = default;
 
  protected:
+  /**
+   * \brief Clear duties and phases before calc()
+   * \details A gain which updates only a part of the data at each build overrides it to keep the data of the last build.
+   */
+  virtual void clear_data() {
+    for (auto& d : this->_duties) d.fill(0x0000);
+    for (auto& p : this->_phases) p.fill(0x0000);
+  }
+
   bool _built;
-  std::vector<DataArray> _duties;
-  std::vector<DataArray> _phases;
+  DataArrays _duties;
+  DataArrays _phases;
 };
 }  // namespace autd::core
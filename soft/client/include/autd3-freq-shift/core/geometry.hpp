@@ -3,7 +3,7 @@
 // Created Date: 14/04/2021
 // Author: Shun Suzuki
 // -----
-// Last Modified: 10/10/2021
+// Last Modified: 19/10/2026
 // Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
 // -----
 // Copyright (c) 2021 Hapis Lab. All rights reserved.
@@ -27,8 +27,16 @@
 #pragma GCC diagnostic pop
 #endif
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 #include <map>
 #include <memory>
+#include <stdexcept>
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -65,6 +73,44 @@ struct Device {
         global_trans_positions[index++] = Vector3(global_pos[0], global_pos[1], global_pos[2]);
       }
     g2l = transform_matrix.inverse();
+    center = transform_matrix * local_center();
+
+    // positions are quantized to 1 um so that the hash does not depend on rounding errors
+    position_hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < NUM_TRANS_IN_UNIT; i++)
+      for (Eigen::Index j = 0; j < 3; j++) position_hash = fnv1a(position_hash, static_cast<uint64_t>(std::llround(global_trans_positions[i][j] * 1000.0)));
+  }
+
+  static constexpr uint64_t FNV_OFFSET_BASIS = 0xcbf29ce484222325;
+
+  static uint64_t fnv1a(uint64_t hash, const uint64_t value) {
+    for (size_t i = 0; i < sizeof(uint64_t); i++) {
+      hash ^= value >> (8 * i) & 0xFF;
+      hash *= 0x100000001b3;
+    }
+    return hash;
+  }
+
+  /**
+   * @brief Center of the device in the local coordinate. The device is a DEVICE_WIDTH x DEVICE_HEIGHT rectangle around it.
+   */
+  static Vector3 local_center() {
+    return Vector3(static_cast<double>(NUM_TRANS_X - 1) * TRANS_SPACING_MM / 2.0, static_cast<double>(NUM_TRANS_Y - 1) * TRANS_SPACING_MM / 2.0, 0);
+  }
+
+  /**
+   * @brief Radius of the sphere which bounds the device
+   */
+  static double bounding_radius() { return std::sqrt(DEVICE_WIDTH * DEVICE_WIDTH + DEVICE_HEIGHT * DEVICE_HEIGHT) / 2.0; }
+
+  /**
+   * @brief Distance from a point to the device rectangle
+   */
+  [[nodiscard]] double distance(const Vector3& point) const {
+    const Vector3 local = g2l * point - local_center();
+    const auto dx = std::max(std::abs(local.x()) - DEVICE_WIDTH / 2.0, 0.0);
+    const auto dy = std::max(std::abs(local.y()) - DEVICE_HEIGHT / 2.0, 0.0);
+    return std::sqrt(dx * dx + dy * dy + local.z() * local.z());
   }
 
   Device(const Vector3& position, const Vector3& euler_angles, const uint16_t freq_cycle)
@@ -73,12 +119,33 @@ struct Device {
                    Eigen::AngleAxis<double>(euler_angles.z(), Vector3::UnitZ()),
                freq_cycle) {}
 
+  ~Device() = default;
+  Device(const Device& v)
+      : freq_cycle(v.freq_cycle),
+        x_direction(v.x_direction),
+        y_direction(v.y_direction),
+        z_direction(v.z_direction),
+        global_trans_positions(std::make_unique<Vector3[]>(NUM_TRANS_IN_UNIT)),
+        g2l(v.g2l),
+        center(v.center),
+        position_hash(v.position_hash) {
+    std::copy_n(v.global_trans_positions.get(), NUM_TRANS_IN_UNIT, global_trans_positions.get());
+  }
+  Device& operator=(const Device& obj) {
+    if (this != &obj) *this = Device(obj);
+    return *this;
+  }
+  Device(Device&& obj) = default;
+  Device& operator=(Device&& obj) = default;
+
   uint16_t freq_cycle;
   Vector3 x_direction;
   Vector3 y_direction;
   Vector3 z_direction;
   std::unique_ptr<Vector3[]> global_trans_positions;
   Eigen::Transform<double, 3, Eigen::Affine> g2l;
+  Vector3 center;
+  uint64_t position_hash;
 };
 
 /**
@@ -102,8 +169,10 @@ class Geometry {
    * @return an id of added device
    */
   size_t add_device(const Vector3& position, const Vector3& euler_angles, const uint16_t freq_cycle = FPGA_BASE_CLK_FREQ / 40000) {
+    check_freq_cycle(freq_cycle);
     const auto device_id = this->_devices.size();
     this->_devices.emplace_back(position, euler_angles, freq_cycle);
+    this->build_index();
     return device_id;
   }
 
@@ -115,8 +184,10 @@ class Geometry {
    * @return an id of added device
    */
   size_t add_device(const Vector3& position, const Quaternion& quaternion, const uint16_t freq_cycle = FPGA_BASE_CLK_FREQ / 40000) {
+    check_freq_cycle(freq_cycle);
     const auto device_id = this->_devices.size();
     this->_devices.emplace_back(position, quaternion, freq_cycle);
+    this->build_index();
     return device_id;
   }
 
@@ -127,13 +198,95 @@ class Geometry {
    */
   size_t del_device(const size_t idx) {
     this->_devices.erase(this->_devices.begin() + idx);
+    this->build_index();
     return idx;
   }
 
   /**
    * @brief Clear all devices
    */
-  void clear_devices() { std::vector<Device>().swap(this->_devices); }
+  void clear_devices() {
+    std::vector<Device>().swap(this->_devices);
+    this->build_index();
+  }
+
+  /**
+   * @brief Geometry which contains only the specified devices
+   * @param device_ids Indices of the devices to be contained. The i-th device of the returned geometry is device_ids[i] of this geometry.
+   */
+  [[nodiscard]] GeometryPtr subset(const std::vector<size_t>& device_ids) const {
+    auto geometry = std::make_unique<Geometry>();
+    geometry->_c = this->_c;
+    geometry->_devices.reserve(device_ids.size());
+    for (const auto dev_idx : device_ids) geometry->_devices.emplace_back(this->_devices[dev_idx]);
+    geometry->build_index();
+    return geometry;
+  }
+
+  /**
+   * @brief Hash of the transducer positions, the frequencies and the sound speed
+   * @details Duties and phases calculated for a geometry are valid for another geometry only if their fingerprints are the same.
+   * The fingerprint is never 0.
+   */
+  [[nodiscard]] uint64_t fingerprint() const {
+    uint64_t c_bits = 0;
+    std::memcpy(&c_bits, &this->_c, sizeof(double));
+    auto hash = Device::fnv1a(Device::fnv1a(Device::FNV_OFFSET_BASIS, c_bits), this->_devices.size());
+    for (const auto& dev : this->_devices) hash = Device::fnv1a(Device::fnv1a(hash, dev.position_hash), dev.freq_cycle);
+    return hash == 0 ? 1 : hash;
+  }
+
+  /**
+   * @brief Fingerprint of subset(device_ids), without constructing it
+   */
+  [[nodiscard]] uint64_t fingerprint(const std::vector<size_t>& device_ids) const {
+    uint64_t c_bits = 0;
+    std::memcpy(&c_bits, &this->_c, sizeof(double));
+    auto hash = Device::fnv1a(Device::fnv1a(Device::FNV_OFFSET_BASIS, c_bits), device_ids.size());
+    for (const auto dev_idx : device_ids)
+      hash = Device::fnv1a(Device::fnv1a(hash, this->_devices[dev_idx].position_hash), this->_devices[dev_idx].freq_cycle);
+    return hash == 0 ? 1 : hash;
+  }
+
+  /**
+   * @brief Indices of the devices within a distance from a point
+   * @param point target position
+   * @param range maximum distance from the point to the device rectangle
+   * @return indices of the devices in ascending order
+   */
+  [[nodiscard]] std::vector<size_t> devices_in_range(const Vector3& point, const double range) const {
+    std::vector<size_t> res;
+    this->query(point, range, [this, &point, range, &res](const size_t dev_idx) {
+      if (this->_devices[dev_idx].distance(point) <= range) res.emplace_back(dev_idx);
+    });
+    std::sort(res.begin(), res.end());
+    return res;
+  }
+
+  /**
+   * @brief Indices of the devices which face a point
+   * @param point target position
+   * @param max_angle maximum angle in radian between the direction of a device and the direction from the device to the point
+   * @param range maximum distance from the point to the device rectangle
+   * @return indices of the devices in ascending order
+   * @details The angle is tested against the bounding sphere of each device, so that a device is returned if the point is in the cone of any
+   * part of the device, and a device slightly outside the cone may be returned.
+   */
+  [[nodiscard]] std::vector<size_t> devices_in_cone(const Vector3& point, const double max_angle,
+                                                    const double range = std::numeric_limits<double>::infinity()) const {
+    std::vector<size_t> res;
+    this->query(point, range, [this, &point, max_angle, range, &res](const size_t dev_idx) {
+      const auto& dev = this->_devices[dev_idx];
+      if (dev.distance(point) > range) return;
+      const Vector3 v = point - dev.center;
+      const auto d = v.norm();
+      const auto r = Device::bounding_radius();
+      if (d > r && std::acos(std::clamp(v.dot(dev.z_direction) / d, -1.0, 1.0)) > max_angle + std::asin(r / d)) return;
+      res.emplace_back(dev_idx);
+    });
+    std::sort(res.begin(), res.end());
+    return res;
+  }
 
   /**
    * @brief Speed of sound
@@ -157,6 +310,26 @@ class Geometry {
 
   [[nodiscard]] uint16_t freq_cycle(const size_t device_idx) const { return this->_devices[device_idx].freq_cycle; }
 
+  /**
+   * @brief Change frequency of a device
+   * @param device_idx Index of the device
+   * @param freq_cycle frequency will be  FPGA_BASE_CLK_FREQ / freq_cycle, which must be MIN_FREQ_CYCLE or more
+   */
+  void set_freq_cycle(const size_t device_idx, const uint16_t freq_cycle) {
+    if (device_idx >= this->_devices.size()) throw std::out_of_range("Device " + std::to_string(device_idx) + " does not exist");
+    check_freq_cycle(freq_cycle);
+    this->_devices[device_idx].freq_cycle = freq_cycle;
+  }
+
+  /**
+   * @brief Throw std::invalid_argument if the devices cannot be driven with the freq_cycle
+   */
+  static void check_freq_cycle(const uint16_t freq_cycle) {
+    if (freq_cycle < MIN_FREQ_CYCLE)
+      throw std::invalid_argument("freq_cycle must be " + std::to_string(MIN_FREQ_CYCLE) + " or more, but " + std::to_string(freq_cycle) +
+                                  " is given");
+  }
+
   [[nodiscard]] double frequency(const size_t device_idx) const {
     return static_cast<double>(FPGA_BASE_CLK_FREQ) / static_cast<double>(freq_cycle(device_idx));
   }
@@ -211,8 +384,81 @@ class Geometry {
   [[nodiscard]] static size_t device_idx_for_trans_idx(const size_t transducer_idx) { return transducer_idx / NUM_TRANS_IN_UNIT; }
 
  private:
+  /**
+   * @brief Node of the bounding volume hierarchy over the device rectangles
+   * @details A leaf has count > 0 and contains _index_devices[first, first + count). An inner node has count == 0, and its children are
+   * the next node and the node at first.
+   */
+  struct IndexNode {
+    Vector3 min;
+    Vector3 max;
+    uint32_t first;
+    uint32_t count;
+  };
+
+  static constexpr size_t INDEX_LEAF_SIZE = 4;
+
+  void build_index() {
+    this->_index_nodes.clear();
+    this->_index_devices.resize(this->_devices.size());
+    for (size_t i = 0; i < this->_devices.size(); i++) this->_index_devices[i] = i;
+    if (!this->_devices.empty()) this->build_index(0, this->_devices.size());
+  }
+
+  size_t build_index(const size_t first, const size_t last) {
+    Vector3 min = Vector3::Constant(std::numeric_limits<double>::infinity());
+    Vector3 max = -min;
+    for (auto i = first; i < last; i++) {
+      const auto& dev = this->_devices[this->_index_devices[i]];
+      for (const auto sx : {-1.0, 1.0})
+        for (const auto sy : {-1.0, 1.0}) {
+          const Vector3 corner = dev.center + sx * DEVICE_WIDTH / 2.0 * dev.x_direction + sy * DEVICE_HEIGHT / 2.0 * dev.y_direction;
+          min = min.cwiseMin(corner);
+          max = max.cwiseMax(corner);
+        }
+    }
+
+    const auto node_idx = this->_index_nodes.size();
+    this->_index_nodes.emplace_back(IndexNode{min, max, static_cast<uint32_t>(first), static_cast<uint32_t>(last - first)});
+    if (last - first <= INDEX_LEAF_SIZE) return node_idx;
+
+    // split at the median of the centers along the longest axis
+    Eigen::Index axis = 0;
+    (max - min).maxCoeff(&axis);
+    const auto mid = first + (last - first) / 2;
+    std::nth_element(this->_index_devices.begin() + static_cast<std::ptrdiff_t>(first), this->_index_devices.begin() + static_cast<std::ptrdiff_t>(mid),
+                     this->_index_devices.begin() + static_cast<std::ptrdiff_t>(last),
+                     [this, axis](const size_t a, const size_t b) { return this->_devices[a].center[axis] < this->_devices[b].center[axis]; });
+    this->build_index(first, mid);
+    const auto right = this->build_index(mid, last);
+    this->_index_nodes[node_idx].first = static_cast<uint32_t>(right);
+    this->_index_nodes[node_idx].count = 0;
+    return node_idx;
+  }
+
+  // call f for each device whose bounding box is within range from point
+  template <typename F>
+  void query(const Vector3& point, const double range, F&& f) const {
+    if (this->_index_nodes.empty()) return;
+    std::array<size_t, 64> stack{};
+    size_t top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+      const auto& node = this->_index_nodes[stack[--top]];
+      if ((point - point.cwiseMax(node.min).cwiseMin(node.max)).norm() > range) continue;
+      if (node.count > 0) {
+        for (size_t i = node.first; i < node.first + node.count; i++) f(this->_index_devices[i]);
+        continue;
+      }
+      stack[top++] = node.first;
+      stack[top++] = static_cast<size_t>(&node - &this->_index_nodes[0]) + 1;
+    }
+  }
+
   std::vector<Device> _devices;
   double _c;
+  std::vector<IndexNode> _index_nodes;
+  std::vector<size_t> _index_devices;
 };
 }  // namespace core
 }  // namespace autd
@@ -0,0 +1,22 @@
+// File: global_params.hpp
+// Project: core
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+namespace autd::core {
+/**
+ * \brief Phase offset and duty scale applied by the FPGA to all the transducers of a device
+ */
+struct GlobalParams {
+  double phase_offset = 0.0;  //!< phase offset in radian
+  double duty_scale = 1.0;    //!< scale of duty (0 to 1)
+};
+}  // namespace autd::core
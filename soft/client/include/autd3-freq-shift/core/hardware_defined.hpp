@@ -3,7 +3,7 @@
 // Created Date: 14/04/2021
 // Author: Shun Suzuki
 // -----
-// Last Modified: 09/10/2021
+// Last Modified: 19/10/2026
 // Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
 // -----
 // Copyright (c) 2021 Hapis Lab. All rights reserved.
@@ -31,6 +31,8 @@ constexpr auto is_missing_transducer(T x, T y) {
 constexpr size_t ULTRASOUND_FREQUENCY = 40000;
 constexpr uint32_t FPGA_BASE_CLK_FREQ = 200000000;
 constexpr uint32_t FPGA_BASE_CLK_PERIOD_NS = 1000000000 / FPGA_BASE_CLK_FREQ;
+// the FPGA takes about 330 clocks of each ultrasound period to load the phases of all transducers
+constexpr uint16_t MIN_FREQ_CYCLE = 400;
 
 using DataArray = std::array<uint16_t, NUM_TRANS_IN_UNIT>;
 
@@ -41,14 +43,46 @@ enum class COMMAND : uint8_t {
   READ_FPGA_VER_LSB = 0x04,
   READ_FPGA_VER_MSB = 0x05,
   SEQ_FOCI_MODE = 0x06,
+  COMMAND_LIST = 0x07,
   CLEAR = 0x09,
   ULTRASOUND_CYCLE_CNT = 0x0B,
+  GLOBAL_PARAMS = 0x0C,
+  PAUSE = 0x0D,
+  RESUME = 0x0E,
   WRITE_DUTY = 0x10,
   WRITE_PHASE = 0x11
 };
 
+/**
+ * \brief Flags in GlobalHeader
+ * \details Duty and phase are staged in the device, and output from the next ultrasound period after the frame with APPLY flag is processed.
+ */
+constexpr uint8_t HEADER_FLAG_APPLY = 1 << 0;
+/**
+ * \brief The frame with APPLY takes effect at the first SYNC0 edge at or after the time in the tail of the header
+ */
+constexpr uint8_t HEADER_FLAG_APPLY_AT = 1 << 1;
+
 constexpr size_t FRAME_PADDING_SIZE = 125;
 
+/**
+ * \brief Maximum number of commands in a frame of COMMAND_LIST
+ * \details The commands and the offsets of their payloads in the body are stored in GlobalHeader::mod. Supported since firmware v0.5.
+ */
+constexpr size_t COMMAND_LIST_MAX = 16;
+
+/**
+ * \brief Offset of the time of HEADER_FLAG_APPLY_AT in GlobalHeader::mod, which follows the area of COMMAND_LIST
+ * \details The time is the system time of the distributed clocks in ns, in 64 bit little endian. Supported since firmware v0.8.
+ */
+constexpr size_t APPLY_TIME_OFFSET = 117;
+
+/**
+ * \brief Maximum number of SYNC0 periods from now to the time of HEADER_FLAG_APPLY_AT
+ * \details The FPGA compares the 16 bit index of the SYNC0 edge with its SYNC0 counter by sign, so that a later edge would be taken as passed.
+ */
+constexpr uint64_t APPLY_AT_MAX_SYNC0_PERIODS = 32767;
+
 /**
  * \brief Data header common to all devices
  */
@@ -0,0 +1,101 @@
+// File: input_snapshot.hpp
+// Project: core
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace autd::core {
+
+/**
+ * @brief Input process data published by the cyclic task of a link
+ * @details The cyclic task is the only writer, and writes each received image into the older of two buffers, each guarded by a sequence number.
+ * Readers copy the latest buffer and retry only if the writer has lapped it during the copy, so that neither the writer nor the readers block.
+ * The data are stored in atomic words to make the concurrent copy well-defined.
+ */
+class InputSnapshot {
+ public:
+  /**
+   * @brief Allocate the buffers. Must not be called concurrently with publish() or read().
+   */
+  void resize(const size_t size) {
+    _size = size;
+    for (auto& buf : _bufs) {
+      buf.seq.store(0, std::memory_order_relaxed);
+      buf.words = std::make_unique<std::atomic<uint64_t>[]>(num_words());
+      for (size_t i = 0; i < num_words(); i++) buf.words[i].store(0, std::memory_order_relaxed);
+    }
+    _cycle.store(0, std::memory_order_release);
+  }
+
+  [[nodiscard]] size_t size() const noexcept { return _size; }
+
+  /**
+   * @brief Publish a received image. Called only from the cyclic task.
+   */
+  void publish(const uint8_t* src) noexcept {
+    const auto cycle = _cycle.load(std::memory_order_relaxed) + 1;
+    auto& buf = _bufs[cycle % 2];
+    buf.seq.store(2 * cycle - 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0, offset = 0; i < num_words(); i++, offset += sizeof(uint64_t)) {
+      uint64_t word = 0;
+      std::memcpy(&word, src + offset, std::min(sizeof(uint64_t), _size - offset));
+      buf.words[i].store(word, std::memory_order_relaxed);
+    }
+    buf.seq.store(2 * cycle, std::memory_order_release);
+    _cycle.store(cycle, std::memory_order_release);
+  }
+
+  /**
+   * @brief Copy the latest image
+   * @param[out] dst buffer of size() bytes
+   * @return the number of the cycle in which the image was received, which is 0 before the first cycle
+   */
+  uint64_t read(uint8_t* dst) const noexcept {
+    while (true) {
+      const auto cycle = _cycle.load(std::memory_order_acquire);
+      const auto& buf = _bufs[cycle % 2];
+      const auto seq = buf.seq.load(std::memory_order_acquire);
+      if (seq != 2 * cycle) continue;
+      for (size_t i = 0, offset = 0; i < num_words(); i++, offset += sizeof(uint64_t)) {
+        const auto word = buf.words[i].load(std::memory_order_relaxed);
+        std::memcpy(dst + offset, &word, std::min(sizeof(uint64_t), _size - offset));
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (buf.seq.load(std::memory_order_relaxed) == seq) return cycle;
+    }
+  }
+
+  /**
+   * @brief The number of the latest published cycle
+   */
+  [[nodiscard]] uint64_t cycle() const noexcept { return _cycle.load(std::memory_order_acquire); }
+
+ private:
+  struct Buffer {
+    std::atomic<uint64_t> seq{0};
+    std::unique_ptr<std::atomic<uint64_t>[]> words;
+  };
+
+  [[nodiscard]] size_t num_words() const noexcept { return (_size + sizeof(uint64_t) - 1) / sizeof(uint64_t); }
+
+  size_t _size = 0;
+  std::atomic<uint64_t> _cycle{0};
+  std::array<Buffer, 2> _bufs{};
+};
+
+}  // namespace autd::core
@@ -3,7 +3,7 @@
 // Created Date: 11/05/2021
 // Author: Shun Suzuki
 // -----
-// Last Modified: 09/10/2021
+// Last Modified: 19/10/2026
 // Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
 // -----
 // Copyright (c) 2021 Hapis Lab. All rights reserved.
@@ -11,11 +11,23 @@
 
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <vector>
 
 namespace autd::core {
 
+/**
+ * @brief How a link may treat a frame when frames are queued faster than they are transmitted
+ */
+enum class SendPolicy : uint8_t {
+  Fifo = 0,         //!< sent in order. It may be dropped by a later Urgent frame.
+  LatestWinsFirst,  //!< first frame of a replaceable group. The queued replaceable frames are dropped before it is queued.
+  LatestWins,       //!< following frame of a replaceable group. It may be dropped by a later LatestWinsFirst or Urgent frame.
+  Urgent,           //!< the queued frames except the urgent ones are dropped, and it is sent after the queued urgent frames
+  Preempt,          //!< sent after the queued urgent frames, before the other queued frames. Nothing is dropped.
+};
+
 class LinkConfiguration {
  public:
   std::vector<uint16_t> freq_cycles;
@@ -37,6 +49,11 @@ class Link {
    * @brief Open link
    */
   virtual void open(const LinkConfiguration& config) = 0;
+  /**
+   * @brief Apply new configuration to the opened link
+   * @details Only the parts which differ from the current configuration are applied.
+   */
+  virtual void reconfigure(const LinkConfiguration& config) = 0;
   /**
    * @brief Close link
    */
@@ -45,10 +62,25 @@ class Link {
    * @brief  Send data to devices
    */
   virtual void send(const uint8_t* buf, size_t size) = 0;
+  /**
+   * @brief  Send data to devices with a queueing policy
+   * @details Links which do not queue frames can ignore the policy.
+   */
+  virtual void send_with_policy(const uint8_t* buf, const size_t size, SendPolicy) { send(buf, size); }
+  /**
+   * @brief Mark the end of the frames of a command sent by send_with_policy()
+   * @details Links which forward the frames of several senders forward the frames of a command at once, without interleaving those of the
+   * others. Links which send the frames one by one can ignore it.
+   */
+  virtual void end_command() {}
   /**
    * @brief  Read data from devices
    */
   virtual void read(uint8_t* rx, size_t buffer_len) = 0;
+  /**
+   * @brief System time of the distributed clocks of the devices in ns, or 0 if the link has no distributed clocks
+   */
+  virtual uint64_t dc_time() { return 0; }
 
   [[nodiscard]] virtual bool is_open() = 0;
 };
@@ -3,7 +3,7 @@
 // Created Date: 11/05/2021
 // Author: Shun Suzuki
 // -----
-// Last Modified: 10/10/2021
+// Last Modified: 19/10/2026
 // Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
 // -----
 // Copyright (c) 2021 Hapis Lab. All rights reserved.
@@ -11,29 +11,46 @@
 
 #pragma once
 
-#include <atomic>
+#include <algorithm>
+#include <cmath>
 #include <memory>
 #include <thread>
 #include <vector>
 
+#include "device_status.hpp"
 #include "gain.hpp"
 #include "geometry.hpp"
+#include "global_params.hpp"
+#include "utils.hpp"
 
 namespace autd::core {
 /**
- * \brief Hardware logic
+ * \brief Sequence of message ids
+ * \details Each Controller owns its sequence, so that controllers on different links share no state.
+ * 0 is never used since the devices treat it as the initial id, and 0xFF is reserved.
  */
-class Logic {
-  static uint8_t get_id() {
-    static std::atomic<uint8_t> id{0};
+class MsgIdSequence {
+ public:
+  uint8_t next() noexcept {
+    _id = _id >= MSG_ID_MAX ? 1 : static_cast<uint8_t>(_id + 1);
+    return _id;
+  }
 
-    id.fetch_add(0x01);
-    uint8_t expected = 0xff;
-    id.compare_exchange_weak(expected, 1);
+  /**
+   * \brief The id which is most recently issued
+   */
+  [[nodiscard]] uint8_t last() const noexcept { return _id; }
 
-    return id.load();
-  }
+ private:
+  static constexpr uint8_t MSG_ID_MAX = 0xFE;
 
+  uint8_t _id = 0;
+};
+
+/**
+ * \brief Hardware logic
+ */
+class Logic {
  public:
   /**
    * \brief check if the data which have msg_id have been processed in the devices.
@@ -41,27 +58,58 @@ class Logic {
    * \param msg_id message id
    * \param rx pointer to received data
    * \return whether the data have been processed
+   * \details The data are regarded as processed if msg_id is in the ack history, even if later frames have been processed after them.
    */
   static bool is_msg_processed(const size_t num_devices, const uint8_t msg_id, const uint8_t* const rx) {
-    size_t processed = 0;
-    for (size_t dev = 0; dev < num_devices; dev++)
-      if (const uint8_t proc_id = rx[dev * 2 + 1]; proc_id == msg_id) processed++;
-    return processed == num_devices;
+    const DeviceStatusView status(rx, num_devices);
+    return std::all_of(status.begin(), status.end(), [msg_id](const DeviceStatus& s) { return s.has_processed(msg_id); });
   }
 
   /**
    * \brief Pack header with COMMAND
    * \param cmd command
+   * \param msg_id message id
    * \param[out] data pointer to transmission data
-   * \param[out] msg_id message id
+   * \param flags header flags
    */
-  static void pack_header(const COMMAND cmd, uint8_t* data, uint8_t* const msg_id) {
+  static void pack_header(const COMMAND cmd, const uint8_t msg_id, uint8_t* data, const uint8_t flags = 0) {
     auto* header = reinterpret_cast<GlobalHeader*>(data);
-    *msg_id = get_id();
-    header->msg_id = *msg_id;
+    header->msg_id = msg_id;
+    header->_control_flags = flags;
     header->command = cmd;
   }
 
+  /**
+   * \brief Make the packed frame with APPLY flag take effect at the first SYNC0 edge at or after dc_time
+   * \param data pointer to transmission data, whose header has been packed
+   * \param dc_time system time of the distributed clocks in ns
+   */
+  static void pack_apply_time(uint8_t* data, const uint64_t dc_time) {
+    auto* header = reinterpret_cast<GlobalHeader*>(data);
+    header->_control_flags |= HEADER_FLAG_APPLY_AT;
+    for (size_t i = 0; i < sizeof(uint64_t); i++) header->mod[APPLY_TIME_OFFSET + i] = static_cast<uint8_t>(dc_time >> (8 * i));
+  }
+
+  /**
+   * \brief Pack header of COMMAND_LIST
+   * \param cmds commands executed in order
+   * \param word_offsets offsets of the payloads of the commands in the body of each device in units of 16 bit words
+   * \param n number of the commands (up to COMMAND_LIST_MAX)
+   * \param msg_id message id
+   * \param[out] data pointer to transmission data
+   * \param flags header flags, which are processed after all the commands
+   */
+  static void pack_command_list(const COMMAND* cmds, const uint8_t* word_offsets, const size_t n, const uint8_t msg_id, uint8_t* data,
+                                const uint8_t flags = 0) {
+    pack_header(COMMAND::COMMAND_LIST, msg_id, data, flags);
+    auto* header = reinterpret_cast<GlobalHeader*>(data);
+    header->mod[0] = static_cast<uint8_t>(n);
+    for (size_t i = 0; i < n; i++) {
+      header->mod[1 + 2 * i] = static_cast<uint8_t>(cmds[i]);
+      header->mod[2 + 2 * i] = word_offsets[i];
+    }
+  }
+
   /**
    * \brief Pack data body which contain duty data of each transducer.
    * \param gain Gain
@@ -69,14 +117,18 @@ class Logic {
    * \param[out] size size to send
    */
   static void pack_duty_body(const GainPtr& gain, uint8_t* data, size_t* size) {
-    const auto num_devices = gain != nullptr ? gain->duties().size() : 0;
-
-    *size = sizeof(GlobalHeader) + sizeof(uint16_t) * NUM_TRANS_IN_UNIT * num_devices;
-    if (gain == nullptr) return;
+    pack_duty_body(gain != nullptr ? gain->data() : GainData{}, data, size);
+  }
 
-    auto* cursor = data + sizeof(GlobalHeader);
-    const auto byte_size = NUM_TRANS_IN_UNIT * sizeof(uint16_t);
-    for (size_t i = 0; i < num_devices; i++, cursor += byte_size) std::memcpy(cursor, gain->duties()[i].data(), byte_size);
+  /**
+   * \brief Pack data body which contain duty data of each transducer.
+   * \param gain built duties and phases
+   * \param[out] data pointer to transmission data
+   * \param[out] size size to send
+   */
+  static void pack_duty_body(const GainData& gain, uint8_t* data, size_t* size) {
+    *size = sizeof(GlobalHeader) + sizeof(uint16_t) * NUM_TRANS_IN_UNIT * gain.num_devices;
+    if (gain.num_devices > 0) std::memcpy(data + sizeof(GlobalHeader), gain.duties, sizeof(uint16_t) * NUM_TRANS_IN_UNIT * gain.num_devices);
   }
 
   /**
@@ -86,14 +138,52 @@ class Logic {
    * \param[out] size size to send
    */
   static void pack_phase_body(const GainPtr& gain, uint8_t* data, size_t* size) {
-    const auto num_devices = gain != nullptr ? gain->phases().size() : 0;
+    pack_phase_body(gain != nullptr ? gain->data() : GainData{}, data, size);
+  }
+
+  /**
+   * \brief Pack data body which contain phase data of each transducer.
+   * \param gain built duties and phases
+   * \param[out] data pointer to transmission data
+   * \param[out] size size to send
+   */
+  static void pack_phase_body(const GainData& gain, uint8_t* data, size_t* size) {
+    *size = sizeof(GlobalHeader) + sizeof(uint16_t) * NUM_TRANS_IN_UNIT * gain.num_devices;
+    if (gain.num_devices > 0) std::memcpy(data + sizeof(GlobalHeader), gain.phases, sizeof(uint16_t) * NUM_TRANS_IN_UNIT * gain.num_devices);
+  }
+
+  /**
+   * \brief Pack data body of SEQ_FOCI_MODE, from which the devices calculate the phases of a focus by themselves.
+   * \param geometry Geometry
+   * \param point focal point
+   * \param amp amplitude of the focus (0 to 1)
+   * \param[out] data pointer to transmission data
+   * \param[out] size size to send
+   * \param word_offset offset of the payload in the body of each device in units of 16 bit words
+   * \details Each device receives the focal point in its local coordinate in units of 1/1024 mm as 32 bit signed integer, duty, and
+   * FPGA_BASE_CLK_FREQ / sound_speed in units of 1/65536 clk/mm as 32 bit unsigned integer.
+   */
+  static void pack_seq_foci_body(const GeometryPtr& geometry, const Vector3& point, const double amp, uint8_t* data, size_t* size,
+                                 const size_t word_offset = 0) {
+    const auto num_devices = geometry->num_devices();
 
     *size = sizeof(GlobalHeader) + sizeof(uint16_t) * NUM_TRANS_IN_UNIT * num_devices;
-    if (gain == nullptr) return;
 
-    auto* cursor = data + sizeof(GlobalHeader);
-    const auto byte_size = NUM_TRANS_IN_UNIT * sizeof(uint16_t);
-    for (size_t i = 0; i < num_devices; i++, cursor += byte_size) std::memcpy(cursor, gain->phases()[i].data(), byte_size);
+    const auto to_q10 = [](const double v) { return static_cast<uint32_t>(static_cast<int32_t>(std::round(v * 1024.0))); };
+    const auto k = static_cast<uint32_t>(std::round(static_cast<double>(FPGA_BASE_CLK_FREQ) / geometry->sound_speed() * 65536.0));
+
+    auto* cursor = reinterpret_cast<uint16_t*>(data + sizeof(GlobalHeader)) + word_offset;
+    for (size_t i = 0; i < num_devices; i++, cursor += NUM_TRANS_IN_UNIT) {
+      const auto local = geometry->to_local_position(i, point);
+      for (size_t axis = 0; axis < 3; axis++) {
+        const auto v = to_q10(local[axis]);
+        cursor[2 * axis] = static_cast<uint16_t>(v & 0xFFFF);
+        cursor[2 * axis + 1] = static_cast<uint16_t>(v >> 16);
+      }
+      cursor[6] = Utilities::to_duty(amp, geometry->freq_cycle(i));
+      cursor[7] = static_cast<uint16_t>(k & 0xFFFF);
+      cursor[8] = static_cast<uint16_t>(k >> 16);
+    }
   }
 
   /**
@@ -101,14 +191,40 @@ class Logic {
    * \param geometry Geometry
    * \param[out] data pointer to transmission data
    * \param[out] size size to send
+   * \param word_offset offset of the payload in the body of each device in units of 16 bit words
    */
-  static void pack_freq_body(const GeometryPtr& geometry, uint8_t* data, size_t* size) {
+  static void pack_freq_body(const GeometryPtr& geometry, uint8_t* data, size_t* size, const size_t word_offset = 0) {
     const auto num_devices = geometry->num_devices();
 
     *size = sizeof(GlobalHeader) + sizeof(uint16_t) * NUM_TRANS_IN_UNIT * num_devices;
 
-    auto* cursor = reinterpret_cast<uint16_t*>(data + sizeof(GlobalHeader));
+    auto* cursor = reinterpret_cast<uint16_t*>(data + sizeof(GlobalHeader)) + word_offset;
     for (size_t i = 0; i < num_devices; i++, cursor += NUM_TRANS_IN_UNIT) cursor[0] = geometry->freq_cycle(i);
   }
+
+  /**
+   * \brief Pack data body of GLOBAL_PARAMS
+   * \param geometry Geometry
+   * \param params phase offset and duty scale of each device
+   * \param[out] data pointer to transmission data
+   * \param[out] size size to send
+   * \param word_offset offset of the payload in the body of each device in units of 16 bit words
+   * \details Each device receives the phase offset in units of its ultrasound cycle count, and the duty scale in units of 1/256.
+   */
+  static void pack_global_params_body(const GeometryPtr& geometry, const GlobalParams* params, uint8_t* data, size_t* size,
+                                      const size_t word_offset = 0) {
+    const auto num_devices = geometry->num_devices();
+
+    *size = sizeof(GlobalHeader) + sizeof(uint16_t) * NUM_TRANS_IN_UNIT * num_devices;
+
+    auto* cursor = reinterpret_cast<uint16_t*>(data + sizeof(GlobalHeader)) + word_offset;
+    for (size_t i = 0; i < num_devices; i++, cursor += NUM_TRANS_IN_UNIT) {
+      const auto freq_cycle = geometry->freq_cycle(i);
+      auto offset = std::fmod(params[i].phase_offset, 2.0 * M_PI);
+      if (offset < 0.0) offset += 2.0 * M_PI;
+      cursor[0] = static_cast<uint16_t>(static_cast<uint32_t>(std::round(offset / (2.0 * M_PI) * static_cast<double>(freq_cycle))) % freq_cycle);
+      cursor[1] = static_cast<uint16_t>(std::round(std::clamp(params[i].duty_scale, 0.0, 1.0) * 256.0));
+    }
+  }
 };
 }  // namespace autd::core
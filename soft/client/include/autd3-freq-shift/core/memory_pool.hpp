@@ -0,0 +1,79 @@
+// File: memory_pool.hpp
+// Project: core
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#include <memory>
+#include <memory_resource>
+#include <type_traits>
+
+namespace autd::core {
+
+using MemoryPoolPtr = std::shared_ptr<std::pmr::memory_resource>;
+
+/**
+ * @brief Create a thread-safe pool which recycles freed blocks
+ * @details Blocks up to max_block_size bytes are kept in the pool after they are freed, so that allocations of the same sizes do not reach the
+ * heap once the pool is warmed up.
+ */
+inline MemoryPoolPtr create_memory_pool(const size_t max_block_size = 1 << 20) {
+  std::pmr::pool_options options;
+  options.largest_required_pool_block = max_block_size;
+  return std::make_shared<std::pmr::synchronized_pool_resource>(options);
+}
+
+/**
+ * @brief Allocator which allocates from a pool, or from the heap if no pool is given
+ * @details The allocator shares the ownership of the pool, so that objects allocated from the pool can outlive the owner of the pool.
+ * The allocator propagates on assignment, so that an empty container can be moved to the pool by assigning a container with the allocator.
+ */
+template <typename T>
+class PoolAllocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  PoolAllocator() noexcept = default;
+  explicit PoolAllocator(MemoryPoolPtr pool) noexcept : _pool(std::move(pool)) {}
+  template <typename U>
+  PoolAllocator(const PoolAllocator<U>& other) noexcept : _pool(other.pool()) {}  // NOLINT
+
+  T* allocate(const size_t n) {
+    if (_pool == nullptr) return std::allocator<T>().allocate(n);
+    return static_cast<T*>(_pool->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, const size_t n) noexcept {
+    if (_pool == nullptr)
+      std::allocator<T>().deallocate(p, n);
+    else
+      _pool->deallocate(p, n * sizeof(T), alignof(T));
+  }
+
+  [[nodiscard]] const MemoryPoolPtr& pool() const noexcept { return _pool; }
+
+ private:
+  MemoryPoolPtr _pool = nullptr;
+};
+
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>& lhs, const PoolAllocator<U>& rhs) noexcept {
+  return lhs.pool() == rhs.pool();
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>& lhs, const PoolAllocator<U>& rhs) noexcept {
+  return !(lhs == rhs);
+}
+
+}  // namespace autd::core
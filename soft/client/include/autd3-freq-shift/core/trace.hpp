@@ -0,0 +1,201 @@
+// File: trace.hpp
+// Project: core
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+
+namespace autd::core::trace {
+
+/**
+ * @brief Whether tracing is compiled in. Define AUTD3_ENABLE_TRACE (CMake option ENABLE_TRACE) to enable it.
+ * @details If disabled, all the functions in this namespace are empty and no clock is read.
+ */
+#ifdef AUTD3_ENABLE_TRACE
+constexpr bool ENABLED = true;
+#else
+constexpr bool ENABLED = false;
+#endif
+
+/**
+ * @brief Stages of a frame from the calculation to the acknowledgement
+ */
+enum class Stage : uint8_t {
+  GainCalc = 0,  //!< Gain::build in the calling thread
+  Pack,          //!< packing the frames into the command queue
+  Enqueue,       //!< Link::send, e.g., copying the frame into the send queue of the SOEM link
+  SendQueue,     //!< the frame waits in the send queue of the link until it is copied to the process data
+  ProcessData,   //!< the frame is in the process data until it is transmitted by ec_send_processdata
+  Ack,           //!< polling the devices until the frame is acknowledged
+};
+
+constexpr const char* stage_name(const Stage stage) {
+  switch (stage) {
+    case Stage::GainCalc:
+      return "gain_calc";
+    case Stage::Pack:
+      return "pack";
+    case Stage::Enqueue:
+      return "enqueue";
+    case Stage::SendQueue:
+      return "send_queue";
+    case Stage::ProcessData:
+      return "process_data";
+    case Stage::Ack:
+      return "ack";
+  }
+  return "unknown";
+}
+
+/**
+ * @brief Nanoseconds of a monotonic clock, or 0 if tracing is disabled
+ */
+inline uint64_t now() noexcept {
+  if constexpr (ENABLED)
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+  else
+    return 0;
+}
+
+/**
+ * @brief Lock-free ring of the trace events shared by all threads
+ * @details Each slot is guarded by a sequence number, so that writers never wait and the exporter skips the slots being written.
+ * The oldest events are overwritten when the ring is full.
+ */
+class Tracer {
+ public:
+  static constexpr size_t RING_SIZE = 1 << 16;
+
+  static Tracer& instance() {
+    static Tracer tracer;
+    return tracer;
+  }
+
+  void record(const Stage stage, const uint8_t msg_id, const uint64_t begin_ns, const uint64_t end_ns) noexcept {
+    const auto idx = _head.fetch_add(1, std::memory_order_relaxed);
+    auto& slot = _ring[idx % RING_SIZE];
+    slot.seq.store(2 * idx + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.begin_ns.store(begin_ns, std::memory_order_relaxed);
+    slot.end_ns.store(end_ns, std::memory_order_relaxed);
+    slot.info.store(static_cast<uint64_t>(thread_id()) << 16 | static_cast<uint64_t>(stage) << 8 | msg_id, std::memory_order_relaxed);
+    slot.seq.store(2 * idx + 2, std::memory_order_release);
+  }
+
+  /**
+   * @brief Write the events in Chrome trace event format, which can be opened by chrome://tracing and Perfetto
+   * @return number of the written events
+   */
+  size_t export_chrome(std::ostream& os) const {
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    size_t n = 0;
+    for (const auto& slot : _ring) {
+      const auto seq = slot.seq.load(std::memory_order_acquire);
+      const auto begin_ns = slot.begin_ns.load(std::memory_order_relaxed);
+      const auto end_ns = slot.end_ns.load(std::memory_order_relaxed);
+      const auto info = slot.info.load(std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (seq == 0 || seq % 2 != 0 || slot.seq.load(std::memory_order_relaxed) != seq) continue;
+
+      const auto stage = static_cast<Stage>(info >> 8 & 0xFF);
+      const auto msg_id = static_cast<uint32_t>(info & 0xFF);
+      const auto tid = info >> 16;
+      if (n++ > 0) os << ",";
+      os << "{\"name\":\"" << stage_name(stage) << "\",\"cat\":\"autd3\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid << ",\"ts\":" << to_us(begin_ns)
+         << ",\"dur\":" << to_us(end_ns - begin_ns) << ",\"args\":{\"msg_id\":" << msg_id << "}}";
+    }
+    os << "]}\n";
+    return n;
+  }
+
+  size_t export_chrome(const std::string& path) const {
+    std::ofstream ofs(path);
+    return export_chrome(ofs);
+  }
+
+  void clear() noexcept {
+    for (auto& slot : _ring) slot.seq.store(0, std::memory_order_relaxed);
+  }
+
+ private:
+  Tracer() = default;
+
+  struct Slot {
+    std::atomic<uint64_t> seq{0};
+    std::atomic<uint64_t> begin_ns{0};
+    std::atomic<uint64_t> end_ns{0};
+    std::atomic<uint64_t> info{0};
+  };
+
+  static uint32_t thread_id() noexcept {
+    static std::atomic<uint32_t> next{1};
+    thread_local const auto id = next.fetch_add(1, std::memory_order_relaxed);
+    return id;
+  }
+
+  static std::string to_us(const uint64_t ns) { return std::to_string(ns / 1000) + "." + std::to_string(ns % 1000 + 1000).substr(1); }
+
+  std::atomic<uint64_t> _head{0};
+  std::array<Slot, RING_SIZE> _ring{};
+};
+
+/**
+ * @brief Record a stage of a frame which began at begin_ns and ends now
+ */
+inline void span(const Stage stage, const uint8_t msg_id, const uint64_t begin_ns) noexcept {
+  if constexpr (ENABLED) Tracer::instance().record(stage, msg_id, begin_ns, now());
+}
+
+/**
+ * @brief Record a stage of a frame with its beginning and end
+ */
+inline void span(const Stage stage, const uint8_t msg_id, const uint64_t begin_ns, const uint64_t end_ns) noexcept {
+  if constexpr (ENABLED) Tracer::instance().record(stage, msg_id, begin_ns, end_ns);
+}
+
+/**
+ * @brief Timestamps of the stages before a message id is assigned to the frames of a command
+ */
+#ifdef AUTD3_ENABLE_TRACE
+struct CommandStamps {
+  void calc(const uint64_t begin_ns, const uint64_t end_ns) noexcept {
+    calc_begin = begin_ns;
+    calc_end = end_ns;
+  }
+  void pack(const uint64_t begin_ns, const uint64_t end_ns) noexcept {
+    pack_begin = begin_ns;
+    pack_end = end_ns;
+  }
+  void emit(const uint8_t msg_id) const noexcept {
+    if (calc_end != 0) span(Stage::GainCalc, msg_id, calc_begin, calc_end);
+    if (pack_end != 0) span(Stage::Pack, msg_id, pack_begin, pack_end);
+  }
+
+  uint64_t calc_begin = 0;
+  uint64_t calc_end = 0;
+  uint64_t pack_begin = 0;
+  uint64_t pack_end = 0;
+};
+#else
+struct CommandStamps {
+  void calc(uint64_t, uint64_t) noexcept {}
+  void pack(uint64_t, uint64_t) noexcept {}
+  void emit(uint8_t) const noexcept {}
+};
+#endif
+
+}  // namespace autd::core::trace
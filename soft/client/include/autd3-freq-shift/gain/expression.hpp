@@ -0,0 +1,155 @@
+// File: expression.hpp
+// Project: gain
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#include "autd3-freq-shift/core/gain.hpp"
+#include "autd3-freq-shift/core/geometry.hpp"
+#include "autd3-freq-shift/core/utils.hpp"
+
+namespace autd::gain {
+
+/**
+ * @brief Expressions of complex drive fields of the transducers, e.g., 0.8 * focus(p) + 0.2 * plane(d)
+ * @details An expression is a tree of small values resolved at compile time. It is evaluated per transducer in the loop of Composite,
+ * so that any expression is calculated in a single loop over the transducers, and quantized once with the freq_cycle of each device.
+ * The drive of a transducer is amp * exp(i * phase), where the phase is in the same convention as FocalPoint.
+ */
+namespace expr {
+
+/**
+ * @brief Base of all the expressions
+ */
+template <typename E>
+struct Expr {
+  [[nodiscard]] const E& self() const noexcept { return static_cast<const E&>(*this); }
+};
+
+/**
+ * @brief Single focus at point
+ */
+struct Focus final : Expr<Focus> {
+  Focus(const core::Vector3& point, const double amp) : point(point), amp(amp) {}
+
+  [[nodiscard]] std::complex<double> eval(const core::Vector3& pos, const double wavenum) const {
+    return std::polar(amp, wavenum * (pos - point).norm());
+  }
+
+  core::Vector3 point;
+  double amp;
+};
+
+/**
+ * @brief Plane wave propagating toward direction
+ */
+struct Plane final : Expr<Plane> {
+  Plane(const core::Vector3& direction, const double amp) : direction(direction.normalized()), amp(amp) {}
+
+  [[nodiscard]] std::complex<double> eval(const core::Vector3& pos, const double wavenum) const {
+    return std::polar(amp, -wavenum * pos.dot(direction));
+  }
+
+  core::Vector3 direction;
+  double amp;
+};
+
+template <typename E>
+struct Scaled final : Expr<Scaled<E>> {
+  Scaled(const double weight, E e) : weight(weight), e(std::move(e)) {}
+
+  [[nodiscard]] std::complex<double> eval(const core::Vector3& pos, const double wavenum) const { return weight * e.eval(pos, wavenum); }
+
+  double weight;
+  E e;
+};
+
+template <typename L, typename R>
+struct Sum final : Expr<Sum<L, R>> {
+  Sum(L l, R r) : l(std::move(l)), r(std::move(r)) {}
+
+  [[nodiscard]] std::complex<double> eval(const core::Vector3& pos, const double wavenum) const {
+    return l.eval(pos, wavenum) + r.eval(pos, wavenum);
+  }
+
+  L l;
+  R r;
+};
+
+inline Focus focus(const core::Vector3& point, const double amp = 1.0) { return {point, amp}; }
+inline Plane plane(const core::Vector3& direction, const double amp = 1.0) { return {direction, amp}; }
+
+template <typename E>
+Scaled<E> operator*(const double weight, const Expr<E>& e) {
+  return {weight, e.self()};
+}
+template <typename E>
+Scaled<E> operator*(const Expr<E>& e, const double weight) {
+  return {weight, e.self()};
+}
+template <typename L, typename R>
+Sum<L, R> operator+(const Expr<L>& l, const Expr<R>& r) {
+  return {l.self(), r.self()};
+}
+template <typename L, typename R>
+Sum<L, Scaled<R>> operator-(const Expr<L>& l, const Expr<R>& r) {
+  return {l.self(), Scaled<R>(-1.0, r.self())};
+}
+
+}  // namespace expr
+
+/**
+ * @brief Gain of an expression of drive fields
+ * @details The amplitude of the sum is clamped to 1.
+ */
+template <typename E>
+class Composite final : public core::Gain {
+ public:
+  explicit Composite(E e) : Gain(), _expr(std::move(e)) {}
+
+  [[nodiscard]] const E& expression() const noexcept { return this->_expr; }
+
+  void set_expression(E e) {
+    this->_expr = std::move(e);
+    this->_built = false;
+  }
+
+  void calc(const core::GeometryPtr& geometry) override {
+    for (size_t dev_idx = 0; dev_idx < geometry->num_devices(); dev_idx++) {
+      const auto freq_cycle = geometry->freq_cycle(dev_idx);
+      const auto wavenum = 2.0 * M_PI / geometry->wavelength(dev_idx);
+      for (size_t i = 0; i < core::NUM_TRANS_IN_UNIT; i++) {
+        const auto q = this->_expr.eval(geometry->position(dev_idx, i), wavenum);
+        this->_duties[dev_idx][i] = core::Utilities::to_duty(std::abs(q), freq_cycle);
+        this->_phases[dev_idx][i] = core::Utilities::to_phase(std::arg(q), freq_cycle);
+      }
+    }
+  }
+
+ private:
+  E _expr;
+};
+
+/**
+ * @brief Generate a gain of an expression, e.g., compose(0.8 * expr::focus(p) + 0.2 * expr::plane(d))
+ */
+template <typename E>
+std::shared_ptr<Composite<E>> compose(const expr::Expr<E>& e) {
+  return std::make_shared<Composite<E>>(e.self());
+}
+
+}  // namespace autd::gain
@@ -0,0 +1,87 @@
+// File: focal_point.hpp
+// Project: gain
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "autd3-freq-shift/core/gain.hpp"
+#include "autd3-freq-shift/core/geometry.hpp"
+#include "autd3-freq-shift/core/utils.hpp"
+
+namespace autd::gain {
+
+/**
+ * @brief Gain to produce a single focal point
+ */
+class FocalPoint final : public core::Gain {
+ public:
+  /**
+   * @brief Generate FocalPoint gain
+   * @param point focal point
+   * @param amp amplitude of the focus (0 to 1)
+   */
+  static std::shared_ptr<FocalPoint> create(const core::Vector3& point, const double amp = 1.0) {
+    return std::make_shared<FocalPoint>(point, amp);
+  }
+
+  /**
+   * @brief Drive only the devices which face the focal point
+   * @param max_angle maximum angle in radian between the direction of a device and the direction from the device to the focal point
+   * @param range maximum distance from the focal point to a device
+   * @details The devices are looked up with Geometry::devices_in_cone(), so that the calculation time is proportional to the number of the
+   * driven devices. The other devices are not driven.
+   */
+  void set_culling(const double max_angle, const double range = std::numeric_limits<double>::infinity()) {
+    this->_max_angle = max_angle;
+    this->_range = range;
+    this->_built = false;
+  }
+
+  void set_point(const core::Vector3& point) {
+    this->_point = point;
+    this->_built = false;
+  }
+
+  [[nodiscard]] const core::Vector3& point() const noexcept { return this->_point; }
+
+  void calc(const core::GeometryPtr& geometry) override {
+    if (this->_max_angle >= M_PI && std::isinf(this->_range)) {
+      for (size_t dev_idx = 0; dev_idx < geometry->num_devices(); dev_idx++) calc_device(geometry, dev_idx);
+      return;
+    }
+    for (const auto dev_idx : geometry->devices_in_cone(this->_point, this->_max_angle, this->_range)) calc_device(geometry, dev_idx);
+  }
+
+  FocalPoint(const core::Vector3& point, const double amp) : Gain(), _point(point), _amp(amp) {}
+
+ private:
+  void calc_device(const core::GeometryPtr& geometry, const size_t dev_idx) {
+    const auto freq_cycle = geometry->freq_cycle(dev_idx);
+    const auto wavenum = 2.0 * M_PI / geometry->wavelength(dev_idx);
+    const auto duty = core::Utilities::to_duty(this->_amp, freq_cycle);
+    for (size_t i = 0; i < core::NUM_TRANS_IN_UNIT; i++) {
+      const auto dist = (geometry->position(dev_idx, i) - this->_point).norm();
+      this->_duties[dev_idx][i] = duty;
+      this->_phases[dev_idx][i] = core::Utilities::to_phase(dist * wavenum, freq_cycle);
+    }
+  }
+
+  core::Vector3 _point;
+  double _amp;
+  double _max_angle = M_PI;
+  double _range = std::numeric_limits<double>::infinity();
+};
+
+}  // namespace autd::gain
@@ -0,0 +1,225 @@
+// File: focus_lattice.hpp
+// Project: gain
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "autd3-freq-shift/core/exception.hpp"
+#include "autd3-freq-shift/core/gain.hpp"
+#include "autd3-freq-shift/core/geometry.hpp"
+#include "autd3-freq-shift/core/utils.hpp"
+
+namespace autd::gain {
+
+class FocusLattice;
+using FocusLatticePtr = std::shared_ptr<const FocusLattice>;
+
+/**
+ * @brief Phases of a single focus precomputed for every point of a regular 3D lattice
+ * @details The phase of each transducer is stored in the unit of the freq_cycle of its device, i.e., as the value sent to the device.
+ * The phases of all the devices for a lattice point are contiguous, so that they are copied to a gain at once.
+ * The lattice is valid only for the geometry and the frequencies at the time of creation.
+ * The phases between the lattice points can be interpolated only if the spacing is less than wavelength / (2 * sqrt(3)) of every device,
+ * since the phase must differ by less than half a cycle between the diagonal corners of a lattice cell.
+ */
+class FocusLattice {
+ public:
+  /**
+   * @brief Precompute a lattice
+   * @param geometry Geometry
+   * @param origin position of the lattice point (0, 0, 0)
+   * @param spacing distance between the neighboring lattice points
+   * @param size number of the lattice points along x, y and z axes
+   */
+  static FocusLatticePtr create(const core::GeometryPtr& geometry, const core::Vector3& origin, const double spacing,
+                                const std::array<size_t, 3>& size) {
+    return std::make_shared<FocusLattice>(geometry, origin, spacing, size);
+  }
+
+  FocusLattice(const core::GeometryPtr& geometry, const core::Vector3& origin, const double spacing, const std::array<size_t, 3>& size)
+      : _origin(origin), _spacing(spacing), _size(size), _num_devices(geometry->num_devices()), _interpolatable(true) {
+    if (spacing <= 0.0) throw core::exception::GainBuildError("Lattice spacing must be positive");
+    for (size_t dev_idx = 0; dev_idx < _num_devices; dev_idx++) {
+      _freq_cycles.emplace_back(geometry->freq_cycle(dev_idx));
+      if (spacing >= geometry->wavelength(dev_idx) / (2.0 * std::sqrt(3.0))) _interpolatable = false;
+    }
+
+    _phases.resize(num_points() * _num_devices * core::NUM_TRANS_IN_UNIT);
+    auto* cursor = _phases.data();
+    for (size_t iz = 0; iz < size[2]; iz++)
+      for (size_t iy = 0; iy < size[1]; iy++)
+        for (size_t ix = 0; ix < size[0]; ix++) {
+          const auto point = position(ix, iy, iz);
+          for (size_t dev_idx = 0; dev_idx < _num_devices; dev_idx++) {
+            const auto freq_cycle = _freq_cycles[dev_idx];
+            const auto wavenum = 2.0 * M_PI / geometry->wavelength(dev_idx);
+            for (size_t i = 0; i < core::NUM_TRANS_IN_UNIT; i++)
+              *cursor++ = core::Utilities::to_phase((geometry->position(dev_idx, i) - point).norm() * wavenum, freq_cycle);
+          }
+        }
+  }
+
+  [[nodiscard]] core::Vector3 position(const size_t ix, const size_t iy, const size_t iz) const {
+    return _origin + _spacing * core::Vector3(static_cast<double>(ix), static_cast<double>(iy), static_cast<double>(iz));
+  }
+
+  [[nodiscard]] const std::array<size_t, 3>& size() const noexcept { return _size; }
+  [[nodiscard]] size_t num_points() const noexcept { return _size[0] * _size[1] * _size[2]; }
+
+  /**
+   * @brief Size of the precomputed table in bytes
+   */
+  [[nodiscard]] size_t memory_size() const noexcept { return _phases.size() * sizeof(uint16_t); }
+
+  /**
+   * @brief Phases of all the transducers of all the devices for a lattice point
+   */
+  [[nodiscard]] const uint16_t* phases(const size_t ix, const size_t iy, const size_t iz) const {
+    if (ix >= _size[0] || iy >= _size[1] || iz >= _size[2]) throw core::exception::GainBuildError("Lattice index out of range");
+    return &_phases[((iz * _size[1] + iy) * _size[0] + ix) * _num_devices * core::NUM_TRANS_IN_UNIT];
+  }
+
+  /**
+   * @brief Check that the lattice has been computed for the geometry
+   */
+  void validate(const core::GeometryPtr& geometry) const {
+    if (geometry->num_devices() != _num_devices) throw core::exception::GainBuildError("Lattice was computed for a different number of devices");
+    for (size_t dev_idx = 0; dev_idx < _num_devices; dev_idx++)
+      if (geometry->freq_cycle(dev_idx) != _freq_cycles[dev_idx])
+        throw core::exception::GainBuildError("Lattice was computed for a different frequency of device " + std::to_string(dev_idx));
+  }
+
+  /**
+   * @brief Lattice coordinate of a position
+   */
+  [[nodiscard]] core::Vector3 to_lattice(const core::Vector3& point) const { return (point - _origin) / _spacing; }
+
+  [[nodiscard]] uint16_t freq_cycle(const size_t dev_idx) const { return _freq_cycles[dev_idx]; }
+
+  /**
+   * @brief Whether the spacing is fine enough to interpolate the phases between the lattice points
+   */
+  [[nodiscard]] bool interpolatable() const noexcept { return _interpolatable; }
+
+ private:
+  core::Vector3 _origin;
+  double _spacing;
+  std::array<size_t, 3> _size;
+  size_t _num_devices;
+  bool _interpolatable;
+  std::vector<uint16_t> _freq_cycles;
+  std::vector<uint16_t> _phases;
+};
+
+/**
+ * @brief Gain to produce a single focus at a point of a precomputed lattice
+ * @details At a lattice point the phases are copied from the lattice. Between the lattice points the phases are interpolated trilinearly
+ * from the eight surrounding points if FocusLattice::interpolatable(), i.e., the spacing is less than wavelength / (2 * sqrt(3)) (2.45 mm at
+ * 40 kHz). Otherwise, the focus is moved to the nearest lattice point.
+ */
+class LatticeFocus final : public core::Gain {
+ public:
+  static std::shared_ptr<LatticeFocus> create(FocusLatticePtr lattice, const double amp = 1.0) {
+    return std::make_shared<LatticeFocus>(std::move(lattice), amp);
+  }
+
+  /**
+   * @brief Move the focus to a lattice point
+   */
+  void set_index(const size_t ix, const size_t iy, const size_t iz) {
+    this->_index = {ix, iy, iz};
+    this->_frac = {0.0, 0.0, 0.0};
+    this->_built = false;
+  }
+
+  /**
+   * @brief Move the focus to a point in the lattice. The point is clamped to the lattice.
+   * @details If the lattice is too coarse to interpolate, the focus is moved to the nearest lattice point instead.
+   */
+  void set_point(const core::Vector3& point) {
+    const auto p = this->_lattice->to_lattice(point);
+    for (size_t axis = 0; axis < 3; axis++) {
+      const auto n = this->_lattice->size()[axis];
+      const auto v = std::clamp(p[static_cast<Eigen::Index>(axis)], 0.0, static_cast<double>(n - 1));
+      if (this->_lattice->interpolatable()) {
+        this->_index[axis] = std::min(static_cast<size_t>(v), n - 1);
+        this->_frac[axis] = v - static_cast<double>(this->_index[axis]);
+      } else {
+        this->_index[axis] = std::min(static_cast<size_t>(std::lround(v)), n - 1);
+        this->_frac[axis] = 0.0;
+      }
+    }
+    this->_built = false;
+  }
+
+  void calc(const core::GeometryPtr& geometry) override {
+    this->_lattice->validate(geometry);
+    const auto [ix, iy, iz] = this->_index;
+    const auto* base = this->_lattice->phases(ix, iy, iz);
+
+    for (size_t dev_idx = 0; dev_idx < geometry->num_devices(); dev_idx++)
+      this->_duties[dev_idx].fill(core::Utilities::to_duty(this->_amp, geometry->freq_cycle(dev_idx)));
+
+    if (this->_frac == std::array<double, 3>{0.0, 0.0, 0.0}) {
+      for (size_t dev_idx = 0; dev_idx < geometry->num_devices(); dev_idx++, base += core::NUM_TRANS_IN_UNIT)
+        std::memcpy(this->_phases[dev_idx].data(), base, sizeof(core::DataArray));
+      return;
+    }
+
+    std::array<const uint16_t*, 8> corners{};
+    std::array<int32_t, 8> weights{};  // Q16
+    for (size_t c = 0; c < 8; c++) {
+      const auto step = [this, c](const size_t axis) { return (c >> axis & 1) != 0 && this->_index[axis] + 1 < this->_lattice->size()[axis] ? 1 : 0; };
+      corners[c] = this->_lattice->phases(ix + step(0), iy + step(1), iz + step(2));
+      auto w = 1.0;
+      for (size_t axis = 0; axis < 3; axis++) w *= (c >> axis & 1) != 0 ? this->_frac[axis] : 1.0 - this->_frac[axis];
+      weights[c] = static_cast<int32_t>(std::lround(w * 65536.0));
+    }
+
+    // the phases are interpolated as the differences from the corner (0, 0, 0) wrapped into a half cycle
+    for (size_t dev_idx = 0; dev_idx < geometry->num_devices(); dev_idx++) {
+      const auto cycle = static_cast<int32_t>(this->_lattice->freq_cycle(dev_idx));
+      const auto offset = dev_idx * core::NUM_TRANS_IN_UNIT;
+      for (size_t i = 0; i < core::NUM_TRANS_IN_UNIT; i++) {
+        const auto p0 = static_cast<int32_t>(corners[0][offset + i]);
+        int32_t d = 0;
+        for (size_t c = 1; c < 8; c++) {
+          auto diff = static_cast<int32_t>(corners[c][offset + i]) - p0;
+          if (diff > cycle / 2) diff -= cycle;
+          if (diff < -cycle / 2) diff += cycle;
+          d += weights[c] * diff;
+        }
+        auto phase = p0 + ((d + 0x8000) >> 16);
+        if (phase < 0) phase += cycle;
+        if (phase >= cycle) phase -= cycle;
+        this->_phases[dev_idx][i] = static_cast<uint16_t>(phase);
+      }
+    }
+  }
+
+  LatticeFocus(FocusLatticePtr lattice, const double amp) : Gain(), _lattice(std::move(lattice)), _amp(amp) {}
+
+ private:
+  FocusLatticePtr _lattice;
+  double _amp;
+  std::array<size_t, 3> _index{0, 0, 0};
+  std::array<double, 3> _frac{0.0, 0.0, 0.0};
+};
+
+}  // namespace autd::gain
@@ -0,0 +1,240 @@
+// File: grouped.hpp
+// Project: gain
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "autd3-freq-shift/core/exception.hpp"
+#include "autd3-freq-shift/core/gain.hpp"
+#include "autd3-freq-shift/core/geometry.hpp"
+
+namespace autd::gain {
+
+/**
+ * @brief Gain to drive disjoint groups of devices with different gains
+ * @details Each child gain is calculated only over the devices of its group, i.e., the child sees a Geometry which contains only them, and
+ * writes its data directly into the rows of the Grouped, so that the data are never copied.
+ * Children whose data are still valid are not calculated again, so re-sending a Grouped after replacing some of the children costs only
+ * the calculation of the replaced ones. A child is calculated again when the frequency, the position or the sound speed of its devices
+ * changes. The devices which do not belong to any group are not driven.
+ * The geometries of the groups are kept until the devices of the group change. If more than one child is calculated, they are built in
+ * parallel by workers which are started at the first such build and kept until the Grouped is destroyed. A single child is built in the
+ * calling thread. Since the children are built in parallel, a gain object can belong to only one group.
+ */
+class Grouped final : public core::Gain {
+ public:
+  /**
+   * @brief Generate empty Grouped gain
+   */
+  static std::shared_ptr<Grouped> create() { return std::make_shared<Grouped>(); }
+
+  /**
+   * \brief Add a group
+   * \param device_ids ids of the devices which belong to the group
+   * \param gain gain of the group
+   * \return an id of added group
+   */
+  size_t add(std::vector<size_t> device_ids, core::GainPtr gain) {
+    if (device_ids.empty()) throw core::exception::GainBuildError("A group must contain at least one device");
+    for (auto it = device_ids.begin(); it != device_ids.end(); ++it)
+      if (std::find(it + 1, device_ids.end(), *it) != device_ids.end())
+        throw core::exception::GainBuildError("Device " + std::to_string(*it) + " is specified more than once");
+    for (const auto& group : this->_groups)
+      for (const auto dev_idx : device_ids)
+        if (std::find(group.device_ids.begin(), group.device_ids.end(), dev_idx) != group.device_ids.end())
+          throw core::exception::GainBuildError("Device " + std::to_string(dev_idx) + " already belongs to another group");
+    this->check_unique(gain);
+
+    const auto group_id = this->_groups.size();
+    this->_groups.emplace_back(std::move(device_ids), std::move(gain));
+    this->_built = false;
+    return group_id;
+  }
+
+  /**
+   * \brief Replace the gain of the group. Only the replaced groups are calculated at the next build.
+   * \param group_id id of the group
+   * \param gain new gain of the group
+   */
+  void replace(const size_t group_id, core::GainPtr gain) {
+    auto& group = this->_groups.at(group_id);
+    if (group.gain == gain) return;
+    this->check_unique(gain);
+    this->detach(group);
+    group.gain = std::move(gain);
+    this->_built = false;
+  }
+
+  [[nodiscard]] size_t num_groups() const noexcept { return this->_groups.size(); }
+
+  void calc(const core::GeometryPtr& geometry) override {
+    for (const auto& group : this->_groups)
+      for (const auto dev_idx : group.device_ids)
+        if (dev_idx >= geometry->num_devices()) throw core::exception::GainBuildError("Device " + std::to_string(dev_idx) + " does not exist");
+
+    // rows of the devices may have been re-allocated or cleared if the number of devices has changed
+    const auto resized = this->_num_devices != geometry->num_devices();
+    this->_num_devices = geometry->num_devices();
+
+    std::vector<Group*> dirty;
+    for (auto& group : this->_groups) {
+      if (group.gain == nullptr) continue;
+      const auto fingerprint = geometry->fingerprint(group.device_ids);
+      if (group.geometry == nullptr || group.fingerprint != fingerprint) {
+        group.geometry = geometry->subset(group.device_ids);
+        dirty.emplace_back(&group);
+      } else if (resized || !this->attached(group)) {
+        dirty.emplace_back(&group);
+      }
+      group.fingerprint = fingerprint;
+    }
+
+    std::atomic<size_t> next(0);
+    std::exception_ptr error = nullptr;
+    std::mutex error_mtx;
+    const std::function<void()> work = [&] {
+      for (auto i = next.fetch_add(1); i < dirty.size(); i = next.fetch_add(1)) {
+        auto* group = dirty[i];
+        try {
+          group->gain->build_into(group->geometry, this->_duties, this->_phases, group->device_ids);
+        } catch (...) {
+          std::lock_guard lk(error_mtx);
+          if (error == nullptr) error = std::current_exception();
+        }
+      }
+    };
+    if (const auto num_threads = std::min<size_t>(dirty.size(), std::max(1u, std::thread::hardware_concurrency())); num_threads > 1)
+      this->run_parallel(num_threads - 1, work);
+    else
+      work();
+    if (error != nullptr) std::rethrow_exception(error);
+
+    std::vector<bool> driven(geometry->num_devices(), false);
+    for (const auto& group : this->_groups)
+      if (group.gain != nullptr)
+        for (const auto dev_idx : group.device_ids) driven[dev_idx] = true;
+    for (size_t i = 0; i < geometry->num_devices(); i++) {
+      if (driven[i]) continue;
+      this->_duties[i].fill(0x0000);
+      this->_phases[i].fill(0x0000);
+    }
+  }
+
+  Grouped() : Gain(), _num_devices(0) {}
+  ~Grouped() override {
+    {
+      std::lock_guard lk(this->_pool_mtx);
+      this->_quit = true;
+    }
+    this->_start_cv.notify_all();
+    for (auto& worker : this->_workers) worker.join();
+    for (auto& group : this->_groups) this->detach(group);
+  }
+  Grouped(const Grouped& v) = delete;
+  Grouped& operator=(const Grouped& obj) = delete;
+  Grouped(Grouped&& obj) = delete;
+  Grouped& operator=(Grouped&& obj) = delete;
+
+ protected:
+  // the rows of the children which are not calculated again must be kept
+  void clear_data() override {}
+
+ private:
+  struct Group {
+    Group(std::vector<size_t> device_ids, core::GainPtr gain)
+        : device_ids(std::move(device_ids)), gain(std::move(gain)), geometry(nullptr), fingerprint(0) {}
+
+    std::vector<size_t> device_ids;
+    core::GainPtr gain;
+    core::GeometryPtr geometry;  // subset of the devices of the group, whose fingerprint is fingerprint
+    uint64_t fingerprint;
+  };
+
+  // Run work in the calling thread and num_workers workers, and wait until all of them return
+  void run_parallel(const size_t num_workers, const std::function<void()>& work) {
+    {
+      std::lock_guard lk(this->_pool_mtx);
+      while (this->_workers.size() < num_workers) this->_workers.emplace_back([this] { this->worker_loop(); });
+      this->_job = &work;
+      this->_pending = num_workers;
+      this->_generation++;
+    }
+    this->_start_cv.notify_all();
+    work();
+    std::unique_lock lk(this->_pool_mtx);
+    this->_done_cv.wait(lk, [this] { return this->_pending == 0 && this->_active == 0; });
+    this->_job = nullptr;
+  }
+
+  // Each worker takes a job at most once per generation, so that a job is run by exactly the requested number of workers
+  void worker_loop() {
+    size_t generation = 0;
+    std::unique_lock lk(this->_pool_mtx);
+    for (;;) {
+      this->_start_cv.wait(lk, [this, &generation] { return this->_quit || (this->_pending > 0 && this->_generation != generation); });
+      if (this->_quit) return;
+      generation = this->_generation;
+      this->_pending--;
+      this->_active++;
+      const auto* job = this->_job;
+      lk.unlock();
+      (*job)();
+      lk.lock();
+      if (--this->_active == 0 && this->_pending == 0) this->_done_cv.notify_all();
+    }
+  }
+
+  void check_unique(const core::GainPtr& gain) const {
+    if (gain == nullptr) return;
+    if (gain.get() == this) throw core::exception::GainBuildError("Grouped cannot contain itself");
+    for (const auto& group : this->_groups)
+      if (group.gain == gain) throw core::exception::GainBuildError("The same gain cannot be added to more than one group");
+  }
+
+  /**
+   * \brief Whether the child gain holds valid data built into the rows of this gain
+   */
+  [[nodiscard]] bool attached(const Group& group) const {
+    const auto& duties = group.gain->duties();
+    return group.gain->built() && duties.borrowed() && duties.size() == group.device_ids.size() &&
+           &duties[0] == &this->_duties[group.device_ids[0]];
+  }
+
+  void detach(const Group& group) const {
+    if (group.gain != nullptr && group.device_ids[0] < this->_duties.size() && this->attached(group)) group.gain->release();
+  }
+
+  std::vector<Group> _groups;
+  size_t _num_devices;
+
+  std::vector<std::thread> _workers;
+  std::mutex _pool_mtx;
+  std::condition_variable _start_cv;
+  std::condition_variable _done_cv;
+  const std::function<void()>* _job = nullptr;
+  size_t _pending = 0;
+  size_t _active = 0;
+  size_t _generation = 0;
+  bool _quit = false;
+};
+
+}  // namespace autd::gain
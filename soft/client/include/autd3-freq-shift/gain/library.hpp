@@ -0,0 +1,286 @@
+// File: library.hpp
+// Project: gain
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#if WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "autd3-freq-shift/core/exception.hpp"
+#include "autd3-freq-shift/core/gain.hpp"
+#include "autd3-freq-shift/core/geometry.hpp"
+
+namespace autd::gain {
+
+class GainLibrary;
+using GainLibraryPtr = std::unique_ptr<GainLibrary>;
+
+/**
+ * @brief Library of built gains stored in a file
+ * @details The file is mapped into memory, and a stored gain is sent directly from the mapped file by Controller::send(const core::GainData&).
+ * The file is stamped with Geometry::fingerprint() of the geometry for which the gains are built, and the gains are rejected for another
+ * geometry or frequencies.
+ *
+ * The file consists of a header, an entry table sorted by name, the names, and the data. The data of each gain is the duties followed
+ * by the phases of all the devices, and the data begins at a multiple of 64 bytes. All the values are in the byte order of the host.
+ */
+class GainLibrary {
+ public:
+  static constexpr char MAGIC[8] = {'A', 'U', 'T', 'D', 'G', 'L', 'I', 'B'};
+  static constexpr uint32_t VERSION = 1;
+
+  /**
+   * @brief Build the gains and store them to a file
+   * @param path path to the file
+   * @param geometry Geometry
+   * @param gains pairs of a name and a gain. The names must be unique.
+   */
+  static void save(const std::string& path, const core::GeometryPtr& geometry, const std::vector<std::pair<std::string, core::GainPtr>>& gains) {
+    std::vector<size_t> order(gains.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&gains](const size_t a, const size_t b) { return gains[a].first < gains[b].first; });
+    for (size_t i = 1; i < order.size(); i++)
+      if (gains[order[i - 1]].first == gains[order[i]].first) throw core::exception::GainBuildError("Duplicated gain name: " + gains[order[i]].first);
+
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.num_devices = static_cast<uint32_t>(geometry->num_devices());
+    header.fingerprint = geometry->fingerprint();
+    header.num_entries = gains.size();
+
+    std::vector<Entry> entries;
+    std::string names;
+    for (const auto idx : order) {
+      entries.emplace_back(Entry{names.size(), static_cast<uint32_t>(gains[idx].first.size()), 0});
+      names += gains[idx].first;
+    }
+    header.names_offset = sizeof(Header) + sizeof(Entry) * entries.size();
+    header.data_offset = (header.names_offset + names.size() + DATA_ALIGN - 1) / DATA_ALIGN * DATA_ALIGN;
+
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    if (!ofs) throw core::exception::GainBuildError("Cannot open " + path);
+    ofs.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    ofs.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(sizeof(Entry) * entries.size()));
+    ofs.write(names.data(), static_cast<std::streamsize>(names.size()));
+    const std::vector<char> padding(header.data_offset - header.names_offset - names.size(), 0);
+    ofs.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+
+    const auto array_size = static_cast<std::streamsize>(sizeof(uint16_t) * core::NUM_TRANS_IN_UNIT * geometry->num_devices());
+    for (const auto idx : order) {
+      const auto& gain = gains[idx].second;
+      gain->build(geometry);
+      const auto data = gain->data();
+      ofs.write(reinterpret_cast<const char*>(data.duties), array_size);
+      ofs.write(reinterpret_cast<const char*>(data.phases), array_size);
+    }
+    if (!ofs) throw core::exception::GainBuildError("Failed to write " + path);
+  }
+
+  /**
+   * @brief Map a library file into memory
+   */
+  static GainLibraryPtr open(const std::string& path) { return std::make_unique<GainLibrary>(path); }
+
+  explicit GainLibrary(const std::string& path) {
+    map(path);
+    try {
+      check(path);
+    } catch (...) {
+      unmap();
+      throw;
+    }
+  }
+
+  ~GainLibrary() { unmap(); }
+  GainLibrary(const GainLibrary& v) = delete;
+  GainLibrary& operator=(const GainLibrary& obj) = delete;
+  GainLibrary(GainLibrary&& obj) = delete;
+  GainLibrary& operator=(GainLibrary&& obj) = delete;
+
+  /**
+   * @brief Number of the stored gains
+   */
+  [[nodiscard]] size_t size() const noexcept { return _header.num_entries; }
+
+  [[nodiscard]] size_t num_devices() const noexcept { return _header.num_devices; }
+
+  [[nodiscard]] uint64_t fingerprint() const noexcept { return _header.fingerprint; }
+
+  /**
+   * @brief Name of the idx-th gain. The gains are sorted by name.
+   */
+  [[nodiscard]] std::string_view name(const size_t idx) const {
+    const auto& e = entry(idx);
+    return {reinterpret_cast<const char*>(_addr) + _header.names_offset + e.name_offset, e.name_size};
+  }
+
+  /**
+   * @brief The idx-th gain
+   */
+  [[nodiscard]] core::GainData at(const size_t idx) const {
+    if (idx >= size()) throw core::exception::GainBuildError("Gain index out of range");
+    const auto* base = reinterpret_cast<const uint16_t*>(_addr + _header.data_offset + stride() * idx);
+    return core::GainData{base, base + core::NUM_TRANS_IN_UNIT * num_devices(), num_devices(), fingerprint()};
+  }
+
+  /**
+   * @brief Look up a gain by name
+   */
+  [[nodiscard]] std::optional<core::GainData> find(const std::string_view name) const {
+    size_t lo = 0;
+    size_t hi = size();
+    while (lo < hi) {
+      const auto mid = lo + (hi - lo) / 2;
+      if (this->name(mid) < name)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    if (lo == size() || this->name(lo) != name) return std::nullopt;
+    return at(lo);
+  }
+
+  [[nodiscard]] core::GainData get(const std::string_view name) const {
+    const auto data = find(name);
+    if (!data.has_value()) throw core::exception::GainBuildError("Gain " + std::string(name) + " is not found");
+    return data.value();
+  }
+
+  /**
+   * @brief Check that the library has been built for the geometry
+   */
+  void validate(const core::GeometryPtr& geometry) const {
+    if (geometry->num_devices() != num_devices() || geometry->fingerprint() != fingerprint())
+      throw core::exception::GainBuildError("The gain library was built for a different geometry or frequencies");
+  }
+
+ private:
+  static constexpr size_t DATA_ALIGN = 64;
+
+  void check(const std::string& path) {
+    if (_size < sizeof(Header)) throw core::exception::GainBuildError(path + " is not a gain library");
+    std::memcpy(&_header, _addr, sizeof(Header));
+    if (std::memcmp(_header.magic, MAGIC, sizeof(MAGIC)) != 0) throw core::exception::GainBuildError(path + " is not a gain library");
+    if (_header.version != VERSION) throw core::exception::GainBuildError(path + " has an unsupported version " + std::to_string(_header.version));
+    if (_header.names_offset != sizeof(Header) + sizeof(Entry) * _header.num_entries || _header.data_offset < _header.names_offset ||
+        _header.data_offset % DATA_ALIGN != 0 || _header.data_offset + stride() * _header.num_entries > _size)
+      throw core::exception::GainBuildError(path + " is broken");
+    for (size_t i = 0; i < _header.num_entries; i++)
+      if (const auto& e = entry(i); _header.names_offset + e.name_offset + e.name_size > _header.data_offset)
+        throw core::exception::GainBuildError(path + " is broken");
+  }
+
+  struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_devices;
+    uint64_t fingerprint;
+    uint64_t num_entries;
+    uint64_t names_offset;
+    uint64_t data_offset;
+  };
+
+  struct Entry {
+    uint64_t name_offset;
+    uint32_t name_size;
+    uint32_t reserved;
+  };
+
+  [[nodiscard]] size_t stride() const noexcept { return 2 * sizeof(uint16_t) * core::NUM_TRANS_IN_UNIT * _header.num_devices; }
+
+  [[nodiscard]] const Entry& entry(const size_t idx) const { return reinterpret_cast<const Entry*>(_addr + sizeof(Header))[idx]; }
+
+#if WIN32
+  void map(const std::string& path) {
+    _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (_file == INVALID_HANDLE_VALUE) throw core::exception::GainBuildError("Cannot open " + path);
+    LARGE_INTEGER size;
+    GetFileSizeEx(_file, &size);
+    _size = static_cast<size_t>(size.QuadPart);
+    if (_size == 0) return;
+    _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (_mapping == nullptr) {
+      unmap();
+      throw core::exception::GainBuildError("Cannot map " + path);
+    }
+    _addr = static_cast<const uint8_t*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (_addr == nullptr) {
+      unmap();
+      throw core::exception::GainBuildError("Cannot map " + path);
+    }
+  }
+
+  void unmap() noexcept {
+    if (_addr != nullptr) UnmapViewOfFile(_addr);
+    if (_mapping != nullptr) CloseHandle(_mapping);
+    if (_file != INVALID_HANDLE_VALUE) CloseHandle(_file);
+    _addr = nullptr;
+    _mapping = nullptr;
+    _file = INVALID_HANDLE_VALUE;
+  }
+
+  HANDLE _file = INVALID_HANDLE_VALUE;
+  HANDLE _mapping = nullptr;
+#else
+  void map(const std::string& path) {
+    const auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw core::exception::GainBuildError("Cannot open " + path);
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw core::exception::GainBuildError("Cannot open " + path);
+    }
+    _size = static_cast<size_t>(st.st_size);
+    if (_size > 0) {
+      auto* addr = mmap(nullptr, _size, PROT_READ, MAP_SHARED, fd, 0);
+      if (addr == MAP_FAILED) {
+        ::close(fd);
+        throw core::exception::GainBuildError("Cannot map " + path);
+      }
+      _addr = static_cast<const uint8_t*>(addr);
+    }
+    ::close(fd);
+  }
+
+  void unmap() noexcept {
+    if (_addr != nullptr) munmap(const_cast<uint8_t*>(_addr), _size);
+    _addr = nullptr;
+  }
+#endif
+
+  const uint8_t* _addr = nullptr;
+  size_t _size = 0;
+  Header _header{};
+};
+
+}  // namespace autd::gain
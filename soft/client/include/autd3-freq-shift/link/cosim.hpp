@@ -0,0 +1,86 @@
+// File: cosim.hpp
+// Project: link
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "autd3-freq-shift/core/link.hpp"
+
+namespace autd::link {
+
+/**
+ * @brief Timestamps of a frame in the co-simulation. All times are simulation time in ns.
+ */
+struct CosimLatency final {
+  uint8_t msg_id;
+  uint8_t command;
+  uint64_t sent_ns;               //!< Link::send is called, and the frame is queued
+  uint64_t dequeued_ns;           //!< the frame leaves the send queue and is copied to the process data
+  uint64_t delivered_ns;          //!< the frame arrives at the device on the EtherCAT cycle
+  uint64_t firmware_done_ns;      //!< recv_ethercat returns, i.e., all bus accesses are finished
+  uint64_t period_latched_ns;     //!< the first ultrasound period begins after the firmware finished
+  std::optional<uint64_t> output_changed_ns;  //!< the first ultrasound period in which XDCR_OUT differs from the previous period
+  uint32_t bus_cycles;            //!< number of 16 bit bus cycles issued by the firmware
+  bool dropped;                   //!< the frame is dropped from the send queue by a later frame, and the other times are not recorded
+};
+
+/**
+ * @brief Link to a co-simulation of one device: the firmware built for host and the FPGA logic simulated by Verilator
+ * @details Frames are queued by send() with the same policies as the SOEM link, and delivered one by one on the EtherCAT cycle.
+ * Each bus access of the firmware drives the CPU bus of the simulated FPGA. The system time of the distributed clocks is the simulation time.
+ * The simulation advances only in open(), advance(), read() (to the next EtherCAT cycle) and close() (until the queued frames are delivered),
+ * so the results are deterministic and independent of the host load. The command queue of Controller takes no simulation time.
+ * @warning This is an unverified stub. It has only been compiled against stub headers of Verilator, and has never been built with Verilator
+ * or run, so that neither the simulation nor the latencies are checked.
+ */
+class Cosim : virtual public core::Link {
+ public:
+  /**
+   * @brief Create co-simulation link.
+   * @param cycle_ticks cycle time in ticks
+   * @param max_wait_periods how many ultrasound periods to wait for XDCR_OUT to change after each frame
+   */
+  static std::unique_ptr<Cosim> create(uint32_t cycle_ticks = 1, uint32_t max_wait_periods = 4);
+
+  Cosim() = default;
+  ~Cosim() override = default;
+  Cosim(const Cosim& v) noexcept = delete;
+  Cosim& operator=(const Cosim& obj) = delete;
+  Cosim(Cosim&& obj) = delete;
+  Cosim& operator=(Cosim&& obj) = delete;
+
+  void open(const core::LinkConfiguration& config) override = 0;
+  void reconfigure(const core::LinkConfiguration& config) override = 0;
+  void close() override = 0;
+  void send(const uint8_t* buf, size_t size) override = 0;
+  void send_with_policy(const uint8_t* buf, size_t size, core::SendPolicy policy) override = 0;
+  void read(uint8_t* rx, size_t buffer_len) override = 0;
+  bool is_open() override = 0;
+  uint64_t dc_time() override = 0;
+
+  /**
+   * @brief Advance the simulation without sending frames
+   */
+  virtual void advance(uint64_t duration_ns) = 0;
+  /**
+   * @brief Current simulation time in ns
+   */
+  [[nodiscard]] virtual uint64_t now_ns() = 0;
+  /**
+   * @brief Timestamps of all frames sent since open, in the order of send()
+   */
+  [[nodiscard]] virtual const std::vector<CosimLatency>& latencies() = 0;
+};
+}  // namespace autd::link
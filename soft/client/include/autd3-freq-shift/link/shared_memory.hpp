@@ -0,0 +1,58 @@
+// File: shared_memory.hpp
+// Project: link
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "autd3-freq-shift/core/link.hpp"
+
+namespace autd::link {
+
+/**
+ * @brief Link to autd3_daemon, which owns the EtherCAT master, through POSIX shared memory (Linux only)
+ * @details Each client process attaches to its own area of the shared memory, and passes the frames through a lock-free ring,
+ * which the daemon forwards to the SOEM link. The frames of a command are published at once by end_command(), and the daemon forwards them
+ * without interleaving the frames of the other clients. The daemon returns the input data to each area with the message ids translated back,
+ * so that several processes can control the same devices with their own message id sequences.
+ * Since all the clients drive the same devices, the frequencies can be changed by open() or reconfigure() only while no other client is
+ * attached, or otherwise a LinkError is thrown.
+ * The EtherCAT cycle is kept by the daemon even if a client exits or crashes.
+ */
+class SharedMemory : virtual public core::Link {
+ public:
+  static constexpr const char* DEFAULT_NAME = "/autd3-freq-shift";
+
+  /**
+   * @brief Create shared memory link.
+   * @param name name of the shared memory, which is given to autd3_daemon
+   */
+  static std::unique_ptr<SharedMemory> create(const std::string& name = DEFAULT_NAME);
+
+  SharedMemory() = default;
+  ~SharedMemory() override = default;
+  SharedMemory(const SharedMemory& v) noexcept = delete;
+  SharedMemory& operator=(const SharedMemory& obj) = delete;
+  SharedMemory(SharedMemory&& obj) = delete;
+  SharedMemory& operator=(SharedMemory&& obj) = delete;
+
+  void open(const core::LinkConfiguration& config) override = 0;
+  void reconfigure(const core::LinkConfiguration& config) override = 0;
+  void close() override = 0;
+  void send(const uint8_t* buf, size_t size) override = 0;
+  void send_with_policy(const uint8_t* buf, size_t size, core::SendPolicy policy) override = 0;
+  void end_command() override = 0;
+  void read(uint8_t* rx, size_t buffer_len) override = 0;
+  uint64_t dc_time() override = 0;
+  bool is_open() override = 0;
+};
+}  // namespace autd::link
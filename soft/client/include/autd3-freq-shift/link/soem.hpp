@@ -3,7 +3,7 @@
 // Created Date: 10/05/2021
 // Author: Shun Suzuki
 // -----
-// Last Modified: 09/10/2021
+// Last Modified: 19/10/2026
 // Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
 // -----
 // Copyright (c) 2021 Hapis Lab. All rights reserved.
@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <string>
@@ -33,6 +34,14 @@ struct EtherCATAdapter final {
   std::string name;
 };
 
+/**
+ * @brief How the SOEM link exchanges the process data every cycle
+ */
+enum class NicBackend : uint8_t {
+  Socket = 0,  //!< NIC layer of SOEM, which calls send and recv for each frame
+  PacketMmap,  //!< PACKET_MMAP rings, which transmit all the frames of a cycle by one system call and receive them without copy (Linux only)
+};
+
 /**
  * @brief Link using [SOEM](https://github.com/OpenEtherCATsociety/SOEM)
  */
@@ -43,10 +52,11 @@ class SOEM : virtual public core::Link {
    * @param ifname Network interface name. (e.g. eth0)
    * @param device_num The number of AUTD you connected.
    * @param cycle_ticks cycle time in ticks
+   * @param backend how the process data are exchanged. The configuration and the recovery of the devices always use the NIC layer of SOEM.
    * @details Available Network interface names are obtained by EnumerateAdapters().
    *          The numbers of connected devices is obtained by Geometry::num_devices().
    */
-  static std::unique_ptr<SOEM> create(const std::string& ifname, size_t device_num, uint32_t cycle_ticks = 1);
+  static std::unique_ptr<SOEM> create(const std::string& ifname, size_t device_num, uint32_t cycle_ticks = 1, NicBackend backend = NicBackend::Socket);
 
   /**
    * @brief Enumerate Ethernet adapters of the computer.
@@ -60,9 +70,17 @@ class SOEM : virtual public core::Link {
   SOEM& operator=(SOEM&& obj) = delete;
 
   void open(const core::LinkConfiguration& config) override = 0;
+  void reconfigure(const core::LinkConfiguration& config) override = 0;
   void close() override = 0;
   void send(const uint8_t* buf, size_t size) override = 0;
+  void send_with_policy(const uint8_t* buf, size_t size, core::SendPolicy policy) override = 0;
   void read(uint8_t* rx, size_t buffer_len) override = 0;
+  uint64_t dc_time() override = 0;
+  /**
+   * @brief Set a callback which is called with a message when a device is lost
+   * @details The state of the devices is checked and recovered by a supervisor thread, and the callback is called from the thread.
+   * The link remains open and keeps transmitting to the other devices, and the lost device is recovered when it comes back.
+   */
   virtual void on_lost(std::function<void(std::string)> callback) = 0;
   bool is_open() override = 0;
 };
@@ -0,0 +1,429 @@
+// File: cosim.cpp
+// Project: cosim
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#include "autd3-freq-shift/link/cosim.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "Vcosim_top.h"
+#include "autd3-freq-shift/core/ec_config.hpp"
+#include "autd3-freq-shift/core/exception.hpp"
+#include "autd3-freq-shift/core/hardware_defined.hpp"
+#include "host_app.h"
+#include "verilated.h"
+
+namespace autd::link {
+
+namespace {
+constexpr uint64_t SYS_CLK_HALF_PERIOD_PS = 1000000000000ULL / core::FPGA_BASE_CLK_FREQ / 2;
+constexpr uint64_t BUS_CLK_HALF_PERIOD_PS = 6667;  // CKIO of the CPU is 75MHz
+constexpr uint64_t SYNC0_PULSE_WIDTH_PS = 100000;
+constexpr uint64_t RESET_DURATION_PS = 1000000;
+constexpr uint32_t SYNC0_CYCLE_IN_ULTRASOUND_PERIOD = 40;
+constexpr size_t NUM_PINS = 252;
+constexpr size_t PERIOD_GPIO_BIT = 1;  // gpo_1 toggles at the beginning of each ultrasound period
+constexpr uint64_t PS_PER_NS = 1000;
+}  // namespace
+
+/**
+ * @brief Simulated FPGA with the clocks, SYNC0 and the CPU bus driven by the harness
+ */
+class SimulatedFPGA {
+ public:
+  SimulatedFPGA() : _ctx(std::make_unique<VerilatedContext>()), _top(std::make_unique<Vcosim_top>(_ctx.get())) {}
+  ~SimulatedFPGA() { _top->final(); }
+  SimulatedFPGA(const SimulatedFPGA& v) = delete;
+  SimulatedFPGA& operator=(const SimulatedFPGA& obj) = delete;
+  SimulatedFPGA(SimulatedFPGA&& obj) = delete;
+  SimulatedFPGA& operator=(SimulatedFPGA&& obj) = delete;
+
+  void reset(const uint16_t freq_cycle) {
+    _top->CPU_ADDR = 0;
+    _top->CPU_DATA_IN = 0;
+    _top->CPU_CKIO = 0;
+    _top->CPU_CS1_N = 1;
+    _top->CPU_WE0_N = 1;
+    _top->CPU_RD_N = 1;
+    _top->CPU_RDWR = 0;
+    _top->MRCC_25P6M = 0;
+    _top->CAT_SYNC0 = 0;
+    _top->THERMO = 0;
+    _top->RESET_N = 0;
+    _top->eval();
+    run_until(_time_ps + RESET_DURATION_PS);
+    _top->RESET_N = 1;
+    set_freq_cycle(freq_cycle);
+  }
+
+  // The system time of the distributed clocks is the simulation time, and SYNC0 fires at its multiples of the SYNC0 cycle as on the devices
+  void set_freq_cycle(const uint16_t freq_cycle) {
+    _sync0_period_ps = static_cast<uint64_t>(freq_cycle) * SYNC0_CYCLE_IN_ULTRASOUND_PERIOD * SYS_CLK_HALF_PERIOD_PS * 2;
+    _sync0_origin_ps = (_time_ps + RESET_DURATION_PS + _sync0_period_ps - 1) / _sync0_period_ps * _sync0_period_ps;
+  }
+
+  void run_until(const uint64_t time_ps) {
+    while (_time_ps < time_ps) step();
+  }
+
+  void bus_write(const uint16_t addr, const uint16_t value) {
+    wait_bus_posedge();
+    _top->CPU_ADDR = static_cast<uint32_t>(addr) << 1;
+    _top->CPU_DATA_IN = value;
+    _top->CPU_CS1_N = 0;
+    _top->CPU_WE0_N = 0;
+    wait_bus_posedge();
+    _top->CPU_CS1_N = 1;
+    _top->CPU_WE0_N = 1;
+  }
+
+  uint16_t bus_read(const uint16_t addr) {
+    wait_bus_posedge();
+    _top->CPU_ADDR = static_cast<uint32_t>(addr) << 1;
+    _top->CPU_CS1_N = 0;
+    _top->CPU_RD_N = 0;
+    _top->CPU_RDWR = 1;
+    wait_bus_posedge();
+    wait_bus_posedge();
+    wait_bus_posedge();
+    const auto value = static_cast<uint16_t>(_top->CPU_DATA_OUT);
+    _top->CPU_CS1_N = 1;
+    _top->CPU_RD_N = 1;
+    _top->CPU_RDWR = 0;
+    return value;
+  }
+
+  [[nodiscard]] uint64_t time_ps() const noexcept { return _time_ps; }
+  [[nodiscard]] uint64_t num_periods() const noexcept { return _period_starts.size(); }
+  [[nodiscard]] uint64_t period_start_ps(const size_t i) const { return _period_starts[i]; }
+  /**
+   * @return whether the output of i-th period differs from the previous one. Only finished periods can be queried.
+   */
+  [[nodiscard]] bool period_changed(const size_t i) const { return _period_changed[i]; }
+  [[nodiscard]] size_t num_finished_periods() const noexcept { return _period_changed.size(); }
+
+ private:
+  void step() {
+    const auto t = std::min(_next_sys_edge_ps, _next_bus_edge_ps);
+    _ctx->timeInc(t - _time_ps);
+    _time_ps = t;
+
+    bool sys_posedge = false;
+    if (_time_ps == _next_sys_edge_ps) {
+      _top->MRCC_25P6M = !_top->MRCC_25P6M;
+      sys_posedge = _top->MRCC_25P6M;
+      _next_sys_edge_ps += SYS_CLK_HALF_PERIOD_PS;
+    }
+    if (_time_ps == _next_bus_edge_ps) {
+      _top->CPU_CKIO = !_top->CPU_CKIO;
+      _bus_posedge = _bus_posedge || _top->CPU_CKIO;
+      _next_bus_edge_ps += BUS_CLK_HALF_PERIOD_PS;
+    }
+    _top->CAT_SYNC0 = _sync0_period_ps != 0 && _time_ps >= _sync0_origin_ps &&
+                      (_time_ps - _sync0_origin_ps) % _sync0_period_ps < SYNC0_PULSE_WIDTH_PS;
+    _top->eval();
+
+    if (sys_posedge) monitor();
+  }
+
+  void wait_bus_posedge() {
+    _bus_posedge = false;
+    while (!_bus_posedge) step();
+  }
+
+  [[nodiscard]] bool pin(const size_t i) const { return (_top->XDCR_OUT[i / 32] >> (i % 32)) & 1; }
+
+  // record the first rising and falling edges of each pin in each period, and compare them with those of the previous period
+  void monitor() {
+    if (const bool period_bit = (_top->GPIO_OUT >> PERIOD_GPIO_BIT) & 1; period_bit != _last_period_bit) {
+      _last_period_bit = period_bit;
+      if (!_period_starts.empty()) {
+        _period_changed.emplace_back(_edges != _prev_edges);
+        std::swap(_edges, _prev_edges);
+      }
+      _period_starts.emplace_back(_time_ps);
+      _edges.fill(0);
+      _clk_in_period = 0;
+    }
+
+    _clk_in_period++;
+    for (size_t i = 0; i < NUM_PINS; i++) {
+      const auto v = pin(i);
+      if (v == _pins[i]) continue;
+      _pins[i] = v;
+      auto& edge = _edges[2 * i + (v ? 0 : 1)];
+      if (edge == 0) edge = _clk_in_period;
+    }
+  }
+
+  std::unique_ptr<VerilatedContext> _ctx;
+  std::unique_ptr<Vcosim_top> _top;
+
+  uint64_t _time_ps = 0;
+  uint64_t _next_sys_edge_ps = SYS_CLK_HALF_PERIOD_PS;
+  uint64_t _next_bus_edge_ps = BUS_CLK_HALF_PERIOD_PS;
+  uint64_t _sync0_origin_ps = 0;
+  uint64_t _sync0_period_ps = 0;
+  bool _bus_posedge = false;
+
+  bool _last_period_bit = false;
+  uint32_t _clk_in_period = 0;
+  std::array<bool, NUM_PINS> _pins{};
+  std::array<uint32_t, 2 * NUM_PINS> _edges{};
+  std::array<uint32_t, 2 * NUM_PINS> _prev_edges{};
+  std::vector<uint64_t> _period_starts;
+  std::vector<bool> _period_changed;
+};
+
+class CosimImpl final : public Cosim {
+ public:
+  CosimImpl(const uint32_t cycle_ticks, const uint32_t max_wait_periods)
+      : Cosim(), _cycle_ticks(cycle_ticks), _max_wait_periods(max_wait_periods), _fpga(nullptr), _last_delivered_ps(0) {}
+  ~CosimImpl() override = default;
+  CosimImpl(const CosimImpl& v) noexcept = delete;
+  CosimImpl& operator=(const CosimImpl& obj) = delete;
+  CosimImpl(CosimImpl&& obj) = delete;
+  CosimImpl& operator=(CosimImpl&& obj) = delete;
+
+ protected:
+  void open(const core::LinkConfiguration& config) override;
+  void reconfigure(const core::LinkConfiguration& config) override;
+  void close() override;
+  void send(const uint8_t* buf, size_t size) override;
+  void send_with_policy(const uint8_t* buf, size_t size, core::SendPolicy policy) override;
+  void read(uint8_t* rx, size_t buffer_len) override;
+  bool is_open() override;
+  uint64_t dc_time() override;
+  void advance(uint64_t duration_ns) override;
+  uint64_t now_ns() override;
+  const std::vector<CosimLatency>& latencies() override;
+
+ private:
+  /**
+   * @brief Frame in the send queue, with the index of its timestamps in latencies
+   */
+  struct QueuedFrame {
+    std::vector<uint8_t> data;
+    bool replaceable;
+    size_t latency_idx;
+  };
+
+  // the firmware reads the system time of the distributed clocks during the bus accesses, which advance the simulation
+  static void write_handler(void* ctx, const uint16_t addr, const uint16_t value) {
+    auto* fpga = static_cast<SimulatedFPGA*>(ctx);
+    fpga->bus_write(addr, value);
+    host_dc_sys_time = fpga->time_ps() / PS_PER_NS;
+  }
+  static uint16_t read_handler(void* ctx, const uint16_t addr) {
+    auto* fpga = static_cast<SimulatedFPGA*>(ctx);
+    const auto value = fpga->bus_read(addr);
+    host_dc_sys_time = fpga->time_ps() / PS_PER_NS;
+    return value;
+  }
+
+  [[nodiscard]] uint64_t ec_cycle_ps() const noexcept { return static_cast<uint64_t>(core::EC_SM3_CYCLE_TIME_NANO_SEC) * _cycle_ticks * PS_PER_NS; }
+
+  void run_until(uint64_t time_ps);
+  void dequeue(uint64_t time_ps);
+  void deliver();
+  void watch_output();
+
+  uint32_t _cycle_ticks;
+  uint32_t _max_wait_periods;
+  std::unique_ptr<SimulatedFPGA> _fpga;
+  uint64_t _last_delivered_ps;
+  std::vector<CosimLatency> _latencies;
+
+  // frames waiting for the process data, as the send queue of the SOEM link, and the frame copied to the process data
+  std::deque<QueuedFrame> _send_queue;
+  size_t _urgent_size = 0;
+  std::optional<QueuedFrame> _process_data;
+
+  // the frame whose output is watched, and the next period to check
+  std::optional<size_t> _watched;
+  uint64_t _watch_first_period = 0;
+  uint64_t _watch_next_period = 0;
+};
+
+std::unique_ptr<Cosim> Cosim::create(const uint32_t cycle_ticks, const uint32_t max_wait_periods) {
+  return std::make_unique<CosimImpl>(cycle_ticks, max_wait_periods);
+}
+
+void CosimImpl::open(const core::LinkConfiguration& config) {
+  if (config.freq_cycles.size() != 1) throw core::exception::LinkError("Co-simulation supports only one device");
+
+  _fpga = std::make_unique<SimulatedFPGA>();
+  _fpga->reset(config.freq_cycles[0]);
+
+  const HostBusHandler handler{write_handler, read_handler, _fpga.get()};
+  host_bus_attach(&handler);
+  host_dc_sys_time = _fpga->time_ps() / PS_PER_NS;
+  host_app_init();
+
+  _last_delivered_ps = 0;
+  _latencies.clear();
+  _send_queue.clear();
+  _urgent_size = 0;
+  _process_data = std::nullopt;
+  _watched = std::nullopt;
+}
+
+void CosimImpl::reconfigure(const core::LinkConfiguration& config) {
+  if (config.freq_cycles.size() != 1) throw core::exception::LinkError("Co-simulation supports only one device");
+  _fpga->set_freq_cycle(config.freq_cycles[0]);
+}
+
+void CosimImpl::close() {
+  if (_fpga == nullptr) return;
+
+  // deliver the queued frames, and wait for the output of the last one
+  while (_process_data.has_value()) run_until(std::max(_fpga->time_ps(), _last_delivered_ps) + ec_cycle_ps());
+  while (_watched.has_value()) run_until(_fpga->time_ps() + SYS_CLK_HALF_PERIOD_PS * 2);
+
+  host_bus_attach(nullptr);
+  _fpga = nullptr;
+}
+
+void CosimImpl::send(const uint8_t* buf, const size_t size) { send_with_policy(buf, size, core::SendPolicy::Fifo); }
+
+// same policies as the send queue of the SOEM link
+void CosimImpl::send_with_policy(const uint8_t* buf, const size_t size, const core::SendPolicy policy) {
+  if (_fpga == nullptr) throw core::exception::LinkError("Link is closed");
+
+  const auto drop = [this](const QueuedFrame& frame) {
+    _latencies[frame.latency_idx].dropped = true;
+    return true;
+  };
+  if (policy == core::SendPolicy::Urgent) {
+    // the queued frames except the urgent ones are cancelled by the urgent frame
+    std::for_each(_send_queue.begin() + static_cast<std::ptrdiff_t>(_urgent_size), _send_queue.end(), drop);
+    _send_queue.erase(_send_queue.begin() + static_cast<std::ptrdiff_t>(_urgent_size), _send_queue.end());
+  } else if (policy == core::SendPolicy::LatestWinsFirst) {
+    _send_queue.erase(
+        std::remove_if(_send_queue.begin(), _send_queue.end(), [&drop](const QueuedFrame& frame) { return frame.replaceable && drop(frame); }),
+        _send_queue.end());
+  }
+
+  CosimLatency latency{};
+  latency.msg_id = buf[0];
+  latency.command = buf[2];
+  latency.sent_ns = _fpga->time_ps() / PS_PER_NS;
+  _latencies.emplace_back(latency);
+
+  QueuedFrame frame{std::vector<uint8_t>(buf, buf + size),
+                    policy == core::SendPolicy::LatestWinsFirst || policy == core::SendPolicy::LatestWins, _latencies.size() - 1};
+  if (policy == core::SendPolicy::Urgent || policy == core::SendPolicy::Preempt)
+    _send_queue.emplace(_send_queue.begin() + static_cast<std::ptrdiff_t>(_urgent_size++), std::move(frame));
+  else
+    _send_queue.emplace_back(std::move(frame));
+
+  if (!_process_data.has_value()) dequeue(_fpga->time_ps());
+}
+
+void CosimImpl::read(uint8_t* rx, const size_t buffer_len) {
+  if (_fpga == nullptr) throw core::exception::LinkError("Link is closed");
+
+  // the input is received on the next EtherCAT cycle
+  const auto cycle = ec_cycle_ps();
+  run_until((_fpga->time_ps() / cycle + 1) * cycle);
+
+  std::array<uint8_t, HOST_APP_INPUT_SIZE> input{};
+  host_dc_sys_time = _fpga->time_ps() / PS_PER_NS;
+  host_app_update();  // the periodic task of the firmware refreshes the status before the input is sampled
+  host_app_input(input.data());
+  std::memcpy(rx, input.data(), std::min(buffer_len, input.size()));
+}
+
+bool CosimImpl::is_open() { return _fpga != nullptr; }
+
+uint64_t CosimImpl::dc_time() { return now_ns(); }
+
+void CosimImpl::advance(const uint64_t duration_ns) {
+  if (_fpga == nullptr) throw core::exception::LinkError("Link is closed");
+  run_until(_fpga->time_ps() + duration_ns * PS_PER_NS);
+}
+
+uint64_t CosimImpl::now_ns() { return _fpga == nullptr ? 0 : _fpga->time_ps() / PS_PER_NS; }
+
+const std::vector<CosimLatency>& CosimImpl::latencies() { return _latencies; }
+
+// Run the simulation, delivering the frame in the process data on each EtherCAT cycle
+void CosimImpl::run_until(const uint64_t time_ps) {
+  const auto cycle = ec_cycle_ps();
+  while (_process_data.has_value()) {
+    const auto dequeued_ps = _latencies[_process_data->latency_idx].dequeued_ns * PS_PER_NS;
+    const auto delivered_ps = std::max((dequeued_ps + cycle - 1) / cycle * cycle, _last_delivered_ps + cycle);
+    if (delivered_ps > time_ps) break;
+    _fpga->run_until(delivered_ps);
+    watch_output();
+    _last_delivered_ps = delivered_ps;
+    deliver();
+  }
+  _fpga->run_until(time_ps);
+  watch_output();
+}
+
+// Copy the first frame in the send queue to the process data
+void CosimImpl::dequeue(const uint64_t time_ps) {
+  if (_send_queue.empty()) return;
+  _process_data = std::move(_send_queue.front());
+  _send_queue.pop_front();
+  if (_urgent_size > 0) _urgent_size--;
+  _latencies[_process_data->latency_idx].dequeued_ns = time_ps / PS_PER_NS;
+}
+
+void CosimImpl::deliver() {
+  const auto frame = std::move(_process_data.value());
+  _process_data = std::nullopt;
+  auto& latency = _latencies[frame.latency_idx];
+  latency.delivered_ns = _last_delivered_ps / PS_PER_NS;
+
+  // the next frame is copied to the process data as soon as this one is sent
+  dequeue(_last_delivered_ps);
+
+  host_bus_reset_stats();
+  host_dc_sys_time = _fpga->time_ps() / PS_PER_NS;
+  host_app_receive(frame.data.data(), frame.data.size() > core::HEADER_SIZE ? frame.data.data() + core::HEADER_SIZE : nullptr);
+  latency.firmware_done_ns = _fpga->time_ps() / PS_PER_NS;
+  latency.bus_cycles = host_bus_stats.bus_cycles;
+
+  // the output of the previous frame is not watched any more
+  _watched = frame.latency_idx;
+  _watch_first_period = _fpga->num_periods();
+  _watch_next_period = _watch_first_period;
+}
+
+// Record when the first period begins after the firmware finished, and the first period in which the output changed,
+// for at most max_wait_periods periods
+void CosimImpl::watch_output() {
+  if (!_watched.has_value()) return;
+  auto& latency = _latencies[_watched.value()];
+  if (latency.period_latched_ns == 0 && _fpga->num_periods() > _watch_first_period)
+    latency.period_latched_ns = _fpga->period_start_ps(_watch_first_period) / PS_PER_NS;
+  for (; _watch_next_period < _fpga->num_finished_periods(); _watch_next_period++) {
+    if (_watch_next_period >= _watch_first_period + _max_wait_periods) {
+      _watched = std::nullopt;
+      return;
+    }
+    if (_fpga->period_changed(_watch_next_period)) {
+      latency.output_changed_ns = _fpga->period_start_ps(_watch_next_period) / PS_PER_NS;
+      _watched = std::nullopt;
+      return;
+    }
+  }
+}
+
+}  // namespace autd::link
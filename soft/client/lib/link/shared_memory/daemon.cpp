@@ -0,0 +1,61 @@
+// File: daemon.cpp
+// Project: shared_memory
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// autd3_daemon owns the SOEM link and forwards the frames of the processes which use link::SharedMemory.
+// usage: autd3_daemon <ifname> <num_devices> [freq_cycle] [shm_name] [mode]
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "autd3-freq-shift/core/hardware_defined.hpp"
+#include "autd3-freq-shift/link/shared_memory.hpp"
+#include "autd3-freq-shift/link/soem.hpp"
+#include "shm_server.hpp"
+
+namespace {
+std::atomic<bool> stop_requested(false);
+void request_stop(int) { stop_requested.store(true, std::memory_order_release); }
+}  // namespace
+
+int main(const int argc, char* argv[]) try {
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0] << " <ifname> <num_devices> [freq_cycle] [shm_name] [mode]" << std::endl;
+    size_t i = 0;
+    for (auto&& [desc, name] : autd::link::SOEM::enumerate_adapters()) std::cerr << "[" << i++ << "]: " << desc << ", " << name << std::endl;
+    return EINVAL;
+  }
+
+  const std::string ifname = argv[1];
+  const auto num_devices = static_cast<size_t>(std::stoul(argv[2]));
+  const auto freq_cycle = argc > 3 ? static_cast<uint16_t>(std::stoul(argv[3])) : static_cast<uint16_t>(autd::core::FPGA_BASE_CLK_FREQ / 40000);
+  const std::string name = argc > 4 ? argv[4] : autd::link::SharedMemory::DEFAULT_NAME;
+  const auto mode = argc > 5 ? static_cast<mode_t>(std::stoul(argv[5], nullptr, 8)) : autd::shm::SERVER_DEFAULT_MODE;
+
+  std::signal(SIGINT, request_stop);
+  std::signal(SIGTERM, request_stop);
+
+  auto link = autd::link::SOEM::create(ifname, num_devices);
+  link->on_lost([](const std::string& msg) { std::cerr << "Link is lost: " << msg << std::endl; });
+  autd::shm::Server server(name, std::move(link), std::vector<uint16_t>(num_devices, freq_cycle), mode);
+  server.on_log([](const std::string& msg) { std::cerr << msg << std::endl; });
+
+  std::cout << "autd3_daemon: " << num_devices << " devices on " << ifname << ", shared memory " << name << std::endl;
+  server.run(stop_requested);
+
+  return 0;
+} catch (std::exception& e) {
+  std::cerr << e.what() << std::endl;
+  return ENXIO;
+}
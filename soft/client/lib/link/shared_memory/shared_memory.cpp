@@ -0,0 +1,241 @@
+// File: shared_memory.cpp
+// Project: shared_memory
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#include "autd3-freq-shift/link/shared_memory.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "autd3-freq-shift/core/exception.hpp"
+#include "shm_layout.hpp"
+
+namespace autd::link {
+
+/**
+ * @brief Timeout of close() to wait for the daemon to consume the remaining frames
+ */
+constexpr auto SHM_DRAIN_TIMEOUT = std::chrono::milliseconds(1000);
+/**
+ * @brief Timeout of reconfigure() to wait for the daemon to forward the remaining frames and to handle the request
+ */
+constexpr auto SHM_REQUEST_TIMEOUT = std::chrono::milliseconds(1000);
+
+class SharedMemoryImpl final : public SharedMemory {
+ public:
+  explicit SharedMemoryImpl(std::string name) : SharedMemory(), _name(std::move(name)), _layout(0) {}
+  ~SharedMemoryImpl() override {
+    try {
+      this->close();
+    } catch (...) {
+    }
+  }
+  SharedMemoryImpl(const SharedMemoryImpl& v) noexcept = delete;
+  SharedMemoryImpl& operator=(const SharedMemoryImpl& obj) = delete;
+  SharedMemoryImpl(SharedMemoryImpl&& obj) = delete;
+  SharedMemoryImpl& operator=(SharedMemoryImpl&& obj) = delete;
+
+ protected:
+  void open(const core::LinkConfiguration& config) override;
+  void reconfigure(const core::LinkConfiguration& config) override;
+  void close() override;
+  void send(const uint8_t* buf, size_t size) override;
+  void send_with_policy(const uint8_t* buf, size_t size, core::SendPolicy policy) override;
+  void end_command() override;
+  void read(uint8_t* rx, size_t buffer_len) override;
+  uint64_t dc_time() override;
+  bool is_open() override;
+
+ private:
+  [[nodiscard]] bool is_daemon_alive() const { return kill(shm::Layout::header(_base)->daemon_pid, 0) == 0 || errno != ESRCH; }
+  template <typename P>
+  void wait_daemon(P&& pred) const;
+  void unmap();
+
+  std::string _name;
+  shm::Layout _layout;
+  int _fd = -1;
+  uint8_t* _base = nullptr;
+  size_t _client = 0;
+  uint64_t _head = 0;  // frames written to the ring, which are published at the end of the command
+};
+
+std::unique_ptr<SharedMemory> SharedMemory::create(const std::string& name) { return std::make_unique<SharedMemoryImpl>(name); }
+
+void SharedMemoryImpl::open(const core::LinkConfiguration& config) {
+  if (is_open()) return;
+
+  _fd = shm_open(_name.c_str(), O_RDWR, 0);
+  if (_fd < 0) throw core::exception::LinkError("Failed to open shared memory " + _name + ": is autd3_daemon running?");
+
+  auto* header = static_cast<uint8_t*>(mmap(nullptr, sizeof(shm::SegmentHeader), PROT_READ, MAP_SHARED, _fd, 0));
+  if (header == MAP_FAILED) {
+    unmap();
+    throw core::exception::LinkError("Failed to map shared memory " + _name);
+  }
+  const auto* h = shm::Layout::header(header);
+  const auto magic = h->magic.load(std::memory_order_acquire);
+  const auto version = h->version;
+  const auto segment_size = h->segment_size;
+  const auto num_devices = static_cast<size_t>(h->num_devices);
+  munmap(header, sizeof(shm::SegmentHeader));
+  if (magic != shm::SHM_MAGIC || version != shm::SHM_VERSION) {
+    unmap();
+    throw core::exception::LinkError("Shared memory " + _name + " is not initialized or the version of autd3_daemon differs");
+  }
+  if (num_devices != config.freq_cycles.size()) {
+    unmap();
+    throw core::exception::LinkError("autd3_daemon controls " + std::to_string(num_devices) + " devices, but the geometry has " +
+                                     std::to_string(config.freq_cycles.size()));
+  }
+
+  _layout = shm::Layout(num_devices);
+  auto* base = mmap(nullptr, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+  if (base == MAP_FAILED || segment_size != _layout.segment_size()) {
+    if (base != MAP_FAILED) munmap(base, segment_size);
+    unmap();
+    throw core::exception::LinkError("Failed to map shared memory " + _name);
+  }
+  _base = static_cast<uint8_t*>(base);
+
+  const auto pid = static_cast<int32_t>(getpid());
+  for (_client = 0; _client < shm::MAX_CLIENTS; _client++) {
+    int32_t expected = 0;
+    if (_layout.client(_base, _client)->owner.compare_exchange_strong(expected, pid, std::memory_order_acq_rel)) break;
+  }
+  if (_client == shm::MAX_CLIENTS) {
+    unmap();
+    throw core::exception::LinkError("No free client slot in autd3_daemon");
+  }
+  _head = _layout.client(_base, _client)->head.load(std::memory_order_relaxed);
+
+  try {
+    reconfigure(config);
+  } catch (core::exception::LinkError&) {
+    _layout.client(_base, _client)->owner.store(0, std::memory_order_release);
+    unmap();
+    throw;
+  }
+}
+
+void SharedMemoryImpl::reconfigure(const core::LinkConfiguration& config) {
+  if (_base == nullptr) throw core::exception::LinkError("link is closed");
+
+  // the frames sent before are forwarded with the previous frequencies
+  end_command();
+  auto* client = _layout.client(_base, _client);
+  wait_daemon([this, client] { return client->tail.load(std::memory_order_acquire) == _head; });
+
+  auto* freq_cycles = _layout.freq_cycles(_base, _client);
+  for (size_t i = 0; i < _layout.num_devices(); i++) freq_cycles[i].store(config.freq_cycles[i], std::memory_order_relaxed);
+  const auto seq = client->config_seq.fetch_add(1, std::memory_order_release) + 1;
+  shm::ring_doorbell(shm::Layout::header(_base));
+  wait_daemon([client, seq] { return client->config_ack.load(std::memory_order_acquire) == seq; });
+  if (client->config_rejected.load(std::memory_order_relaxed) != 0)
+    throw core::exception::LinkError("autd3_daemon drives the devices with other frequencies for the other clients");
+}
+
+template <typename P>
+void SharedMemoryImpl::wait_daemon(P&& pred) const {
+  const auto deadline = std::chrono::steady_clock::now() + SHM_REQUEST_TIMEOUT;
+  while (!pred()) {
+    if (!is_daemon_alive()) throw core::exception::LinkError("autd3_daemon is not running");
+    if (std::chrono::steady_clock::now() > deadline) throw core::exception::LinkError("autd3_daemon does not respond");
+    std::this_thread::yield();
+  }
+}
+
+void SharedMemoryImpl::close() {
+  if (_base == nullptr) return;
+
+  end_command();
+  auto* client = _layout.client(_base, _client);
+  const auto deadline = std::chrono::steady_clock::now() + SHM_DRAIN_TIMEOUT;
+  while (client->tail.load(std::memory_order_acquire) != _head && std::chrono::steady_clock::now() < deadline && is_daemon_alive())
+    std::this_thread::yield();
+  client->owner.store(0, std::memory_order_release);
+
+  unmap();
+}
+
+void SharedMemoryImpl::unmap() {
+  if (_base != nullptr) munmap(_base, _layout.segment_size());
+  _base = nullptr;
+  if (_fd >= 0) ::close(_fd);
+  _fd = -1;
+}
+
+void SharedMemoryImpl::send(const uint8_t* buf, const size_t size) {
+  send_with_policy(buf, size, core::SendPolicy::Fifo);
+  end_command();
+}
+
+void SharedMemoryImpl::send_with_policy(const uint8_t* buf, const size_t size, const core::SendPolicy policy) {
+  if (_base == nullptr) throw core::exception::LinkError("link is closed");
+  if (size > _layout.frame_size()) throw core::exception::LinkError("frame is larger than the frame of autd3_daemon");
+
+  auto* client = _layout.client(_base, _client);
+  while (_head - client->tail.load(std::memory_order_acquire) >= shm::RING_SIZE) {
+    // the daemon cannot consume the unpublished frames of the command
+    if (client->tail.load(std::memory_order_acquire) == client->head.load(std::memory_order_relaxed))
+      throw core::exception::LinkError("a command has more frames than the ring of autd3_daemon");
+    if (!is_daemon_alive()) throw core::exception::LinkError("autd3_daemon is not running");
+    std::this_thread::yield();
+  }
+
+  auto* entry = _layout.entry(_base, _client, _head++);
+  std::memcpy(shm::Layout::frame(entry), buf, size);
+  entry->size = static_cast<uint32_t>(size);
+  entry->policy = static_cast<uint8_t>(policy);
+}
+
+void SharedMemoryImpl::end_command() {
+  if (_base == nullptr) throw core::exception::LinkError("link is closed");
+
+  auto* client = _layout.client(_base, _client);
+  if (client->head.load(std::memory_order_relaxed) == _head) return;
+  client->head.store(_head, std::memory_order_release);
+  shm::ring_doorbell(shm::Layout::header(_base));
+}
+
+void SharedMemoryImpl::read(uint8_t* rx, const size_t buffer_len) {
+  if (_base == nullptr) throw core::exception::LinkError("link is closed");
+
+  auto* client = _layout.client(_base, _client);
+  const auto* words = _layout.input(_base, _client);
+  const auto size = std::min(buffer_len, _layout.input_size());
+  while (true) {
+    const auto seq = client->input_seq.load(std::memory_order_acquire);
+    if (seq % 2 != 0) continue;
+    for (size_t i = 0, offset = 0; offset < size; i++, offset += sizeof(uint64_t)) {
+      const auto word = words[i].load(std::memory_order_relaxed);
+      std::memcpy(rx + offset, &word, std::min(sizeof(uint64_t), size - offset));
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (client->input_seq.load(std::memory_order_relaxed) == seq) return;
+  }
+}
+
+uint64_t SharedMemoryImpl::dc_time() {
+  if (_base == nullptr) return 0;
+  return shm::Layout::header(_base)->dc_time.load(std::memory_order_acquire);
+}
+
+bool SharedMemoryImpl::is_open() { return _base != nullptr && is_daemon_alive(); }
+}  // namespace autd::link
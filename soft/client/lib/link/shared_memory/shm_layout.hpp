@@ -0,0 +1,151 @@
+// File: shm_layout.hpp
+// Project: shared_memory
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <climits>
+#include <cstdint>
+
+#include "autd3-freq-shift/core/ec_config.hpp"
+
+namespace autd::shm {
+
+constexpr uint32_t SHM_MAGIC = 0x44545541;  // "AUTD"
+constexpr uint32_t SHM_VERSION = 2;
+
+/**
+ * @brief Maximum number of client processes attached at the same time
+ */
+constexpr size_t MAX_CLIENTS = 8;
+/**
+ * @brief Number of frames in the ring of each client, which is the same as the send queue of the SOEM link
+ */
+constexpr size_t RING_SIZE = 32;
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free,
+              "atomics in shared memory must be lock-free to be shared between processes");
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "the doorbell is used as a futex word");
+
+/**
+ * @brief Header of the segment, written by the daemon
+ */
+struct SegmentHeader {
+  std::atomic<uint32_t> magic;  //!< written last, after the segment is initialized
+  uint32_t version;
+  uint64_t segment_size;
+  uint32_t num_devices;
+  int32_t daemon_pid;
+  std::atomic<uint64_t> dc_time;
+  alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> doorbell;  //!< incremented by the clients after publishing frames
+  std::atomic<uint32_t> sleeping;                           //!< set while the daemon waits on the doorbell
+};
+
+/**
+ * @brief Header of the area of a client
+ * @details The frames are passed through a single-producer single-consumer ring, so that a client which crashes while writing a frame
+ * leaves only an unpublished slot, which the daemon discards when it reclaims the area. The head is advanced only at the end of a command, so
+ * that the daemon always sees the frames of a command at once.
+ */
+struct ClientHeader {
+  std::atomic<int32_t> owner;             //!< pid of the client, or 0 if the area is free
+  std::atomic<uint32_t> config_seq;       //!< incremented by the client after writing freq_cycles
+  std::atomic<uint32_t> config_ack;       //!< config_seq handled by the daemon
+  std::atomic<uint32_t> config_rejected;  //!< whether the daemon rejected the freq_cycles of config_ack
+  alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head;       //!< number of frames of the commands published by the client
+  alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> tail;       //!< number of frames consumed by the daemon
+  alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> input_seq;  //!< odd while the daemon writes the input
+};
+
+/**
+ * @brief Header of a frame in the ring, followed by the frame
+ */
+struct FrameHeader {
+  uint32_t size;
+  uint8_t policy;
+};
+
+/**
+ * @brief Offsets in the segment, which are determined by the number of devices
+ * @details The segment consists of the SegmentHeader and MAX_CLIENTS areas of
+ * ClientHeader | freq_cycles (uint16 per device) | input (uint64 words) | RING_SIZE frames,
+ * each part aligned to a cache line.
+ */
+class Layout {
+ public:
+  explicit Layout(const size_t num_devices) noexcept
+      : _num_devices(num_devices),
+        _frame_size(num_devices * core::EC_OUTPUT_FRAME_SIZE),
+        _input_size(num_devices * core::EC_INPUT_FRAME_SIZE),
+        _freq_offset(align(sizeof(ClientHeader))),
+        _input_offset(_freq_offset + align(num_devices * sizeof(std::atomic<uint16_t>))),
+        _ring_offset(_input_offset + align(input_words() * sizeof(std::atomic<uint64_t>))),
+        _entry_size(align(sizeof(FrameHeader) + _frame_size)),
+        _client_size(_ring_offset + RING_SIZE * _entry_size) {}
+
+  [[nodiscard]] size_t num_devices() const noexcept { return _num_devices; }
+  [[nodiscard]] size_t frame_size() const noexcept { return _frame_size; }
+  [[nodiscard]] size_t input_size() const noexcept { return _input_size; }
+  [[nodiscard]] size_t input_words() const noexcept { return (_input_size + sizeof(uint64_t) - 1) / sizeof(uint64_t); }
+  [[nodiscard]] size_t segment_size() const noexcept { return align(sizeof(SegmentHeader)) + MAX_CLIENTS * _client_size; }
+
+  static SegmentHeader* header(uint8_t* base) noexcept { return reinterpret_cast<SegmentHeader*>(base); }
+  ClientHeader* client(uint8_t* base, const size_t c) const noexcept { return reinterpret_cast<ClientHeader*>(client_base(base, c)); }
+  std::atomic<uint16_t>* freq_cycles(uint8_t* base, const size_t c) const noexcept {
+    return reinterpret_cast<std::atomic<uint16_t>*>(client_base(base, c) + _freq_offset);
+  }
+  std::atomic<uint64_t>* input(uint8_t* base, const size_t c) const noexcept {
+    return reinterpret_cast<std::atomic<uint64_t>*>(client_base(base, c) + _input_offset);
+  }
+  FrameHeader* entry(uint8_t* base, const size_t c, const uint64_t idx) const noexcept {
+    return reinterpret_cast<FrameHeader*>(client_base(base, c) + _ring_offset + (idx % RING_SIZE) * _entry_size);
+  }
+  static uint8_t* frame(FrameHeader* entry) noexcept { return reinterpret_cast<uint8_t*>(entry) + sizeof(FrameHeader); }
+
+ private:
+  static constexpr size_t align(const size_t size) noexcept { return (size + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE; }
+  uint8_t* client_base(uint8_t* base, const size_t c) const noexcept { return base + align(sizeof(SegmentHeader)) + c * _client_size; }
+
+  size_t _num_devices;
+  size_t _frame_size;
+  size_t _input_size;
+  size_t _freq_offset;
+  size_t _input_offset;
+  size_t _ring_offset;
+  size_t _entry_size;
+  size_t _client_size;
+};
+
+/**
+ * @brief Wait until the doorbell differs from expected, or the timeout expires
+ */
+inline void wait_doorbell(std::atomic<uint32_t>* doorbell, const uint32_t expected, const long timeout_ns) noexcept {
+  const timespec timeout{0, timeout_ns};
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(doorbell), FUTEX_WAIT, expected, &timeout, nullptr, 0);
+}
+
+/**
+ * @brief Notify the daemon of new frames or requests, waking it only if it is waiting
+ */
+inline void ring_doorbell(SegmentHeader* header) noexcept {
+  header->doorbell.fetch_add(1, std::memory_order_seq_cst);
+  if (header->sleeping.load(std::memory_order_seq_cst) != 0)
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&header->doorbell), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+}  // namespace autd::shm
@@ -0,0 +1,352 @@
+// File: shm_server.hpp
+// Project: shared_memory
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "autd3-freq-shift/core/device_status.hpp"
+#include "autd3-freq-shift/core/exception.hpp"
+#include "autd3-freq-shift/core/hardware_defined.hpp"
+#include "autd3-freq-shift/core/link.hpp"
+#include "autd3-freq-shift/core/logic.hpp"
+#include "shm_layout.hpp"
+
+namespace autd::shm {
+
+/**
+ * @brief Time for which the server keeps polling the rings after the last frame, before it waits on the doorbell
+ */
+constexpr auto SERVER_SPIN_DURATION = std::chrono::milliseconds(10);
+/**
+ * @brief Maximum time to wait on the doorbell, which bounds the age of the input data and dc_time published while idle
+ */
+constexpr long SERVER_WAIT_TIMEOUT_NS = 1000 * 1000;
+/**
+ * @brief Interval of checking whether the client processes are alive
+ */
+constexpr auto SERVER_CHECK_INTERVAL = std::chrono::milliseconds(100);
+/**
+ * @brief Default permission of the shared memory, with which the processes of the users in the group of the daemon can attach
+ */
+constexpr mode_t SERVER_DEFAULT_MODE = 0660;
+
+/**
+ * @brief Forwards the frames of the client processes in shared memory to a link, which is the main loop of autd3_daemon
+ * @details The server is the only process which touches the link. It assigns its own message id to each frame, and reports to each client
+ * the statuses with the ack history of its own frames in its message ids, so that the acks of a client are not flushed out of the history
+ * by the frames of the others.
+ * The area of a client which exits without closing the link is reclaimed, and its unconsumed frames are discarded.
+ * The frequencies of the devices are shared by the clients, so a client can change them only while no other client is attached.
+ */
+class Server {
+ public:
+  /**
+   * @param[in] name name of the shared memory, which must not exist
+   * @param[in] link link to the devices
+   * @param[in] freq_cycles frequency cycles of the devices
+   * @param[in] mode permission of the shared memory, which is not masked by umask
+   * @details The shared memory is not removed if it exists, because it may be used by another daemon.
+   */
+  Server(std::string name, core::LinkPtr link, const std::vector<uint16_t>& freq_cycles, const mode_t mode = SERVER_DEFAULT_MODE)
+      : _name(std::move(name)),
+        _link(std::move(link)),
+        _layout(freq_cycles.size()),
+        _config(),
+        _rx(_layout.input_size()),
+        _last_rx(_layout.input_size()) {
+    _config.freq_cycles = freq_cycles;
+    _link->open(_config);
+
+    _fd = shm_open(_name.c_str(), O_CREAT | O_EXCL | O_RDWR, mode);
+    if (_fd < 0) {
+      const auto err = errno;
+      if (err == EEXIST)
+        throw core::exception::LinkError("Shared memory " + _name + " already exists. Another autd3_daemon may be running, or remove /dev/shm" +
+                                         _name + " left by a daemon which crashed");
+      throw core::exception::LinkError("Failed to create shared memory " + _name + ": " + std::strerror(err));
+    }
+    if (fchmod(_fd, mode) != 0) {
+      release();
+      throw core::exception::LinkError("Failed to set the permission of shared memory " + _name);
+    }
+    if (ftruncate(_fd, static_cast<off_t>(_layout.segment_size())) != 0) {
+      release();
+      throw core::exception::LinkError("Failed to allocate shared memory " + _name);
+    }
+    auto* base = mmap(nullptr, _layout.segment_size(), PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (base == MAP_FAILED) {
+      release();
+      throw core::exception::LinkError("Failed to map shared memory " + _name);
+    }
+    _base = static_cast<uint8_t*>(base);
+
+    auto* header = new (_base) SegmentHeader{};
+    header->version = SHM_VERSION;
+    header->segment_size = _layout.segment_size();
+    header->num_devices = static_cast<uint32_t>(_layout.num_devices());
+    header->daemon_pid = static_cast<int32_t>(getpid());
+    for (size_t c = 0; c < MAX_CLIENTS; c++) {
+      new (_layout.client(_base, c)) ClientHeader{};
+      for (size_t i = 0; i < _layout.num_devices(); i++) new (&_layout.freq_cycles(_base, c)[i]) std::atomic<uint16_t>(0);
+      for (size_t i = 0; i < _layout.input_words(); i++) new (&_layout.input(_base, c)[i]) std::atomic<uint64_t>(0);
+    }
+    for (auto& statuses : _statuses) statuses.resize(_layout.num_devices());
+    _last_acked.resize(_layout.num_devices());
+    header->magic.store(SHM_MAGIC, std::memory_order_release);
+  }
+  ~Server() {
+    try {
+      _link->close();
+    } catch (...) {
+    }
+    release();
+  }
+  Server(const Server& v) noexcept = delete;
+  Server& operator=(const Server& obj) = delete;
+  Server(Server&& obj) = delete;
+  Server& operator=(Server&& obj) = delete;
+
+  void on_log(std::function<void(std::string)> callback) { _on_log = std::move(callback); }
+
+  /**
+   * @brief Forward the frames until stop is set
+   */
+  void run(const std::atomic<bool>& stop) {
+    auto* header = Layout::header(_base);
+    auto last_active = std::chrono::steady_clock::now();
+    auto last_check = last_active;
+    while (!stop.load(std::memory_order_acquire)) {
+      const auto bell = header->doorbell.load(std::memory_order_acquire);
+      const auto active = poll();
+
+      const auto now = std::chrono::steady_clock::now();
+      if (now - last_check > SERVER_CHECK_INTERVAL) {
+        reclaim();
+        last_check = now;
+      }
+      if (active) {
+        last_active = now;
+      } else if (now - last_active <= SERVER_SPIN_DURATION) {
+        std::this_thread::yield();  // gives way to the clients sharing the core, without leaving the run queue
+      } else {
+        header->sleeping.store(1, std::memory_order_seq_cst);
+        if (header->doorbell.load(std::memory_order_seq_cst) == bell) wait_doorbell(&header->doorbell, bell, SERVER_WAIT_TIMEOUT_NS);
+        header->sleeping.store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+  /**
+   * @brief Forward the published frames and configurations, and publish the input data to the clients
+   * @return whether any frame or configuration has been forwarded
+   */
+  bool poll() {
+    auto active = false;
+    for (size_t c = 0; c < MAX_CLIENTS; c++) {
+      auto* client = _layout.client(_base, c);
+      const auto owner = client->owner.load(std::memory_order_acquire);
+      if (owner == 0) continue;
+      if (owner != _owners[c]) attach(c, owner);
+      active |= forward_config(c);
+      active |= forward_frames(c);
+    }
+
+    // the input data are republished only if they change, so that the readers are not kept retrying by the spinning server
+    _link->read(_rx.data(), _rx.size());
+    Layout::header(_base)->dc_time.store(_link->dc_time(), std::memory_order_release);
+    const auto changed = _rx != _last_rx;
+    if (changed) {
+      std::swap(_rx, _last_rx);
+      track_acks();
+    }
+    for (size_t c = 0; c < MAX_CLIENTS; c++) {
+      if (_owners[c] == 0 || (_published[c] && !changed)) continue;
+      publish_input(c);
+      _published[c] = true;
+    }
+    return active;
+  }
+
+ private:
+  // The frequencies are shared by all the clients, so they are changed only by the client attached alone
+  bool forward_config(const size_t c) {
+    auto* client = _layout.client(_base, c);
+    const auto seq = client->config_seq.load(std::memory_order_acquire);
+    if (seq == _config_seqs[c]) return false;
+    _config_seqs[c] = seq;
+
+    const auto* freq_cycles = _layout.freq_cycles(_base, c);
+    auto config = _config;
+    for (size_t i = 0; i < _layout.num_devices(); i++) config.freq_cycles[i] = freq_cycles[i].load(std::memory_order_relaxed);
+    auto rejected = false;
+    if (config.freq_cycles != _config.freq_cycles) {
+      rejected = is_shared(c);
+      if (!rejected) {
+        try {
+          _link->reconfigure(config);
+          _config = std::move(config);
+        } catch (std::exception& e) {
+          rejected = true;
+          if (_on_log != nullptr) _on_log(std::string("failed to change the frequencies: ") + e.what());
+        }
+      }
+    }
+    client->config_rejected.store(rejected ? 1 : 0, std::memory_order_relaxed);
+    client->config_ack.store(seq, std::memory_order_release);
+    return true;
+  }
+
+  [[nodiscard]] bool is_shared(const size_t c) const {
+    for (size_t other = 0; other < MAX_CLIENTS; other++) {
+      if (other == c) continue;
+      const auto owner = _layout.client(_base, other)->owner.load(std::memory_order_acquire);
+      if (owner != 0 && (kill(owner, 0) == 0 || errno != ESRCH)) return true;
+    }
+    return false;
+  }
+
+  // The clients advance the head at the end of a command, so the frames of a command are forwarded at once without interleaving those of
+  // the others
+  bool forward_frames(const size_t c) {
+    auto* client = _layout.client(_base, c);
+    auto tail = client->tail.load(std::memory_order_relaxed);
+    const auto head = client->head.load(std::memory_order_acquire);
+    if (tail == head) return false;
+    for (; tail != head; tail++) {
+      auto* entry = _layout.entry(_base, c, tail);
+      auto* header = reinterpret_cast<core::GlobalHeader*>(Layout::frame(entry));
+      const auto msg_id = _msg_id.next();
+      _id_owner[msg_id] = static_cast<uint8_t>(c + 1);
+      _id_client[msg_id] = header->msg_id;
+      header->msg_id = msg_id;
+      _link->send_with_policy(Layout::frame(entry), entry->size, static_cast<core::SendPolicy>(entry->policy));
+      client->tail.store(tail + 1, std::memory_order_release);
+    }
+    _link->end_command();
+    return true;
+  }
+
+  void attach(const size_t c, const int32_t owner) {
+    _owners[c] = owner;
+    std::fill(_statuses[c].begin(), _statuses[c].end(), core::DeviceStatus{});
+    for (auto& id_owner : _id_owner)
+      if (id_owner == c + 1) id_owner = 0;
+    _published[c] = false;
+  }
+
+  // Only the frames processed since the previous input data are pushed to the histories of their senders
+  void track_acks() {
+    const core::DeviceStatusView rx(_last_rx.data(), _layout.num_devices());
+    for (size_t dev = 0; dev < rx.size(); dev++) {
+      const auto& s = rx[dev];
+      const auto& history = s.ack_history;
+      const auto num_new = std::find(history.begin(), history.end(), _last_acked[dev]) - history.begin();
+      _last_acked[dev] = history[0];
+      for (auto k = num_new; k > 0; k--) {
+        const auto id = history[static_cast<size_t>(k - 1)];
+        if (_id_owner[id] == 0) continue;
+        auto& h = _statuses[_id_owner[id] - 1][dev].ack_history;
+        std::copy_backward(h.begin(), h.end() - 1, h.end());
+        h[0] = _id_client[id];
+      }
+      for (size_t c = 0; c < MAX_CLIENTS; c++) {
+        if (_owners[c] == 0) continue;
+        auto& status = _statuses[c][dev];
+        if (_id_owner[s.msg_id] == c + 1) {
+          status.msg_id = _id_client[s.msg_id];
+          status.ack_data = s.ack_data;
+        }
+        status.fpga_info = s.fpga_info;
+        status.ctrl_flags = s.ctrl_flags;
+        status.cycle = s.cycle;
+      }
+    }
+  }
+
+  void publish_input(const size_t c) {
+    auto* client = _layout.client(_base, c);
+    auto* words = _layout.input(_base, c);
+    const auto* src = reinterpret_cast<const uint8_t*>(_statuses[c].data());
+    const auto size = _layout.input_size();
+
+    const auto seq = client->input_seq.load(std::memory_order_relaxed);
+    client->input_seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (size_t i = 0, offset = 0; offset < size; i++, offset += sizeof(uint64_t)) {
+      uint64_t word = 0;
+      std::memcpy(&word, src + offset, std::min(sizeof(uint64_t), size - offset));
+      words[i].store(word, std::memory_order_relaxed);
+    }
+    client->input_seq.store(seq + 2, std::memory_order_release);
+  }
+
+  void reclaim() {
+    for (size_t c = 0; c < MAX_CLIENTS; c++) {
+      auto* client = _layout.client(_base, c);
+      const auto owner = client->owner.load(std::memory_order_acquire);
+      if (owner == 0 || kill(owner, 0) == 0 || errno != ESRCH) continue;
+      client->tail.store(client->head.load(std::memory_order_acquire), std::memory_order_release);
+      client->owner.store(0, std::memory_order_release);
+      _owners[c] = 0;
+      if (_on_log != nullptr) _on_log("client " + std::to_string(owner) + " exited without closing the link");
+    }
+  }
+
+  void release() {
+    if (_base != nullptr) munmap(_base, _layout.segment_size());
+    _base = nullptr;
+    if (_fd >= 0) {
+      ::close(_fd);
+      shm_unlink(_name.c_str());
+    }
+    _fd = -1;
+  }
+
+  std::string _name;
+  core::LinkPtr _link;
+  Layout _layout;
+  core::LinkConfiguration _config;
+  int _fd = -1;
+  uint8_t* _base = nullptr;
+  std::vector<uint8_t> _rx;
+  std::vector<uint8_t> _last_rx;
+  core::MsgIdSequence _msg_id;
+  std::array<int32_t, MAX_CLIENTS> _owners{};
+  std::array<uint32_t, MAX_CLIENTS> _config_seqs{};
+  std::array<bool, MAX_CLIENTS> _published{};
+  std::array<uint8_t, 256> _id_owner{};   // message id of the server -> index of the client + 1, or 0
+  std::array<uint8_t, 256> _id_client{};  // message id of the server -> that of the client
+  std::array<std::vector<core::DeviceStatus>, MAX_CLIENTS> _statuses;
+  std::vector<uint8_t> _last_acked;
+  std::function<void(std::string)> _on_log = nullptr;
+};
+
+}  // namespace autd::shm
@@ -3,7 +3,7 @@
 // Created Date: 23/08/2019
 // Author: Shun Suzuki
 // -----
-// Last Modified: 09/10/2021
+// Last Modified: 19/10/2026
 // Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
 // -----
 // Copyright (c) 2019-2020 Hapis Lab. All rights reserved.
@@ -13,6 +13,7 @@
 #include <cstdint>
 #include <cstring>
 #include <memory>
+#include <numeric>
 #include <queue>
 #include <sstream>
 #include <string>
@@ -22,6 +23,7 @@
 #include "./ethercat.h"
 
 // "ethercat.h" must be included before followings
+#include "autd3-freq-shift/core/ec_config.hpp"
 #include "autd3-freq-shift/core/exception.hpp"
 #include "autd3-freq-shift/core/hardware_defined.hpp"
 #include "autdsoem.hpp"
@@ -30,43 +32,108 @@ namespace autd::autdsoem {
 
 void SOEMCallback::callback() {
   if (auto expected = false; _rt_lock.compare_exchange_weak(expected, true)) {
-    ec_send_processdata();
+    send_processdata();
     this->_sent->store(true, std::memory_order_release);
-    if (const auto wkc = ec_receive_processdata(EC_TIMEOUTRET); wkc != _expected_wkc)
-      if (!this->_error_handler()) return;
+    if (const auto wkc = receive_processdata(); wkc != _expected_wkc) this->_fault->store(true, std::memory_order_release);
+    this->_inputs->publish(this->_padded.empty() ? this->_input : pad_inputs());
+    this->_dc_time->store(dc_time(), std::memory_order_relaxed);
     _rt_lock.store(false, std::memory_order_release);
   }
 }
 
+void SOEMCallback::send_processdata() {
+  if (_process_data != nullptr)
+    _process_data->send();
+  else
+    ec_send_processdata();
+}
+
+int SOEMCallback::receive_processdata() {
+  return _process_data != nullptr ? _process_data->receive(EC_TIMEOUTRET) : ec_receive_processdata(EC_TIMEOUTRET);
+}
+
+const uint8_t* SOEMCallback::pad_inputs() {
+  const auto* src = this->_input;
+  for (size_t i = 0; i < this->_input_sizes.size(); src += this->_input_sizes[i], i++)
+    std::memcpy(&this->_padded[i * this->_input_frame_size], src, this->_input_sizes[i]);
+  return this->_padded.data();
+}
+
+uint64_t SOEMCallback::dc_time() const { return static_cast<uint64_t>(_process_data != nullptr ? _process_data->dc_time() : ec_DCtime); }
+
 bool SOEMController::is_open() const { return _is_open; }
 
-void SOEMController::send(const uint8_t* buf, const size_t) {
+void SOEMController::send(const uint8_t* buf, const size_t, const core::SendPolicy policy) {
   if (!_is_open) throw core::exception::LinkError("link is closed");
 
-  while (_send_buf_size == SEND_BUF_SIZE) std::this_thread::sleep_for(std::chrono::milliseconds(this->_config.ec_sm3_cycle_time_ns / 1000 / 1000));
   {
-    std::lock_guard lock(_send_mtx);
+    std::unique_lock lock(_send_mtx);
+    if (policy == core::SendPolicy::Urgent) {
+      // the commands of the queued frames except the urgent ones are cancelled by the urgent frame
+      for (auto i = _urgent_size; i < _send_buf_size; i++) _free_bufs[SEND_BUF_SIZE - _send_buf_size + (i - _urgent_size)] = _send_order[i];
+      _send_buf_size = _urgent_size;
+    } else if (policy == core::SendPolicy::LatestWinsFirst) {
+      size_t kept = 0;
+      for (size_t i = 0; i < _send_buf_size; i++) {
+        if (const auto idx = _send_order[i]; _replaceable[idx])
+          _free_bufs[SEND_BUF_SIZE - _send_buf_size + (i - kept)] = idx;
+        else
+          _send_order[kept++] = idx;
+      }
+      _send_buf_size = kept;
+    }
+    while (_send_buf_size == SEND_BUF_SIZE) {
+      lock.unlock();
+      std::this_thread::sleep_for(std::chrono::milliseconds(this->_config.ec_sm3_cycle_time_ns / 1000 / 1000));
+      lock.lock();
+    }
+
+    const auto idx = _free_bufs[SEND_BUF_SIZE - _send_buf_size - 1];
     const auto body_size = this->_config.body_size;
     const auto header_size = this->_config.header_size;
-    for (size_t i = 0; i < _dev_num; i++)
-      std::memcpy(&_send_buf[_send_buf_cursor][(header_size + body_size) * i], &buf[header_size + body_size * i], body_size);
-    for (size_t i = 0; i < _dev_num; i++) std::memcpy(&_send_buf[_send_buf_cursor][(header_size + body_size) * i + body_size], &buf[0], header_size);
+    for (size_t i = 0; i < _dev_num; i++) std::memcpy(&_send_buf[idx][(header_size + body_size) * i], &buf[header_size + body_size * i], body_size);
+    for (size_t i = 0; i < _dev_num; i++) std::memcpy(&_send_buf[idx][(header_size + body_size) * i + body_size], &buf[0], header_size);
+    _replaceable[idx] = policy == core::SendPolicy::LatestWinsFirst || policy == core::SendPolicy::LatestWins;
+    if constexpr (core::trace::ENABLED) _enqueued_at[idx] = core::trace::now();
+
+    if (policy == core::SendPolicy::Urgent || policy == core::SendPolicy::Preempt) {
+      // after the urgent and preempting frames already queued, before all the others
+      for (auto i = _send_buf_size; i > _urgent_size; i--) _send_order[i] = _send_order[i - 1];
+      _send_order[_urgent_size++] = idx;
+    } else {
+      _send_order[_send_buf_size] = idx;
+    }
     _send_buf_size++;
-    _send_buf_cursor = (_send_buf_cursor + 1) % SEND_BUF_SIZE;
   }
 
   _send_cond.notify_one();
 }
 
-void SOEMController::read(uint8_t* rx) const {
+uint64_t SOEMController::read(uint8_t* rx) const {
   if (!_is_open) throw core::exception::LinkError("link is closed");
-  std::memcpy(rx, &_io_map[this->_output_size], this->_dev_num * this->_config.input_frame_size);
+  return this->_inputs.read(rx);
+}
+
+uint64_t SOEMController::dc_time() const { return _dc_time.load(std::memory_order_relaxed); }
+
+void SOEMController::setup_sync0(const uint16_t slave, const bool activate, const uint16_t freq_cycle) {
+  const uint32_t cycle_time_ns = core::FPGA_BASE_CLK_PERIOD_NS * freq_cycle * 40;
+  ec_dcsync0(slave, activate, cycle_time_ns, 0);
 }
 
 void SOEMController::setup_sync0(const bool activate, const std::vector<uint16_t>& freq_cycles) const {
+  for (size_t slave = 1; slave <= _dev_num; slave++) setup_sync0(static_cast<uint16_t>(slave), activate, freq_cycles[slave - 1]);
+}
+
+void SOEMController::set_freq_cycles(const std::vector<uint16_t>& freq_cycles) {
+  if (!_is_open) throw core::exception::LinkError("link is closed");
+  if (freq_cycles.size() != _dev_num) throw core::exception::LinkError("The number of frequency cycles does not match the number of devices");
+
+  std::unique_lock lk(_check_mtx);
   for (size_t slave = 1; slave <= _dev_num; slave++) {
-    const uint32_t cycle_time_ns = core::FPGA_BASE_CLK_PERIOD_NS * freq_cycles[slave - 1] * 40;
-    ec_dcsync0(static_cast<uint16_t>(slave), activate, cycle_time_ns, 0);
+    if (freq_cycles[slave - 1] == _freq_cycles[slave - 1]) continue;
+    setup_sync0(static_cast<uint16_t>(slave), true, freq_cycles[slave - 1]);
+    _freq_cycles[slave - 1] = freq_cycles[slave - 1];
   }
 }
 
@@ -80,8 +147,15 @@ void SOEMController::open(const char* ifname, const size_t dev_num, const ECConf
   const auto output_size = (header_size + body_size) * _dev_num;
   _output_size = output_size;
 
+#ifndef __linux__
+  if (config.packet_mmap) throw core::exception::LinkError("PACKET_MMAP is supported only on Linux");
+#endif
+
   this->_send_buf = std::make_unique<std::unique_ptr<uint8_t[]>[]>(SEND_BUF_SIZE);
   for (size_t i = 0; i < SEND_BUF_SIZE; i++) this->_send_buf[i] = std::make_unique<uint8_t[]>(output_size);
+  for (size_t i = 0; i < SEND_BUF_SIZE; i++) this->_free_bufs[i] = i;
+  this->_send_buf_size = 0;
+  this->_urgent_size = 0;
 
   if (const auto size = _output_size + config.input_frame_size * _dev_num; size != _io_map_size) {
     _io_map_size = size;
@@ -107,6 +181,19 @@ void SOEMController::open(const char* ifname, const size_t dev_num, const ECConf
 
   ec_config_map(&_io_map[0]);
 
+  // The slaves with the ESI older than firmware v0.6 map only the ack, and are accepted without the other statuses
+  std::vector<size_t> input_sizes;
+  for (uint16_t slave = 1; slave <= static_cast<uint16_t>(wc); slave++) {
+    const auto ibytes = static_cast<size_t>(ec_slave[slave].Ibytes);
+    if (ibytes != config.input_frame_size && ibytes != core::EC_LEGACY_INPUT_FRAME_SIZE) {
+      std::stringstream ss;
+      ss << "The input of slave " << slave << " is " << ibytes << " bytes, but " << config.input_frame_size << " or "
+         << core::EC_LEGACY_INPUT_FRAME_SIZE << " bytes are expected.";
+      throw core::exception::LinkError(ss.str());
+    }
+    input_sizes.emplace_back(ibytes);
+  }
+
   ec_configdc();
 
   ec_statecheck(0, EC_STATE_SAFE_OP, EC_TIMEOUTSTATE * 4);
@@ -128,25 +215,53 @@ void SOEMController::open(const char* ifname, const size_t dev_num, const ECConf
 
   const auto expected_wkc = ec_group[0].outputsWKC * 2 + ec_group[0].inputsWKC;
   const auto interval_us = config.ec_sm3_cycle_time_ns / 1000;
-  this->_timer = core::Timer<SOEMCallback>::start(std::make_unique<SOEMCallback>(
-                                                      expected_wkc, [this]() { return this->error_handle(); }, &this->_sent),
-                                                  interval_us);
+  std::unique_ptr<ProcessData> process_data = nullptr;
+#ifdef __linux__
+  if (config.packet_mmap) {
+    std::vector<size_t> boundaries;
+    for (uint16_t slave = 1; slave <= static_cast<uint16_t>(wc); slave++) {
+      boundaries.emplace_back(static_cast<size_t>(ec_slave[slave].outputs - &_io_map[0]));
+      boundaries.emplace_back(static_cast<size_t>(ec_slave[slave].inputs - &_io_map[0]));
+    }
+    const auto image_size = std::accumulate(input_sizes.begin(), input_sizes.end(), _output_size);
+    const auto dc_slave_address = ec_group[0].hasdc ? ec_slave[ec_group[0].DCnext].configadr : static_cast<uint16_t>(0);
+    process_data = std::make_unique<ProcessData>(create_packet_mmap_nic(ifname), &_io_map[0], _output_size, image_size, std::move(boundaries),
+                                                 ec_group[0].logstartaddr, dc_slave_address);
+  }
+#endif
+  this->_fault.store(false);
+  this->_inputs.resize(config.input_frame_size * _dev_num);
+  this->_timer = core::Timer<SOEMCallback>::start(
+      std::make_unique<SOEMCallback>(expected_wkc, &this->_fault, &this->_sent, &this->_io_map[this->_output_size], std::move(input_sizes),
+                                     config.input_frame_size, &this->_inputs, &this->_dc_time, std::move(process_data)),
+      interval_us);
 
   _is_open = true;
+  this->_check_thread = std::thread([this] { this->supervise(); });
   this->_send_thread = std::thread([this]() {
+    [[maybe_unused]] uint8_t msg_id = 0;
+    [[maybe_unused]] uint64_t copied_at = 0;
     while (this->_is_open) {
       {
         std::unique_lock lock(this->_send_mtx);
         if (this->_send_buf_size == 0) this->_send_cond.wait(lock, [this] { return !this->_is_open || this->_send_buf_size != 0; });
         if (!this->_is_open) return;
-        const auto idx = this->_send_buf_cursor >= this->_send_buf_size ? this->_send_buf_cursor - this->_send_buf_size
-                                                                        : this->_send_buf_cursor + SEND_BUF_SIZE - this->_send_buf_size;
+        const auto idx = this->_send_order[0];
         std::memcpy(this->_io_map.get(), this->_send_buf[idx].get(), this->_output_size);
+        if constexpr (core::trace::ENABLED) {
+          msg_id = this->_send_buf[idx][this->_config.body_size];
+          copied_at = core::trace::now();
+          core::trace::span(core::trace::Stage::SendQueue, msg_id, this->_enqueued_at[idx], copied_at);
+        }
+        for (size_t i = 1; i < this->_send_buf_size; i++) this->_send_order[i - 1] = this->_send_order[i];
         this->_send_buf_size--;
+        this->_free_bufs[SEND_BUF_SIZE - this->_send_buf_size - 1] = idx;
+        if (this->_urgent_size > 0) this->_urgent_size--;
       }
       this->_sent.store(false, std::memory_order_release);
       while (this->_is_open && !this->_sent.load(std::memory_order_acquire))
         std::this_thread::sleep_for(std::chrono::milliseconds(this->_config.ec_sm3_cycle_time_ns / 1000 / 1000));
+      core::trace::span(core::trace::Stage::ProcessData, msg_id, copied_at);
     }
   });
 }
@@ -162,6 +277,11 @@ void SOEMController::close() {
 
   this->_send_cond.notify_one();
   if (this->_send_thread.joinable()) this->_send_thread.join();
+  {
+    std::unique_lock lk(_check_mtx);
+    this->_check_cond.notify_one();
+  }
+  if (this->_check_thread.joinable()) this->_check_thread.join();
 
   const auto _ = this->_timer->stop();
 
@@ -176,9 +296,20 @@ void SOEMController::close() {
   _io_map_size = 0;
 }
 
+void SOEMController::supervise() {
+  std::unique_lock lk(_check_mtx);
+  while (this->_is_open) {
+    this->_check_cond.wait_for(lk, std::chrono::milliseconds(EC_CHECK_INTERVAL_MS));
+    if (!this->_is_open) return;
+    if (this->_fault.exchange(false, std::memory_order_acquire) || ec_group[0].docheckstate) error_handle();
+  }
+}
+
+// Returns whether all the slaves are operational. A lost slave is reported once, and its recovery is retried at the next check.
 bool SOEMController::error_handle() {
   ec_group[0].docheckstate = 0;
   ec_readstate();
+  auto lost = false;
   std::stringstream ss;
   for (uint16_t slave = 1; slave <= static_cast<uint16_t>(ec_slavecount); slave++) {
     if (ec_slave[slave].state != EC_STATE_OPERATIONAL) {
@@ -194,12 +325,14 @@ bool SOEMController::error_handle() {
       } else if (ec_slave[slave].state > EC_STATE_NONE) {
         if (ec_reconfig_slave(slave, 500)) {
           ec_slave[slave].islost = 0;
+          setup_sync0(slave, true, _freq_cycles[slave - 1]);
           ss << "MESSAGE : slave " << slave << " reconfigured\n";
         }
       } else if (!ec_slave[slave].islost) {
         ec_statecheck(slave, EC_STATE_OPERATIONAL, EC_TIMEOUTRET);
         if (ec_slave[slave].state == EC_STATE_NONE) {
           ec_slave[slave].islost = 1;
+          lost = true;
           ss << "ERROR : slave " << slave << " lost\n";
         }
       }
@@ -208,6 +341,7 @@ bool SOEMController::error_handle() {
       if (ec_slave[slave].state == EC_STATE_NONE) {
         if (ec_recover_slave(slave, 500)) {
           ec_slave[slave].islost = 0;
+          setup_sync0(slave, true, _freq_cycles[slave - 1]);
           ss << "MESSAGE : slave " << slave << " recovered\n";
         }
       } else {
@@ -216,15 +350,26 @@ bool SOEMController::error_handle() {
       }
     }
   }
-  if (!ec_group[0].docheckstate) return true;
-
-  this->_is_open = false;
-  if (_on_lost != nullptr) _on_lost(ss.str());
-  return false;
+  if (lost && _on_lost != nullptr) _on_lost(ss.str());
+  return !ec_group[0].docheckstate;
 }
 
 SOEMController::SOEMController()
-    : _io_map(nullptr), _io_map_size(0), _output_size(0), _dev_num(0), _config(), _is_open(false), _send_buf_cursor(0), _send_buf_size(0) {}
+    : _fault(false),
+      _io_map(nullptr),
+      _io_map_size(0),
+      _output_size(0),
+      _dev_num(0),
+      _config(),
+      _is_open(false),
+      _send_order(),
+      _free_bufs(),
+      _replaceable(),
+      _enqueued_at(),
+      _send_buf_size(0),
+      _urgent_size(0),
+      _sent(false),
+      _dc_time(0) {}
 
 SOEMController::~SOEMController() {
   try {
@@ -3,7 +3,7 @@
 // Created Date: 08/03/2021
 // Author: Shun Suzuki
 // -----
-// Last Modified: 09/10/2021
+// Last Modified: 19/10/2026
 // Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
 // -----
 // Copyright (c) 2021 Hapis Lab. All rights reserved.
@@ -11,19 +11,34 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <condition_variable>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
+#include "autd3-freq-shift/core/input_snapshot.hpp"
+#include "autd3-freq-shift/core/link.hpp"
 #include "autd3-freq-shift/core/osal_timer.hpp"
+#include "autd3-freq-shift/core/trace.hpp"
+#include "process_data.hpp"
 
 namespace autd::autdsoem {
 
+/**
+ * @brief Cyclic task which exchanges the process data
+ * @details The task never blocks on a fault. If the working counter does not match, it only raises the fault flag, which is handled by the
+ * supervisor thread of SOEMController, and keeps transmitting to the healthy slaves.
+ * The received input image is published to an InputSnapshot every cycle. The inputs of the slaves whose TxPDO is mapped to less than
+ * input_frame_size bytes, i.e., those with the firmware older than v0.6, are padded with zeros, so that their statuses other than the ack are 0.
+ * If process_data is given, the process data are exchanged through it instead of the NIC layer of SOEM.
+ */
 struct SOEMCallback final : core::CallbackHandler {
   virtual ~SOEMCallback() = default;
   SOEMCallback(const SOEMCallback& v) noexcept = delete;
@@ -31,16 +46,42 @@ struct SOEMCallback final : core::CallbackHandler {
   SOEMCallback(SOEMCallback&& obj) = delete;
   SOEMCallback& operator=(SOEMCallback&& obj) = delete;
 
-  explicit SOEMCallback(const int expected_wkc, std::function<bool()> error_handler, std::atomic<bool>* sent)
-      : _rt_lock(false), _expected_wkc(expected_wkc), _error_handler(std::move(error_handler)), _sent(sent) {}
+  explicit SOEMCallback(const int expected_wkc, std::atomic<bool>* fault, std::atomic<bool>* sent, const uint8_t* input,
+                        std::vector<size_t> input_sizes, const size_t input_frame_size, core::InputSnapshot* inputs, std::atomic<uint64_t>* dc_time,
+                        std::unique_ptr<ProcessData> process_data)
+      : _rt_lock(false),
+        _expected_wkc(expected_wkc),
+        _fault(fault),
+        _sent(sent),
+        _input(input),
+        _input_sizes(std::move(input_sizes)),
+        _input_frame_size(input_frame_size),
+        _padded(std::any_of(_input_sizes.begin(), _input_sizes.end(), [input_frame_size](const size_t size) { return size != input_frame_size; })
+                    ? std::vector<uint8_t>(_input_sizes.size() * input_frame_size, 0)
+                    : std::vector<uint8_t>{}),
+        _inputs(inputs),
+        _dc_time(dc_time),
+        _process_data(std::move(process_data)) {}
 
   void callback() override;
 
  private:
+  void send_processdata();
+  int receive_processdata();
+  [[nodiscard]] const uint8_t* pad_inputs();
+  [[nodiscard]] uint64_t dc_time() const;
+
   std::atomic<bool> _rt_lock;
   int _expected_wkc;
-  std::function<bool()> _error_handler;
+  std::atomic<bool>* _fault;
   std::atomic<bool>* _sent;
+  const uint8_t* _input;
+  std::vector<size_t> _input_sizes;  // size of the inputs of each slave mapped by ec_config_map
+  size_t _input_frame_size;
+  std::vector<uint8_t> _padded;  // empty if the inputs of all the slaves are of input_frame_size
+  core::InputSnapshot* _inputs;
+  std::atomic<uint64_t>* _dc_time;
+  std::unique_ptr<ProcessData> _process_data;
 };
 
 struct ECConfig {
@@ -49,10 +90,16 @@ struct ECConfig {
   size_t header_size;
   size_t body_size;
   size_t input_frame_size;
+  bool packet_mmap;  //!< exchange the process data through PACKET_MMAP rings (Linux only)
 };
 
 constexpr size_t SEND_BUF_SIZE = 32;
 
+/**
+ * @brief Interval of the state check by the supervisor thread, if no fault is reported
+ */
+constexpr uint32_t EC_CHECK_INTERVAL_MS = 100;
+
 class SOEMController {
  public:
   SOEMController();
@@ -64,33 +111,56 @@ class SOEMController {
 
   void open(const char* ifname, size_t dev_num, ECConfig config, const std::vector<uint16_t>& freq_cycles);
   void on_lost(std::function<void(std::string)> callback);
+  void set_freq_cycles(const std::vector<uint16_t>& freq_cycles);
   void close();
 
   [[nodiscard]] bool is_open() const;
 
-  void send(const uint8_t* buf, size_t size);
-  void read(uint8_t* rx) const;
+  void send(const uint8_t* buf, size_t size, core::SendPolicy policy);
+  /**
+   * @brief Copy a consistent snapshot of the input process data without blocking the cyclic task
+   * @return the number of the cycle in which the snapshot was received
+   */
+  uint64_t read(uint8_t* rx) const;
+  /**
+   * @brief System time of the distributed clocks in ns, which is received in the latest cycle
+   */
+  [[nodiscard]] uint64_t dc_time() const;
 
  private:
   void setup_sync0(bool activate, const std::vector<uint16_t>& freq_cycles) const;
+  static void setup_sync0(uint16_t slave, bool activate, uint16_t freq_cycle);
 
+  // The supervisor thread owns the state check and the recovery of the slaves, which may block for hundreds of milliseconds
+  void supervise();
   bool error_handle();
   std::function<void(std::string)> _on_lost = nullptr;
+  std::atomic<bool> _fault;
+  std::mutex _check_mtx;
+  std::condition_variable _check_cond;
+  std::thread _check_thread;
 
   std::unique_ptr<uint8_t[]> _io_map;
+  core::InputSnapshot _inputs;
   size_t _io_map_size;
   size_t _output_size;
   size_t _dev_num;
   ECConfig _config;
   bool _is_open;
 
+  // frames waiting for the cycle. _send_order holds the indices of _send_buf in order of transmission, and urgent frames are at its head.
   std::unique_ptr<std::unique_ptr<uint8_t[]>[]> _send_buf;
-  size_t _send_buf_cursor;
+  std::array<size_t, SEND_BUF_SIZE> _send_order;
+  std::array<size_t, SEND_BUF_SIZE> _free_bufs;
+  std::array<bool, SEND_BUF_SIZE> _replaceable;
+  std::array<uint64_t, SEND_BUF_SIZE> _enqueued_at;  // only used if tracing is enabled
   size_t _send_buf_size;
+  size_t _urgent_size;
   std::mutex _send_mtx;
   std::condition_variable _send_cond;
   std::thread _send_thread;
   std::atomic<bool> _sent;
+  std::atomic<uint64_t> _dc_time;
 
   std::vector<uint16_t> _freq_cycles;
 
@@ -0,0 +1,190 @@
+// File: nic.cpp
+// Project: soem
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#include "nic.hpp"
+
+#include <arpa/inet.h>
+#include <linux/if_packet.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "autd3-freq-shift/core/exception.hpp"
+
+namespace autd::autdsoem {
+
+namespace {
+
+int open_packet_socket() {
+  const auto fd = socket(PF_PACKET, SOCK_RAW, htons(ETHERTYPE_ECAT));
+  if (fd < 0) throw core::exception::LinkError("Failed to open a packet socket: " + std::string(std::strerror(errno)));
+  return fd;
+}
+
+void bind_packet_socket(const int fd, const std::string& ifname) {
+  sockaddr_ll addr{};
+  addr.sll_family = AF_PACKET;
+  addr.sll_protocol = htons(ETHERTYPE_ECAT);
+  addr.sll_ifindex = static_cast<int>(if_nametoindex(ifname.c_str()));
+  if (addr.sll_ifindex == 0 || bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) != 0) {
+    close(fd);
+    throw core::exception::LinkError("Failed to bind a packet socket to " + ifname);
+  }
+}
+
+timespec to_timespec(const std::chrono::nanoseconds ns) {
+  const auto s = std::chrono::duration_cast<std::chrono::seconds>(ns);
+  return {static_cast<time_t>(s.count()), static_cast<long>((ns - s).count())};
+}
+
+class SocketNic final : public Nic {
+ public:
+  explicit SocketNic(const std::string& ifname) : Nic(), _fd(open_packet_socket()) {
+    // SOEM polls the socket with a receive timeout of 1 us
+    timeval timeout{0, 1};
+    setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+    bind_packet_socket(_fd, ifname);
+  }
+  ~SocketNic() override { close(_fd); }
+  SocketNic(const SocketNic& v) = delete;
+  SocketNic& operator=(const SocketNic& obj) = delete;
+  SocketNic(SocketNic&& obj) = delete;
+  SocketNic& operator=(SocketNic&& obj) = delete;
+
+  uint8_t* frame_buffer() override { return _tx.data(); }
+
+  void send(const size_t len) override { ::send(_fd, _tx.data(), len, 0); }
+
+  void flush() override {}
+
+  bool receive(const std::function<bool(const uint8_t*, size_t)>& handler, const uint32_t timeout_us) override {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout_us);
+    do {
+      sockaddr_ll addr{};
+      socklen_t addr_len = sizeof addr;
+      const auto len = recvfrom(_fd, _rx.data(), _rx.size(), 0, reinterpret_cast<sockaddr*>(&addr), &addr_len);
+      if (len > 0 && addr.sll_pkttype != PACKET_OUTGOING && handler(_rx.data(), static_cast<size_t>(len))) return true;
+    } while (std::chrono::steady_clock::now() < deadline);
+    return false;
+  }
+
+ private:
+  int _fd;
+  std::array<uint8_t, ETH_FRAME_MAX_SIZE> _tx{};
+  std::array<uint8_t, ETH_FRAME_MAX_SIZE> _rx{};
+};
+
+class PacketMmapNic final : public Nic {
+ public:
+  static constexpr uint32_t FRAME_SIZE = 2048;
+  static constexpr uint32_t BLOCK_SIZE = 4096;
+  static constexpr uint32_t NUM_FRAMES = 128;
+  static constexpr size_t DATA_OFFSET = TPACKET2_HDRLEN - sizeof(sockaddr_ll);
+
+  explicit PacketMmapNic(const std::string& ifname) : Nic(), _fd(open_packet_socket()) {
+    bind_packet_socket(_fd, ifname);
+    // TPACKET_V3 delivers the frames block by block, and a block which is not full is retired only after a timeout in ms,
+    // which is too long for the cycle, so that the frame-based TPACKET_V2 is used
+    constexpr int version = TPACKET_V2;
+    constexpr int bypass = 1;
+    tpacket_req req{BLOCK_SIZE, NUM_FRAMES * FRAME_SIZE / BLOCK_SIZE, FRAME_SIZE, NUM_FRAMES};
+    if (setsockopt(_fd, SOL_PACKET, PACKET_VERSION, &version, sizeof version) != 0 ||
+        setsockopt(_fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof req) != 0 || setsockopt(_fd, SOL_PACKET, PACKET_TX_RING, &req, sizeof req) != 0) {
+      close(_fd);
+      throw core::exception::LinkError("Failed to set up PACKET_MMAP rings: " + std::string(std::strerror(errno)));
+    }
+    setsockopt(_fd, SOL_PACKET, PACKET_QDISC_BYPASS, &bypass, sizeof bypass);
+
+    auto* ring = mmap(nullptr, 2 * RING_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, 0);
+    if (ring == MAP_FAILED) {
+      close(_fd);
+      throw core::exception::LinkError("Failed to map PACKET_MMAP rings: " + std::string(std::strerror(errno)));
+    }
+    _rx_ring = static_cast<uint8_t*>(ring);
+    _tx_ring = _rx_ring + RING_SIZE;
+  }
+  ~PacketMmapNic() override {
+    munmap(_rx_ring, 2 * RING_SIZE);
+    close(_fd);
+  }
+  PacketMmapNic(const PacketMmapNic& v) = delete;
+  PacketMmapNic& operator=(const PacketMmapNic& obj) = delete;
+  PacketMmapNic(PacketMmapNic&& obj) = delete;
+  PacketMmapNic& operator=(PacketMmapNic&& obj) = delete;
+
+  uint8_t* frame_buffer() override {
+    auto* hdr = tx_header();
+    // the slot is in use only if the kernel has not transmitted the frame of NUM_FRAMES frames before
+    while (status(hdr) & (TP_STATUS_SEND_REQUEST | TP_STATUS_SENDING)) std::this_thread::yield();
+    return reinterpret_cast<uint8_t*>(hdr) + DATA_OFFSET;
+  }
+
+  void send(const size_t len) override {
+    auto* hdr = tx_header();
+    hdr->tp_len = static_cast<uint32_t>(len);
+    __atomic_store_n(&hdr->tp_status, TP_STATUS_SEND_REQUEST, __ATOMIC_RELEASE);
+    _tx_idx = (_tx_idx + 1) % NUM_FRAMES;
+  }
+
+  void flush() override { sendto(_fd, nullptr, 0, MSG_DONTWAIT, nullptr, 0); }
+
+  bool receive(const std::function<bool(const uint8_t*, size_t)>& handler, const uint32_t timeout_us) override {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::microseconds(timeout_us);
+    while (true) {
+      auto* hdr = reinterpret_cast<tpacket2_hdr*>(_rx_ring + _rx_idx * FRAME_SIZE);
+      if (status(hdr) & TP_STATUS_USER) {
+        const auto* addr = reinterpret_cast<const sockaddr_ll*>(reinterpret_cast<const uint8_t*>(hdr) + TPACKET_ALIGN(sizeof(tpacket2_hdr)));
+        const auto done = addr->sll_pkttype != PACKET_OUTGOING && handler(reinterpret_cast<const uint8_t*>(hdr) + hdr->tp_mac, hdr->tp_snaplen);
+        __atomic_store_n(&hdr->tp_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        _rx_idx = (_rx_idx + 1) % NUM_FRAMES;
+        if (done) return true;
+        continue;
+      }
+
+      const auto remaining = deadline - std::chrono::steady_clock::now();
+      if (remaining <= std::chrono::nanoseconds::zero()) return false;
+      pollfd pfd{_fd, POLLIN, 0};
+      const auto timeout = to_timespec(remaining);
+      ppoll(&pfd, 1, &timeout, nullptr);
+    }
+  }
+
+ private:
+  static constexpr size_t RING_SIZE = static_cast<size_t>(NUM_FRAMES) * FRAME_SIZE;
+
+  static uint32_t status(tpacket2_hdr* hdr) { return __atomic_load_n(&hdr->tp_status, __ATOMIC_ACQUIRE); }
+  tpacket2_hdr* tx_header() const { return reinterpret_cast<tpacket2_hdr*>(_tx_ring + _tx_idx * FRAME_SIZE); }
+
+  int _fd;
+  uint8_t* _rx_ring = nullptr;
+  uint8_t* _tx_ring = nullptr;
+  size_t _rx_idx = 0;
+  size_t _tx_idx = 0;
+};
+
+}  // namespace
+
+std::unique_ptr<Nic> create_socket_nic(const std::string& ifname) { return std::make_unique<SocketNic>(ifname); }
+
+std::unique_ptr<Nic> create_packet_mmap_nic(const std::string& ifname) { return std::make_unique<PacketMmapNic>(ifname); }
+
+}  // namespace autd::autdsoem
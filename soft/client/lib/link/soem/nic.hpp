@@ -0,0 +1,70 @@
+// File: nic.hpp
+// Project: soem
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+namespace autd::autdsoem {
+
+constexpr uint16_t ETHERTYPE_ECAT = 0x88A4;
+constexpr size_t ETH_FRAME_MAX_SIZE = 1514;
+
+/**
+ * @brief Raw Ethernet interface used for the cyclic exchange of the process data (Linux only)
+ * @details Frames are written in place into frame_buffer(), queued by send() and transmitted together by flush().
+ * Received EtherCAT frames are passed to the handler in place, excluding the frames transmitted from this host.
+ */
+class Nic {
+ public:
+  Nic() = default;
+  virtual ~Nic() = default;
+  Nic(const Nic& v) = delete;
+  Nic& operator=(const Nic& obj) = delete;
+  Nic(Nic&& obj) = delete;
+  Nic& operator=(Nic&& obj) = delete;
+
+  /**
+   * @brief Buffer of ETH_FRAME_MAX_SIZE bytes for the next frame
+   */
+  virtual uint8_t* frame_buffer() = 0;
+  /**
+   * @brief Queue the frame written in frame_buffer()
+   */
+  virtual void send(size_t len) = 0;
+  /**
+   * @brief Transmit the queued frames
+   */
+  virtual void flush() = 0;
+  /**
+   * @brief Pass the received frames to handler until it returns true, or timeout_us elapses
+   * @return whether handler returned true
+   */
+  virtual bool receive(const std::function<bool(const uint8_t*, size_t)>& handler, uint32_t timeout_us) = 0;
+};
+
+/**
+ * @brief Packet socket with a send and a recv system call per frame, in the same way as the NIC layer of SOEM
+ */
+std::unique_ptr<Nic> create_socket_nic(const std::string& ifname);
+
+/**
+ * @brief Packet socket with PACKET_MMAP rings, through which the frames are written and read in place
+ * @details All the frames of a cycle are transmitted by one system call, and the received frames are read without any system call
+ * if they have already arrived. The transmission bypasses the qdisc of the interface.
+ */
+std::unique_ptr<Nic> create_packet_mmap_nic(const std::string& ifname);
+
+}  // namespace autd::autdsoem
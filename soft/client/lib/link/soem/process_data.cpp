@@ -0,0 +1,135 @@
+// File: process_data.cpp
+// Project: soem
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#include "process_data.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "autd3-freq-shift/core/exception.hpp"
+
+namespace autd::autdsoem {
+
+namespace {
+constexpr size_t DATAGRAM_OFFSET = ETH_HEADER_SIZE + EC_HEADER_SIZE;
+constexpr size_t DATA_OFFSET = DATAGRAM_OFFSET + EC_DATAGRAM_HEADER_SIZE;
+constexpr uint16_t EC_DATAGRAM_FOLLOWS = 1 << 15;
+constexpr uint16_t EC_HEADER_TYPE_DATAGRAM = 1 << 12;
+
+void put16(uint8_t* dst, const uint16_t v) {
+  dst[0] = static_cast<uint8_t>(v);
+  dst[1] = static_cast<uint8_t>(v >> 8);
+}
+
+void put32(uint8_t* dst, const uint32_t v) {
+  put16(dst, static_cast<uint16_t>(v));
+  put16(dst + 2, static_cast<uint16_t>(v >> 16));
+}
+
+uint16_t get16(const uint8_t* src) { return static_cast<uint16_t>(src[0] | src[1] << 8); }
+
+void put_datagram_header(uint8_t* dst, const uint8_t cmd, const uint8_t idx, const uint32_t address, const size_t size, const bool follows) {
+  dst[0] = cmd;
+  dst[1] = idx;
+  put32(dst + 2, address);
+  put16(dst + 6, static_cast<uint16_t>(size | (follows ? EC_DATAGRAM_FOLLOWS : 0)));
+  put16(dst + 8, 0);
+}
+}  // namespace
+
+ProcessData::ProcessData(std::unique_ptr<Nic> nic, uint8_t* io_map, const size_t output_size, const size_t image_size, std::vector<size_t> boundaries,
+                         const uint32_t logical_address, const uint16_t dc_slave_address)
+    : _nic(std::move(nic)),
+      _io_map(io_map),
+      _output_size(output_size),
+      _logical_address(logical_address),
+      _dc_slave_address(dc_slave_address),
+      _index_base(PD_INDEX_BASE),
+      _num_received(0),
+      _wkc(0),
+      _dc_time(0) {
+  boundaries.emplace_back(image_size);
+  std::sort(boundaries.begin(), boundaries.end());
+  boundaries.erase(std::unique(boundaries.begin(), boundaries.end()), boundaries.end());
+
+  for (size_t offset = 0, b = 0; offset < image_size;) {
+    const auto max_size = EC_MAX_DATAGRAM_DATA - (has_dc(_chunks.size()) ? EC_DC_DATAGRAM_SIZE : 0);
+    auto end = offset;
+    for (; b < boundaries.size() && boundaries[b] - offset <= max_size; b++) end = std::max(end, boundaries[b]);
+    if (end == offset) throw core::exception::LinkError("The process data of a slave does not fit in a frame");
+    _chunks.emplace_back(Chunk{offset, end - offset});
+    offset = end;
+  }
+  if (_chunks.size() > PD_MAX_FRAMES) throw core::exception::LinkError("The process data are too large to be exchanged in a cycle");
+  _received.resize(_chunks.size());
+}
+
+size_t ProcessData::frame_size(const size_t chunk) const noexcept {
+  const auto size = DATA_OFFSET + _chunks[chunk].size + EC_WKC_SIZE + (has_dc(chunk) ? EC_DC_DATAGRAM_SIZE : 0);
+  return std::max(size, ETH_MIN_FRAME_SIZE);
+}
+
+void ProcessData::send() {
+  _index_base = _index_base == PD_INDEX_BASE ? static_cast<uint8_t>(PD_INDEX_BASE + PD_MAX_FRAMES) : PD_INDEX_BASE;
+  for (size_t i = 0; i < _chunks.size(); i++) {
+    const auto& [offset, size] = _chunks[i];
+    auto* frame = _nic->frame_buffer();
+    const auto len = frame_size(i);
+    std::memset(frame, 0, len);
+
+    std::memset(frame, 0xFF, 6);  // broadcast
+    std::memset(frame + 6, 0x01, 6);
+    frame[12] = static_cast<uint8_t>(ETHERTYPE_ECAT >> 8);
+    frame[13] = static_cast<uint8_t>(ETHERTYPE_ECAT);
+    const auto datagrams_size = EC_DATAGRAM_HEADER_SIZE + size + EC_WKC_SIZE + (has_dc(i) ? EC_DC_DATAGRAM_SIZE : 0);
+    put16(frame + ETH_HEADER_SIZE, static_cast<uint16_t>(datagrams_size | EC_HEADER_TYPE_DATAGRAM));
+
+    const auto idx = static_cast<uint8_t>(_index_base + i);
+    put_datagram_header(frame + DATAGRAM_OFFSET, EC_CMD_LRW, idx, _logical_address + static_cast<uint32_t>(offset), size, has_dc(i));
+    std::memcpy(frame + DATA_OFFSET, _io_map + offset, size);
+    if (has_dc(i)) {
+      auto* dc = frame + DATA_OFFSET + size + EC_WKC_SIZE;
+      put_datagram_header(dc, EC_CMD_FRMW, idx, static_cast<uint32_t>(_dc_slave_address) | static_cast<uint32_t>(EC_REG_DCSYSTIME) << 16,
+                          sizeof(int64_t), false);
+    }
+    _nic->send(len);
+  }
+  _nic->flush();
+
+  std::fill(_received.begin(), _received.end(), false);
+  _num_received = 0;
+  _wkc = 0;
+}
+
+int ProcessData::receive(const uint32_t timeout_us) {
+  _nic->receive([this](const uint8_t* frame, const size_t len) { return this->on_frame(frame, len); }, timeout_us);
+  return _num_received == _chunks.size() ? _wkc : -1;
+}
+
+bool ProcessData::on_frame(const uint8_t* frame, const size_t len) {
+  if (len < DATA_OFFSET || frame[12] != static_cast<uint8_t>(ETHERTYPE_ECAT >> 8) || frame[13] != static_cast<uint8_t>(ETHERTYPE_ECAT) ||
+      frame[DATAGRAM_OFFSET] != EC_CMD_LRW)
+    return false;
+  const auto i = static_cast<size_t>(static_cast<uint8_t>(frame[DATAGRAM_OFFSET + 1] - _index_base));
+  if (i >= _chunks.size() || _received[i] || len < frame_size(i)) return false;
+
+  const auto& [offset, size] = _chunks[i];
+  if (const auto input_begin = std::max(offset, _output_size); input_begin < offset + size)
+    std::memcpy(_io_map + input_begin, frame + DATA_OFFSET + (input_begin - offset), offset + size - input_begin);
+  _wkc += get16(frame + DATA_OFFSET + size);
+  if (has_dc(i)) std::memcpy(&_dc_time, frame + DATA_OFFSET + size + EC_WKC_SIZE + EC_DATAGRAM_HEADER_SIZE, sizeof(int64_t));
+
+  _received[i] = true;
+  return ++_num_received == _chunks.size();
+}
+
+}  // namespace autd::autdsoem
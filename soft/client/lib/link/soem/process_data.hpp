@@ -0,0 +1,102 @@
+// File: process_data.hpp
+// Project: soem
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "nic.hpp"
+
+namespace autd::autdsoem {
+
+constexpr uint8_t EC_CMD_LRW = 0x0C;
+constexpr uint8_t EC_CMD_FRMW = 0x0E;
+constexpr uint16_t EC_REG_DCSYSTIME = 0x0910;
+
+constexpr size_t ETH_HEADER_SIZE = 14;
+constexpr size_t EC_HEADER_SIZE = 2;
+constexpr size_t EC_DATAGRAM_HEADER_SIZE = 10;
+constexpr size_t EC_WKC_SIZE = 2;
+constexpr size_t EC_MAX_DATAGRAM_DATA = 1486;
+constexpr size_t EC_DC_DATAGRAM_SIZE = EC_DATAGRAM_HEADER_SIZE + sizeof(int64_t) + EC_WKC_SIZE;
+constexpr size_t ETH_MIN_FRAME_SIZE = 60;
+
+/**
+ * @brief Datagram indices used by the cyclic exchange, which do not collide with the indices of SOEM (0 to EC_MAXBUF - 1)
+ * @details The indices of even and odd cycles differ, so that a frame which returns after the timeout is not mistaken for a frame of the next cycle.
+ */
+constexpr uint8_t PD_INDEX_BASE = 0x80;
+constexpr size_t PD_MAX_FRAMES = 32;
+
+/**
+ * @brief Cyclic exchange of the process data over a Nic, in place of ec_send_processdata and ec_receive_processdata
+ * @details The image mapped by ec_config_map, i.e., the outputs of all the slaves followed by their inputs, is exchanged by LRW datagrams.
+ * The image is split into frames only at the boundaries of the slaves, so that the working counter of each slave is counted once.
+ * If the group has a DC reference clock, its system time is read by FRMW in the first frame, as SOEM does.
+ */
+class ProcessData {
+ public:
+  /**
+   * @param nic interface on which the slaves are connected
+   * @param io_map image mapped by ec_config_map
+   * @param output_size size of the outputs of all the slaves, which are followed by the inputs in io_map
+   * @param image_size size of the outputs and the inputs of all the slaves
+   * @param boundaries offsets in io_map where the outputs or the inputs of each slave begin
+   * @param logical_address logical address of io_map
+   * @param dc_slave_address configured address of the DC reference clock, or 0 if the group has no distributed clocks
+   */
+  ProcessData(std::unique_ptr<Nic> nic, uint8_t* io_map, size_t output_size, size_t image_size, std::vector<size_t> boundaries,
+              uint32_t logical_address, uint16_t dc_slave_address);
+
+  /**
+   * @brief Transmit the current image
+   */
+  void send();
+  /**
+   * @brief Receive the frames transmitted by send(), and copy the inputs to the image
+   * @return working counter of the LRW datagrams, or -1 if any frame is not received in timeout_us
+   */
+  int receive(uint32_t timeout_us);
+
+  /**
+   * @brief System time of the DC reference clock read in the last cycle
+   */
+  [[nodiscard]] int64_t dc_time() const noexcept { return _dc_time; }
+  [[nodiscard]] size_t num_frames() const noexcept { return _chunks.size(); }
+
+ private:
+  struct Chunk {
+    size_t offset;
+    size_t size;
+  };
+
+  [[nodiscard]] bool has_dc(const size_t chunk) const noexcept { return chunk == 0 && _dc_slave_address != 0; }
+  [[nodiscard]] size_t frame_size(size_t chunk) const noexcept;
+  bool on_frame(const uint8_t* frame, size_t len);
+
+  std::unique_ptr<Nic> _nic;
+  uint8_t* _io_map;
+  size_t _output_size;
+  uint32_t _logical_address;
+  uint16_t _dc_slave_address;
+  std::vector<Chunk> _chunks;
+
+  uint8_t _index_base;
+  std::vector<bool> _received;
+  size_t _num_received;
+  int _wkc;
+  int64_t _dc_time;
+};
+
+}  // namespace autd::autdsoem
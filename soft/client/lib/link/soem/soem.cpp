@@ -3,7 +3,7 @@
 // Created Date: 08/03/2021
 // Author: Shun Suzuki
 // -----
-// Last Modified: 09/10/2021
+// Last Modified: 19/10/2026
 // Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
 // -----
 // Copyright (c) 2021 Hapis Lab. All rights reserved.
@@ -25,8 +25,8 @@ std::vector<EtherCATAdapter> SOEM::enumerate_adapters() {
 
 class SOEMImpl final : public SOEM {
  public:
-  SOEMImpl(std::string ifname, const size_t device_num, const uint32_t cycle_ticks)
-      : SOEM(), _device_num(device_num), _cycle_ticks(cycle_ticks), _ifname(std::move(ifname)), _config() {}
+  SOEMImpl(std::string ifname, const size_t device_num, const uint32_t cycle_ticks, const NicBackend backend)
+      : SOEM(), _device_num(device_num), _cycle_ticks(cycle_ticks), _backend(backend), _ifname(std::move(ifname)), _config() {}
   ~SOEMImpl() override = default;
   SOEMImpl(const SOEMImpl& v) noexcept = delete;
   SOEMImpl& operator=(const SOEMImpl& obj) = delete;
@@ -35,9 +35,12 @@ class SOEMImpl final : public SOEM {
 
  protected:
   void open(const core::LinkConfiguration& config) override;
+  void reconfigure(const core::LinkConfiguration& config) override;
   void close() override;
   void send(const uint8_t* buf, size_t size) override;
+  void send_with_policy(const uint8_t* buf, size_t size, core::SendPolicy policy) override;
   void read(uint8_t* rx, size_t buffer_len) override;
+  uint64_t dc_time() override;
   void on_lost(std::function<void(std::string)> callback) override;
   bool is_open() override;
 
@@ -45,12 +48,13 @@ class SOEMImpl final : public SOEM {
   autdsoem::SOEMController _cnt;
   size_t _device_num;
   uint32_t _cycle_ticks;
+  NicBackend _backend;
   std::string _ifname;
   autdsoem::ECConfig _config;
 };
 
-std::unique_ptr<SOEM> SOEM::create(const std::string& ifname, const size_t device_num, uint32_t cycle_ticks) {
-  return std::make_unique<SOEMImpl>(ifname, device_num, cycle_ticks);
+std::unique_ptr<SOEM> SOEM::create(const std::string& ifname, const size_t device_num, uint32_t cycle_ticks, const NicBackend backend) {
+  return std::make_unique<SOEMImpl>(ifname, device_num, cycle_ticks, backend);
 }
 
 void SOEMImpl::open(const core::LinkConfiguration& config) {
@@ -62,15 +66,22 @@ void SOEMImpl::open(const core::LinkConfiguration& config) {
   _config.header_size = core::HEADER_SIZE;
   _config.body_size = core::EC_OUTPUT_FRAME_SIZE - core::HEADER_SIZE;
   _config.input_frame_size = core::EC_INPUT_FRAME_SIZE;
+  _config.packet_mmap = _backend == NicBackend::PacketMmap;
 
   _cnt.open(_ifname.c_str(), _device_num, _config, config.freq_cycles);
 }
 
+void SOEMImpl::reconfigure(const core::LinkConfiguration& config) { _cnt.set_freq_cycles(config.freq_cycles); }
+
 void SOEMImpl::close() { return _cnt.close(); }
 
-void SOEMImpl::send(const uint8_t* buf, const size_t size) { return _cnt.send(buf, size); }
+void SOEMImpl::send(const uint8_t* buf, const size_t size) { return _cnt.send(buf, size, core::SendPolicy::Fifo); }
+
+void SOEMImpl::send_with_policy(const uint8_t* buf, const size_t size, const core::SendPolicy policy) { return _cnt.send(buf, size, policy); }
+
+void SOEMImpl::read(uint8_t* rx, size_t) { _cnt.read(rx); }
 
-void SOEMImpl::read(uint8_t* rx, size_t) { return _cnt.read(rx); }
+uint64_t SOEMImpl::dc_time() { return _cnt.dc_time(); }
 
 bool SOEMImpl::is_open() { return _cnt.is_open(); }
 
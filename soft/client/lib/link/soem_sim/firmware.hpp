@@ -0,0 +1,253 @@
+// File: firmware.hpp
+// Project: soem_sim
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "autd3-freq-shift/core/device_status.hpp"
+#include "autd3-freq-shift/core/hardware_defined.hpp"
+#include "cpu_version.h"
+
+namespace autd::sim {
+
+constexpr uint16_t FPGA_VERSION = 0xF006;
+
+/**
+ * @brief Model of the firmware of a device, which acknowledges the frames as recv_ethercat in cpu/src/app.c does
+ * @details The duties and phases are not simulated, but the status reported in the inputs (ack, ctrl flags, cycle and ack history) is.
+ * The inputs are those after the periodic update() of the firmware. example_soem_sim_conformance compares the model with the host build of
+ * cpu/src/app.c, which should be run after either is changed.
+ */
+class Firmware {
+ public:
+  static constexpr uint8_t CTRL_FLAG_SYNC0_LOAD = 1 << 3;
+  static constexpr uint64_t SYNC0_ALIGN_MARGIN_NS = 50000;
+
+  Firmware() { reset(); }
+
+  /**
+   * @brief Power on reset
+   */
+  void reset() {
+    _status = core::DeviceStatus{};
+    _header_id = 0;
+    _ctrl_flags = 0;
+    _cycle_cnt = 0;
+    _sync0_aligned = false;
+    _image_applied = false;
+    _cycle_cnt_held = false;
+    _held_cycle_cnt = 0;
+    _sync0_load_time = 0;
+    _apply_at_time = 0;
+  }
+
+  /**
+   * @brief Process the frame in the output buffers, which is called when the outputs are written in OP
+   * @param header GlobalHeader in the output buffer
+   * @param body body in the output buffer
+   * @param sys_time system time of the distributed clocks in ns
+   */
+  void receive(const uint8_t* header, const uint8_t* body, const uint64_t sys_time) {
+    if (!_sync0_aligned) align_sync0(sys_time);
+
+    const auto msg_id = header[0];
+    if (msg_id == _header_id) return;
+    _header_id = msg_id;
+
+    const auto control_flags = header[1];
+    const auto cmd = static_cast<core::COMMAND>(header[2]);
+    const auto* pad = header + 3;
+    if (cmd == core::COMMAND::COMMAND_LIST) {
+      const auto n = std::min<size_t>(pad[0], core::COMMAND_LIST_MAX);
+      for (size_t i = 0; i < n; i++) {
+        const auto list_cmd = static_cast<core::COMMAND>(pad[1 + 2 * i]);
+        const auto offset = static_cast<size_t>(pad[2 + 2 * i]);
+        if (offset + payload_words(list_cmd) > core::NUM_TRANS_IN_UNIT) continue;
+        execute(list_cmd, msg_id, body + 2 * offset, sys_time);
+      }
+      set_ack(msg_id, 0);
+    } else {
+      execute(cmd, msg_id, body, sys_time);
+    }
+
+    if (control_flags & core::HEADER_FLAG_APPLY) {
+      if (control_flags & core::HEADER_FLAG_APPLY_AT) {
+        uint64_t time = 0;
+        for (size_t i = 0; i < sizeof(uint64_t); i++) time |= static_cast<uint64_t>(pad[core::APPLY_TIME_OFFSET + i]) << (8 * i);
+        apply_at(time, sys_time);
+      } else {
+        apply(0, sys_time);
+      }
+    }
+
+    std::copy_backward(_status.ack_history.begin(), _status.ack_history.end() - 1, _status.ack_history.end());
+    _status.ack_history[0] = msg_id;
+  }
+
+  /**
+   * @brief Write the input data of core::EC_INPUT_FRAME_SIZE bytes
+   */
+  void input(uint8_t* dst) {
+    _status.ctrl_flags = _ctrl_flags;
+    _status.cycle = _cycle_cnt;
+    std::memcpy(dst, &_status, sizeof(core::DeviceStatus));
+  }
+
+  void set_thermal_alert(const bool alert) {
+    if (alert)
+      _status.fpga_info |= core::FPGA_INFO_THERMO;
+    else
+      _status.fpga_info &= static_cast<uint8_t>(~core::FPGA_INFO_THERMO);
+  }
+
+ private:
+  // number of 16 bit words of the payload read by the command
+  static size_t payload_words(const core::COMMAND cmd) {
+    switch (cmd) {
+      case core::COMMAND::WRITE_DUTY:
+      case core::COMMAND::WRITE_PHASE:
+        return core::NUM_TRANS_IN_UNIT;
+      case core::COMMAND::SEQ_FOCI_MODE:
+        return 9;
+      case core::COMMAND::ULTRASOUND_CYCLE_CNT:
+        return 1;
+      case core::COMMAND::GLOBAL_PARAMS:
+        return 2;
+      default:
+        return 0;
+    }
+  }
+
+  // SYNC0 fires every 40 ultrasound periods, and the FPGA base clock is 5 ns
+  [[nodiscard]] uint64_t sync0_cycle_ns() const { return static_cast<uint64_t>(_cycle_cnt) * core::FPGA_BASE_CLK_PERIOD_NS * 40; }
+
+  void set_ack(const uint8_t msg_id, const uint8_t data) {
+    _status.msg_id = msg_id;
+    _status.ack_data = data;
+  }
+
+  void execute(const core::COMMAND cmd, const uint8_t msg_id, const uint8_t* data, const uint64_t sys_time) {
+    switch (cmd) {
+      case core::COMMAND::WRITE_DUTY:
+      case core::COMMAND::WRITE_PHASE:
+      case core::COMMAND::GLOBAL_PARAMS:
+        set_ack(msg_id, 0);
+        break;
+      case core::COMMAND::SEQ_FOCI_MODE:
+        cancel_schedule(sys_time);
+        commit_cycle_cnt(sys_time);
+        _image_applied = true;
+        _ctrl_flags ^= core::CTRL_FLAG_BANK;
+        _ctrl_flags |= core::CTRL_FLAG_FOCUS_MODE;
+        set_ack(msg_id, 0);
+        break;
+      case core::COMMAND::PAUSE:
+        _ctrl_flags |= core::CTRL_FLAG_PAUSE;
+        set_ack(msg_id, 0);
+        break;
+      case core::COMMAND::RESUME:
+        _ctrl_flags &= static_cast<uint8_t>(~core::CTRL_FLAG_PAUSE);
+        set_ack(msg_id, 0);
+        break;
+      case core::COMMAND::ULTRASOUND_CYCLE_CNT:
+        _held_cycle_cnt = static_cast<uint16_t>(data[0] | data[1] << 8);
+        _cycle_cnt_held = true;
+        if (!_image_applied) commit_cycle_cnt(sys_time);
+        set_ack(msg_id, 0);
+        break;
+      case core::COMMAND::READ_CPU_VER_LSB:
+        set_ack(msg_id, static_cast<uint8_t>(CPU_VERSION));
+        break;
+      case core::COMMAND::READ_CPU_VER_MSB:
+        set_ack(msg_id, static_cast<uint8_t>(CPU_VERSION >> 8));
+        break;
+      case core::COMMAND::READ_FPGA_VER_LSB:
+        set_ack(msg_id, static_cast<uint8_t>(FPGA_VERSION));
+        break;
+      case core::COMMAND::READ_FPGA_VER_MSB:
+        set_ack(msg_id, static_cast<uint8_t>(FPGA_VERSION >> 8));
+        break;
+      case core::COMMAND::CLEAR:
+        _ctrl_flags &= CTRL_FLAG_SYNC0_LOAD;
+        _cycle_cnt = 0;
+        _sync0_aligned = false;
+        _image_applied = false;
+        _cycle_cnt_held = false;
+        break;
+      default:
+        break;
+    }
+  }
+
+  void cancel_schedule(const uint64_t sys_time) {
+    if ((_ctrl_flags & core::CTRL_FLAG_APPLY_AT) && sys_time < _apply_at_time) _ctrl_flags ^= core::CTRL_FLAG_BANK;
+    _ctrl_flags &= static_cast<uint8_t>(~core::CTRL_FLAG_APPLY_AT);
+  }
+
+  // While an image is output, a new cycle count is held until the next image is applied
+  void commit_cycle_cnt(const uint64_t sys_time) {
+    if (!_cycle_cnt_held) return;
+    _cycle_cnt_held = false;
+    _cycle_cnt = _held_cycle_cnt;
+    _sync0_aligned = false;
+    align_sync0(sys_time);
+  }
+
+  void apply(const uint8_t flags, const uint64_t sys_time) {
+    cancel_schedule(sys_time);
+    commit_cycle_cnt(sys_time);
+    _image_applied = true;
+    _ctrl_flags ^= core::CTRL_FLAG_BANK;
+    _ctrl_flags &= static_cast<uint8_t>(~core::CTRL_FLAG_FOCUS_MODE);
+    _ctrl_flags |= flags;
+  }
+
+  // The SYNC0 counter of the FPGA is loaded at the next SYNC0 edge, unless the edge is too close
+  void align_sync0(const uint64_t sys_time) {
+    if (_cycle_cnt == 0) return;
+    const auto cycle_ns = sync0_cycle_ns();
+    const auto r = sys_time % cycle_ns;
+    if (r < SYNC0_ALIGN_MARGIN_NS || r + SYNC0_ALIGN_MARGIN_NS > cycle_ns) return;
+
+    const auto next = sys_time / cycle_ns + 1;
+    if (sys_time >= _sync0_load_time) _ctrl_flags ^= CTRL_FLAG_SYNC0_LOAD;
+    _sync0_load_time = next * cycle_ns;
+    _sync0_aligned = true;
+  }
+
+  void apply_at(const uint64_t time, const uint64_t sys_time) {
+    commit_cycle_cnt(sys_time);
+    if (!_sync0_aligned) align_sync0(sys_time);
+    if (!_sync0_aligned || time <= sys_time) {
+      apply(0, sys_time);
+      return;
+    }
+    const auto cycle_ns = sync0_cycle_ns();
+    apply(core::CTRL_FLAG_APPLY_AT, sys_time);
+    _apply_at_time = (time + cycle_ns - 1) / cycle_ns * cycle_ns;
+  }
+
+  core::DeviceStatus _status{};
+  uint8_t _header_id = 0;
+  uint8_t _ctrl_flags = 0;
+  uint16_t _cycle_cnt = 0;
+  bool _sync0_aligned = false;
+  bool _image_applied = false;
+  bool _cycle_cnt_held = false;
+  uint16_t _held_cycle_cnt = 0;
+  uint64_t _sync0_load_time = 0;
+  uint64_t _apply_at_time = 0;
+};
+
+}  // namespace autd::sim
@@ -0,0 +1,130 @@
+// File: main.cpp
+// Project: soem_sim
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+// autd3_slave_sim simulates a chain of AUTDs on a network interface, typically one end of a veth pair whose other end is used by the SOEM link.
+// usage: autd3_slave_sim <ifname> <num_devices>
+// The faults are injected by the commands from stdin, one per line. The devices are indexed from 0.
+// After the end of stdin, the simulation continues until SIGINT or SIGTERM.
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "slave_chain.hpp"
+
+namespace {
+std::atomic<bool> stop_requested(false);
+void request_stop(int) { stop_requested.store(true, std::memory_order_release); }
+
+template <typename T>
+T arg(std::stringstream& ss) {
+  T v{};
+  if (!(ss >> v)) throw std::invalid_argument("invalid argument");
+  return v;
+}
+
+void print_help() {
+  std::cout << "commands:\n"
+               "  unplug <dev_idx>        disconnect the input of dev_idx and the following devices\n"
+               "  plug                    reconnect all the devices\n"
+               "  reset <dev_idx>         power cycle a device\n"
+               "  error <dev_idx> [code]  set the error indicator with AL status code (default 0x001A)\n"
+               "  thermo <dev_idx> <0|1>  set the thermal alert\n"
+               "  drop <rate>             lose frames with probability rate\n"
+               "  delay <us>              delay returning frames\n"
+               "  status                  print AL status of the devices\n"
+               "  stats                   print the cycle intervals since the last stats, and clear them\n"
+               "  quit"
+            << std::endl;
+}
+
+void print_status(autd::sim::SlaveChain& chain) {
+  const auto status = chain.al_status();
+  for (size_t i = 0; i < status.size(); i++)
+    std::cout << i << ": AL status 0x" << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(status[i]) << std::dec
+              << std::setfill(' ') << std::endl;
+}
+
+void print_stats(autd::sim::SlaveChain& chain) {
+  const auto [cycles, mean, p50, p99, max] = chain.cycle_stats(true);
+  std::cout << std::fixed << std::setprecision(1) << cycles << " cycles, interval " << mean << " us, jitter p50/p99/max " << p50 << "/" << p99
+            << "/" << max << " us" << std::endl;
+}
+}  // namespace
+
+int main(const int argc, char* argv[]) try {
+  if (argc < 3) {
+    std::cerr << "usage: " << argv[0] << " <ifname> <num_devices>" << std::endl;
+    return EINVAL;
+  }
+
+  std::signal(SIGINT, request_stop);
+  std::signal(SIGTERM, request_stop);
+
+  autd::sim::SlaveChain chain(argv[1], static_cast<size_t>(std::stoul(argv[2])));
+  std::cout << "autd3_slave_sim: " << chain.num_devices() << " devices on " << argv[1] << std::endl;
+
+  auto quit = false;
+  std::string line;
+  while (!quit && std::getline(std::cin, line)) {
+    std::stringstream ss(line);
+    std::string cmd;
+    if (!(ss >> cmd)) continue;
+    try {
+      if (cmd == "unplug") {
+        chain.unplug(arg<size_t>(ss));
+      } else if (cmd == "plug") {
+        chain.plug();
+      } else if (cmd == "reset") {
+        chain.reset(arg<size_t>(ss));
+      } else if (cmd == "error") {
+        const auto dev_idx = arg<size_t>(ss);
+        std::string code;
+        if (ss >> code)
+          chain.set_error(dev_idx, static_cast<uint16_t>(std::stoul(code, nullptr, 0)));
+        else
+          chain.set_error(dev_idx);
+      } else if (cmd == "thermo") {
+        const auto dev_idx = arg<size_t>(ss);
+        chain.set_thermal_alert(dev_idx, arg<int>(ss) != 0);
+      } else if (cmd == "drop") {
+        chain.set_drop_rate(arg<double>(ss));
+      } else if (cmd == "delay") {
+        chain.set_delay_us(arg<uint32_t>(ss));
+      } else if (cmd == "status") {
+        print_status(chain);
+      } else if (cmd == "stats") {
+        print_stats(chain);
+      } else if (cmd == "quit") {
+        quit = true;
+      } else {
+        print_help();
+      }
+    } catch (std::exception& e) {
+      std::cerr << e.what() << std::endl;
+    }
+  }
+
+  while (!quit && !stop_requested.load(std::memory_order_acquire)) std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  print_stats(chain);
+  return 0;
+} catch (std::exception& e) {
+  std::cerr << e.what() << std::endl;
+  return ENXIO;
+}
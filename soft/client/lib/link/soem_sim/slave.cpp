@@ -0,0 +1,467 @@
+// File: slave.cpp
+// Project: soem_sim
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#include "slave.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+
+#include "autd3-freq-shift/core/ec_config.hpp"
+
+namespace autd::sim {
+
+namespace {
+
+constexpr uint16_t REG_TYPE = 0x0000;
+constexpr uint16_t REG_FMMU_NUM = 0x0004;
+constexpr uint16_t REG_SM_NUM = 0x0005;
+constexpr uint16_t REG_RAM_SIZE = 0x0006;
+constexpr uint16_t REG_PORT_DESC = 0x0007;
+constexpr uint16_t REG_FEATURES = 0x0008;
+constexpr uint16_t REG_ALIAS = 0x0012;
+constexpr uint16_t REG_DL_STATUS = 0x0110;
+constexpr uint16_t REG_AL_CTRL = 0x0120;
+constexpr uint16_t REG_AL_STATUS_CODE = 0x0134;
+constexpr uint16_t REG_PDI_CTRL = 0x0140;
+constexpr uint16_t REG_EEP_CTRL = 0x0502;
+constexpr uint16_t REG_EEP_ADDR = 0x0504;
+constexpr uint16_t REG_EEP_DATA = 0x0508;
+constexpr uint16_t REG_FMMU = 0x0600;
+constexpr uint16_t REG_SM = 0x0800;
+constexpr uint16_t REG_DC_RECV_TIME = 0x0900;
+constexpr uint16_t REG_DC_SYS_TIME = 0x0910;
+constexpr uint16_t REG_DC_RECV_TIME_PU = 0x0918;
+constexpr uint16_t REG_DC_SYS_OFFSET = 0x0920;
+
+constexpr uint8_t ESC_TYPE_ET1100 = 0x11;
+constexpr uint8_t NUM_FMMU = 8;
+constexpr uint8_t NUM_SM = 8;
+constexpr uint8_t PORT_DESC_MII_PORT_0_1 = 0x0F;
+constexpr uint16_t ESC_FEATURES = 0x01FC;  // DC available and 64 bit
+constexpr uint8_t PDI_ASYNC_UC_16BIT = 0x08;
+constexpr uint16_t EEP_STATUS_READ_8_BYTES = 1 << 6;
+constexpr uint16_t EEP_CMD_READ = 1;
+constexpr uint16_t EEP_CMD_WRITE = 2;
+constexpr size_t EEP_SIZE = 4096;
+
+constexpr uint8_t FMMU_TYPE_READ = 1 << 0;
+constexpr uint8_t FMMU_TYPE_WRITE = 1 << 1;
+
+/**
+ * @brief Sync managers defined in the SII: the body and the header of the outputs, and the inputs
+ */
+struct SyncManager {
+  uint16_t start;
+  uint16_t length;
+  uint8_t control;
+  uint8_t type;
+  uint16_t al_status_code;
+};
+constexpr uint8_t SM_TYPE_OUTPUTS = 3;
+constexpr uint8_t SM_TYPE_INPUTS = 4;
+constexpr std::array<SyncManager, 3> SYNC_MANAGERS = {
+    SyncManager{0x1000, core::NUM_TRANS_IN_UNIT * sizeof(uint16_t), 0x64, SM_TYPE_OUTPUTS, AL_STATUS_CODE_INVALID_OUTPUT_CONFIG},
+    SyncManager{0x1800, core::HEADER_SIZE, 0x64, SM_TYPE_OUTPUTS, AL_STATUS_CODE_INVALID_OUTPUT_CONFIG},
+    SyncManager{0x1C00, core::EC_INPUT_FRAME_SIZE, 0x20, SM_TYPE_INPUTS, AL_STATUS_CODE_INVALID_INPUT_CONFIG},
+};
+constexpr uint16_t BODY_ADDR = SYNC_MANAGERS[0].start;
+constexpr uint16_t HEADER_ADDR = SYNC_MANAGERS[1].start;
+constexpr uint16_t INPUT_ADDR = SYNC_MANAGERS[2].start;
+static_assert(SYNC_MANAGERS[0].length + SYNC_MANAGERS[1].length == core::EC_OUTPUT_FRAME_SIZE, "outputs must match the output frame of a device");
+
+constexpr uint32_t VENDOR_ID = 0x00000001;
+constexpr uint32_t PRODUCT_CODE = 0x00000001;
+constexpr uint32_t REVISION = 0x00000001;
+constexpr uint16_t SII_CAT_STRINGS = 10;
+constexpr uint16_t SII_CAT_GENERAL = 30;
+constexpr uint16_t SII_CAT_FMMU = 40;
+constexpr uint16_t SII_CAT_SYNC_M = 41;
+constexpr uint16_t SII_CAT_TXPDO = 50;
+constexpr uint16_t SII_CAT_RXPDO = 51;
+constexpr uint16_t SII_CAT_END = 0xFFFF;
+constexpr uint8_t SII_DATA_TYPE_UINT16 = 0x06;
+
+class SiiWriter {
+ public:
+  void u8(const uint8_t v) { _data.emplace_back(v); }
+  void u16(const uint16_t v) {
+    u8(static_cast<uint8_t>(v));
+    u8(static_cast<uint8_t>(v >> 8));
+  }
+  void u32(const uint32_t v) {
+    u16(static_cast<uint16_t>(v));
+    u16(static_cast<uint16_t>(v >> 16));
+  }
+  void category(const uint16_t type, const SiiWriter& body) {
+    auto data = body._data;
+    if (data.size() % 2 != 0) data.emplace_back(0);
+    u16(type);
+    u16(static_cast<uint16_t>(data.size() / 2));
+    _data.insert(_data.end(), data.begin(), data.end());
+  }
+  void pdo(const uint16_t index, const uint8_t sm, const uint16_t entry_index, const size_t num_entries) {
+    u16(index);
+    u8(static_cast<uint8_t>(num_entries));
+    u8(sm);
+    u8(0);   // synchronization
+    u8(0);   // name
+    u16(0);  // flags
+    for (size_t i = 0; i < num_entries; i++) {
+      u16(entry_index);
+      u8(static_cast<uint8_t>(i + 1));
+      u8(0);  // name
+      u8(SII_DATA_TYPE_UINT16);
+      u8(16);
+      u16(0);  // flags
+    }
+  }
+  std::vector<uint8_t>& data() { return _data; }
+
+ private:
+  std::vector<uint8_t> _data;
+};
+
+uint8_t sii_crc(const uint8_t* data, const size_t size) {
+  uint8_t crc = 0xFF;
+  for (size_t i = 0; i < size; i++) {
+    crc ^= data[i];
+    for (auto b = 0; b < 8; b++) crc = static_cast<uint8_t>(crc & 0x80 ? crc << 1 ^ 0x07 : crc << 1);
+  }
+  return crc;
+}
+
+/**
+ * @brief SII of an AUTD, which has no mailbox, and whose process data are described by the PDO categories
+ */
+std::vector<uint8_t> make_sii(const uint32_t serial) {
+  SiiWriter sii;
+  sii.u16(PDI_ASYNC_UC_16BIT);
+  for (auto i = 0; i < 6; i++) sii.u16(0);  // PDI configuration, sync impulse length, alias
+  sii.u16(sii_crc(sii.data().data(), sii.data().size()));
+  sii.u32(VENDOR_ID);
+  sii.u32(PRODUCT_CODE);
+  sii.u32(REVISION);
+  sii.u32(serial);
+  while (sii.data().size() < 0x3E * 2) sii.u16(0);  // bootstrap and standard mailboxes are not used
+  sii.u16(EEP_SIZE * 8 / 1024 - 1);
+  sii.u16(1);  // version
+
+  const std::string name = "AUTD";
+  SiiWriter strings;
+  strings.u8(1);
+  strings.u8(static_cast<uint8_t>(name.size()));
+  for (const auto c : name) strings.u8(static_cast<uint8_t>(c));
+  sii.category(SII_CAT_STRINGS, strings);
+
+  SiiWriter general;
+  general.u8(1);  // group
+  general.u8(0);  // image
+  general.u8(1);  // order
+  general.u8(1);  // name
+  for (auto i = 4; i < 16; i++) general.u8(0);
+  general.u16(0x0011);  // port 0 and 1 are MII
+  for (auto i = 18; i < 32; i++) general.u8(0);
+  sii.category(SII_CAT_GENERAL, general);
+
+  SiiWriter fmmu;
+  for (const uint8_t usage : {1, 1, 2, 3}) fmmu.u8(usage);  // outputs, outputs, inputs, sync manager status
+  sii.category(SII_CAT_FMMU, fmmu);
+
+  SiiWriter sm;
+  for (const auto& s : SYNC_MANAGERS) {
+    sm.u16(s.start);
+    sm.u16(s.length);
+    sm.u8(s.control);
+    sm.u8(0);
+    sm.u8(1);  // enable
+    sm.u8(s.type);
+  }
+  sii.category(SII_CAT_SYNC_M, sm);
+
+  SiiWriter tx_pdo;
+  tx_pdo.pdo(0x1A00, 2, 0x6000, SYNC_MANAGERS[2].length / 2);
+  sii.category(SII_CAT_TXPDO, tx_pdo);
+
+  SiiWriter rx_pdo;
+  rx_pdo.pdo(0x1600, 0, 0x7000, SYNC_MANAGERS[0].length / 2);
+  rx_pdo.pdo(0x1601, 1, 0x7001, SYNC_MANAGERS[1].length / 2);
+  sii.category(SII_CAT_RXPDO, rx_pdo);
+
+  sii.u16(SII_CAT_END);
+  auto data = sii.data();
+  data.resize(EEP_SIZE, 0xFF);
+  return data;
+}
+
+bool overlaps(const size_t addr, const size_t size, const size_t reg, const size_t reg_size) { return addr < reg + reg_size && reg < addr + size; }
+
+bool is_read_only(const size_t addr) {
+  return addr < Slave::REG_STATION_ADDR || (REG_DL_STATUS <= addr && addr < REG_DL_STATUS + 2) ||
+         (Slave::REG_AL_STATUS <= addr && addr < REG_AL_STATUS_CODE + 2) || (REG_DC_RECV_TIME <= addr && addr < REG_DC_SYS_OFFSET);
+}
+
+}  // namespace
+
+Slave::Slave(const uint32_t serial) : _clock_offset((serial + 1) * 1234567891ull), _sii(make_sii(serial)) { power_on(); }
+
+void Slave::power_on() {
+  _mem.fill(0);
+  _mem[REG_TYPE] = ESC_TYPE_ET1100;
+  _mem[REG_FMMU_NUM] = NUM_FMMU;
+  _mem[REG_SM_NUM] = NUM_SM;
+  _mem[REG_RAM_SIZE] = (MEMORY_SIZE - 0x1000) / 1024;
+  _mem[REG_PORT_DESC] = PORT_DESC_MII_PORT_0_1;
+  put16(REG_FEATURES, ESC_FEATURES);
+  put16(REG_ALIAS, static_cast<uint16_t>(_sii[8] | _sii[9] << 8));
+  _mem[REG_PDI_CTRL] = PDI_ASYNC_UC_16BIT;
+  put16(REG_EEP_CTRL, EEP_STATUS_READ_8_BYTES);
+  set_state(EC_STATE_INIT, 0);
+  _firmware.reset();
+  _outputs_written = false;
+  _last_outputs_ns = 0;
+}
+
+void Slave::put16(const size_t addr, const uint16_t v) {
+  _mem[addr] = static_cast<uint8_t>(v);
+  _mem[addr + 1] = static_cast<uint8_t>(v >> 8);
+}
+
+void Slave::put32(const size_t addr, const uint32_t v) {
+  put16(addr, static_cast<uint16_t>(v));
+  put16(addr + 2, static_cast<uint16_t>(v >> 16));
+}
+
+void Slave::put64(const size_t addr, const uint64_t v) {
+  put32(addr, static_cast<uint32_t>(v));
+  put32(addr + 4, static_cast<uint32_t>(v >> 32));
+}
+
+uint64_t Slave::get64(const size_t addr) const {
+  uint64_t v = 0;
+  for (size_t i = 0; i < sizeof(uint64_t); i++) v |= static_cast<uint64_t>(_mem[addr + i]) << (8 * i);
+  return v;
+}
+
+uint64_t Slave::sys_time() const { return local_time(_passage.arrival_ns) + get64(REG_DC_SYS_OFFSET); }
+
+void Slave::process(std::vector<Datagram>& datagrams, const Passage& passage) {
+  _passage = passage;
+  _outputs_written = false;
+  tick(passage.arrival_ns);
+
+  for (auto& d : datagrams) {
+    const auto station = station_address();
+    switch (d.cmd) {
+      case EC_CMD_APRD:
+      case EC_CMD_APWR:
+      case EC_CMD_APRW:
+        if (d.adp == 0) physical(d, d.cmd != EC_CMD_APWR, d.cmd != EC_CMD_APRD);
+        d.adp++;
+        break;
+      case EC_CMD_FPRD:
+      case EC_CMD_FPWR:
+      case EC_CMD_FPRW:
+        if (d.adp == station) physical(d, d.cmd != EC_CMD_FPWR, d.cmd != EC_CMD_FPRD);
+        break;
+      case EC_CMD_BRD:
+      case EC_CMD_BWR:
+      case EC_CMD_BRW:
+        physical(d, d.cmd != EC_CMD_BWR, d.cmd != EC_CMD_BRD);
+        d.adp++;
+        break;
+      case EC_CMD_LRD:
+      case EC_CMD_LWR:
+      case EC_CMD_LRW:
+        logical(d);
+        break;
+      case EC_CMD_ARMW:
+        physical(d, d.adp == 0, d.adp != 0);
+        d.adp++;
+        break;
+      case EC_CMD_FRMW:
+        physical(d, d.adp == station, d.adp != station);
+        break;
+      default:
+        break;
+    }
+  }
+
+  const auto state = static_cast<uint8_t>(_mem[REG_AL_STATUS] & 0x0F);
+  if (state < EC_STATE_SAFE_OP) return;
+  if (_outputs_written) {
+    _last_outputs_ns = passage.arrival_ns;
+    if (_mem[REG_AL_STATUS] == EC_STATE_OPERATIONAL) _firmware.receive(&_mem[HEADER_ADDR], &_mem[BODY_ADDR], sys_time());
+  }
+  _firmware.input(&_mem[INPUT_ADDR]);
+}
+
+void Slave::tick(const uint64_t now_ns) {
+  if (_mem[REG_AL_STATUS] == EC_STATE_OPERATIONAL && now_ns > _last_outputs_ns + PD_WATCHDOG_NS)
+    set_state(EC_STATE_SAFE_OP, AL_STATUS_CODE_SM_WATCHDOG);
+}
+
+void Slave::set_error(const uint16_t code) {
+  const auto state = static_cast<uint8_t>(_mem[REG_AL_STATUS] & 0x0F);
+  set_state(state == EC_STATE_OPERATIONAL ? EC_STATE_SAFE_OP : state, code);
+}
+
+void Slave::read(const uint16_t ado, uint8_t* dst, const size_t size, const bool bitwise_or) {
+  // DL status: PDI operational, link and communication on port 0, and on port 1 unless it is the end of the chain; port 2 and 3 are closed
+  uint16_t dl_status = 0x0001 | 0x0010 | 0x0200 | 0x1000 | 0x4000;
+  dl_status |= _passage.is_last ? 0x0400 : 0x0020 | 0x0800;
+  put16(REG_DL_STATUS, dl_status);
+  put64(REG_DC_SYS_TIME, sys_time());
+
+  for (size_t i = 0; i < size; i++) {
+    const auto addr = static_cast<size_t>(ado) + i;
+    const auto v = addr < MEMORY_SIZE ? _mem[addr] : static_cast<uint8_t>(0);
+    dst[i] = bitwise_or ? static_cast<uint8_t>(dst[i] | v) : v;
+  }
+}
+
+void Slave::write(const uint16_t ado, const uint8_t* src, const size_t size) {
+  for (size_t i = 0; i < size; i++)
+    if (const auto addr = static_cast<size_t>(ado) + i; addr < MEMORY_SIZE && !is_read_only(addr)) _mem[addr] = src[i];
+
+  if (overlaps(ado, size, REG_AL_CTRL, 2)) on_al_control();
+  if (overlaps(ado, size, REG_EEP_CTRL, 2)) on_eeprom_command();
+  if (overlaps(ado, size, REG_DC_RECV_TIME, 4)) latch_receive_times();
+  if (overlaps(ado, size, BODY_ADDR, SYNC_MANAGERS[0].length) || overlaps(ado, size, HEADER_ADDR, SYNC_MANAGERS[1].length)) _outputs_written = true;
+}
+
+void Slave::physical(Datagram& d, const bool rd, const bool wr) {
+  if (rd && wr) {
+    std::vector<uint8_t> tmp(d.size);
+    read(d.ado, tmp.data(), d.size, false);
+    write(d.ado, d.data, d.size);
+    std::memcpy(d.data, tmp.data(), d.size);
+    d.wkc += 3;
+  } else if (rd) {
+    read(d.ado, d.data, d.size, d.cmd == EC_CMD_BRD);
+    d.wkc += 1;
+  } else if (wr) {
+    write(d.ado, d.data, d.size);
+    d.wkc += 1;
+  }
+}
+
+void Slave::logical(Datagram& d) {
+  // the slave stack enables the sync managers of the process data in SAFE_OP and OP
+  if ((_mem[REG_AL_STATUS] & 0x0F) < EC_STATE_SAFE_OP) return;
+
+  const auto address = static_cast<uint64_t>(d.adp) | static_cast<uint64_t>(d.ado) << 16;
+  auto rd = false;
+  auto wr = false;
+  for (size_t f = 0; f < NUM_FMMU; f++) {
+    const auto reg = REG_FMMU + 16 * f;
+    if ((_mem[reg + 12] & 0x01) == 0) continue;
+    const auto log_start = static_cast<uint64_t>(get16(reg)) | static_cast<uint64_t>(get16(reg + 2)) << 16;
+    const auto begin = std::max(log_start, address);
+    const auto end = std::min(log_start + get16(reg + 4), address + d.size);
+    if (begin >= end) continue;
+
+    auto* data = d.data + (begin - address);
+    const auto phys = static_cast<uint16_t>(get16(reg + 8) + (begin - log_start));
+    const auto size = static_cast<size_t>(end - begin);
+    const auto type = _mem[reg + 11];
+    if ((type & FMMU_TYPE_READ) && (d.cmd == EC_CMD_LRD || d.cmd == EC_CMD_LRW)) {
+      read(phys, data, size, false);
+      rd = true;
+    } else if ((type & FMMU_TYPE_WRITE) && (d.cmd == EC_CMD_LWR || d.cmd == EC_CMD_LRW)) {
+      write(phys, data, size);
+      wr = true;
+    }
+  }
+  if (rd) d.wkc += 1;
+  if (wr) d.wkc += d.cmd == EC_CMD_LRW ? 2 : 1;
+}
+
+void Slave::on_al_control() {
+  const auto requested = static_cast<uint8_t>(_mem[REG_AL_CTRL] & 0x0F);
+  const auto ack = (_mem[REG_AL_CTRL] & EC_STATE_ERROR) != 0;
+  const auto status = _mem[REG_AL_STATUS];
+  const auto state = static_cast<uint8_t>(status & 0x0F);
+
+  if ((status & EC_STATE_ERROR) && !ack) return;
+
+  switch (requested) {
+    case EC_STATE_INIT:
+      set_state(EC_STATE_INIT, 0);
+      break;
+    case EC_STATE_PRE_OP:
+      set_state(EC_STATE_PRE_OP, 0);
+      break;
+    case EC_STATE_SAFE_OP:
+      if (state == EC_STATE_PRE_OP) {
+        uint16_t code = 0;
+        if (check_sync_managers(code))
+          set_state(EC_STATE_SAFE_OP, 0);
+        else
+          set_state(EC_STATE_PRE_OP, code);
+      } else if (state >= EC_STATE_SAFE_OP) {
+        set_state(EC_STATE_SAFE_OP, 0);
+      } else {
+        set_state(state, AL_STATUS_CODE_INVALID_STATE_CHANGE);
+      }
+      break;
+    case EC_STATE_OPERATIONAL:
+      if (state >= EC_STATE_SAFE_OP) {
+        if (state != EC_STATE_OPERATIONAL) _last_outputs_ns = _passage.arrival_ns;
+        set_state(EC_STATE_OPERATIONAL, 0);
+      } else {
+        set_state(state, AL_STATUS_CODE_INVALID_STATE_CHANGE);
+      }
+      break;
+    default:
+      set_state(state, AL_STATUS_CODE_INVALID_STATE_CHANGE);
+      break;
+  }
+}
+
+bool Slave::check_sync_managers(uint16_t& code) const {
+  for (size_t i = 0; i < SYNC_MANAGERS.size(); i++) {
+    const auto reg = REG_SM + 8 * i;
+    if (get16(reg) != SYNC_MANAGERS[i].start || get16(reg + 2) != SYNC_MANAGERS[i].length || (_mem[reg + 6] & 0x01) == 0) {
+      code = SYNC_MANAGERS[i].al_status_code;
+      return false;
+    }
+  }
+  return true;
+}
+
+void Slave::on_eeprom_command() {
+  const auto command = static_cast<uint16_t>((get16(REG_EEP_CTRL) >> 8) & 0x07);
+  const auto byte_addr = static_cast<size_t>(get16(REG_EEP_ADDR)) * 2;
+  if (command == EEP_CMD_READ) {
+    for (size_t i = 0; i < 8; i++) _mem[REG_EEP_DATA + i] = byte_addr + i < _sii.size() ? _sii[byte_addr + i] : 0xFF;
+  } else if (command == EEP_CMD_WRITE && byte_addr + 1 < _sii.size()) {
+    _sii[byte_addr] = _mem[REG_EEP_DATA];
+    _sii[byte_addr + 1] = _mem[REG_EEP_DATA + 1];
+  }
+  // the command completes immediately, so that the busy bit is never seen
+  put16(REG_EEP_CTRL, EEP_STATUS_READ_8_BYTES);
+}
+
+void Slave::latch_receive_times() {
+  const auto port0 = local_time(_passage.arrival_ns);
+  const auto port1 = _passage.is_last ? port0 : local_time(_passage.return_ns);
+  put32(REG_DC_RECV_TIME, static_cast<uint32_t>(port0));
+  put32(REG_DC_RECV_TIME + 4, static_cast<uint32_t>(port1));
+  put64(REG_DC_RECV_TIME_PU, port0);
+}
+
+void Slave::set_state(const uint8_t state, const uint16_t code) {
+  _mem[REG_AL_STATUS] = static_cast<uint8_t>(state | (code != 0 ? EC_STATE_ERROR : 0));
+  put16(REG_AL_STATUS_CODE, code);
+}
+
+}  // namespace autd::sim
@@ -0,0 +1,145 @@
+// File: slave.hpp
+// Project: soem_sim
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "firmware.hpp"
+
+namespace autd::sim {
+
+constexpr uint8_t EC_CMD_APRD = 0x01;
+constexpr uint8_t EC_CMD_APWR = 0x02;
+constexpr uint8_t EC_CMD_APRW = 0x03;
+constexpr uint8_t EC_CMD_FPRD = 0x04;
+constexpr uint8_t EC_CMD_FPWR = 0x05;
+constexpr uint8_t EC_CMD_FPRW = 0x06;
+constexpr uint8_t EC_CMD_BRD = 0x07;
+constexpr uint8_t EC_CMD_BWR = 0x08;
+constexpr uint8_t EC_CMD_BRW = 0x09;
+constexpr uint8_t EC_CMD_LRD = 0x0A;
+constexpr uint8_t EC_CMD_LWR = 0x0B;
+constexpr uint8_t EC_CMD_LRW = 0x0C;
+constexpr uint8_t EC_CMD_ARMW = 0x0D;
+constexpr uint8_t EC_CMD_FRMW = 0x0E;
+
+constexpr uint8_t EC_STATE_INIT = 0x01;
+constexpr uint8_t EC_STATE_PRE_OP = 0x02;
+constexpr uint8_t EC_STATE_SAFE_OP = 0x04;
+constexpr uint8_t EC_STATE_OPERATIONAL = 0x08;
+constexpr uint8_t EC_STATE_ERROR = 0x10;
+
+constexpr uint16_t AL_STATUS_CODE_INVALID_STATE_CHANGE = 0x0011;
+constexpr uint16_t AL_STATUS_CODE_SYNC_ERROR = 0x001A;
+constexpr uint16_t AL_STATUS_CODE_SM_WATCHDOG = 0x001B;
+constexpr uint16_t AL_STATUS_CODE_INVALID_OUTPUT_CONFIG = 0x001D;
+constexpr uint16_t AL_STATUS_CODE_INVALID_INPUT_CONFIG = 0x001E;
+
+/**
+ * @brief Time for which a datagram takes to pass a slave, which is used for the receive times of the ports
+ */
+constexpr uint64_t HOP_DELAY_NS = 1000;
+/**
+ * @brief Timeout of the process data watchdog, after which a slave in OP falls to SAFE_OP + ERROR
+ */
+constexpr uint64_t PD_WATCHDOG_NS = 100ull * 1000 * 1000;
+
+/**
+ * @brief EtherCAT datagram in a frame, which is passed through all the slaves
+ */
+struct Datagram {
+  uint8_t cmd;
+  uint16_t adp;
+  uint16_t ado;
+  uint8_t* data;
+  size_t size;
+  uint16_t wkc;
+};
+
+/**
+ * @brief Position of a slave in the chain when a frame passes it
+ */
+struct Passage {
+  uint64_t arrival_ns;  //!< host time at which the frame enters port 0
+  uint64_t return_ns;   //!< host time at which the frame returns to port 1
+  bool is_last;         //!< whether port 1 is closed
+};
+
+/**
+ * @brief EtherCAT slave controller of an AUTD (ET1100) with the firmware model behind its process data interface
+ * @details The registers, the AL state machine, the SII EEPROM interface, FMMUs and the distributed clocks are emulated at byte level,
+ * so that a master configures the slave in the same way as a real device. The process data are accessible in SAFE_OP and OP, and the
+ * firmware processes the outputs written in OP.
+ */
+class Slave {
+ public:
+  explicit Slave(uint32_t serial);
+
+  /**
+   * @brief Power on reset, after which the slave is in INIT without a configured address
+   */
+  void power_on();
+
+  /**
+   * @brief Process all the datagrams of a frame
+   */
+  void process(std::vector<Datagram>& datagrams, const Passage& passage);
+  /**
+   * @brief Check the process data watchdog
+   */
+  void tick(uint64_t now_ns);
+
+  void set_error(uint16_t code);
+  void set_thermal_alert(bool alert) { _firmware.set_thermal_alert(alert); }
+
+  [[nodiscard]] uint8_t al_status() const { return _mem[REG_AL_STATUS]; }
+  [[nodiscard]] uint16_t station_address() const { return get16(REG_STATION_ADDR); }
+
+  static constexpr size_t MEMORY_SIZE = 0x3000;  // registers and 8 KiB of process RAM
+  static constexpr uint16_t REG_STATION_ADDR = 0x0010;
+  static constexpr uint16_t REG_AL_STATUS = 0x0130;
+
+ private:
+  [[nodiscard]] uint16_t get16(size_t addr) const { return static_cast<uint16_t>(_mem[addr] | _mem[addr + 1] << 8); }
+  void put16(size_t addr, uint16_t v);
+  void put32(size_t addr, uint32_t v);
+  void put64(size_t addr, uint64_t v);
+  [[nodiscard]] uint64_t get64(size_t addr) const;
+
+  [[nodiscard]] uint64_t local_time(uint64_t host_ns) const { return host_ns + _clock_offset; }
+  [[nodiscard]] uint64_t sys_time() const;
+
+  void read(uint16_t ado, uint8_t* dst, size_t size, bool bitwise_or);
+  void write(uint16_t ado, const uint8_t* src, size_t size);
+  void physical(Datagram& d, bool rd, bool wr);
+  void logical(Datagram& d);
+
+  void on_al_control();
+  void on_eeprom_command();
+  void latch_receive_times();
+  void set_state(uint8_t state, uint16_t code);
+  [[nodiscard]] bool check_sync_managers(uint16_t& code) const;
+
+  uint64_t _clock_offset;
+  std::vector<uint8_t> _sii;
+  std::array<uint8_t, MEMORY_SIZE> _mem{};
+  Firmware _firmware;
+
+  Passage _passage{};
+  bool _outputs_written = false;
+  uint64_t _last_outputs_ns = 0;
+};
+
+}  // namespace autd::sim
@@ -0,0 +1,181 @@
+// File: slave_chain.cpp
+// Project: soem_sim
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#include "slave_chain.hpp"
+
+#include <time.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include "autd3-freq-shift/core/exception.hpp"
+#include "process_data.hpp"
+
+namespace autd::sim {
+
+namespace {
+constexpr size_t DATAGRAM_OFFSET = autdsoem::ETH_HEADER_SIZE + autdsoem::EC_HEADER_SIZE;
+constexpr uint32_t RECEIVE_TIMEOUT_US = 10 * 1000;
+constexpr size_t MAX_CYCLE_RECORDS = 1 << 20;
+
+uint64_t now_ns() {
+  timespec ts{};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + static_cast<uint64_t>(ts.tv_nsec);
+}
+
+uint16_t get16(const uint8_t* src) { return static_cast<uint16_t>(src[0] | src[1] << 8); }
+
+void put16(uint8_t* dst, const uint16_t v) {
+  dst[0] = static_cast<uint8_t>(v);
+  dst[1] = static_cast<uint8_t>(v >> 8);
+}
+}  // namespace
+
+SlaveChain::SlaveChain(const std::string& ifname, const size_t num_devices)
+    : _nic(autdsoem::create_packet_mmap_nic(ifname)), _connected(num_devices), _rng(std::random_device{}()) {
+  if (num_devices == 0) throw core::exception::LinkError("At least one device is required");
+  _slaves.reserve(num_devices);
+  for (size_t i = 0; i < num_devices; i++) _slaves.emplace_back(static_cast<uint32_t>(i));
+  _cycle_times.reserve(MAX_CYCLE_RECORDS);
+  _th = std::thread([this] { run(); });
+}
+
+SlaveChain::~SlaveChain() {
+  _stop.store(true);
+  if (_th.joinable()) _th.join();
+}
+
+void SlaveChain::unplug(const size_t dev_idx) {
+  std::lock_guard lk(_mtx);
+  _connected = std::min(dev_idx, _slaves.size());
+}
+
+void SlaveChain::plug() {
+  std::lock_guard lk(_mtx);
+  _connected = _slaves.size();
+}
+
+void SlaveChain::reset(const size_t dev_idx) {
+  std::lock_guard lk(_mtx);
+  _slaves.at(dev_idx).power_on();
+}
+
+void SlaveChain::set_error(const size_t dev_idx, const uint16_t code) {
+  std::lock_guard lk(_mtx);
+  _slaves.at(dev_idx).set_error(code);
+}
+
+void SlaveChain::set_thermal_alert(const size_t dev_idx, const bool alert) {
+  std::lock_guard lk(_mtx);
+  _slaves.at(dev_idx).set_thermal_alert(alert);
+}
+
+void SlaveChain::set_drop_rate(const double rate) {
+  std::lock_guard lk(_mtx);
+  _drop_rate = rate;
+}
+
+void SlaveChain::set_delay_us(const uint32_t delay_us) {
+  std::lock_guard lk(_mtx);
+  _delay_us = delay_us;
+}
+
+std::vector<uint8_t> SlaveChain::al_status() {
+  std::lock_guard lk(_mtx);
+  std::vector<uint8_t> status;
+  status.reserve(_slaves.size());
+  for (const auto& slave : _slaves) status.emplace_back(slave.al_status());
+  return status;
+}
+
+CycleStats SlaveChain::cycle_stats(const bool clear) {
+  std::lock_guard lk(_mtx);
+  CycleStats stats{_cycle_times.size(), 0.0, 0.0, 0.0, 0.0};
+  if (_cycle_times.size() > 1) {
+    std::vector<double> intervals;
+    intervals.reserve(_cycle_times.size() - 1);
+    for (size_t i = 1; i < _cycle_times.size(); i++) intervals.emplace_back(static_cast<double>(_cycle_times[i] - _cycle_times[i - 1]) / 1000.0);
+    stats.mean_us = static_cast<double>(_cycle_times.back() - _cycle_times.front()) / 1000.0 / static_cast<double>(intervals.size());
+    for (auto& interval : intervals) interval = std::abs(interval - stats.mean_us);
+    std::sort(intervals.begin(), intervals.end());
+    stats.jitter_p50_us = intervals[intervals.size() / 2];
+    stats.jitter_p99_us = intervals[intervals.size() * 99 / 100];
+    stats.jitter_max_us = intervals.back();
+  }
+  if (clear) _cycle_times.clear();
+  return stats;
+}
+
+void SlaveChain::run() {
+  while (!_stop.load()) {
+    _nic->receive([this](const uint8_t* frame, const size_t len) { return this->on_frame(frame, len); }, RECEIVE_TIMEOUT_US);
+    // the devices which do not see any frame still check the watchdog
+    std::lock_guard lk(_mtx);
+    const auto now = now_ns();
+    for (auto& slave : _slaves) slave.tick(now);
+  }
+}
+
+bool SlaveChain::on_frame(const uint8_t* frame, const size_t len) {
+  const auto now = now_ns();
+  std::lock_guard lk(_mtx);
+  if (len < DATAGRAM_OFFSET || len > autdsoem::ETH_FRAME_MAX_SIZE || _connected == 0) return false;
+  if (_drop_rate > 0.0 && std::uniform_real_distribution(0.0, 1.0)(_rng) < _drop_rate) return false;
+
+  auto* tx = _nic->frame_buffer();
+  std::memcpy(tx, frame, len);
+
+  _datagrams.clear();
+  const auto end = std::min(len, DATAGRAM_OFFSET + (get16(tx + autdsoem::ETH_HEADER_SIZE) & 0x07FF));
+  for (auto pos = DATAGRAM_OFFSET;;) {
+    if (pos + autdsoem::EC_DATAGRAM_HEADER_SIZE > end) return false;
+    const auto length = get16(tx + pos + 6);
+    const auto size = static_cast<size_t>(length & 0x07FF);
+    auto* data = tx + pos + autdsoem::EC_DATAGRAM_HEADER_SIZE;
+    if (pos + autdsoem::EC_DATAGRAM_HEADER_SIZE + size + autdsoem::EC_WKC_SIZE > end) return false;
+    _datagrams.emplace_back(Datagram{tx[pos], get16(tx + pos + 2), get16(tx + pos + 4), data, size, get16(data + size)});
+    if ((length & 0x8000) == 0) break;
+    pos += autdsoem::EC_DATAGRAM_HEADER_SIZE + size + autdsoem::EC_WKC_SIZE;
+  }
+
+  // a cycle begins with the frame which accesses the beginning of the process data image
+  for (const auto& d : _datagrams) {
+    if (d.cmd < EC_CMD_LRD || d.cmd > EC_CMD_LRW) continue;
+    const auto address = static_cast<uint32_t>(d.adp) | static_cast<uint32_t>(d.ado) << 16;
+    if (address < _cycle_address) {
+      _cycle_address = address;
+      _cycle_times.clear();
+    }
+    if (address == _cycle_address && _cycle_times.size() < MAX_CYCLE_RECORDS) _cycle_times.emplace_back(now);
+    break;
+  }
+
+  const auto last = _connected - 1;
+  for (size_t k = 0; k < _connected; k++)
+    _slaves[k].process(_datagrams, Passage{now + k * HOP_DELAY_NS, now + (2 * last - k) * HOP_DELAY_NS, k == last});
+
+  for (auto& d : _datagrams) {
+    put16(d.data - autdsoem::EC_DATAGRAM_HEADER_SIZE + 2, d.adp);
+    put16(d.data + d.size, d.wkc);
+  }
+  tx[6] |= 0x02;  // the first slave marks the source address as a real ESC does
+
+  if (_delay_us > 0)
+    while (now_ns() < now + static_cast<uint64_t>(_delay_us) * 1000) std::this_thread::yield();
+  _nic->send(len);
+  _nic->flush();
+  return false;
+}
+
+}  // namespace autd::sim
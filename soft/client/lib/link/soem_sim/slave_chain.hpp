@@ -0,0 +1,109 @@
+// File: slave_chain.hpp
+// Project: soem_sim
+// Created Date: 19/10/2026
+// Author: Shun Suzuki
+// -----
+// Last Modified: 19/10/2026
+// Modified By: Shun Suzuki (suzuki@hapis.k.u-tokyo.ac.jp)
+// -----
+// Copyright (c) 2021 Hapis Lab. All rights reserved.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "nic.hpp"
+#include "slave.hpp"
+
+namespace autd::sim {
+
+/**
+ * @brief Intervals between the cycles of the process data seen by the first slave
+ */
+struct CycleStats {
+  size_t cycles;
+  double mean_us;        //!< mean interval
+  double jitter_p50_us;  //!< deviation of the intervals from the mean
+  double jitter_p99_us;
+  double jitter_max_us;
+};
+
+/**
+ * @brief Chain of simulated AUTDs on a network interface (Linux only, root is required)
+ * @details Each received EtherCAT frame is passed through the connected slaves in order, and returned from the same interface.
+ * A master on the other end of a veth pair sees the chain as real devices.
+ * The faults are injected at any time from another thread. The devices are indexed from 0, i.e., dev_idx = SOEM slave number - 1.
+ */
+class SlaveChain {
+ public:
+  SlaveChain(const std::string& ifname, size_t num_devices);
+  ~SlaveChain();
+  SlaveChain(const SlaveChain& v) = delete;
+  SlaveChain& operator=(const SlaveChain& obj) = delete;
+  SlaveChain(SlaveChain&& obj) = delete;
+  SlaveChain& operator=(SlaveChain&& obj) = delete;
+
+  [[nodiscard]] size_t num_devices() const { return _slaves.size(); }
+
+  /**
+   * @brief Disconnect the cable on the input of dev_idx, so that it and the following devices do not see any frame
+   */
+  void unplug(size_t dev_idx);
+  /**
+   * @brief Reconnect all the devices
+   */
+  void plug();
+  /**
+   * @brief Power cycle a device
+   */
+  void reset(size_t dev_idx);
+  /**
+   * @brief Set the error indicator of a device with AL status code, and fall back to SAFE_OP if it is in OP
+   */
+  void set_error(size_t dev_idx, uint16_t code = AL_STATUS_CODE_SYNC_ERROR);
+  void set_thermal_alert(size_t dev_idx, bool alert);
+  /**
+   * @brief Probability with which a frame is lost
+   */
+  void set_drop_rate(double rate);
+  /**
+   * @brief Additional delay before a frame is returned
+   */
+  void set_delay_us(uint32_t delay_us);
+
+  /**
+   * @brief AL status of each device
+   */
+  [[nodiscard]] std::vector<uint8_t> al_status();
+  [[nodiscard]] CycleStats cycle_stats(bool clear);
+
+ private:
+  void run();
+  bool on_frame(const uint8_t* frame, size_t len);
+
+  std::unique_ptr<autdsoem::Nic> _nic;
+  std::vector<Slave> _slaves;
+  size_t _connected;
+  double _drop_rate = 0.0;
+  uint32_t _delay_us = 0;
+  std::mt19937 _rng;
+  std::vector<uint64_t> _cycle_times;
+  uint32_t _cycle_address = std::numeric_limits<uint32_t>::max();
+  std::vector<Datagram> _datagrams;
+
+  std::mutex _mtx;
+  std::atomic<bool> _stop{false};
+  std::thread _th;
+};
+
+}  // namespace autd::sim